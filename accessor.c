@@ -3,6 +3,48 @@
 
 #include "qmic.h"
 
+/* Set by -i, emitting the member accessors static inline in the header */
+bool accessor_inline;
+
+static const int simple_type_bits[] = {
+	[TYPE_U8] = 8,
+	[TYPE_U16] = 16,
+	[TYPE_U32] = 32,
+	[TYPE_U64] = 64,
+};
+
+/*
+ * Arrays of 256 elements or more are prefixed by a 16-bit element count, fixed
+ * size numeric arrays by none at all. Struct arrays are always counted, as the
+ * kernel encodes them as VAR_LEN_ARRAY whatever their declaration.
+ */
+static unsigned array_len_size(struct qmi_message_member *qmm)
+{
+	if (qmm->array_fixed && qmm->type != TYPE_STRUCT)
+		return 0;
+
+	return qmm->array_size >= 256 ? 2 : 1;
+}
+
+/*
+ * Storage class of the member accessors, and the lookups they use; the inline
+ * ones go through the lookups of qmi_tlv.h rather than calls into the runtime.
+ */
+static const char *accessor_storage(void)
+{
+	return accessor_inline ? "static inline " : "";
+}
+
+static const char *accessor_get(void)
+{
+	return accessor_inline ? "qmi_tlv_find_data" : "qmi_tlv_get";
+}
+
+static const char *accessor_get_array(void)
+{
+	return accessor_inline ? "qmi_tlv_find_array" : "qmi_tlv_get_array";
+}
+
 static void qmi_struct_header(FILE *fp, const char *package)
 {
 	struct qmi_struct_member *qsm;
@@ -12,8 +54,12 @@ static void qmi_struct_header(FILE *fp, const char *package)
 		fprintf(fp, "struct %s_%s {\n",
 			    package, qs->name);
 		list_for_each_entry(qsm, &qs->members, node) {
-			fprintf(fp, "\t%s %s;\n",
-				    sz_simple_types[qsm->type], qsm->name);
+			if (qsm->type == TYPE_STRING)
+				fprintf(fp, "\tchar %s[%d];\n",
+					    qsm->name, QMI_STRING_MAX + 1);
+			else
+				fprintf(fp, "\t%s %s;\n",
+					    sz_simple_types[qsm->type], qsm->name);
 		}
 		fprintf(fp, "};\n"
 			    "\n");
@@ -28,75 +74,125 @@ static void qmi_struct_emit_prototype(FILE *fp,
 			       struct qmi_struct *qs)
 {
 	if (array_size) {
-		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val, size_t count);\n",
+		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, const struct %1$s_%4$s *val, size_t count);\n",
+			    package, message, member, qs->name);
+
+		fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val, size_t count);\n",
 			    package, message, member, qs->name);
 
-		fprintf(fp, "struct %1$s_%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, size_t *count);\n\n",
+		fprintf(fp, "int %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, const struct %1$s_%4$s *val, size_t count);\n\n",
 			    package, message, member, qs->name);
 	} else {
-		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val);\n",
+		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, const struct %1$s_%4$s *val);\n",
 			    package, message, member, qs->name);
 
-		fprintf(fp, "struct %1$s_%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s);\n\n",
+		fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val);\n",
+			    package, message, member, qs->name);
+
+		fprintf(fp, "int %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, const struct %1$s_%4$s *val);\n\n",
 			    package, message, member, qs->name);
 	}
 }
 
+/* The _set_ or _replace_ accessor of a struct member, as per op */
+static void qmi_struct_emit_store(FILE *fp,
+				  const char *package,
+				  const char *message,
+				  struct qmi_message_member *qmm,
+				  const char *op)
+{
+	struct qmi_struct *qs = qmm->qmi_struct;
+
+	if (qmm->array_size)
+		fprintf(fp, "%7$sint %1$s_%2$s_%8$s_%3$s(struct %1$s_%2$s *%2$s, const struct %1$s_%4$s *val, size_t count)\n"
+			    "{\n"
+			    "	uint8_t *buf;\n"
+			    "	int len;\n"
+			    "	int ret;\n"
+			    "\n"
+			    "	if (count %10$s %9$d)\n"
+			    "		return -EINVAL;\n"
+			    "\n"
+			    "	len = %1$s_%4$s_pack_array(val, count, %6$d, &buf);\n"
+			    "	if (len < 0)\n"
+			    "		return len;\n"
+			    "\n"
+			    "	ret = qmi_tlv_%8$s((struct qmi_tlv*)%2$s, %5$d, buf, len);\n"
+			    "	free(buf);\n"
+			    "\n"
+			    "	return ret;\n"
+			    "}\n\n",
+			    package, message, qmm->name, qs->name, qmm->id, array_len_size(qmm),
+			    accessor_storage(), op, qmm->array_size, qmm->array_fixed ? "!=" : ">");
+	else
+		fprintf(fp, "%6$sint %1$s_%2$s_%7$s_%3$s(struct %1$s_%2$s *%2$s, const struct %1$s_%4$s *val)\n"
+			    "{\n"
+			    "	uint8_t buf[%8$d];\n"
+			    "	int len;\n"
+			    "\n"
+			    "	len = %1$s_%4$s_pack(val, buf);\n"
+			    "	if (len < 0)\n"
+			    "		return len;\n"
+			    "\n"
+			    "	return qmi_tlv_%7$s((struct qmi_tlv*)%2$s, %5$d, buf, len);\n"
+			    "}\n\n",
+			    package, message, qmm->name, qs->name, qmm->id, accessor_storage(),
+			    op, qmi_struct_max_size(qs));
+}
+
+/*
+ * Struct accessors pack the C struct into its wire encoding and unpack it
+ * back, through the helpers of qmi_struct_emit_codec(), so they work on any
+ * host and whatever the padding of the C struct. Arrays are packed into a
+ * temporary buffer, behind their count.
+ */
 static void qmi_struct_emit_accessors(FILE *fp,
 			       const char *package,
 			       const char *message,
-			       const char *member,
-			       int member_id,
-			       unsigned array_size,
-			       struct qmi_struct *qs)
+			       struct qmi_message_member *qmm)
 {
-	if (array_size) {
-		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val, size_t count)\n"
-			    "{\n"
-			    "	return qmi_tlv_set_array((struct qmi_tlv*)%2$s, %5$d, %6$d, val, count, sizeof(struct %1$s_%4$s));\n"
-			    "}\n\n",
-			    package, message, member, qs->name, member_id, array_size);
+	struct qmi_struct *qs = qmm->qmi_struct;
+
+	qmi_struct_emit_store(fp, package, message, qmm, "set");
 
-		fprintf(fp, "struct %1$s_%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, size_t *count)\n"
+	if (qmm->array_size)
+		fprintf(fp, "%7$sint %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val, size_t count)\n"
 			    "{\n"
-			    "	size_t size;\n"
 			    "	size_t len;\n"
 			    "	void *ptr;\n"
+			    "	int ret;\n"
 			    "\n"
-			    "	ptr = qmi_tlv_get_array((struct qmi_tlv*)%2$s, %5$d, %6$d, &len, &size);\n"
+			    "	ptr = %8$s((struct qmi_tlv*)%2$s, %5$d, &len);\n"
 			    "	if (!ptr)\n"
-			    "		return NULL;\n"
+			    "		return -ENOENT;\n"
 			    "\n"
-			    "	if (size != sizeof(struct %1$s_%4$s))\n"
-			    "		return NULL;\n"
+			    "	ret = %1$s_%4$s_unpack_array(val, count, %6$d, ptr, len);\n"
+			    "	if (ret %10$s %9$d)\n"
+			    "		return -EINVAL;\n"
 			    "\n"
-			    "	*count = len;\n"
-			    "	return ptr;\n"
+			    "	return ret;\n"
 			    "}\n\n",
-			    package, message, member, qs->name, member_id, array_size);
-	} else {
-		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val)\n"
-			    "{\n"
-			    "	return qmi_tlv_set((struct qmi_tlv*)%2$s, %5$d, val, sizeof(struct %1$s_%4$s));\n"
-			    "}\n\n",
-			    package, message, member, qs->name, member_id);
-
-		fprintf(fp, "struct %1$s_%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s)\n"
+			    package, message, qmm->name, qs->name, qmm->id, array_len_size(qmm),
+			    accessor_storage(), accessor_get(), qmm->array_size,
+			    qmm->array_fixed ? ">= 0 && ret !=" : ">");
+	else
+		fprintf(fp, "%6$sint %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, struct %1$s_%4$s *val)\n"
 			    "{\n"
 			    "	size_t len;\n"
 			    "	void *ptr;\n"
 			    "\n"
-			    "	ptr = qmi_tlv_get((struct qmi_tlv*)%2$s, %5$d, &len);\n"
+			    "	ptr = %7$s((struct qmi_tlv*)%2$s, %5$d, &len);\n"
 			    "	if (!ptr)\n"
-			    "		return NULL;\n"
+			    "		return -ENOENT;\n"
 			    "\n"
-			    "	if (len != sizeof(struct %1$s_%4$s))\n"
-			    "		return NULL;\n"
+			    "	if (%1$s_%4$s_unpack(val, ptr, len) != (int)len)\n"
+			    "		return -EINVAL;\n"
 			    "\n"
-			    "	return ptr;\n"
+			    "	return 0;\n"
 			    "}\n\n",
-			    package, message, member, qs->name, member_id);
-	}
+			    package, message, qmm->name, qs->name, qmm->id, accessor_storage(), accessor_get());
+
+	qmi_struct_emit_store(fp, package, message, qmm, "replace");
 }
 
 static void qmi_message_emit_message_type(FILE *fp,
@@ -124,7 +220,22 @@ static void qmi_message_emit_message_prototype(FILE *fp,
 	fprintf(fp, "void *%1$s_%2$s_encode(struct %1$s_%2$s *%2$s, size_t *len);\n",
 		    package, message);
 
-	fprintf(fp, "void %1$s_%2$s_free(struct %1$s_%2$s *%2$s);\n\n",
+	fprintf(fp, "void %1$s_%2$s_free(struct %1$s_%2$s *%2$s);\n",
+		    package, message);
+
+	fprintf(fp, "ssize_t %1$s_%2$s_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct %1$s_%2$s ***%2$s);\n",
+		    package, message);
+
+	fprintf(fp, "ssize_t %1$s_%2$s_encode_batch(struct %1$s_%2$s **%2$s, size_t count, void *buf, size_t size, size_t *lens);\n",
+		    package, message);
+
+	fprintf(fp, "void %1$s_%2$s_free_batch(struct %1$s_%2$s **%2$s, size_t count);\n",
+		    package, message);
+
+	fprintf(fp, "struct qmi_tlv_stream *%1$s_%2$s_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);\n",
+		    package, message);
+
+	fprintf(fp, "int %1$s_%2$s_diff(struct %1$s_%2$s *a, struct %1$s_%2$s *b, uint64_t changed[4]);\n\n",
 		    package, message);
 }
 
@@ -140,9 +251,9 @@ static void qmi_message_emit_message(FILE *fp,
 
 	fprintf(fp, "struct %1$s_%2$s *%1$s_%2$s_parse(void *buf, size_t len, unsigned *txn)\n"
 		    "{\n"
-		    "	return (struct %1$s_%2$s*)qmi_tlv_decode(buf, len, txn, %3$d);\n"
+		    "	return (struct %1$s_%2$s*)qmi_tlv_decode(buf, len, txn, %3$d, %4$d);\n"
 		    "}\n\n",
-		    package, qm->name, qm->type);
+		    package, qm->name, qm->msg_id, qm->type);
 
 	fprintf(fp, "void *%1$s_%2$s_encode(struct %1$s_%2$s *%2$s, size_t *len)\n"
 		    "{\n"
@@ -155,6 +266,50 @@ static void qmi_message_emit_message(FILE *fp,
 		    "	qmi_tlv_free((struct qmi_tlv*)%2$s);\n"
 		    "}\n\n",
 		    package, qm->name);
+
+	fprintf(fp, "ssize_t %1$s_%2$s_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct %1$s_%2$s ***%2$s)\n"
+		    "{\n"
+		    "	return qmi_tlv_decode_batch(bufs, lens, count, txns, %3$d, %4$d, (struct qmi_tlv***)%2$s);\n"
+		    "}\n\n",
+		    package, qm->name, qm->msg_id, qm->type);
+
+	fprintf(fp, "ssize_t %1$s_%2$s_encode_batch(struct %1$s_%2$s **%2$s, size_t count, void *buf, size_t size, size_t *lens)\n"
+		    "{\n"
+		    "	return qmi_tlv_encode_batch((struct qmi_tlv**)%2$s, count, buf, size, lens);\n"
+		    "}\n\n",
+		    package, qm->name);
+
+	fprintf(fp, "void %1$s_%2$s_free_batch(struct %1$s_%2$s **%2$s, size_t count)\n"
+		    "{\n"
+		    "	qmi_tlv_free_batch((struct qmi_tlv**)%2$s, count);\n"
+		    "}\n\n",
+		    package, qm->name);
+
+	fprintf(fp, "struct qmi_tlv_stream *%1$s_%2$s_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)\n"
+		    "{\n"
+		    "	return qmi_tlv_stream_init(%3$d, %4$d, txn, cb, ctx);\n"
+		    "}\n\n",
+		    package, qm->name, qm->msg_id, qm->type);
+
+	fprintf(fp, "int %1$s_%2$s_diff(struct %1$s_%2$s *a, struct %1$s_%2$s *b, uint64_t changed[4])\n"
+		    "{\n"
+		    "	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);\n"
+		    "}\n\n",
+		    package, qm->name);
+
+	fprintf(fp, "static void *%1$s_%2$s_parse_msg(void *buf, size_t len, unsigned *txn)\n"
+		    "{\n"
+		    "	return %1$s_%2$s_parse(buf, len, txn);\n"
+		    "}\n\n",
+		    package, qm->name);
+}
+
+static void qmi_message_emit_dispatch(FILE *fp,
+				      const char *package,
+				      struct qmi_message *qm)
+{
+	fprintf(fp, "\t\t.parse = %1$s_%2$s_parse_msg,\n",
+		    package, qm->name);
 }
 
 static void qmi_message_emit_simple_prototype(FILE *fp,
@@ -166,70 +321,148 @@ static void qmi_message_emit_simple_prototype(FILE *fp,
 		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, %4$s *val, size_t count);\n",
 			    package, message, qmm->name, sz_simple_types[qmm->type]);
 
-		fprintf(fp, "%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, size_t *count);\n\n",
+		fprintf(fp, "%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, size_t *count);\n",
+			    package, message, qmm->name, sz_simple_types[qmm->type]);
+
+		fprintf(fp, "int %1$s_%2$s_set_%3$s_copy(struct %1$s_%2$s *%2$s, const %4$s *val, size_t count);\n",
+			    package, message, qmm->name, sz_simple_types[qmm->type]);
+
+		fprintf(fp, "int %1$s_%2$s_get_%3$s_copy(struct %1$s_%2$s *%2$s, %4$s *val, size_t count);\n",
+			    package, message, qmm->name, sz_simple_types[qmm->type]);
+
+		fprintf(fp, "int %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, %4$s *val, size_t count);\n\n",
 			    package, message, qmm->name, sz_simple_types[qmm->type]);
 	} else {
 		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, %4$s val);\n",
 			    package, message, qmm->name, sz_simple_types[qmm->type]);
 
-		fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, %4$s *val);\n\n",
+		fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, %4$s *val);\n",
+			    package, message, qmm->name, sz_simple_types[qmm->type]);
+
+		fprintf(fp, "int %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, %4$s val);\n\n",
 			    package, message, qmm->name, sz_simple_types[qmm->type]);
 	}
 }
 
-
+/*
+ * The _get_ accessor of an array returns the wire data in place, in little
+ * endian order; _get_copy and _set_copy convert to and from host order.
+ */
 static void qmi_message_emit_simple_accessors(FILE *fp,
 					      const char *package,
 					      const char *message,
 					      struct qmi_message_member *qmm)
 {
 	if (qmm->array_size) {
-		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, %4$s *val, size_t count)\n"
+		fprintf(fp, "%7$sint %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, %4$s *val, size_t count)\n"
 			    "{\n"
+			    "	if (count %9$s %8$d)\n"
+			    "		return -EINVAL;\n"
+			    "\n"
 			    "	return qmi_tlv_set_array((struct qmi_tlv*)%2$s, %5$d, %6$d, val, count, sizeof(%4$s));\n"
 			    "}\n\n",
-			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, qmm->array_size);
+			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, array_len_size(qmm),
+			    accessor_storage(), qmm->array_size, qmm->array_fixed ? "!=" : ">");
 
-		fprintf(fp, "%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, size_t *count)\n"
+		fprintf(fp, "%7$s%4$s *%1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, size_t *count)\n"
 			    "{\n"
+			    "	size_t size = sizeof(%4$s);\n"
 			    "	%4$s *ptr;\n"
-			    "	size_t size;\n"
 			    "	size_t len;\n"
 			    "\n"
-			    "	ptr = qmi_tlv_get_array((struct qmi_tlv*)%2$s, %5$d, %6$d, &len, &size);\n"
+			    "	ptr = %8$s((struct qmi_tlv*)%2$s, %5$d, %6$d, &len, &size);\n"
 			    "	if (!ptr)\n"
 			    "		return NULL;\n"
-			    "\n"
-			    "	if (size != sizeof(%4$s))\n"
-			    "		return NULL;\n"
-			    "\n"
+			    "\n",
+			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, array_len_size(qmm),
+			    accessor_storage(), accessor_get_array());
+		if (qmm->array_fixed)
+			fprintf(fp, "	if (len != %d)\n"
+				    "		return NULL;\n",
+				    qmm->array_size);
+		else
+			fprintf(fp, "	if (len && size != sizeof(%s))\n"
+				    "		return NULL;\n",
+				    sz_simple_types[qmm->type]);
+		fprintf(fp, "\n"
 			    "	*count = len;\n"
 			    "	return ptr;\n"
+			    "}\n\n");
+
+		fprintf(fp, "%7$sint %1$s_%2$s_set_%3$s_copy(struct %1$s_%2$s *%2$s, const %4$s *val, size_t count)\n"
+			    "{\n"
+			    "	if (count %9$s %8$d)\n"
+			    "		return -EINVAL;\n"
+			    "\n"
+			    "	return qmi_tlv_set_le_array((struct qmi_tlv*)%2$s, %5$d, %6$d, val, count, sizeof(%4$s));\n"
+			    "}\n\n",
+			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, array_len_size(qmm),
+			    accessor_storage(), qmm->array_size, qmm->array_fixed ? "!=" : ">");
+
+		if (qmm->array_fixed)
+			fprintf(fp, "%7$sint %1$s_%2$s_get_%3$s_copy(struct %1$s_%2$s *%2$s, %4$s *val, size_t count)\n"
+				    "{\n"
+				    "	int ret;\n"
+				    "\n"
+				    "	ret = qmi_tlv_get_le_array((struct qmi_tlv*)%2$s, %5$d, %6$d, val, count, sizeof(%4$s));\n"
+				    "	if (ret >= 0 && ret != %8$d)\n"
+				    "		return -EINVAL;\n"
+				    "\n"
+				    "	return ret;\n"
+				    "}\n\n",
+				    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, array_len_size(qmm),
+				    accessor_storage(), qmm->array_size);
+		else
+			fprintf(fp, "%7$sint %1$s_%2$s_get_%3$s_copy(struct %1$s_%2$s *%2$s, %4$s *val, size_t count)\n"
+				    "{\n"
+				    "	return qmi_tlv_get_le_array((struct qmi_tlv*)%2$s, %5$d, %6$d, val, count, sizeof(%4$s));\n"
+				    "}\n\n",
+				    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, array_len_size(qmm),
+				    accessor_storage());
+
+		fprintf(fp, "%7$sint %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, %4$s *val, size_t count)\n"
+			    "{\n"
+			    "	if (count %9$s %8$d)\n"
+			    "		return -EINVAL;\n"
+			    "\n"
+			    "	return qmi_tlv_replace_array((struct qmi_tlv*)%2$s, %5$d, %6$d, val, count, sizeof(%4$s));\n"
 			    "}\n\n",
-			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, qmm->array_size);
+			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id, array_len_size(qmm),
+			    accessor_storage(), qmm->array_size, qmm->array_fixed ? "!=" : ">");
 	} else {
-		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, %4$s val)\n"
+		fprintf(fp, "%7$sint %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, %4$s val)\n"
 			    "{\n"
+			    "	val = qmi_cpu_to_le%6$d(val);\n"
 			    "	return qmi_tlv_set((struct qmi_tlv*)%2$s, %5$d, &val, sizeof(%4$s));\n"
 			    "}\n\n",
-			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id);
+			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id,
+			    simple_type_bits[qmm->type], accessor_storage());
 
-		fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, %4$s *val)\n"
+		fprintf(fp, "%7$sint %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, %4$s *val)\n"
 			    "{\n"
 			    "	%4$s *ptr;\n"
 			    "	size_t len;\n"
 			    "\n"
-			    "	ptr = qmi_tlv_get((struct qmi_tlv*)%2$s, %5$d, &len);\n"
+			    "	ptr = %8$s((struct qmi_tlv*)%2$s, %5$d, &len);\n"
 			    "	if (!ptr)\n"
 			    "		return -ENOENT;\n"
 			    "\n"
 			    "	if (len != sizeof(%4$s))\n"
 			    "		return -EINVAL;\n"
 			    "\n"
-			    "	*val = *(%4$s*)ptr;\n"
+			    "	*val = qmi_le%6$d_to_cpu(ptr);\n"
 			    "	return 0;\n"
 			    "}\n\n",
-			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id);
+			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id,
+			    simple_type_bits[qmm->type], accessor_storage(), accessor_get());
+
+		fprintf(fp, "%7$sint %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, %4$s val)\n"
+			    "{\n"
+			    "	val = qmi_cpu_to_le%6$d(val);\n"
+			    "	return qmi_tlv_replace((struct qmi_tlv*)%2$s, %5$d, &val, sizeof(%4$s));\n"
+			    "}\n\n",
+			    package, message, qmm->name, sz_simple_types[qmm->type], qmm->id,
+			    simple_type_bits[qmm->type], accessor_storage());
 	}
 }
 
@@ -245,7 +478,10 @@ static void qmi_message_emit_string_prototype(FILE *fp,
 		fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t len);\n",
 			    package, message, qmm->name);
 
-		fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t buflen);\n\n",
+		fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t buflen);\n",
+			    package, message, qmm->name);
+
+		fprintf(fp, "int %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t len);\n\n",
 			    package, message, qmm->name);
 	}
 }
@@ -255,18 +491,18 @@ static void qmi_message_emit_string_accessors(FILE *fp,
 					      const char *message,
 					      struct qmi_message_member *qmm)
 {
-	fprintf(fp, "int %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t len)\n"
+	fprintf(fp, "%5$sint %1$s_%2$s_set_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t len)\n"
 		    "{\n"
 		    "	return qmi_tlv_set((struct qmi_tlv*)%2$s, %4$d, buf, len);\n"
 		    "}\n\n",
-		    package, message, qmm->name, qmm->id);
+		    package, message, qmm->name, qmm->id, accessor_storage());
 
-	fprintf(fp, "int %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t buflen)\n"
+	fprintf(fp, "%5$sint %1$s_%2$s_get_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t buflen)\n"
 		    "{\n"
 		    "	size_t len;\n"
 		    "	char *ptr;\n"
 		    "\n"
-		    "	ptr = qmi_tlv_get((struct qmi_tlv*)%2$s, %4$d, &len);\n"
+		    "	ptr = %6$s((struct qmi_tlv*)%2$s, %4$d, &len);\n"
 		    "	if (!ptr)\n"
 		    "		return -ENOENT;\n"
 		    "\n"
@@ -277,40 +513,963 @@ static void qmi_message_emit_string_accessors(FILE *fp,
 		    "	buf[len] = '\\0';\n"
 		    "	return len;\n"
 		    "}\n\n",
-		    package, message, qmm->name, qmm->id);
+		    package, message, qmm->name, qmm->id, accessor_storage(), accessor_get());
+
+	fprintf(fp, "%5$sint %1$s_%2$s_replace_%3$s(struct %1$s_%2$s *%2$s, char *buf, size_t len)\n"
+		    "{\n"
+		    "	return qmi_tlv_replace((struct qmi_tlv*)%2$s, %4$d, buf, len);\n"
+		    "}\n\n",
+		    package, message, qmm->name, qmm->id, accessor_storage());
 
 }
 
-static void qmi_message_source(FILE *fp, const char *package)
+/*
+ * Load and store helpers for scalar TLVs, the wire data is little endian and
+ * not necessarily aligned. These compile down to plain loads and stores on
+ * little endian hosts.
+ */
+static void emit_le_helpers(FILE *fp)
+{
+	int bits;
+
+	for (bits = 8; bits <= 64; bits *= 2) {
+		fprintf(fp, "static inline uint%1$d_t qmi_le%1$d_to_cpu(const void *ptr)\n"
+			    "{\n"
+			    "	uint%1$d_t val;\n"
+			    "\n"
+			    "	memcpy(&val, ptr, sizeof(val));\n",
+			    bits);
+		if (bits > 8)
+			fprintf(fp, "#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__\n"
+				    "	val = __builtin_bswap%1$d(val);\n"
+				    "#endif\n",
+				    bits);
+		fprintf(fp, "	return val;\n"
+			    "}\n\n");
+
+		fprintf(fp, "static inline uint%1$d_t qmi_cpu_to_le%1$d(uint%1$d_t val)\n"
+			    "{\n",
+			    bits);
+		if (bits > 8)
+			fprintf(fp, "#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__\n"
+				    "	val = __builtin_bswap%1$d(val);\n"
+				    "#endif\n",
+				    bits);
+		fprintf(fp, "	return val;\n"
+			    "}\n\n");
+
+		fprintf(fp, "static inline void qmi_put_le%1$d(void *ptr, uint%1$d_t val)\n"
+			    "{\n"
+			    "	val = qmi_cpu_to_le%1$d(val);\n"
+			    "	memcpy(ptr, &val, sizeof(val));\n"
+			    "}\n\n",
+			    bits);
+	}
+}
+
+static bool qmi_message_has_simple_array(void)
 {
 	struct qmi_message_member *qmm;
 	struct qmi_message *qm;
 
+	list_for_each_entry(qm, &qmi_messages, node) {
+		list_for_each_entry(qmm, &qm->members, node) {
+			if (qmm->type <= TYPE_U64 && qmm->array_size)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Helpers backing the _copy accessors of numeric arrays. Wire data is little
+ * endian and possibly unaligned, so it's copied out to (or in from) a caller
+ * provided array; on little endian hosts this is a single memcpy(), otherwise
+ * a byte swapping loop simple enough for the compiler to vectorize.
+ */
+static void emit_le_array_helpers(FILE *fp)
+{
+	const char *storage = accessor_inline ? "static inline " : "static ";
+
+	fprintf(fp, "#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__\n"
+		    "%1$svoid qmi_swap_array(void *dst, const void *src, size_t count, size_t size)\n"
+		    "{\n"
+		    "	const uint8_t *s = src;\n"
+		    "	uint16_t v16;\n"
+		    "	uint32_t v32;\n"
+		    "	uint64_t v64;\n"
+		    "	size_t i;\n"
+		    "\n"
+		    "	switch (size) {\n"
+		    "	case 2:\n"
+		    "		for (i = 0; i < count; i++) {\n"
+		    "			memcpy(&v16, s + i * 2, 2);\n"
+		    "			((uint16_t*)dst)[i] = __builtin_bswap16(v16);\n"
+		    "		}\n"
+		    "		break;\n"
+		    "	case 4:\n"
+		    "		for (i = 0; i < count; i++) {\n"
+		    "			memcpy(&v32, s + i * 4, 4);\n"
+		    "			((uint32_t*)dst)[i] = __builtin_bswap32(v32);\n"
+		    "		}\n"
+		    "		break;\n"
+		    "	case 8:\n"
+		    "		for (i = 0; i < count; i++) {\n"
+		    "			memcpy(&v64, s + i * 8, 8);\n"
+		    "			((uint64_t*)dst)[i] = __builtin_bswap64(v64);\n"
+		    "		}\n"
+		    "		break;\n"
+		    "	default:\n"
+		    "		memcpy(dst, src, count * size);\n"
+		    "		break;\n"
+		    "	}\n"
+		    "}\n"
+		    "#endif\n"
+		    "\n",
+		    storage);
+
+	fprintf(fp, "%1$sint qmi_tlv_set_le_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, const void *val, size_t count, size_t size)\n"
+		    "{\n"
+		    "#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__\n"
+		    "	return qmi_tlv_set_array(tlv, id, len_size, (void*)val, count, size);\n"
+		    "#else\n"
+		    "	void *tmp;\n"
+		    "	int ret;\n"
+		    "\n"
+		    "	tmp = malloc(count * size);\n"
+		    "	if (!tmp && count)\n"
+		    "		return -ENOMEM;\n"
+		    "\n"
+		    "	qmi_swap_array(tmp, val, count, size);\n"
+		    "	ret = qmi_tlv_set_array(tlv, id, len_size, tmp, count, size);\n"
+		    "	free(tmp);\n"
+		    "\n"
+		    "	return ret;\n"
+		    "#endif\n"
+		    "}\n\n",
+		    storage);
+
+	fprintf(fp, "%1$sint qmi_tlv_get_le_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *val, size_t count, size_t size)\n"
+		    "{\n"
+		    "	size_t elem_size = size;\n"
+		    "	size_t len;\n"
+		    "	void *ptr;\n"
+		    "\n"
+		    "	ptr = %2$s(tlv, id, len_size, &len, &elem_size);\n"
+		    "	if (!ptr)\n"
+		    "		return -ENOENT;\n"
+		    "\n"
+		    "	if (len && elem_size != size)\n"
+		    "		return -EINVAL;\n"
+		    "\n"
+		    "	if (len > count)\n"
+		    "		return -ENOMEM;\n"
+		    "\n"
+		    "#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__\n"
+		    "	memcpy(val, ptr, len * size);\n"
+		    "#else\n"
+		    "	qmi_swap_array(val, ptr, len, size);\n"
+		    "#endif\n"
+		    "	return len;\n"
+		    "}\n\n",
+		    storage, accessor_get_array());
+}
+
+/*
+ * With -i the member accessors are static inline in the header, the helpers
+ * they use go along, guarded as several generated headers may be included.
+ */
+static void emit_inline_helpers(FILE *fp)
+{
+	fprintf(fp, "#ifndef __QMI_LE_HELPERS__\n"
+		    "#define __QMI_LE_HELPERS__\n");
+	emit_le_helpers(fp);
+	fprintf(fp, "#endif\n"
+		    "\n");
+
+	if (!qmi_message_has_simple_array())
+		return;
+
+	fprintf(fp, "#ifndef __QMI_LE_ARRAY_HELPERS__\n"
+		    "#define __QMI_LE_ARRAY_HELPERS__\n");
+	emit_le_array_helpers(fp);
+	fprintf(fp, "#endif\n"
+		    "\n");
+}
+
+/* C type of a member, as passed to the visitor callbacks */
+static void qmi_member_type(char *buf, size_t size, const char *package,
+			    struct qmi_message_member *qmm)
+{
+	if (qmm->type == TYPE_STRUCT)
+		snprintf(buf, size, "struct %s_%s", package, qmm->qmi_struct->name);
+	else
+		snprintf(buf, size, "%s", sz_simple_types[qmm->type]);
+}
+
+static void qmi_message_emit_visitor_prototype(FILE *fp,
+					       const char *package,
+					       struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	char type[256];
+
+	fprintf(fp, "struct %1$s_%2$s_visitor {\n",
+		    package, qm->name);
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		qmi_member_type(type, sizeof(type), package, qmm);
+
+		if (qmm->type == TYPE_STRING)
+			fprintf(fp, "\tint (*%s)(char *buf, size_t len, void *ctx);\n",
+				    qmm->name);
+		else if (qmm->type == TYPE_STRUCT)
+			fprintf(fp, "\tint (*%s)(const void *data, size_t len, size_t count, void *ctx);\n",
+				    qmm->name);
+		else if (qmm->array_size)
+			fprintf(fp, "\tint (*%s)(const %s *val, size_t count, void *ctx);\n",
+				    qmm->name, type);
+		else
+			fprintf(fp, "\tint (*%s)(%s val, void *ctx);\n",
+				    qmm->name, type);
+	}
+
+	fprintf(fp, "\tint (*unknown)(unsigned id, void *data, size_t len, void *ctx);\n"
+		    "};\n\n");
+
+	fprintf(fp, "int %1$s_%2$s_visit(struct %1$s_%2$s *%2$s, const struct %1$s_%2$s_visitor *visitor, void *ctx);\n\n",
+		    package, qm->name);
+}
+
+/* Checks the count of an array TLV, leaving it in count */
+static void qmi_message_emit_visitor_count(FILE *fp, struct qmi_message_member *qmm,
+					   unsigned len_size, const char *type)
+{
+	if (!len_size) {
+		fprintf(fp, "		count = %d;\n",
+			    qmm->array_size);
+		if (type)
+			fprintf(fp, "		if (len != count * sizeof(%s))\n"
+				    "			return -EINVAL;\n",
+				    type);
+		return;
+	}
+
+	fprintf(fp, "		if (len < %1$d)\n"
+		    "			return -EINVAL;\n"
+		    "		count = qmi_le%2$d_to_cpu(data);\n"
+		    "		if (count > %3$d)\n"
+		    "			return -EINVAL;\n",
+		    len_size, len_size * 8, qmm->array_size);
+	if (type)
+		fprintf(fp, "		if (len - %1$d != count * sizeof(%2$s))\n"
+			    "			return -EINVAL;\n",
+			    len_size, type);
+}
+
+/*
+ * The visitor walks the TLVs once, in wire order, dispatching each to the
+ * callback of its member after checking the size; unset callbacks are skipped.
+ * Numeric arrays are handed over in host byte order, copied to an aligned
+ * buffer on the stack unless they are bytes. Structs are handed over as their
+ * packed little endian wire data, with its length and element count.
+ */
+static void qmi_message_emit_visitor(FILE *fp,
+				     const char *package,
+				     struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	unsigned len_size;
+	unsigned size;
+	unsigned max;
+	char type[256];
+	char src[32];
+
+	fprintf(fp, "struct %1$s_%2$s_visit_ctx {\n"
+		    "	const struct %1$s_%2$s_visitor *visitor;\n"
+		    "	void *ctx;\n"
+		    "};\n\n",
+		    package, qm->name);
+
+	fprintf(fp, "static int %1$s_%2$s_visit_tlv(unsigned id, void *data, size_t len, void *ctx)\n"
+		    "{\n"
+		    "	struct %1$s_%2$s_visit_ctx *v = ctx;\n"
+		    "	const struct %1$s_%2$s_visitor *visitor = v->visitor;\n",
+		    package, qm->name);
+	list_for_each_entry(qmm, &qm->members, node) {
+		if (qmm->array_size && qmm->type != TYPE_STRING) {
+			fprintf(fp, "	size_t count;\n");
+			break;
+		}
+	}
+	fprintf(fp, "\n"
+		    "	switch (id) {\n");
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		qmi_member_type(type, sizeof(type), package, qmm);
+		len_size = qmm->array_size ? array_len_size(qmm) : 0;
+		if (len_size)
+			snprintf(src, sizeof(src), "(uint8_t*)data + %d", len_size);
+		else
+			snprintf(src, sizeof(src), "data");
+
+		/* Copied arrays get a block of their own, for the buffer */
+		if (qmm->array_size && qmm->type > TYPE_U8 && qmm->type <= TYPE_U64) {
+			size = simple_type_bits[qmm->type] / 8;
+			max = qmm->array_size < 65535 / size ? qmm->array_size : 65535 / size;
+
+			fprintf(fp, "	case %1$d: {\n"
+				    "		%3$s val[%4$d];\n"
+				    "\n"
+				    "		if (!visitor->%2$s)\n"
+				    "			return 0;\n",
+				    qmm->id, qmm->name, type, max);
+			qmi_message_emit_visitor_count(fp, qmm, len_size, type);
+			fprintf(fp, "#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__\n"
+				    "		memcpy(val, %1$s, count * sizeof(%2$s));\n"
+				    "#else\n"
+				    "		qmi_swap_array(val, %1$s, count, sizeof(%2$s));\n"
+				    "#endif\n"
+				    "		return visitor->%3$s(val, count, v->ctx);\n"
+				    "	}\n",
+				    src, type, qmm->name);
+			continue;
+		}
+
+		fprintf(fp, "	case %1$d:\n"
+			    "		if (!visitor->%2$s)\n"
+			    "			return 0;\n",
+			    qmm->id, qmm->name);
+
+		if (qmm->type == TYPE_STRING) {
+			fprintf(fp, "		return visitor->%1$s(data, len, v->ctx);\n",
+				    qmm->name);
+		} else if (qmm->type == TYPE_STRUCT && qmm->array_size) {
+			qmi_message_emit_visitor_count(fp, qmm, len_size, NULL);
+			fprintf(fp, "		return visitor->%1$s(%2$s, len - %3$d, count, v->ctx);\n",
+				    qmm->name, src, len_size);
+		} else if (qmm->type == TYPE_STRUCT) {
+			fprintf(fp, "		return visitor->%1$s(data, len, 1, v->ctx);\n",
+				    qmm->name);
+		} else if (qmm->array_size) {
+			qmi_message_emit_visitor_count(fp, qmm, len_size, type);
+			fprintf(fp, "		return visitor->%1$s(%2$s, count, v->ctx);\n",
+				    qmm->name, src);
+		} else {
+			fprintf(fp, "		if (len != sizeof(%1$s))\n"
+				    "			return -EINVAL;\n"
+				    "		return visitor->%2$s(qmi_le%3$d_to_cpu(data), v->ctx);\n",
+				    type, qmm->name, simple_type_bits[qmm->type]);
+		}
+	}
+
+	fprintf(fp, "	default:\n"
+		    "		if (!visitor->unknown)\n"
+		    "			return 0;\n"
+		    "		return visitor->unknown(id, data, len, v->ctx);\n"
+		    "	}\n"
+		    "}\n\n");
+
+	fprintf(fp, "int %1$s_%2$s_visit(struct %1$s_%2$s *%2$s, const struct %1$s_%2$s_visitor *visitor, void *ctx)\n"
+		    "{\n"
+		    "	struct %1$s_%2$s_visit_ctx v = { visitor, ctx };\n"
+		    "\n"
+		    "	return qmi_tlv_foreach((struct qmi_tlv*)%2$s, %1$s_%2$s_visit_tlv, &v);\n"
+		    "}\n\n",
+		    package, qm->name);
+}
+
+/* The inline accessors reach the bitmap directly, skipping the call */
+static void qmi_message_emit_present(FILE *fp, const char *message)
+{
+	if (accessor_inline)
+		fprintf(fp, "((struct qmi_tlv*)%s)->present", message);
+	else
+		fprintf(fp, "qmi_tlv_present((struct qmi_tlv*)%s)", message);
+}
+
+/*
+ * Presence tests against the bitmap the runtime fills in at decode time, so
+ * neither needs to scan the TLVs.
+ */
+static void qmi_message_emit_presence(FILE *fp,
+				      const char *package,
+				      struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	unsigned long long required[4];
+	bool first = true;
+	int i;
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		fprintf(fp, "static inline bool %1$s_%2$s_has_%3$s(struct %1$s_%2$s *%2$s)\n"
+			    "{\n"
+			    "	return ",
+			    package, qm->name, qmm->name);
+		qmi_message_emit_present(fp, qm->name);
+		fprintf(fp, "[%d] >> %d & 1;\n"
+			    "}\n\n",
+			    qmm->id / 64, qmm->id % 64);
+	}
+
+	fprintf(fp, "static inline bool %1$s_%2$s_missing_required(struct %1$s_%2$s *%2$s)\n"
+		    "{\n",
+		    package, qm->name);
+
+	if (!qmi_message_required(qm, required)) {
+		fprintf(fp, "	(void)%s;\n"
+			    "\n"
+			    "	return false;\n"
+			    "}\n\n",
+			    qm->name);
+		return;
+	}
+
+	fprintf(fp, "	const uint64_t *present = ");
+	qmi_message_emit_present(fp, qm->name);
+	fprintf(fp, ";\n"
+		    "\n"
+		    "	return ");
+
+	for (i = 0; i < 4; i++) {
+		if (!required[i])
+			continue;
+
+		fprintf(fp, "%1$s(present[%2$d] & 0x%3$llxULL) != 0x%3$llxULL",
+			    first ? "" : " ||\n	       ", i, required[i]);
+		first = false;
+	}
+
+	fprintf(fp, ";\n"
+		    "}\n\n");
+}
+
+static bool qmi_struct_in_messages(struct qmi_struct *qs)
+{
+	struct qmi_message_member *qmm;
+	struct qmi_message *qm;
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		list_for_each_entry(qmm, &qm->members, node) {
+			if (qmm->qmi_struct == qs)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static bool qmi_struct_has_string(struct qmi_struct *qs)
+{
+	struct qmi_struct_member *qsm;
+
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING)
+			return true;
+	}
+
+	return false;
+}
+
+static bool qmi_struct_in_arrays(struct qmi_struct *qs)
+{
+	struct qmi_message_member *qmm;
+	struct qmi_message *qm;
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		list_for_each_entry(qmm, &qm->members, node) {
+			if (qmm->qmi_struct == qs && qmm->array_size)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Packing and unpacking of the structs behind the struct accessors. Members
+ * go packed little endian in declaration order, strings behind a 2 byte
+ * length, as the kernel's elem_info encodes them. Packing to a NULL buffer
+ * only sizes the encoding; unpacking returns the bytes consumed, either one
+ * -EINVAL on an unterminated string or a struct running past len.
+ */
+static void qmi_struct_emit_codec(FILE *fp, const char *package)
+{
+	const char *storage = accessor_inline ? "static inline " : "static ";
+	struct qmi_struct_member *qsm;
+	struct qmi_struct *qs;
+	unsigned bits;
+
+	list_for_each_entry(qs, &qmi_structs, node) {
+		if (!qmi_struct_in_messages(qs))
+			continue;
+
+		fprintf(fp, "%3$sint %1$s_%2$s_pack(const struct %1$s_%2$s *val, uint8_t *buf)\n"
+			    "{\n"
+			    "	size_t offset = 0;\n",
+			    package, qs->name, storage);
+		if (qmi_struct_has_string(qs))
+			fprintf(fp, "	const char *end;\n"
+				    "	size_t n;\n");
+		fprintf(fp, "\n");
+
+		list_for_each_entry(qsm, &qs->members, node) {
+			if (qsm->type == TYPE_STRING) {
+				fprintf(fp, "	end = memchr(val->%1$s, '\\0', sizeof(val->%1$s));\n"
+					    "	if (!end)\n"
+					    "		return -EINVAL;\n"
+					    "	n = end - val->%1$s;\n"
+					    "	if (buf) {\n"
+					    "		qmi_put_le16(buf + offset, n);\n"
+					    "		memcpy(buf + offset + 2, val->%1$s, n);\n"
+					    "	}\n"
+					    "	offset += 2 + n;\n",
+					    qsm->name);
+				continue;
+			}
+
+			bits = simple_type_bits[qsm->type];
+			fprintf(fp, "	if (buf)\n"
+				    "		qmi_put_le%2$d(buf + offset, val->%1$s);\n"
+				    "	offset += %3$d;\n",
+				    qsm->name, bits, bits / 8);
+		}
+
+		fprintf(fp, "\n"
+			    "	return offset;\n"
+			    "}\n\n");
+
+		fprintf(fp, "%3$sint %1$s_%2$s_unpack(struct %1$s_%2$s *val, const uint8_t *data, size_t len)\n"
+			    "{\n"
+			    "	size_t offset = 0;\n",
+			    package, qs->name, storage);
+		if (qmi_struct_has_string(qs))
+			fprintf(fp, "	size_t n;\n");
+		fprintf(fp, "\n");
+
+		list_for_each_entry(qsm, &qs->members, node) {
+			if (qsm->type == TYPE_STRING) {
+				fprintf(fp, "	if (len - offset < 2)\n"
+					    "		return -EINVAL;\n"
+					    "	n = qmi_le16_to_cpu(data + offset);\n"
+					    "	if (n > %2$d || len - offset - 2 < n)\n"
+					    "		return -EINVAL;\n"
+					    "	memcpy(val->%1$s, data + offset + 2, n);\n"
+					    "	val->%1$s[n] = '\\0';\n"
+					    "	offset += 2 + n;\n",
+					    qsm->name, QMI_STRING_MAX);
+				continue;
+			}
+
+			bits = simple_type_bits[qsm->type];
+			fprintf(fp, "	if (len - offset < %3$d)\n"
+				    "		return -EINVAL;\n"
+				    "	val->%1$s = qmi_le%2$d_to_cpu(data + offset);\n"
+				    "	offset += %3$d;\n",
+				    qsm->name, bits, bits / 8);
+		}
+
+		fprintf(fp, "\n"
+			    "	return offset;\n"
+			    "}\n\n");
+
+		if (!qmi_struct_in_arrays(qs))
+			continue;
+
+		fprintf(fp, "%3$sint %1$s_%2$s_pack_array(const struct %1$s_%2$s *val, size_t count, unsigned len_size, uint8_t **buf)\n"
+			    "{\n"
+			    "	size_t size = len_size;\n"
+			    "	size_t i;\n"
+			    "	int ret;\n"
+			    "\n"
+			    "	for (i = 0; i < count; i++) {\n"
+			    "		ret = %1$s_%2$s_pack(&val[i], NULL);\n"
+			    "		if (ret < 0)\n"
+			    "			return ret;\n"
+			    "		size += ret;\n"
+			    "	}\n"
+			    "\n"
+			    "	if (size > UINT16_MAX)\n"
+			    "		return -EINVAL;\n"
+			    "\n"
+			    "	*buf = malloc(size);\n"
+			    "	if (!*buf)\n"
+			    "		return -ENOMEM;\n"
+			    "\n"
+			    "	if (len_size == 2)\n"
+			    "		qmi_put_le16(*buf, count);\n"
+			    "	else\n"
+			    "		qmi_put_le8(*buf, count);\n"
+			    "\n"
+			    "	size = len_size;\n"
+			    "	for (i = 0; i < count; i++)\n"
+			    "		size += %1$s_%2$s_pack(&val[i], *buf + size);\n"
+			    "\n"
+			    "	return size;\n"
+			    "}\n\n",
+			    package, qs->name, storage);
+
+		fprintf(fp, "%3$sint %1$s_%2$s_unpack_array(struct %1$s_%2$s *val, size_t count, unsigned len_size, const uint8_t *data, size_t len)\n"
+			    "{\n"
+			    "	size_t offset = len_size;\n"
+			    "	size_t n;\n"
+			    "	size_t i;\n"
+			    "	int ret;\n"
+			    "\n"
+			    "	if (len < len_size)\n"
+			    "		return -EINVAL;\n"
+			    "\n"
+			    "	n = len_size == 2 ? qmi_le16_to_cpu(data) : qmi_le8_to_cpu(data);\n"
+			    "	if (n > count)\n"
+			    "		return -ENOMEM;\n"
+			    "\n"
+			    "	for (i = 0; i < n; i++) {\n"
+			    "		ret = %1$s_%2$s_unpack(&val[i], data + offset, len - offset);\n"
+			    "		if (ret < 0)\n"
+			    "			return ret;\n"
+			    "		offset += ret;\n"
+			    "	}\n"
+			    "\n"
+			    "	if (offset != len)\n"
+			    "		return -EINVAL;\n"
+			    "\n"
+			    "	return n;\n"
+			    "}\n\n",
+			    package, qs->name, storage);
+	}
+}
+
+static const char *sz_json_types[] = {
+	[TYPE_U8] = "QMI_JSON_U8",
+	[TYPE_U16] = "QMI_JSON_U16",
+	[TYPE_U32] = "QMI_JSON_U32",
+	[TYPE_U64] = "QMI_JSON_U64",
+	[TYPE_STRING] = "QMI_JSON_STRING",
+	[TYPE_STRUCT] = "QMI_JSON_STRUCT",
+};
+
+/*
+ * Structs are rendered as objects, walking their members off the wire: packed
+ * little endian, with strings prefixed by a 2 byte length. Returns the number
+ * of bytes consumed, or -EINVAL if the struct runs past len.
+ */
+static void qmi_struct_emit_json(FILE *fp, const char *package)
+{
+	struct qmi_struct_member *qsm;
+	struct qmi_struct *qs;
+	unsigned size;
+
+	list_for_each_entry(qs, &qmi_structs, node) {
+		if (!qmi_struct_in_messages(qs))
+			continue;
+
+		fprintf(fp, "static int %1$s_%2$s_json(struct qmi_json *json, const uint8_t *data, size_t len)\n"
+			    "{\n"
+			    "	size_t offset = 0;\n",
+			    package, qs->name);
+		if (qmi_struct_has_string(qs))
+			fprintf(fp, "	size_t n;\n");
+		fprintf(fp, "\n"
+			    "	qmi_json_open(json, '{');\n");
+
+		list_for_each_entry(qsm, &qs->members, node) {
+			if (qsm->type == TYPE_STRING) {
+				fprintf(fp, "	if (len - offset < 2)\n"
+					    "		return -EINVAL;\n"
+					    "	n = qmi_le16_to_cpu(data + offset);\n"
+					    "	if (n > %2$d || len - offset - 2 < n)\n"
+					    "		return -EINVAL;\n"
+					    "	qmi_json_key(json, \"%1$s\");\n"
+					    "	qmi_json_string(json, data + offset + 2, n);\n"
+					    "	offset += 2 + n;\n",
+					    qsm->name, QMI_STRING_MAX);
+				continue;
+			}
+
+			size = simple_type_bits[qsm->type] / 8;
+			fprintf(fp, "	if (len - offset < %2$d)\n"
+				    "		return -EINVAL;\n"
+				    "	qmi_json_key(json, \"%1$s\");\n"
+				    "	qmi_json_uint(json, qmi_le%3$d_to_cpu(data + offset));\n"
+				    "	offset += %2$d;\n",
+				    qsm->name, size, simple_type_bits[qsm->type]);
+		}
+
+		fprintf(fp, "	qmi_json_close(json, '}');\n"
+			    "\n"
+			    "	return offset;\n"
+			    "}\n\n");
+
+		fprintf(fp, "static const struct qmi_json_field %1$s_%2$s_json_fields[] = {\n",
+			    package, qs->name);
+		list_for_each_entry(qsm, &qs->members, node) {
+			fprintf(fp, "	{ .name = \"%1$s\", .type = %2$s },\n",
+				    qsm->name, sz_json_types[qsm->type]);
+		}
+		fprintf(fp, "};\n\n");
+	}
+}
+
+static void qmi_message_emit_json_prototype(FILE *fp,
+					    const char *package,
+					    struct qmi_message *qm)
+{
+	fprintf(fp, "int %1$s_%2$s_to_json(void *buf, size_t len, char *out, size_t cap);\n"
+		    "int %1$s_%2$s_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);\n\n",
+		    package, qm->name);
+}
+
+/*
+ * Like the visitor, but driven straight from the wire buffer so that nothing
+ * is allocated; qmi_json_encode() checks the header and walks the TLVs.
+ */
+static void qmi_message_emit_json(FILE *fp,
+				  const char *package,
+				  struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	bool has_struct_array = false;
+	bool has_struct = false;
+	bool has_array = false;
+	unsigned len_size;
+	char type[256];
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		if (qmm->array_size && qmm->type != TYPE_STRING)
+			has_array = true;
+		if (qmm->type == TYPE_STRUCT) {
+			has_struct = true;
+			if (qmm->array_size)
+				has_struct_array = true;
+		}
+	}
+
+	fprintf(fp, "static int %1$s_%2$s_json_tlv(unsigned id, void *data, size_t len, void *ctx)\n"
+		    "{\n"
+		    "	struct qmi_json *json = ctx;\n",
+		    package, qm->name);
+	if (has_struct_array)
+		fprintf(fp, "	size_t offset;\n");
+	if (has_struct)
+		fprintf(fp, "	int ret;\n");
+	if (has_array)
+		fprintf(fp, "	size_t count;\n"
+			    "	size_t i;\n");
+	fprintf(fp, "\n"
+		    "	switch (id) {\n");
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		qmi_member_type(type, sizeof(type), package, qmm);
+
+		fprintf(fp, "	case %d:\n", qmm->id);
+
+		if (qmm->type == TYPE_STRING) {
+			fprintf(fp, "		qmi_json_key(json, \"%1$s\");\n"
+				    "		qmi_json_string(json, data, len);\n",
+				    qmm->name);
+		} else if (qmm->array_size) {
+			len_size = array_len_size(qmm);
+			if (len_size)
+				fprintf(fp, "		if (len < %1$d)\n"
+					    "			return -EINVAL;\n"
+					    "		count = qmi_le%2$d_to_cpu(data);\n"
+					    "		if (count > %3$d)\n"
+					    "			return -EINVAL;\n",
+					    len_size, len_size * 8, qmm->array_size);
+			else
+				fprintf(fp, "		count = %d;\n",
+					    qmm->array_size);
+			if (qmm->type != TYPE_STRUCT)
+				fprintf(fp, "		if (len%2$s != count * sizeof(%1$s))\n"
+					    "			return -EINVAL;\n",
+					    type, len_size == 2 ? " - 2" : len_size ? " - 1" : "");
+			fprintf(fp, "		qmi_json_key(json, \"%1$s\");\n"
+				    "		qmi_json_open(json, '[');\n",
+				    qmm->name);
+			if (qmm->type == TYPE_STRUCT)
+				fprintf(fp, "		offset = %3$d;\n"
+					    "		for (i = 0; i < count; i++) {\n"
+					    "			ret = %1$s_%2$s_json(json, (uint8_t*)data + offset, len - offset);\n"
+					    "			if (ret < 0)\n"
+					    "				return ret;\n"
+					    "			offset += ret;\n"
+					    "		}\n"
+					    "		if (offset != len)\n"
+					    "			return -EINVAL;\n",
+					    package, qmm->qmi_struct->name, len_size);
+			else
+				fprintf(fp, "		for (i = 0; i < count; i++)\n"
+					    "			qmi_json_uint(json, qmi_le%1$d_to_cpu((uint8_t*)data + %2$si * sizeof(%3$s)));\n",
+					    simple_type_bits[qmm->type], len_size == 2 ? "2 + " : len_size ? "1 + " : "", type);
+			fprintf(fp, "		qmi_json_close(json, ']');\n");
+		} else if (qmm->type == TYPE_STRUCT) {
+			fprintf(fp, "		qmi_json_key(json, \"%1$s\");\n"
+				    "		ret = %2$s_%3$s_json(json, data, len);\n"
+				    "		if (ret < 0 || (size_t)ret != len)\n"
+				    "			return -EINVAL;\n",
+				    qmm->name, package, qmm->qmi_struct->name);
+		} else {
+			fprintf(fp, "		if (len != sizeof(%2$s))\n"
+				    "			return -EINVAL;\n"
+				    "		qmi_json_key(json, \"%1$s\");\n"
+				    "		qmi_json_uint(json, qmi_le%3$d_to_cpu(data));\n",
+				    qmm->name, type, simple_type_bits[qmm->type]);
+		}
+
+		fprintf(fp, "		return 0;\n");
+	}
+
+	fprintf(fp, "	default:\n"
+		    "		qmi_json_unknown(json, id, data, len);\n"
+		    "		return 0;\n"
+		    "	}\n"
+		    "}\n\n");
+
+	fprintf(fp, "int %1$s_%2$s_to_json(void *buf, size_t len, char *out, size_t cap)\n"
+		    "{\n"
+		    "	return qmi_json_encode(buf, len, %3$d, %4$d, \"%2$s\", %1$s_%2$s_json_tlv, out, cap);\n"
+		    "}\n\n",
+		    package, qm->name, qm->msg_id, qm->type);
+}
+
+/* The reverse of _to_json(), encoding through a table of the members */
+static void qmi_message_emit_from_json(FILE *fp,
+				       const char *package,
+				       struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	struct qmi_struct_member *qsm;
+	unsigned count = 0;
+
+	list_for_each_entry(qmm, &qm->members, node)
+		count++;
+
+	if (count) {
+		fprintf(fp, "static const struct qmi_json_field %1$s_%2$s_json_fields[] = {\n",
+			    package, qm->name);
+
+		list_for_each_entry(qmm, &qm->members, node) {
+			fprintf(fp, "	{\n"
+				    "		.name = \"%1$s\",\n"
+				    "		.id = %2$d,\n"
+				    "		.type = %3$s,\n",
+				    qmm->name, qmm->id, sz_json_types[qmm->type]);
+			if (qmm->array_size)
+				fprintf(fp, "		.array_size = %d,\n",
+					    qmm->array_size);
+			if (qmm->array_fixed)
+				fprintf(fp, "		.array_fixed = true,\n");
+			if (qmm->array_size && array_len_size(qmm))
+				fprintf(fp, "		.len_size = %d,\n",
+					    array_len_size(qmm));
+			if (qmm->required)
+				fprintf(fp, "		.required = true,\n");
+			if (qmm->type == TYPE_STRUCT) {
+				count = 0;
+				list_for_each_entry(qsm, &qmm->qmi_struct->members, node)
+					count++;
+
+				fprintf(fp, "		.members = %1$s_%2$s_json_fields,\n"
+					    "		.n_members = %3$d,\n",
+					    package, qmm->qmi_struct->name, count);
+			}
+			fprintf(fp, "	},\n");
+		}
+
+		fprintf(fp, "};\n\n");
+	}
+
+	fprintf(fp, "int %1$s_%2$s_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)\n"
+		    "{\n",
+		    package, qm->name);
+	if (list_empty(&qm->members))
+		fprintf(fp, "	return qmi_json_decode(json, len, txn, %1$d, %2$d, NULL, 0, out, cap);\n",
+			    qm->msg_id, qm->type);
+	else
+		fprintf(fp, "	return qmi_json_decode(json, len, txn, %3$d, %4$d, %1$s_%2$s_json_fields,\n"
+			    "			       sizeof(%1$s_%2$s_json_fields) / sizeof(%1$s_%2$s_json_fields[0]), out, cap);\n",
+			    package, qm->name, qm->msg_id, qm->type);
+	fprintf(fp, "}\n\n");
+}
+
+static void qmi_message_emit_accessors(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		switch (qmm->type) {
+		case TYPE_U8:
+		case TYPE_U16:
+		case TYPE_U32:
+		case TYPE_U64:
+			qmi_message_emit_simple_accessors(fp, package, qm->name, qmm);
+			break;
+		case TYPE_STRING:
+			qmi_message_emit_string_accessors(fp, package, qm->name, qmm);
+			break;
+		case TYPE_STRUCT:
+			qmi_struct_emit_accessors(fp, package, qm->name, qmm);
+			break;
+		};
+	}
+}
+
+static void qmi_message_source(FILE *fp, const char *package)
+{
+	struct qmi_message *qm;
+
 	list_for_each_entry(qm, &qmi_messages, node) {
 		qmi_message_emit_message(fp, package, qm);
 
+		if (!accessor_inline)
+			qmi_message_emit_accessors(fp, package, qm);
+
+		qmi_message_emit_visitor(fp, package, qm);
+		qmi_message_emit_json(fp, package, qm);
+		qmi_message_emit_from_json(fp, package, qm);
+	}
+}
+
+static void qmi_message_emit_prototypes(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		switch (qmm->type) {
+		case TYPE_U8:
+		case TYPE_U16:
+		case TYPE_U32:
+		case TYPE_U64:
+			qmi_message_emit_simple_prototype(fp, package, qm->name, qmm);
+			break;
+		case TYPE_STRING:
+			qmi_message_emit_string_prototype(fp, package, qm->name, qmm);
+			break;
+		case TYPE_STRUCT:
+			qmi_struct_emit_prototype(fp, package, qm->name, qmm->name, qmm->array_size, qmm->qmi_struct);
+			break;
+		};
+	}
+}
+
+static bool qmi_message_has_pointer_get(void)
+{
+	struct qmi_message_member *qmm;
+	struct qmi_message *qm;
+
+	list_for_each_entry(qm, &qmi_messages, node) {
 		list_for_each_entry(qmm, &qm->members, node) {
-			switch (qmm->type) {
-			case TYPE_U8:
-			case TYPE_U16:
-			case TYPE_U32:
-			case TYPE_U64:
-				qmi_message_emit_simple_accessors(fp, package, qm->name, qmm);
-				break;
-			case TYPE_STRING:
-				qmi_message_emit_string_accessors(fp, package, qm->name, qmm);
-				break;
-			case TYPE_STRUCT:
-				qmi_struct_emit_accessors(fp, package, qm->name, qmm->name, qmm->id, qmm->array_size, qmm->qmi_struct);
-				break;
-			};
+			if (qmm->array_size && qmm->type != TYPE_STRUCT)
+				return true;
 		}
 	}
+
+	return false;
 }
 
 static void qmi_message_header(FILE *fp, const char *package)
 {
-	struct qmi_message_member *qmm;
 	struct qmi_message *qm;
 
 	list_for_each_entry(qm, &qmi_messages, node)
@@ -318,58 +1477,164 @@ static void qmi_message_header(FILE *fp, const char *package)
 
 	fprintf(fp, "\n");
 
+	if (qmi_message_has_pointer_get())
+		fprintf(fp, "/*\n"
+			    " * The _get_ accessors of numeric arrays return pointers into the message,\n"
+			    " * in wire order: little endian and not necessarily aligned. As such they\n"
+			    " * are only usable on little endian hosts, the _copy accessors convert to\n"
+			    " * host order on any host.\n"
+			    " */\n"
+			    "\n");
+
 	list_for_each_entry(qm, &qmi_messages, node) {
 		qmi_message_emit_message_prototype(fp, package, qm->name);
 
-		list_for_each_entry(qmm, &qm->members, node) {
-			switch (qmm->type) {
-			case TYPE_U8:
-			case TYPE_U16:
-			case TYPE_U32:
-			case TYPE_U64:
-				qmi_message_emit_simple_prototype(fp, package, qm->name, qmm);
-				break;
-			case TYPE_STRING:
-				qmi_message_emit_string_prototype(fp, package, qm->name, qmm);
-				break;
-			case TYPE_STRUCT:
-				qmi_struct_emit_prototype(fp, package, qm->name, qmm->name, qmm->array_size, qmm->qmi_struct);
-				break;
-			};
-		}
+		if (accessor_inline)
+			qmi_message_emit_accessors(fp, package, qm);
+		else
+			qmi_message_emit_prototypes(fp, package, qm);
+
+		qmi_message_emit_visitor_prototype(fp, package, qm);
+		qmi_message_emit_json_prototype(fp, package, qm);
+		qmi_message_emit_changed(fp, package, qm);
+		qmi_message_emit_presence(fp, package, qm);
 	}
 }
 
 static void emit_header_file_header(FILE *fp)
 {
-	fprintf(fp, "#include <stdint.h>\n"
+	fprintf(fp, "#include <sys/types.h>\n"
+		    "#include <stdbool.h>\n"
+		    "#include <stddef.h>\n"
+		    "#include <stdint.h>\n"
 		    "#include <stdlib.h>\n\n");
+	if (accessor_inline)
+		fprintf(fp, "#include <errno.h>\n"
+			    "\n"
+			    "#include \"qmi_tlv.h\"\n"
+			    "\n");
 	fprintf(fp, "struct qmi_tlv;\n"
 		    "\n"
 		    "struct qmi_tlv *qmi_tlv_init(unsigned txn, unsigned msg_id, unsigned type);\n"
-		    "struct qmi_tlv *qmi_tlv_decode(void *buf, size_t len, unsigned *txn, unsigned type);\n"
+		    "struct qmi_tlv *qmi_tlv_decode(void *buf, size_t len, unsigned *txn, unsigned msg_id, unsigned type);\n"
 		    "void *qmi_tlv_encode(struct qmi_tlv *tlv, size_t *len);\n"
 		    "void qmi_tlv_free(struct qmi_tlv *tlv);\n"
+		    "int qmi_tlv_foreach(struct qmi_tlv *tlv, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);\n"
+		    "int qmi_tlv_diff(struct qmi_tlv *a, struct qmi_tlv *b, uint64_t changed[4]);\n"
+		    "const uint64_t *qmi_tlv_present(struct qmi_tlv *tlv);\n"
+		    "\n"
+		    "ssize_t qmi_tlv_decode_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, unsigned msg_id, unsigned type, struct qmi_tlv ***tlvs);\n"
+		    "ssize_t qmi_tlv_encode_batch(struct qmi_tlv **tlvs, size_t count, void *buf, size_t size, size_t *lens);\n"
+		    "void qmi_tlv_free_batch(struct qmi_tlv **tlvs, size_t count);\n"
+		    "\n"
+		    "struct qmi_tlv_stream;\n"
+		    "\n"
+		    "struct qmi_tlv_stream *qmi_tlv_stream_init(unsigned msg_id, unsigned type, unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);\n"
+		    "int qmi_tlv_stream_feed(struct qmi_tlv_stream *stream, const void *buf, size_t len);\n"
+		    "void qmi_tlv_stream_free(struct qmi_tlv_stream *stream);\n"
 		    "\n"
 		    "void *qmi_tlv_get(struct qmi_tlv *tlv, unsigned id, size_t *len);\n"
 		    "void *qmi_tlv_get_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, size_t *len, size_t *size);\n"
 		    "int qmi_tlv_set(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);\n"
 		    "int qmi_tlv_set_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);\n"
+		    "\n"
+		    "void qmi_tlv_set_txn(struct qmi_tlv *tlv, unsigned txn);\n"
+		    "int qmi_tlv_replace(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);\n"
+		    "int qmi_tlv_replace_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);\n"
+		    "\n"
+		    "struct qmi_json;\n"
+		    "\n"
+		    "int qmi_json_encode(void *buf, size_t len, unsigned msg_id, unsigned type, const char *name, int (*cb)(unsigned id, void *data, size_t len, void *ctx), char *out, size_t cap);\n"
+		    "void qmi_json_open(struct qmi_json *json, char c);\n"
+		    "void qmi_json_close(struct qmi_json *json, char c);\n"
+		    "void qmi_json_key(struct qmi_json *json, const char *key);\n"
+		    "void qmi_json_uint(struct qmi_json *json, uint64_t val);\n"
+		    "void qmi_json_string(struct qmi_json *json, const void *buf, size_t len);\n"
+		    "void qmi_json_unknown(struct qmi_json *json, unsigned id, const void *buf, size_t len);\n"
+		    "\n"
+		    "#ifndef __QMI_JSON_FIELD__\n"
+		    "#define __QMI_JSON_FIELD__\n"
+		    "enum qmi_json_type {\n"
+		    "\tQMI_JSON_U8,\n"
+		    "\tQMI_JSON_U16,\n"
+		    "\tQMI_JSON_U32,\n"
+		    "\tQMI_JSON_U64,\n"
+		    "\tQMI_JSON_STRING,\n"
+		    "\tQMI_JSON_STRUCT,\n"
+		    "};\n"
+		    "\n"
+		    "struct qmi_json_field {\n"
+		    "\tconst char *name;\n"
+		    "\tunsigned id;\n"
+		    "\tunsigned type;\n"
+		    "\tunsigned array_size;\n"
+		    "\tunsigned len_size;\n"
+		    "\tbool array_fixed;\n"
+		    "\tbool required;\n"
+		    "\tconst struct qmi_json_field *members;\n"
+		    "\tunsigned n_members;\n"
+		    "};\n"
+		    "#endif\n"
+		    "\n"
+		    "int qmi_json_decode(const char *json, size_t len, unsigned txn, unsigned msg_id, unsigned type, const struct qmi_json_field *fields, unsigned count, void *out, size_t cap);\n"
+		    "\n"
+		    "struct qmi_client;\n"
+		    "\n"
+		    "#ifndef __QMI_CLIENT_COMPLETE__\n"
+		    "#define __QMI_CLIENT_COMPLETE__\n"
+		    "typedef void (*qmi_client_complete)(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx);\n"
+		    "#endif\n"
+		    "\n"
+		    "struct qmi_client *qmi_client_init(int (*send)(const void *buf, size_t len, void *ctx), void *ctx, unsigned depth);\n"
+		    "void qmi_client_free(struct qmi_client *client);\n"
+		    "int qmi_client_call(struct qmi_client *client, struct qmi_tlv *tlv, qmi_client_complete complete, void (*cb)(void), void *ctx);\n"
+		    "int qmi_client_receive(struct qmi_client *client, void *buf, size_t len, unsigned *msg_id);\n"
+		    "void qmi_client_cancel(struct qmi_client *client, int error);\n"
+		    "\n"
+		    "struct qmi_server;\n"
+		    "\n"
+		    "#ifndef __QMI_SERVER_HANDLE__\n"
+		    "#define __QMI_SERVER_HANDLE__\n"
+		    "typedef ssize_t (*qmi_server_handle)(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);\n"
+		    "typedef int (*qmi_server_send)(void **bufs, size_t *lens, size_t count, void *ctx);\n"
+		    "#endif\n"
+		    "\n"
+		    "struct qmi_server *qmi_server_init(unsigned n_workers, qmi_server_handle handle, const void *ops, void *ctx, qmi_server_send send, void *send_ctx);\n"
+		    "int qmi_server_submit(struct qmi_server *server, const void *buf, size_t len);\n"
+		    "void qmi_server_free(struct qmi_server *server);\n"
 		    "\n");
 }
 
 void accessor_emit_c(FILE *fp, const char *package)
 {
 	emit_source_includes(fp, package);
+	if (!accessor_inline) {
+		emit_le_helpers(fp);
+		if (qmi_message_has_simple_array())
+			emit_le_array_helpers(fp);
+		qmi_struct_emit_codec(fp, package);
+	}
+	qmi_struct_emit_json(fp, package);
 	qmi_message_source(fp, package);
+	client_emit_c(fp, package);
+	server_emit_c(fp, package);
+	dispatch_emit_c(fp, package, qmi_message_emit_dispatch);
 }
 	
 void accessor_emit_h(FILE *fp, const char *package)
 {
-	guard_header(fp, qmi_package);
+	guard_header(fp, package);
 	emit_header_file_header(fp);
 	qmi_const_header(fp);
-	qmi_struct_header(fp, qmi_package);
-	qmi_message_header(fp, qmi_package);
+	qmi_struct_header(fp, package);
+	if (accessor_inline) {
+		emit_inline_helpers(fp);
+		qmi_struct_emit_codec(fp, package);
+	}
+	qmi_message_header(fp, package);
+	client_emit_h(fp, package);
+	server_emit_h(fp, package);
+	dispatch_emit_h(fp, package,
+			"\tvoid *(*parse)(void *buf, size_t len, unsigned *txn);\n");
 	guard_footer(fp);
 }
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+#define ARRAY_SIZE(x) (sizeof(x)/sizeof((x)[0]))
+
+#define BENCH_MIN_NS	200000000ULL
+#define BENCH_BUF_SIZE	65536
+
+/* Allocation counting, hooked in with -Wl,--wrap */
+static unsigned long allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	allocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	allocs++;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	allocs++;
+	return __real_realloc(ptr, size);
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct result {
+	unsigned long iterations;
+	unsigned long long ns;
+	unsigned long allocs;
+};
+
+static void run_encode(const struct bench *b, struct result *res)
+{
+	unsigned long long start;
+	unsigned long n = 0;
+
+	allocs = 0;
+	start = now_ns();
+	do {
+		b->encode(NULL, 0);
+		n++;
+	} while ((n & 1023) || now_ns() - start < BENCH_MIN_NS);
+
+	res->ns = now_ns() - start;
+	res->iterations = n;
+	res->allocs = allocs;
+}
+
+static unsigned long run_decode(const struct bench *b, void *buf, size_t len,
+				struct result *res)
+{
+	unsigned long long start;
+	unsigned long sum = 0;
+	unsigned long n = 0;
+
+	allocs = 0;
+	start = now_ns();
+	do {
+		sum += b->decode(buf, len);
+		n++;
+	} while ((n & 1023) || now_ns() - start < BENCH_MIN_NS);
+
+	res->ns = now_ns() - start;
+	res->iterations = n;
+	res->allocs = allocs;
+
+	return sum;
+}
+
+static void report(const char *name, const char *op, unsigned fields,
+		   size_t len, struct result *res)
+{
+	double ns = (double)res->ns / res->iterations;
+
+	printf("%-8s %-7s %6u %7zu %10.1f %8.2f %9.1f %7.2f\n",
+	       name, op, fields, len, ns, ns / fields,
+	       len * 1e3 / ns, (double)res->allocs / res->iterations);
+}
+
+#ifdef BENCH_KERNEL
+#define BENCH_CODEC	"kernel"
+
+static const struct bench *benches[] = {
+	&small_kernel_bench,
+	&wide_kernel_bench,
+	&arrays_kernel_bench,
+	&nested_kernel_bench,
+};
+#else
+#define BENCH_CODEC	"accessor"
+
+static const struct bench *benches[] = {
+	&small_bench,
+	&wide_bench,
+	&arrays_bench,
+	&nested_bench,
+	&sizes_8_bench,
+	&sizes_64_bench,
+	&sizes_512_bench,
+	&sizes_4096_bench,
+};
+#endif
+
+int main(int argc, char **argv)
+{
+	const struct bench *b;
+	struct result res;
+	unsigned long sum;
+	void *buf;
+	size_t len;
+	unsigned i;
+
+	buf = malloc(BENCH_BUF_SIZE);
+	if (!buf)
+		return 1;
+
+	printf("codec: %s\n", BENCH_CODEC);
+	printf("%-8s %-7s %6s %7s %10s %8s %9s %7s\n",
+	       "schema", "op", "fields", "bytes", "ns/msg", "ns/field",
+	       "MB/s", "allocs");
+
+	for (i = 0; i < ARRAY_SIZE(benches); i++) {
+		b = benches[i];
+
+		if (argc > 1 && strcmp(argv[1], b->name))
+			continue;
+
+		len = b->encode(buf, BENCH_BUF_SIZE);
+		if (len > BENCH_BUF_SIZE) {
+			fprintf(stderr, "%s: message too large\n", b->name);
+			return 1;
+		}
+
+		run_encode(b, &res);
+		report(b->name, "encode", b->fields, len, &res);
+
+		sum = run_decode(b, buf, len, &res);
+		report(b->name, "decode", b->fields, len, &res);
+
+		if (!sum)
+			fprintf(stderr, "%s: decoded no data\n", b->name);
+	}
+
+	free(buf);
+
+	return 0;
+}
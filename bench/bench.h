@@ -0,0 +1,30 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stddef.h>
+
+struct bench {
+	const char *name;
+	unsigned fields;
+
+	/* Encode one message, copying it to out if it fits in cap */
+	size_t (*encode)(void *out, size_t cap);
+	/* Decode one message, returning a checksum of the fields read */
+	unsigned long (*decode)(void *buf, size_t len);
+};
+
+extern const struct bench small_bench;
+extern const struct bench wide_bench;
+extern const struct bench arrays_bench;
+extern const struct bench nested_bench;
+extern const struct bench sizes_8_bench;
+extern const struct bench sizes_64_bench;
+extern const struct bench sizes_512_bench;
+extern const struct bench sizes_4096_bench;
+
+extern const struct bench small_kernel_bench;
+extern const struct bench wide_kernel_bench;
+extern const struct bench arrays_kernel_bench;
+extern const struct bench nested_kernel_bench;
+
+#endif
@@ -0,0 +1,74 @@
+#include <string.h>
+
+#include "bench.h"
+#include "qmi_arrays.h"
+
+static uint16_t samples[512];
+static uint32_t values[128];
+static uint8_t bytes[255];
+
+static size_t arrays_encode(void *out, size_t cap)
+{
+	struct arrays_req *req;
+	void *buf;
+	size_t len;
+
+	req = arrays_req_alloc(1);
+	arrays_req_set_samples_copy(req, samples, 512);
+	arrays_req_set_values_copy(req, values, 128);
+	arrays_req_set_bytes_copy(req, bytes, 255);
+
+	buf = arrays_req_encode(req, &len);
+	if (out && len <= cap)
+		memcpy(out, buf, len);
+
+	arrays_req_free(req);
+
+	return len;
+}
+
+static unsigned long arrays_decode(void *buf, size_t len)
+{
+	struct arrays_req *req;
+	unsigned long sum = 0;
+	unsigned txn;
+	int ret;
+
+	req = arrays_req_parse(buf, len, &txn);
+	if (!req)
+		return 0;
+
+	ret = arrays_req_get_samples_copy(req, samples, 512);
+	if (ret > 0)
+		sum += samples[ret - 1];
+	ret = arrays_req_get_values_copy(req, values, 128);
+	if (ret > 0)
+		sum += values[ret - 1];
+	ret = arrays_req_get_bytes_copy(req, bytes, 255);
+	if (ret > 0)
+		sum += bytes[ret - 1];
+
+	arrays_req_free(req);
+
+	return sum;
+}
+
+static void arrays_init(void) __attribute__((constructor));
+static void arrays_init(void)
+{
+	unsigned i;
+
+	for (i = 0; i < 512; i++)
+		samples[i] = i;
+	for (i = 0; i < 128; i++)
+		values[i] = i * 65537;
+	for (i = 0; i < 255; i++)
+		bytes[i] = i;
+}
+
+const struct bench arrays_bench = {
+	.name = "arrays",
+	.fields = 3,
+	.encode = arrays_encode,
+	.decode = arrays_decode,
+};
@@ -0,0 +1,216 @@
+#include <string.h>
+
+#include "bench.h"
+#include "k/qmi_arrays.h"
+#include "k/qmi_nested.h"
+#include "k/qmi_small.h"
+#include "k/qmi_wide.h"
+
+/*
+ * The benchmarks of the accessor codec, over the kernel style (-k) output
+ * of the same schemas and the elem_info interpreter of elem_info.c. Encoding
+ * fills the C struct and encodes it, decoding clears the C struct, decodes
+ * into it and reads the fields back.
+ */
+
+#define BENCH_MSG_ID	0x20
+#define BENCH_BUF_SIZE	65536
+
+static uint8_t scratch[BENCH_BUF_SIZE];
+
+static size_t kernel_encode(void *out, size_t cap, const void *c_struct,
+			    struct qmi_elem_info *ei)
+{
+	struct qrtr_packet pkt = { .data = scratch, .data_len = sizeof(scratch) };
+	ssize_t len;
+
+	len = qmi_encode_message(&pkt, 0, BENCH_MSG_ID, 1, c_struct, ei);
+	if (len < 0)
+		return 0;
+
+	if (out && (size_t)len <= cap)
+		memcpy(out, scratch, len);
+
+	return len;
+}
+
+static int kernel_decode(void *buf, size_t len, void *c_struct, size_t size,
+			 struct qmi_elem_info *ei)
+{
+	struct qrtr_packet pkt = { .data = buf, .data_len = len };
+	unsigned txn;
+
+	memset(c_struct, 0, size);
+
+	return qmi_decode_message(c_struct, &txn, &pkt, 0, BENCH_MSG_ID, ei);
+}
+
+static struct small_req small;
+
+static size_t small_encode(void *out, size_t cap)
+{
+	small.number = 42;
+	small.cookie_valid = true;
+	small.cookie = 0xdeadbeef;
+	memcpy(small.name, "bench", 6);
+
+	return kernel_encode(out, cap, &small, small_req_ei);
+}
+
+static unsigned long small_decode(void *buf, size_t len)
+{
+	unsigned long sum = 0;
+
+	if (kernel_decode(buf, len, &small, sizeof(small), small_req_ei) < 0)
+		return 0;
+
+	sum += small.number;
+	if (small.cookie_valid)
+		sum += small.cookie;
+	sum += strlen(small.name);
+
+	return sum;
+}
+
+const struct bench small_kernel_bench = {
+	.name = "small",
+	.fields = 3,
+	.encode = small_encode,
+	.decode = small_decode,
+};
+
+/* Expand m(n) for n in p0..p9, and for n in p00..p99 */
+#define FIELDS_10(m, p) m(p##0) m(p##1) m(p##2) m(p##3) m(p##4) \
+			m(p##5) m(p##6) m(p##7) m(p##8) m(p##9)
+#define FIELDS_100(m, p) FIELDS_10(m, p##0) FIELDS_10(m, p##1) \
+			 FIELDS_10(m, p##2) FIELDS_10(m, p##3) \
+			 FIELDS_10(m, p##4) FIELDS_10(m, p##5) \
+			 FIELDS_10(m, p##6) FIELDS_10(m, p##7) \
+			 FIELDS_10(m, p##8) FIELDS_10(m, p##9)
+#define FIELDS(m) FIELDS_100(m, 1) FIELDS_100(m, 2)
+
+#define SET_FIELD(n) wide.f##n##_valid = true; wide.f##n = n;
+#define GET_FIELD(n) if (wide.f##n##_valid) sum += wide.f##n;
+
+static struct wide_req wide;
+
+static size_t wide_encode(void *out, size_t cap)
+{
+	FIELDS(SET_FIELD)
+
+	return kernel_encode(out, cap, &wide, wide_req_ei);
+}
+
+static unsigned long wide_decode(void *buf, size_t len)
+{
+	unsigned long sum = 0;
+
+	if (kernel_decode(buf, len, &wide, sizeof(wide), wide_req_ei) < 0)
+		return 0;
+
+	FIELDS(GET_FIELD)
+
+	return sum;
+}
+
+const struct bench wide_kernel_bench = {
+	.name = "wide",
+	.fields = 200,
+	.encode = wide_encode,
+	.decode = wide_decode,
+};
+
+static uint16_t samples[512];
+static uint32_t values[128];
+static uint8_t bytes[255];
+static struct arrays_req arrays;
+
+static size_t arrays_encode(void *out, size_t cap)
+{
+	arrays.samples_len = 512;
+	memcpy(arrays.samples, samples, sizeof(samples));
+	arrays.values_valid = true;
+	arrays.values_len = 128;
+	memcpy(arrays.values, values, sizeof(values));
+	arrays.bytes_valid = true;
+	arrays.bytes_len = 255;
+	memcpy(arrays.bytes, bytes, sizeof(bytes));
+
+	return kernel_encode(out, cap, &arrays, arrays_req_ei);
+}
+
+static unsigned long arrays_decode(void *buf, size_t len)
+{
+	unsigned long sum = 0;
+
+	if (kernel_decode(buf, len, &arrays, sizeof(arrays), arrays_req_ei) < 0)
+		return 0;
+
+	if (arrays.samples_len)
+		sum += arrays.samples[arrays.samples_len - 1];
+	if (arrays.values_valid && arrays.values_len)
+		sum += arrays.values[arrays.values_len - 1];
+	if (arrays.bytes_valid && arrays.bytes_len)
+		sum += arrays.bytes[arrays.bytes_len - 1];
+
+	return sum;
+}
+
+const struct bench arrays_kernel_bench = {
+	.name = "arrays",
+	.fields = 3,
+	.encode = arrays_encode,
+	.decode = arrays_decode,
+};
+
+#define NEIGHBOURS	32
+
+static struct nested_cell cells[NEIGHBOURS];
+static struct nested_req nested;
+
+static size_t nested_encode(void *out, size_t cap)
+{
+	nested.serving = (struct nested_cell){ 240, 1, 0x1234, 50 };
+	nested.neighbours_valid = true;
+	nested.neighbours_len = NEIGHBOURS;
+	memcpy(nested.neighbours, cells, sizeof(cells));
+
+	return kernel_encode(out, cap, &nested, nested_req_ei);
+}
+
+static unsigned long nested_decode(void *buf, size_t len)
+{
+	unsigned long sum = 0;
+	unsigned i;
+
+	if (kernel_decode(buf, len, &nested, sizeof(nested), nested_req_ei) < 0)
+		return 0;
+
+	sum += nested.serving.cid;
+	if (nested.neighbours_valid) {
+		for (i = 0; i < nested.neighbours_len; i++)
+			sum += nested.neighbours[i].rssi;
+	}
+
+	return sum;
+}
+
+const struct bench nested_kernel_bench = {
+	.name = "nested",
+	.fields = 2,
+	.encode = nested_encode,
+	.decode = nested_decode,
+};
+
+static void kernel_init(void) __attribute__((constructor));
+static void kernel_init(void)
+{
+	unsigned i;
+
+	for (i = 0; i < 512; i++)
+		samples[i] = i;
+	for (i = 0; i < 128; i++)
+		values[i] = i * 65537;
+	for (i = 0; i < 255; i++)
+		bytes[i] = i;
+}
@@ -0,0 +1,61 @@
+#include <string.h>
+
+#include "bench.h"
+#include "qmi_nested.h"
+
+#define NEIGHBOURS	32
+
+static struct nested_cell cells[NEIGHBOURS];
+
+static size_t nested_encode(void *out, size_t cap)
+{
+	struct nested_cell serving = { 240, 1, 0x1234, 50 };
+	struct nested_req *req;
+	void *buf;
+	size_t len;
+
+	req = nested_req_alloc(1);
+	nested_req_set_serving(req, &serving);
+	nested_req_set_neighbours(req, cells, NEIGHBOURS);
+
+	buf = nested_req_encode(req, &len);
+	if (out && len <= cap)
+		memcpy(out, buf, len);
+
+	nested_req_free(req);
+
+	return len;
+}
+
+static unsigned long nested_decode(void *buf, size_t len)
+{
+	struct nested_cell neighbours[NEIGHBOURS];
+	struct nested_cell serving;
+	struct nested_req *req;
+	unsigned long sum = 0;
+	unsigned txn;
+	int count;
+	int i;
+
+	req = nested_req_parse(buf, len, &txn);
+	if (!req)
+		return 0;
+
+	if (!nested_req_get_serving(req, &serving))
+		sum += serving.cid;
+
+	count = nested_req_get_neighbours(req, neighbours, NEIGHBOURS);
+	for (i = 0; i < count; i++)
+		sum += neighbours[i].rssi;
+
+	nested_req_free(req);
+
+	return sum;
+}
+
+const struct bench nested_bench = {
+	.name = "nested",
+	.fields = 2,
+	.encode = nested_encode,
+	.decode = nested_decode,
+};
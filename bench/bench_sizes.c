@@ -0,0 +1,80 @@
+#include <string.h>
+
+#include "bench.h"
+#include "qmi_sizes.h"
+
+/*
+ * The copy accessors of a u16 array over a range of sizes, to tell the fixed
+ * cost of a message from the per element cost of the conversion.
+ */
+static uint16_t samples[4096];
+
+static size_t sizes_encode(void *out, size_t cap, size_t count)
+{
+	struct sizes_req *req;
+	void *buf;
+	size_t len;
+
+	req = sizes_req_alloc(1);
+	sizes_req_set_samples_copy(req, samples, count);
+
+	buf = sizes_req_encode(req, &len);
+	if (out && len <= cap)
+		memcpy(out, buf, len);
+
+	sizes_req_free(req);
+
+	return len;
+}
+
+static unsigned long sizes_decode(void *buf, size_t len, size_t count)
+{
+	struct sizes_req *req;
+	unsigned long sum = 0;
+	unsigned txn;
+	int ret;
+
+	req = sizes_req_parse(buf, len, &txn);
+	if (!req)
+		return 0;
+
+	ret = sizes_req_get_samples_copy(req, samples, count);
+	if (ret > 0)
+		sum += samples[ret - 1] + ret;
+
+	sizes_req_free(req);
+
+	return sum;
+}
+
+#define SIZES_BENCH(n)								\
+static size_t sizes_##n##_encode(void *out, size_t cap)			\
+{										\
+	return sizes_encode(out, cap, n);					\
+}										\
+										\
+static unsigned long sizes_##n##_decode(void *buf, size_t len)			\
+{										\
+	return sizes_decode(buf, len, n);					\
+}										\
+										\
+const struct bench sizes_##n##_bench = {					\
+	.name = "u16x" #n,							\
+	.fields = n,								\
+	.encode = sizes_##n##_encode,						\
+	.decode = sizes_##n##_decode,						\
+}
+
+SIZES_BENCH(8);
+SIZES_BENCH(64);
+SIZES_BENCH(512);
+SIZES_BENCH(4096);
+
+static void sizes_init(void) __attribute__((constructor));
+static void sizes_init(void)
+{
+	unsigned i;
+
+	for (i = 0; i < 4096; i++)
+		samples[i] = i;
+}
@@ -0,0 +1,58 @@
+#include <string.h>
+
+#include "bench.h"
+#include "qmi_small.h"
+
+static size_t small_encode(void *out, size_t cap)
+{
+	struct small_req *req;
+	void *buf;
+	size_t len;
+
+	req = small_req_alloc(1);
+	small_req_set_number(req, 42);
+	small_req_set_cookie(req, 0xdeadbeef);
+	small_req_set_name(req, "bench", 5);
+
+	buf = small_req_encode(req, &len);
+	if (out && len <= cap)
+		memcpy(out, buf, len);
+
+	small_req_free(req);
+
+	return len;
+}
+
+static unsigned long small_decode(void *buf, size_t len)
+{
+	struct small_req *req;
+	unsigned long sum = 0;
+	uint32_t cookie;
+	uint8_t number;
+	char name[16];
+	unsigned txn;
+	int ret;
+
+	req = small_req_parse(buf, len, &txn);
+	if (!req)
+		return 0;
+
+	if (!small_req_get_number(req, &number))
+		sum += number;
+	if (!small_req_get_cookie(req, &cookie))
+		sum += cookie;
+	ret = small_req_get_name(req, name, sizeof(name));
+	if (ret > 0)
+		sum += ret;
+
+	small_req_free(req);
+
+	return sum;
+}
+
+const struct bench small_bench = {
+	.name = "small",
+	.fields = 3,
+	.encode = small_encode,
+	.decode = small_decode,
+};
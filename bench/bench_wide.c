@@ -0,0 +1,60 @@
+#include <string.h>
+
+#include "bench.h"
+#include "qmi_wide.h"
+
+/* Expand m(n) for n in p0..p9, and for n in p00..p99 */
+#define FIELDS_10(m, p) m(p##0) m(p##1) m(p##2) m(p##3) m(p##4) \
+			m(p##5) m(p##6) m(p##7) m(p##8) m(p##9)
+#define FIELDS_100(m, p) FIELDS_10(m, p##0) FIELDS_10(m, p##1) \
+			 FIELDS_10(m, p##2) FIELDS_10(m, p##3) \
+			 FIELDS_10(m, p##4) FIELDS_10(m, p##5) \
+			 FIELDS_10(m, p##6) FIELDS_10(m, p##7) \
+			 FIELDS_10(m, p##8) FIELDS_10(m, p##9)
+#define FIELDS(m) FIELDS_100(m, 1) FIELDS_100(m, 2)
+
+#define SET_FIELD(n) wide_req_set_f##n(req, n);
+#define GET_FIELD(n) if (!wide_req_get_f##n(req, &val)) sum += val;
+
+static size_t wide_encode(void *out, size_t cap)
+{
+	struct wide_req *req;
+	void *buf;
+	size_t len;
+
+	req = wide_req_alloc(1);
+	FIELDS(SET_FIELD)
+
+	buf = wide_req_encode(req, &len);
+	if (out && len <= cap)
+		memcpy(out, buf, len);
+
+	wide_req_free(req);
+
+	return len;
+}
+
+static unsigned long wide_decode(void *buf, size_t len)
+{
+	struct wide_req *req;
+	unsigned long sum = 0;
+	unsigned txn;
+	uint32_t val;
+
+	req = wide_req_parse(buf, len, &txn);
+	if (!req)
+		return 0;
+
+	FIELDS(GET_FIELD)
+
+	wide_req_free(req);
+
+	return sum;
+}
+
+const struct bench wide_bench = {
+	.name = "wide",
+	.fields = 200,
+	.encode = wide_encode,
+	.decode = wide_decode,
+};
@@ -0,0 +1,361 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../tests/libqrtr.h"
+
+/*
+ * Minimal stand-in for the elem_info codec of libqrtr, enough to run the
+ * kernel style (-k) output in the benchmarks. The encoder walks the table
+ * entries of the C struct, starting a new TLV whenever the tlv_type changes,
+ * the decoder looks the table entries up by the TLV ids on the wire. Strings
+ * are NUL terminated in the C struct and only carry a length prefix when
+ * nested in a struct. As with libqrtr, the caller clears the C struct before
+ * decoding.
+ */
+
+#define QMI_HEADER_SIZE	7
+
+struct ei_buf {
+	uint8_t *data;
+	size_t len;
+	size_t cap;
+};
+
+static void ei_put_le(struct ei_buf *buf, uint64_t val, unsigned size)
+{
+	unsigned i;
+
+	for (i = 0; i < size; i++)
+		buf->data[buf->len++] = val >> (8 * i);
+}
+
+static uint64_t ei_get_le(const uint8_t *ptr, unsigned size)
+{
+	uint64_t val = 0;
+	unsigned i;
+
+	for (i = 0; i < size; i++)
+		val |= (uint64_t)ptr[i] << (8 * i);
+
+	return val;
+}
+
+/* Host order unsigned of elem_size bytes, for the basic types and lengths */
+static uint64_t ei_load(const void *ptr, unsigned size)
+{
+	switch (size) {
+	case 1:
+		return *(const uint8_t *)ptr;
+	case 2:
+		return *(const uint16_t *)ptr;
+	case 4:
+		return *(const uint32_t *)ptr;
+	default:
+		return *(const uint64_t *)ptr;
+	}
+}
+
+static void ei_store(void *ptr, uint64_t val, unsigned size)
+{
+	switch (size) {
+	case 1:
+		*(uint8_t *)ptr = val;
+		break;
+	case 2:
+		*(uint16_t *)ptr = val;
+		break;
+	case 4:
+		*(uint32_t *)ptr = val;
+		break;
+	default:
+		*(uint64_t *)ptr = val;
+		break;
+	}
+}
+
+static int ei_encode_struct(struct ei_buf *buf, const void *c_struct,
+			    const struct qmi_elem_info *ei);
+
+static int ei_encode_elem(struct ei_buf *buf, const void *ptr,
+			  const struct qmi_elem_info *ei, bool nested)
+{
+	unsigned prefix = ei->elem_len > 255 ? 2 : 1;
+	size_t len;
+
+	switch (ei->data_type) {
+	case QMI_STRUCT:
+		return ei_encode_struct(buf, ptr, ei->ei_array);
+	case QMI_STRING:
+		len = strnlen(ptr, ei->elem_len);
+		if (len == ei->elem_len)
+			return -EINVAL;
+		if (buf->cap - buf->len < len + (nested ? prefix : 0))
+			return -ENOSPC;
+		if (nested)
+			ei_put_le(buf, len, prefix);
+		memcpy(buf->data + buf->len, ptr, len);
+		buf->len += len;
+		return 0;
+	default:
+		if (buf->cap - buf->len < ei->elem_size)
+			return -ENOSPC;
+		ei_put_le(buf, ei_load(ptr, ei->elem_size), ei->elem_size);
+		return 0;
+	}
+}
+
+/*
+ * Encode the entry at ei, and the array it describes when it is a DATA_LEN,
+ * returning the next entry to encode
+ */
+static const struct qmi_elem_info *ei_encode_entry(struct ei_buf *buf, const void *c_struct,
+						    const struct qmi_elem_info *ei,
+						    bool nested, int *ret)
+{
+	const uint8_t *base = c_struct;
+	uint64_t count = 1;
+	uint64_t i;
+
+	if (ei->data_type == QMI_DATA_LEN) {
+		count = ei_load(base + ei->offset, ei->elem_size);
+		if (buf->cap - buf->len < ei->elem_size) {
+			*ret = -ENOSPC;
+			return ei;
+		}
+		ei_put_le(buf, count, ei->elem_size);
+		ei++;
+	} else if (ei->array_type == STATIC_ARRAY) {
+		count = ei->elem_len;
+	}
+
+	if (count > ei->elem_len) {
+		*ret = -EINVAL;
+		return ei;
+	}
+
+	for (i = 0; i < count; i++) {
+		*ret = ei_encode_elem(buf, base + ei->offset + i * ei->elem_size, ei, nested);
+		if (*ret < 0)
+			return ei;
+	}
+
+	return ei + 1;
+}
+
+static int ei_encode_struct(struct ei_buf *buf, const void *c_struct,
+			    const struct qmi_elem_info *ei)
+{
+	int ret = 0;
+
+	while (ei->data_type != QMI_EOTI) {
+		ei = ei_encode_entry(buf, c_struct, ei, true, &ret);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+ssize_t qmi_encode_message(struct qrtr_packet *pkt, int type, int msg_id,
+			   int txn_id, const void *c_struct,
+			   struct qmi_elem_info *ei)
+{
+	struct ei_buf buf = { pkt->data, QMI_HEADER_SIZE, pkt->data_len };
+	const uint8_t *base = c_struct;
+	const struct qmi_elem_info *e = ei;
+	uint8_t tlv_type;
+	size_t start;
+	int ret = 0;
+
+	if (buf.cap < QMI_HEADER_SIZE)
+		return -ENOSPC;
+
+	while (e->data_type != QMI_EOTI) {
+		tlv_type = e->tlv_type;
+
+		if (e->data_type == QMI_OPT_FLAG && !*(const bool *)(base + e->offset)) {
+			while (e->data_type != QMI_EOTI && e->tlv_type == tlv_type)
+				e++;
+			continue;
+		} else if (e->data_type == QMI_OPT_FLAG) {
+			e++;
+		}
+
+		if (buf.cap - buf.len < 3)
+			return -ENOSPC;
+		buf.len += 3;
+		start = buf.len;
+
+		while (e->data_type != QMI_EOTI && e->tlv_type == tlv_type) {
+			e = ei_encode_entry(&buf, c_struct, e, false, &ret);
+			if (ret < 0)
+				return ret;
+		}
+
+		if (buf.len - start > UINT16_MAX)
+			return -EINVAL;
+
+		buf.data[start - 3] = tlv_type;
+		buf.data[start - 2] = buf.len - start;
+		buf.data[start - 1] = (buf.len - start) >> 8;
+	}
+
+	buf.data[0] = type;
+	buf.data[1] = txn_id;
+	buf.data[2] = txn_id >> 8;
+	buf.data[3] = msg_id;
+	buf.data[4] = msg_id >> 8;
+	buf.data[5] = buf.len - QMI_HEADER_SIZE;
+	buf.data[6] = (buf.len - QMI_HEADER_SIZE) >> 8;
+
+	pkt->data_len = buf.len;
+
+	return buf.len;
+}
+
+static int ei_decode_struct(void *c_struct, const uint8_t **ptr, const uint8_t *end,
+			    const struct qmi_elem_info *ei);
+
+static int ei_decode_elem(void *out, const uint8_t **ptr, const uint8_t *end,
+			  const struct qmi_elem_info *ei, bool nested)
+{
+	unsigned prefix = ei->elem_len > 255 ? 2 : 1;
+	size_t len;
+
+	switch (ei->data_type) {
+	case QMI_STRUCT:
+		return ei_decode_struct(out, ptr, end, ei->ei_array);
+	case QMI_STRING:
+		if (nested) {
+			if (end - *ptr < prefix)
+				return -EINVAL;
+			len = ei_get_le(*ptr, prefix);
+			*ptr += prefix;
+		} else {
+			len = end - *ptr;
+		}
+		if (len > (size_t)(end - *ptr) || len >= ei->elem_len)
+			return -EINVAL;
+		memcpy(out, *ptr, len);
+		((char *)out)[len] = '\0';
+		*ptr += len;
+		return 0;
+	default:
+		if ((size_t)(end - *ptr) < ei->elem_size)
+			return -EINVAL;
+		ei_store(out, ei_get_le(*ptr, ei->elem_size), ei->elem_size);
+		*ptr += ei->elem_size;
+		return 0;
+	}
+}
+
+static const struct qmi_elem_info *ei_decode_entry(void *c_struct, const uint8_t **ptr,
+						    const uint8_t *end,
+						    const struct qmi_elem_info *ei,
+						    bool nested, int *ret)
+{
+	uint8_t *base = c_struct;
+	uint64_t count = 1;
+	uint64_t i;
+
+	if (ei->data_type == QMI_DATA_LEN) {
+		if ((size_t)(end - *ptr) < ei->elem_size) {
+			*ret = -EINVAL;
+			return ei;
+		}
+		count = ei_get_le(*ptr, ei->elem_size);
+		ei_store(base + ei->offset, count, ei->elem_size);
+		*ptr += ei->elem_size;
+		ei++;
+	} else if (ei->array_type == STATIC_ARRAY) {
+		count = ei->elem_len;
+	}
+
+	if (count > ei->elem_len) {
+		*ret = -EINVAL;
+		return ei;
+	}
+
+	for (i = 0; i < count; i++) {
+		*ret = ei_decode_elem(base + ei->offset + i * ei->elem_size, ptr, end, ei, nested);
+		if (*ret < 0)
+			return ei;
+	}
+
+	return ei + 1;
+}
+
+static int ei_decode_struct(void *c_struct, const uint8_t **ptr, const uint8_t *end,
+			    const struct qmi_elem_info *ei)
+{
+	int ret = 0;
+
+	while (ei->data_type != QMI_EOTI) {
+		ei = ei_decode_entry(c_struct, ptr, end, ei, true, &ret);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+int qmi_decode_message(void *c_struct, unsigned int *txn,
+		       const struct qrtr_packet *pkt, int type, int id,
+		       struct qmi_elem_info *ei)
+{
+	const uint8_t *data = pkt->data;
+	const uint8_t *end = data + pkt->data_len;
+	const struct qmi_elem_info *e;
+	const uint8_t *tlv_end;
+	const uint8_t *ptr;
+	uint8_t *base = c_struct;
+	unsigned tlv_len;
+	uint8_t tlv_type;
+	int ret = 0;
+
+	if (pkt->data_len < QMI_HEADER_SIZE)
+		return -EINVAL;
+
+	if (data[0] != type || ei_get_le(data + 3, 2) != (unsigned)id)
+		return -EINVAL;
+
+	if (ei_get_le(data + 5, 2) != pkt->data_len - QMI_HEADER_SIZE)
+		return -EINVAL;
+
+	if (txn)
+		*txn = ei_get_le(data + 1, 2);
+
+	ptr = data + QMI_HEADER_SIZE;
+	while (ptr < end) {
+		if (end - ptr < 3)
+			return -EINVAL;
+
+		tlv_type = ptr[0];
+		tlv_len = ei_get_le(ptr + 1, 2);
+		ptr += 3;
+		if (tlv_len > (size_t)(end - ptr))
+			return -EINVAL;
+		tlv_end = ptr + tlv_len;
+
+		for (e = ei; e->data_type != QMI_EOTI && e->tlv_type != tlv_type; e++)
+			;
+
+		/* Unknown TLVs are skipped */
+		if (e->data_type == QMI_OPT_FLAG) {
+			*(bool *)(base + e->offset) = true;
+			e++;
+		}
+
+		while (e->data_type != QMI_EOTI && e->tlv_type == tlv_type) {
+			e = ei_decode_entry(c_struct, &ptr, tlv_end, e, false, &ret);
+			if (ret < 0)
+				return ret;
+		}
+
+		ptr = tlv_end;
+	}
+
+	return 0;
+}
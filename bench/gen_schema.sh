@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Generate a synthetic schema on stdout, for benchmarking qmic itself
+#
+# Usage: gen_schema.sh [consts] [structs] [messages] [members]
+#
+
+consts=${1:-100}
+structs=${2:-10}
+messages=${3:-100}
+members=${4:-10}
+
+awk -v consts=$consts -v structs=$structs -v messages=$messages \
+    -v members=$members 'BEGIN {
+	print "package synth;\n"
+
+	for (i = 0; i < consts; i++)
+		printf "const SYNTH_CONST_%d = %d;\n", i, i
+	print ""
+
+	for (i = 0; i < structs; i++)
+		printf "struct s%d {\n\tu8 a;\n\tu16 b;\n\tu32 c;\n\tu64 d;\n};\n\n", i
+
+	for (i = 0; i < messages; i++) {
+		printf "request msg%d {\n", i
+		for (j = 0; j < members; j++) {
+			qual = j % 2 ? "optional" : "required"
+			type = j % 6
+			if (type == 0)
+				printf "\t%s u8 m%d = %d;\n", qual, j, j + 1
+			else if (type == 1)
+				printf "\t%s u16 m%d(32) = %d;\n", qual, j, j + 1
+			else if (type == 2)
+				printf "\t%s u32 m%d = %d;\n", qual, j, j + 1
+			else if (type == 3)
+				printf "\t%s string m%d = %d;\n", qual, j, j + 1
+			else if (type == 4 && structs)
+				printf "\t%s s%d m%d = %d;\n", qual, j % structs, j, j + 1
+			else
+				printf "\t%s u64 m%d = %d;\n", qual, j, j + 1
+		}
+		if (i < consts)
+			printf "} = SYNTH_CONST_%d;\n\n", i
+		else
+			printf "} = %d;\n\n", i
+	}
+}'
@@ -0,0 +1,119 @@
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../qmic.h"
+
+/*
+ * Time the phases of qmic separately, reading the schema from stdin. Each
+ * phase runs in a fresh process, parsing the schema and then running the
+ * emitter repeatedly into /dev/null, so the peak RSS reported is that of the
+ * parse alone or of the parse followed by that one emitter.
+ */
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss;
+}
+
+static void report(const char *phase, unsigned long long ns, unsigned iterations)
+{
+	printf("%-16s %12.3f %12ld\n", phase, ns / 1e6 / iterations, peak_rss_kb());
+}
+
+static void run_phase(const char *phase, FILE *schema, unsigned iterations,
+		      void (*emit)(FILE *fp, const char *package))
+{
+	unsigned long long start;
+	unsigned i;
+	int status;
+	pid_t pid;
+	FILE *fp;
+
+	fflush(stdout);
+
+	pid = fork();
+	if (pid < 0)
+		err(1, "fork failed");
+
+	if (pid) {
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+			errx(1, "%s failed", phase);
+		return;
+	}
+
+	if (dup2(fileno(schema), STDIN_FILENO) < 0 || fseek(stdin, 0, SEEK_SET))
+		err(1, "failed to rewind schema");
+
+	start = now_ns();
+	qmi_parse();
+	if (!emit) {
+		report(phase, now_ns() - start, 1);
+		exit(0);
+	}
+
+	fp = fopen("/dev/null", "w");
+	if (!fp)
+		err(1, "failed to open /dev/null");
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++)
+		emit(fp, qmi_package);
+	fflush(fp);
+	report(phase, now_ns() - start, iterations);
+
+	exit(0);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned iterations = 10;
+	char buf[4096];
+	FILE *schema;
+	size_t n;
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+
+	/* Keep the schema around, for each phase to parse it again */
+	schema = tmpfile();
+	if (!schema)
+		err(1, "failed to create temporary file");
+
+	while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0) {
+		if (fwrite(buf, 1, n, schema) != n)
+			err(1, "failed to store schema");
+	}
+	if (fflush(schema))
+		err(1, "failed to store schema");
+
+	printf("%-16s %12s %12s\n", "phase", "ms", "peak rss kB");
+
+	run_phase("qmi_parse", schema, 1, NULL);
+	run_phase("accessor_emit_c", schema, iterations, accessor_emit_c);
+	run_phase("accessor_emit_h", schema, iterations, accessor_emit_h);
+	run_phase("kernel_emit_c", schema, iterations, kernel_emit_c);
+	run_phase("kernel_emit_h", schema, iterations, kernel_emit_h);
+	run_phase("schema_emit", schema, iterations, schema_emit);
+
+	fclose(schema);
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include <sys/socket.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "qrtr_local.h"
+
+#define QRTR_LOCAL_NODE		1
+#define QRTR_LOCAL_MAX_LEN	(7 + 65535)
+
+int qrtr_local_pair(struct qrtr_local *client, struct qrtr_local *service)
+{
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+		return -errno;
+
+	client->fd = fds[0];
+	client->node = QRTR_LOCAL_NODE;
+	client->port = 0x4000;
+
+	service->fd = fds[1];
+	service->node = QRTR_LOCAL_NODE;
+	service->port = 0x4001;
+
+	return 0;
+}
+
+ssize_t qrtr_local_send(struct qrtr_local *ep, const void *buf, size_t len)
+{
+	ssize_t ret;
+
+	do {
+		ret = send(ep->fd, buf, len, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -errno : ret;
+}
+
+/* Truncated messages are an error, rather than silently cut short */
+ssize_t qrtr_local_recv(struct qrtr_local *ep, void *buf, size_t cap)
+{
+	struct iovec iov = { buf, cap };
+	struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+	ssize_t ret;
+
+	do {
+		ret = recvmsg(ep->fd, &msg, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0)
+		return -errno;
+	if (msg.msg_flags & MSG_TRUNC)
+		return -EMSGSIZE;
+
+	return ret;
+}
+
+void qrtr_local_close(struct qrtr_local *ep)
+{
+	if (ep->fd >= 0)
+		close(ep->fd);
+	ep->fd = -1;
+}
+
+/*
+ * The service loop, replying to each message through the handler until an
+ * empty message, or the client closing its end, asks it to stop
+ */
+static void *qrtr_local_service_run(void *data)
+{
+	struct qrtr_local_service *svc = data;
+	uint8_t in[QRTR_LOCAL_MAX_LEN];
+	uint8_t out[QRTR_LOCAL_MAX_LEN];
+	ssize_t len;
+
+	for (;;) {
+		len = qrtr_local_recv(&svc->ep, in, sizeof(in));
+		if (len <= 0)
+			break;
+
+		len = svc->handler(in, len, out, sizeof(out), svc->ctx);
+		if (len > 0)
+			len = qrtr_local_send(&svc->ep, out, len);
+		if (len < 0)
+			break;
+	}
+
+	svc->ret = len < 0 ? len : 0;
+
+	return NULL;
+}
+
+int qrtr_local_service_start(struct qrtr_local_service *svc)
+{
+	return -pthread_create(&svc->thread, NULL, qrtr_local_service_run, svc);
+}
+
+int qrtr_local_service_stop(struct qrtr_local_service *svc, struct qrtr_local *client)
+{
+	qrtr_local_send(client, NULL, 0);
+	pthread_join(svc->thread, NULL);
+	qrtr_local_close(&svc->ep);
+
+	return svc->ret;
+}
@@ -0,0 +1,43 @@
+#ifndef __QRTR_LOCAL_H__
+#define __QRTR_LOCAL_H__
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <stddef.h>
+
+/*
+ * Local stand-in for a QRTR endpoint pair, over a SOCK_SEQPACKET socketpair,
+ * so a client and a service can exchange QMI messages without a QRTR capable
+ * kernel. Message boundaries are kept, as with AF_QIPCRTR datagrams.
+ */
+struct qrtr_local {
+	int fd;
+	unsigned node;
+	unsigned port;
+};
+
+/*
+ * Called by the service for each received message, writing the reply to
+ * out. Returns the reply length, 0 for no reply or negative errno to stop.
+ */
+typedef ssize_t (*qrtr_local_handler)(const void *buf, size_t len, void *out,
+				      size_t cap, void *ctx);
+
+struct qrtr_local_service {
+	struct qrtr_local ep;
+	qrtr_local_handler handler;
+	void *ctx;
+
+	pthread_t thread;
+	int ret;
+};
+
+int qrtr_local_pair(struct qrtr_local *client, struct qrtr_local *service);
+ssize_t qrtr_local_send(struct qrtr_local *ep, const void *buf, size_t len);
+ssize_t qrtr_local_recv(struct qrtr_local *ep, void *buf, size_t cap);
+void qrtr_local_close(struct qrtr_local *ep);
+
+int qrtr_local_service_start(struct qrtr_local_service *svc);
+int qrtr_local_service_stop(struct qrtr_local_service *svc, struct qrtr_local *client);
+
+#endif
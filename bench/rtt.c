@@ -0,0 +1,570 @@
+#include <err.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "qrtr_local.h"
+#include "qmi_test.h"
+
+/*
+ * Round trip latency over the local QRTR stand-in, using the messages of
+ * tests/symbolic_values.qmi. An echo service answers each test_request with
+ * a test_response carrying the same txn and, for RTT_INDICATE, sends a
+ * test_indication stamped with the send time instead. Built once for each
+ * codec: the accessor output, and with RTT_KERNEL the kernel elem_info
+ * tables. The accessor build also pipelines requests through the generated
+ * client stubs, to this service and to one built on the generated server
+ * skeleton.
+ */
+
+#define RTT_WARMUP	1000
+#define RTT_BUF_SIZE	512
+#define RTT_INDICATE	0xff
+#define RTT_WINDOW	64
+#define RTT_WORKERS	2
+
+#define QMI_REQUEST	0
+#define QMI_RESPONSE	2
+#define QMI_INDICATION	4
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#ifdef RTT_KERNEL
+
+#define RTT_CODEC	"kernel"
+
+static ssize_t encode_message(void *buf, size_t cap, int type, int msg_id,
+			      unsigned txn, const void *c_struct,
+			      struct qmi_elem_info *ei)
+{
+	struct qrtr_packet pkt = { .data = buf, .data_len = cap };
+
+	return qmi_encode_message(&pkt, type, msg_id, txn, c_struct, ei);
+}
+
+static int decode_message(const void *buf, size_t len, unsigned *txn,
+			  int type, int msg_id, void *c_struct,
+			  struct qmi_elem_info *ei)
+{
+	struct qrtr_packet pkt = { .data = (void *)buf, .data_len = len };
+
+	return qmi_decode_message(c_struct, txn, &pkt, type, msg_id, ei);
+}
+
+static ssize_t encode_request(void *buf, size_t cap, unsigned txn, uint8_t number)
+{
+	struct test_test_request req = { .test_number = number };
+
+	return encode_message(buf, cap, QMI_REQUEST, TEST_REQUEST_RESPONSE, txn,
+			      &req, test_test_request_ei);
+}
+
+static int decode_request(const void *buf, size_t len, unsigned *txn, uint8_t *number)
+{
+	struct test_test_request req = {};
+	int ret;
+
+	ret = decode_message(buf, len, txn, QMI_REQUEST, TEST_REQUEST_RESPONSE,
+			     &req, test_test_request_ei);
+	*number = req.test_number;
+
+	return ret;
+}
+
+static ssize_t encode_response(void *buf, size_t cap, unsigned txn, uint16_t error)
+{
+	struct test_test_response resp = { .r = { .error = error } };
+
+	return encode_message(buf, cap, QMI_RESPONSE, TEST_REQUEST_RESPONSE, txn,
+			      &resp, test_test_response_ei);
+}
+
+static int decode_response(const void *buf, size_t len, unsigned *txn, uint16_t *error)
+{
+	struct test_test_response resp = {};
+	int ret;
+
+	ret = decode_message(buf, len, txn, QMI_RESPONSE, TEST_REQUEST_RESPONSE,
+			     &resp, test_test_response_ei);
+	*error = resp.r.error;
+
+	return ret;
+}
+
+static ssize_t encode_indication(void *buf, size_t cap, uint64_t value)
+{
+	struct test_test_indication ind = { .value_valid = true, .value = value };
+
+	return encode_message(buf, cap, QMI_INDICATION, TEST_INDICATION, 0,
+			      &ind, test_test_indication_ei);
+}
+
+static int decode_indication(const void *buf, size_t len, uint64_t *value)
+{
+	struct test_test_indication ind = {};
+	int ret;
+
+	ret = decode_message(buf, len, NULL, QMI_INDICATION, TEST_INDICATION,
+			     &ind, test_test_indication_ei);
+	if (ret < 0)
+		return ret;
+	if (!ind.value_valid)
+		return -ENOENT;
+
+	*value = ind.value;
+
+	return 0;
+}
+
+#else
+
+#define RTT_CODEC	"accessor"
+
+/* The accessor buffers are owned by the message, copy them out */
+static ssize_t copy_out(void *buf, size_t cap, const void *data, size_t len)
+{
+	if (!data)
+		return -ENOMEM;
+	if (len > cap)
+		return -ENOSPC;
+
+	memcpy(buf, data, len);
+
+	return len;
+}
+
+static ssize_t encode_request(void *buf, size_t cap, unsigned txn, uint8_t number)
+{
+	struct test_test_request *req;
+	ssize_t ret;
+	size_t len;
+	void *data;
+
+	req = test_test_request_alloc(txn);
+	if (!req)
+		return -ENOMEM;
+
+	test_test_request_set_test_number(req, number);
+	data = test_test_request_encode(req, &len);
+	ret = copy_out(buf, cap, data, len);
+	test_test_request_free(req);
+
+	return ret;
+}
+
+static int decode_request(const void *buf, size_t len, unsigned *txn, uint8_t *number)
+{
+	struct test_test_request *req;
+	int ret;
+
+	req = test_test_request_parse((void *)buf, len, txn);
+	if (!req)
+		return -EINVAL;
+
+	ret = test_test_request_get_test_number(req, number);
+	test_test_request_free(req);
+
+	return ret;
+}
+
+static ssize_t encode_response(void *buf, size_t cap, unsigned txn, uint16_t error)
+{
+	struct test_qmi_result r = { .error = error };
+	struct test_test_response *resp;
+	ssize_t ret;
+	size_t len;
+	void *data;
+
+	resp = test_test_response_alloc(txn);
+	if (!resp)
+		return -ENOMEM;
+
+	test_test_response_set_r(resp, &r);
+	data = test_test_response_encode(resp, &len);
+	ret = copy_out(buf, cap, data, len);
+	test_test_response_free(resp);
+
+	return ret;
+}
+
+static int decode_response(const void *buf, size_t len, unsigned *txn, uint16_t *error)
+{
+	struct test_test_response *resp;
+	struct test_qmi_result r;
+	int ret;
+
+	resp = test_test_response_parse((void *)buf, len, txn);
+	if (!resp)
+		return -EINVAL;
+
+	ret = test_test_response_get_r(resp, &r);
+	*error = ret ? 0 : r.error;
+	test_test_response_free(resp);
+
+	return ret;
+}
+
+static ssize_t encode_indication(void *buf, size_t cap, uint64_t value)
+{
+	struct test_test_indication *ind;
+	ssize_t ret;
+	size_t len;
+	void *data;
+
+	ind = test_test_indication_alloc(0);
+	if (!ind)
+		return -ENOMEM;
+
+	test_test_indication_set_value(ind, value);
+	data = test_test_indication_encode(ind, &len);
+	ret = copy_out(buf, cap, data, len);
+	test_test_indication_free(ind);
+
+	return ret;
+}
+
+static int decode_indication(const void *buf, size_t len, uint64_t *value)
+{
+	struct test_test_indication *ind;
+	unsigned txn;
+	int ret;
+
+	ind = test_test_indication_parse((void *)buf, len, &txn);
+	if (!ind)
+		return -EINVAL;
+
+	ret = test_test_indication_get_value(ind, value);
+	test_test_indication_free(ind);
+
+	return ret;
+}
+
+#endif
+
+static ssize_t echo_service(const void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	uint8_t number;
+	unsigned txn;
+	int ret;
+
+	ret = decode_request(buf, len, &txn, &number);
+	if (ret < 0)
+		return ret;
+
+	if (number == RTT_INDICATE)
+		return encode_indication(out, cap, now_ns());
+
+	return encode_response(out, cap, txn, number);
+}
+
+static unsigned long long request_response(struct qrtr_local *ep, unsigned long i)
+{
+	unsigned long long start = now_ns();
+	uint8_t buf[RTT_BUF_SIZE];
+	uint8_t number = i % RTT_INDICATE;
+	uint16_t error;
+	unsigned txn;
+	ssize_t len;
+
+	len = encode_request(buf, sizeof(buf), i & 0xffff, number);
+	if (len < 0 || qrtr_local_send(ep, buf, len) < 0)
+		errx(1, "failed to send test_request");
+
+	len = qrtr_local_recv(ep, buf, sizeof(buf));
+	if (len < 0 || decode_response(buf, len, &txn, &error) < 0)
+		errx(1, "failed to receive test_response");
+
+	if (txn != (i & 0xffff) || error != number)
+		errx(1, "mismatched test_response %u:%u for %lu:%u", txn, error, i, number);
+
+	return now_ns() - start;
+}
+
+/* One way, from encoding on the service side to decoded on the client */
+static unsigned long long indication(struct qrtr_local *ep, unsigned long i)
+{
+	uint8_t buf[RTT_BUF_SIZE];
+	uint64_t stamp;
+	ssize_t len;
+
+	len = encode_request(buf, sizeof(buf), i & 0xffff, RTT_INDICATE);
+	if (len < 0 || qrtr_local_send(ep, buf, len) < 0)
+		errx(1, "failed to send test_request");
+
+	len = qrtr_local_recv(ep, buf, sizeof(buf));
+	if (len < 0 || decode_indication(buf, len, &stamp) < 0)
+		errx(1, "failed to receive test_indication");
+
+	return now_ns() - stamp;
+}
+
+static int cmp_ns(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *message, unsigned long long *samples,
+		   unsigned long count, unsigned long long ns)
+{
+	qsort(samples, count, sizeof(*samples), cmp_ns);
+
+	printf("%-10s %-20s %10lu %10llu %10llu %10llu %12.0f\n",
+	       RTT_CODEC, message, count, samples[count / 2],
+	       samples[count * 99 / 100], samples[count - 1], count / (ns / 1e9));
+}
+
+static void run(const char *message, struct qrtr_local *ep, unsigned long count,
+		unsigned long long (*exchange)(struct qrtr_local *ep, unsigned long i))
+{
+	unsigned long long *samples;
+	unsigned long long start;
+	unsigned long i;
+
+	samples = malloc(count * sizeof(*samples));
+	if (!samples)
+		err(1, "failed to allocate samples");
+
+	for (i = 0; i < RTT_WARMUP; i++)
+		exchange(ep, i);
+
+	start = now_ns();
+	for (i = 0; i < count; i++)
+		samples[i] = exchange(ep, i);
+	report(message, samples, count, now_ns() - start);
+
+	free(samples);
+}
+
+#ifndef RTT_KERNEL
+
+/*
+ * Requests pipelined through the generated client stubs, with up to
+ * RTT_WINDOW of them in flight; latency is from the call to the completion.
+ */
+struct rtt_call {
+	unsigned long long start;
+	unsigned long long *sample;
+	uint8_t number;
+	unsigned *in_flight;
+};
+
+static int client_send(const void *buf, size_t len, void *ctx)
+{
+	ssize_t ret;
+
+	ret = qrtr_local_send(ctx, buf, len);
+
+	return ret < 0 ? ret : 0;
+}
+
+static void pipelined_response(struct test_test_response *resp, int error, void *ctx)
+{
+	struct rtt_call *call = ctx;
+	struct test_qmi_result r;
+
+	if (error < 0)
+		errx(1, "test_response failed: %d", error);
+
+	if (test_test_response_get_r(resp, &r) || r.error != call->number)
+		errx(1, "mismatched test_response");
+
+	*call->sample = now_ns() - call->start;
+	(*call->in_flight)--;
+}
+
+static void run_pipelined(const char *message, struct qrtr_local *ep, unsigned long count)
+{
+	struct test_test_request *req;
+	unsigned long long *samples;
+	struct qmi_client *client;
+	unsigned long long start;
+	struct rtt_call *calls;
+	uint8_t buf[RTT_BUF_SIZE];
+	unsigned in_flight = 0;
+	unsigned long sent = 0;
+	ssize_t len;
+	int ret;
+
+	samples = malloc(count * sizeof(*samples));
+	calls = malloc(count * sizeof(*calls));
+	if (!samples || !calls)
+		err(1, "failed to allocate samples");
+
+	client = qmi_client_init(client_send, ep, RTT_WINDOW);
+	if (!client)
+		err(1, "failed to create client");
+
+	start = now_ns();
+	while (sent < count || in_flight) {
+		while (sent < count && in_flight < RTT_WINDOW) {
+			calls[sent].number = sent % RTT_INDICATE;
+			calls[sent].sample = &samples[sent];
+			calls[sent].in_flight = &in_flight;
+			calls[sent].start = now_ns();
+
+			req = test_test_request_alloc(0);
+			if (!req)
+				err(1, "failed to allocate test_request");
+
+			test_test_request_set_test_number(req, calls[sent].number);
+			ret = test_test_request_call(client, req, pipelined_response, &calls[sent]);
+			test_test_request_free(req);
+			if (ret < 0)
+				errx(1, "failed to call test_request: %d", ret);
+
+			in_flight++;
+			sent++;
+		}
+
+		len = qrtr_local_recv(ep, buf, sizeof(buf));
+		if (len < 0 || test_client_receive(client, buf, len, NULL, NULL) < 0)
+			errx(1, "failed to receive test_response");
+	}
+	report(message, samples, count, now_ns() - start);
+
+	qmi_client_free(client);
+	free(calls);
+	free(samples);
+}
+
+/*
+ * The echo service again, through the generated server skeleton: requests
+ * are handed to RTT_WORKERS workers, which send the responses in batches.
+ */
+static int serve_request(struct test_test_request *req, struct test_test_response *resp, void *ctx)
+{
+	struct test_qmi_result r = {};
+	uint8_t number;
+	int ret;
+
+	ret = test_test_request_get_test_number(req, &number);
+	if (ret < 0)
+		return ret;
+
+	r.error = number;
+
+	return test_test_response_set_r(resp, &r);
+}
+
+static const struct test_server_ops serve_ops = {
+	.test_request = serve_request,
+};
+
+static int server_send(void **bufs, size_t *lens, size_t count, void *ctx)
+{
+	ssize_t ret;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		ret = qrtr_local_send(ctx, bufs[i], lens[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static ssize_t server_submit(const void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	return qmi_server_submit(ctx, buf, len);
+}
+
+static void run_server(const char *message, unsigned long count)
+{
+	struct qrtr_local_service svc = { .handler = server_submit };
+	struct qmi_server *server;
+	struct qrtr_local client;
+	int ret;
+
+	ret = qrtr_local_pair(&client, &svc.ep);
+	if (ret < 0) {
+		errno = -ret;
+		err(1, "failed to create endpoints");
+	}
+
+	server = qmi_server_init(RTT_WORKERS, test_server_dispatch, &serve_ops, NULL,
+				 server_send, &svc.ep);
+	if (!server)
+		err(1, "failed to create server");
+
+	svc.ctx = server;
+	ret = qrtr_local_service_start(&svc);
+	if (ret < 0) {
+		errno = -ret;
+		err(1, "failed to start server");
+	}
+
+	run_pipelined(message, &client, count);
+
+	qmi_server_free(server);
+	ret = qrtr_local_service_stop(&svc, &client);
+	if (ret < 0) {
+		errno = -ret;
+		err(1, "server failed");
+	}
+
+	qrtr_local_close(&client);
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+	struct qrtr_local_service svc = { .handler = echo_service };
+	unsigned long count = 100000;
+	struct qrtr_local client;
+	int ret;
+
+	if (argc > 1)
+		count = strtoul(argv[1], NULL, 0);
+	if (!count)
+		errx(1, "invalid iteration count");
+
+	ret = qrtr_local_pair(&client, &svc.ep);
+	if (ret < 0) {
+		errno = -ret;
+		err(1, "failed to create endpoints");
+	}
+
+	ret = qrtr_local_service_start(&svc);
+	if (ret < 0) {
+		errno = -ret;
+		err(1, "failed to start echo service");
+	}
+
+	printf("%-10s %-20s %10s %10s %10s %10s %12s\n",
+	       "codec", "message", "count", "p50 ns", "p99 ns", "max ns", "msgs/s");
+
+	run("test_response", &client, count, request_response);
+	run("test_indication", &client, count, indication);
+#ifndef RTT_KERNEL
+	run_pipelined("test_response x64", &client, count);
+#endif
+
+	ret = qrtr_local_service_stop(&svc, &client);
+	if (ret < 0) {
+		errno = -ret;
+		err(1, "echo service failed");
+	}
+
+	qrtr_local_close(&client);
+
+#ifndef RTT_KERNEL
+	run_server("test_response srv", count);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+
+#include "qmic.h"
+
+/*
+ * Asynchronous client stubs, on top of the qmi_client runtime. Each request
+ * with a response sharing its msg_id gets a _call() taking a typed callback,
+ * indications are routed by msg_id to the typed handlers of
+ * <package>_client_indications. Messages lacking required members are
+ * rejected with -EPROTO before reaching either.
+ */
+
+static bool client_has_indications(void)
+{
+	struct qmi_message *qm;
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		if (qm->type == MESSAGE_INDICATION)
+			return true;
+	}
+
+	return false;
+}
+
+void client_emit_h(FILE *fp, const char *package)
+{
+	struct qmi_message *resp;
+	struct qmi_message *qm;
+
+	if (client_has_indications()) {
+		fprintf(fp, "struct %s_client_indications {\n", package);
+		list_for_each_entry(qm, &qmi_messages, node) {
+			if (qm->type != MESSAGE_INDICATION)
+				continue;
+
+			fprintf(fp, "\tvoid (*%2$s)(struct %1$s_%2$s *%2$s, void *ctx);\n",
+				    package, qm->name);
+		}
+		fprintf(fp, "};\n"
+			    "\n");
+	} else {
+		fprintf(fp, "struct %s_client_indications;\n"
+			    "\n",
+			    package);
+	}
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		if (qm->type != MESSAGE_REQUEST)
+			continue;
+
+		resp = qmi_message_peer(qm, MESSAGE_RESPONSE);
+		if (!resp)
+			continue;
+
+		fprintf(fp, "int %1$s_%2$s_call(struct qmi_client *client, struct %1$s_%2$s *%2$s, void (*cb)(struct %1$s_%3$s *%3$s, int error, void *ctx), void *ctx);\n",
+			    package, qm->name, resp->name);
+	}
+
+	fprintf(fp, "int %1$s_client_receive(struct qmi_client *client, void *buf, size_t len, const struct %1$s_client_indications *ind, void *ctx);\n"
+		    "\n",
+		    package);
+}
+
+static void client_emit_receive(FILE *fp, const char *package)
+{
+	unsigned long long required[4];
+	struct qmi_message *qm;
+
+	if (!client_has_indications()) {
+		fprintf(fp, "int %1$s_client_receive(struct qmi_client *client, void *buf, size_t len, const struct %1$s_client_indications *ind, void *ctx)\n"
+			    "{\n"
+			    "\tunsigned msg_id;\n"
+			    "\tint ret;\n"
+			    "\n"
+			    "\t(void)ind;\n"
+			    "\t(void)ctx;\n"
+			    "\n"
+			    "\tret = qmi_client_receive(client, buf, len, &msg_id);\n"
+			    "\n"
+			    "\treturn ret <= 0 ? ret : -ENOENT;\n"
+			    "}\n"
+			    "\n",
+			    package);
+		return;
+	}
+
+	fprintf(fp, "int %1$s_client_receive(struct qmi_client *client, void *buf, size_t len, const struct %1$s_client_indications *ind, void *ctx)\n"
+		    "{\n"
+		    "\tstruct qmi_tlv *tlv;\n"
+		    "\tunsigned msg_id;\n"
+		    "\tint ret;\n"
+		    "\n"
+		    "\tret = qmi_client_receive(client, buf, len, &msg_id);\n"
+		    "\tif (ret <= 0)\n"
+		    "\t\treturn ret;\n"
+		    "\n"
+		    "\tswitch (msg_id) {\n",
+		    package);
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		/* Indications sharing a msg_id are routed to the first one */
+		if (qm->type != MESSAGE_INDICATION ||
+		    qmi_message_peer(qm, MESSAGE_INDICATION) != qm)
+			continue;
+
+		fprintf(fp, "\tcase %2$d:\n"
+			    "\t\tif (!ind || !ind->%1$s)\n"
+			    "\t\t\treturn 0;\n"
+			    "\n"
+			    "\t\ttlv = qmi_tlv_decode(buf, len, NULL, %2$d, %3$d);\n"
+			    "\t\tif (!tlv)\n"
+			    "\t\t\treturn -EINVAL;\n"
+			    "\n",
+			    qm->name, qm->msg_id, qm->type);
+
+		if (qmi_message_required(qm, required))
+			fprintf(fp, "\t\tif (%1$s_%2$s_missing_required((struct %1$s_%2$s *)tlv)) {\n"
+				    "\t\t\tqmi_tlv_free(tlv);\n"
+				    "\t\t\treturn -EPROTO;\n"
+				    "\t\t}\n"
+				    "\n",
+				    package, qm->name);
+
+		fprintf(fp, "\t\tind->%2$s((struct %1$s_%2$s *)tlv, ctx);\n"
+			    "\t\tqmi_tlv_free(tlv);\n"
+			    "\t\treturn 0;\n",
+			    package, qm->name);
+	}
+
+	fprintf(fp, "\t}\n"
+		    "\n"
+		    "\treturn -ENOENT;\n"
+		    "}\n"
+		    "\n");
+}
+
+void client_emit_c(FILE *fp, const char *package)
+{
+	unsigned long long required[4];
+	struct qmi_message *resp;
+	struct qmi_message *qm;
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		if (qm->type != MESSAGE_REQUEST)
+			continue;
+
+		resp = qmi_message_peer(qm, MESSAGE_RESPONSE);
+		if (!resp)
+			continue;
+
+		fprintf(fp, "static void %1$s_%2$s_complete(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx)\n"
+			    "{\n",
+			    package, qm->name);
+
+		if (qmi_message_required(resp, required))
+			fprintf(fp, "\tif (tlv && %1$s_%2$s_missing_required((struct %1$s_%2$s *)tlv)) {\n"
+				    "\t\ttlv = NULL;\n"
+				    "\t\terror = -EPROTO;\n"
+				    "\t}\n"
+				    "\n",
+				    package, resp->name);
+
+		/* cb is cast back to the type it was passed in as */
+		fprintf(fp, "\t((void (*)(struct %1$s_%3$s *, int, void *))cb)((struct %1$s_%3$s *)tlv, error, ctx);\n"
+			    "}\n"
+			    "\n"
+			    "int %1$s_%2$s_call(struct qmi_client *client, struct %1$s_%2$s *%2$s, void (*cb)(struct %1$s_%3$s *%3$s, int error, void *ctx), void *ctx)\n"
+			    "{\n"
+			    "\treturn qmi_client_call(client, (struct qmi_tlv *)%2$s, %1$s_%2$s_complete, (void (*)(void))cb, ctx);\n"
+			    "}\n"
+			    "\n",
+			    package, qm->name, resp->name);
+	}
+
+	client_emit_receive(fp, package);
+}
@@ -0,0 +1,698 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qmic.h"
+
+/*
+ * C++ backend, emitting a header only codec. Each message is described by
+ * constexpr field descriptors and gets a reader, validating a received buffer
+ * once and accessing TLVs in place, and a writer encoding into a caller
+ * provided buffer; neither allocates.
+ */
+
+static const char *sz_cxx_types[] = {
+	[TYPE_U8] = "std::uint8_t",
+	[TYPE_U16] = "std::uint16_t",
+	[TYPE_U32] = "std::uint32_t",
+	[TYPE_U64] = "std::uint64_t",
+};
+
+static const char *sz_cxx_kinds[] = {
+	[TYPE_U8] = "u8",
+	[TYPE_U16] = "u16",
+	[TYPE_U32] = "u32",
+	[TYPE_U64] = "u64",
+	[TYPE_STRING] = "string",
+	[TYPE_STRUCT] = "structure",
+};
+
+static const unsigned cxx_type_sizes[] = {
+	[TYPE_U8] = 1,
+	[TYPE_U16] = 2,
+	[TYPE_U32] = 4,
+	[TYPE_U64] = 8,
+};
+
+static const char cxx_runtime[] =
+	"#ifndef __QMI_CXX_RUNTIME__\n"
+	"#define __QMI_CXX_RUNTIME__\n"
+	"\n"
+	"namespace qmi {\n"
+	"\n"
+	"enum class kind : std::uint8_t {\n"
+	"\tu8,\n"
+	"\tu16,\n"
+	"\tu32,\n"
+	"\tu64,\n"
+	"\tstring,\n"
+	"\tstructure,\n"
+	"};\n"
+	"\n"
+	"/* Message member, index being the slot of its TLV in the reader */\n"
+	"struct field {\n"
+	"\tstd::uint8_t id;\n"
+	"\tkind type;\n"
+	"\tbool required;\n"
+	"\tstd::uint16_t array_size;\n"
+	"\tbool array_fixed;\n"
+	"\tstd::uint8_t index;\n"
+	"};\n"
+	"\n"
+	"/* Struct member, at offset in the packed wire encoding of the struct */\n"
+	"struct member {\n"
+	"\tkind type;\n"
+	"\tstd::uint16_t offset;\n"
+	"};\n"
+	"\n"
+	"constexpr std::size_t header_size = 7;\n"
+	"constexpr std::size_t tlv_header_size = 3;\n"
+	"\n"
+	"/*\n"
+	" * Size of the element count ahead of an array. Fixed arrays of integers have\n"
+	" * none, but struct arrays are all VAR_LEN_ARRAY in the kernel encoding, so\n"
+	" * fixed ones are counted too.\n"
+	" */\n"
+	"constexpr std::size_t len_size(const field &f)\n"
+	"{\n"
+	"\tif (!f.array_size || (f.array_fixed && f.type != kind::structure))\n"
+	"\t\treturn 0;\n"
+	"\treturn f.array_size >= 256 ? 2 : 1;\n"
+	"}\n"
+	"\n"
+	"/* Wire size, load() and store() of each struct, specialized per struct */\n"
+	"template <typename T>\n"
+	"struct codec;\n"
+	"\n"
+	"template <typename T>\n"
+	"constexpr T bswap(T val)\n"
+	"{\n"
+	"\tif constexpr (sizeof(T) == 2)\n"
+	"\t\treturn __builtin_bswap16(val);\n"
+	"\telse if constexpr (sizeof(T) == 4)\n"
+	"\t\treturn __builtin_bswap32(val);\n"
+	"\telse if constexpr (sizeof(T) == 8)\n"
+	"\t\treturn __builtin_bswap64(val);\n"
+	"\telse\n"
+	"\t\treturn val;\n"
+	"}\n"
+	"\n"
+	"/* Integers are little endian on the wire, structs packed member by member */\n"
+	"template <typename T>\n"
+	"constexpr std::size_t wire_size()\n"
+	"{\n"
+	"\tif constexpr (std::is_integral_v<T>)\n"
+	"\t\treturn sizeof(T);\n"
+	"\telse\n"
+	"\t\treturn codec<T>::wire_size;\n"
+	"}\n"
+	"\n"
+	"template <typename T>\n"
+	"inline T load(const std::uint8_t *ptr)\n"
+	"{\n"
+	"\tif constexpr (std::is_integral_v<T>) {\n"
+	"\t\tT val;\n"
+	"\n"
+	"\t\tstd::memcpy(&val, ptr, sizeof(val));\n"
+	"\t\tif constexpr (std::endian::native != std::endian::little)\n"
+	"\t\t\tval = bswap(val);\n"
+	"\t\treturn val;\n"
+	"\t} else {\n"
+	"\t\treturn codec<T>::load(ptr);\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"template <typename T>\n"
+	"inline void store(std::uint8_t *ptr, const T &val)\n"
+	"{\n"
+	"\tif constexpr (std::is_integral_v<T>) {\n"
+	"\t\tT le = val;\n"
+	"\n"
+	"\t\tif constexpr (std::endian::native != std::endian::little)\n"
+	"\t\t\tle = bswap(le);\n"
+	"\t\tstd::memcpy(ptr, &le, sizeof(le));\n"
+	"\t} else {\n"
+	"\t\tcodec<T>::store(ptr, val);\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"/* View of an array in a received message, converting elements on access */\n"
+	"template <typename T>\n"
+	"class array_view {\n"
+	"public:\n"
+	"\tclass iterator {\n"
+	"\tpublic:\n"
+	"\t\tconstexpr iterator(const std::uint8_t *ptr) : ptr_(ptr) {}\n"
+	"\n"
+	"\t\tT operator*() const { return load<T>(ptr_); }\n"
+	"\t\titerator &operator++() { ptr_ += wire_size<T>(); return *this; }\n"
+	"\t\tbool operator!=(const iterator &other) const { return ptr_ != other.ptr_; }\n"
+	"\n"
+	"\tprivate:\n"
+	"\t\tconst std::uint8_t *ptr_;\n"
+	"\t};\n"
+	"\n"
+	"\tconstexpr array_view(const std::uint8_t *data, std::size_t count) : data_(data), count_(count) {}\n"
+	"\n"
+	"\tconstexpr std::size_t size() const { return count_; }\n"
+	"\tconstexpr bool empty() const { return !count_; }\n"
+	"\tT operator[](std::size_t i) const { return load<T>(data_ + i * wire_size<T>()); }\n"
+	"\n"
+	"\titerator begin() const { return iterator(data_); }\n"
+	"\titerator end() const { return iterator(data_ + count_ * wire_size<T>()); }\n"
+	"\n"
+	"\tstd::span<const std::uint8_t> bytes() const { return { data_, count_ * wire_size<T>() }; }\n"
+	"\n"
+	"private:\n"
+	"\tconst std::uint8_t *data_;\n"
+	"\tstd::size_t count_;\n"
+	"};\n"
+	"\n"
+	"/* What the accessor of member F, of C++ type T, returns */\n"
+	"template <typename T, field F>\n"
+	"using value_type = std::conditional_t<F.type == kind::string, std::string_view,\n"
+	"\t\t\t\t      std::conditional_t<(F.array_size > 0), array_view<T>, T>>;\n"
+	"\n"
+	"/*\n"
+	" * A received message, validated once on construction. The same pass records\n"
+	" * the offset of the first TLV of each of the N members, Index() mapping TLV\n"
+	" * ids to member slots, so member accessors don't search the message.\n"
+	" */\n"
+	"template <std::size_t N, int (*Index)(std::uint8_t)>\n"
+	"class reader {\n"
+	"public:\n"
+	"\treader(std::span<const std::uint8_t> buf, unsigned msg_id, unsigned type)\n"
+	"\t{\n"
+	"\t\tstd::size_t offset = 0;\n"
+	"\t\tstd::size_t len;\n"
+	"\t\tint slot;\n"
+	"\n"
+	"\t\tif (buf.size() < header_size || buf[0] != type ||\n"
+	"\t\t    load<std::uint16_t>(&buf[3]) != msg_id)\n"
+	"\t\t\treturn;\n"
+	"\n"
+	"\t\tlen = load<std::uint16_t>(&buf[5]);\n"
+	"\t\tif (len > buf.size() - header_size)\n"
+	"\t\t\treturn;\n"
+	"\n"
+	"\t\ttlvs_ = buf.subspan(header_size, len);\n"
+	"\t\twhile (offset < len) {\n"
+	"\t\t\tif (len - offset < tlv_header_size)\n"
+	"\t\t\t\treturn;\n"
+	"\n"
+	"\t\t\tslot = Index(tlvs_[offset]);\n"
+	"\t\t\tif (slot >= 0 && !offsets_[slot])\n"
+	"\t\t\t\toffsets_[slot] = offset + 1;\n"
+	"\n"
+	"\t\t\toffset += tlv_header_size + load<std::uint16_t>(&tlvs_[offset + 1]);\n"
+	"\t\t}\n"
+	"\n"
+	"\t\ttxn_ = load<std::uint16_t>(&buf[1]);\n"
+	"\t\tvalid_ = offset == len;\n"
+	"\t}\n"
+	"\n"
+	"\tbool valid() const { return valid_; }\n"
+	"\tunsigned txn() const { return txn_; }\n"
+	"\n"
+	"\t/* Any TLV by id, e.g. one unknown to the schema; searches the message */\n"
+	"\tstd::optional<std::span<const std::uint8_t>> find(std::uint8_t id) const\n"
+	"\t{\n"
+	"\t\tstd::size_t offset = 0;\n"
+	"\t\tstd::size_t len;\n"
+	"\n"
+	"\t\tif (!valid_)\n"
+	"\t\t\treturn std::nullopt;\n"
+	"\n"
+	"\t\twhile (offset < tlvs_.size()) {\n"
+	"\t\t\tlen = load<std::uint16_t>(&tlvs_[offset + 1]);\n"
+	"\t\t\tif (tlvs_[offset] == id)\n"
+	"\t\t\t\treturn tlvs_.subspan(offset + tlv_header_size, len);\n"
+	"\n"
+	"\t\t\toffset += tlv_header_size + len;\n"
+	"\t\t}\n"
+	"\t\treturn std::nullopt;\n"
+	"\t}\n"
+	"\n"
+	"protected:\n"
+	"\t/* Accessor of member F, specialized on its descriptor */\n"
+	"\ttemplate <typename T, field F>\n"
+	"\tstd::optional<value_type<T, F>> get() const\n"
+	"\t{\n"
+	"\t\tstd::span<const std::uint8_t> tlv;\n"
+	"\t\tstd::size_t offset;\n"
+	"\n"
+	"\t\tif (!valid_ || !offsets_[F.index])\n"
+	"\t\t\treturn std::nullopt;\n"
+	"\n"
+	"\t\toffset = offsets_[F.index] - 1;\n"
+	"\t\ttlv = tlvs_.subspan(offset + tlv_header_size, load<std::uint16_t>(&tlvs_[offset + 1]));\n"
+	"\n"
+	"\t\tif constexpr (F.type == kind::string) {\n"
+	"\t\t\treturn std::string_view(reinterpret_cast<const char *>(tlv.data()), tlv.size());\n"
+	"\t\t} else if constexpr (F.array_size > 0 && !len_size(F)) {\n"
+	"\t\t\tif (tlv.size() != F.array_size * wire_size<T>())\n"
+	"\t\t\t\treturn std::nullopt;\n"
+	"\t\t\treturn array_view<T>(tlv.data(), F.array_size);\n"
+	"\t\t} else if constexpr (F.array_size > 0) {\n"
+	"\t\t\tconstexpr std::size_t n = len_size(F);\n"
+	"\t\t\tstd::size_t count;\n"
+	"\n"
+	"\t\t\tif (tlv.size() < n)\n"
+	"\t\t\t\treturn std::nullopt;\n"
+	"\n"
+	"\t\t\tif constexpr (n == 2)\n"
+	"\t\t\t\tcount = load<std::uint16_t>(tlv.data());\n"
+	"\t\t\telse\n"
+	"\t\t\t\tcount = tlv[0];\n"
+	"\n"
+	"\t\t\tif ((F.array_fixed ? count != F.array_size : count > F.array_size) ||\n"
+	"\t\t\t    tlv.size() - n != count * wire_size<T>())\n"
+	"\t\t\t\treturn std::nullopt;\n"
+	"\t\t\treturn array_view<T>(tlv.data() + n, count);\n"
+	"\t\t} else {\n"
+	"\t\t\tif (tlv.size() != wire_size<T>())\n"
+	"\t\t\t\treturn std::nullopt;\n"
+	"\t\t\treturn load<T>(tlv.data());\n"
+	"\t\t}\n"
+	"\t}\n"
+	"\n"
+	"private:\n"
+	"\tstd::span<const std::uint8_t> tlvs_;\n"
+	"\tstd::array<std::uint16_t, N> offsets_ = {};\n"
+	"\tunsigned txn_ = 0;\n"
+	"\tbool valid_ = false;\n"
+	"};\n"
+	"\n"
+	"/* Encodes a message into a caller provided buffer */\n"
+	"class writer {\n"
+	"public:\n"
+	"\twriter(std::span<std::uint8_t> buf, unsigned txn, unsigned msg_id, unsigned type)\n"
+	"\t\t: buf_(buf), txn_(txn), msg_id_(msg_id), type_(type),\n"
+	"\t\t  len_(header_size), ok_(buf.size() >= header_size)\n"
+	"\t{\n"
+	"\t}\n"
+	"\n"
+	"\tbool ok() const { return ok_; }\n"
+	"\n"
+	"\t/* Fill in the QMI header, returning the encoded message */\n"
+	"\tstd::span<const std::uint8_t> finish()\n"
+	"\t{\n"
+	"\t\tif (!ok_ || len_ - header_size > UINT16_MAX)\n"
+	"\t\t\treturn {};\n"
+	"\n"
+	"\t\tbuf_[0] = type_;\n"
+	"\t\tstore<std::uint16_t>(&buf_[1], txn_);\n"
+	"\t\tstore<std::uint16_t>(&buf_[3], msg_id_);\n"
+	"\t\tstore<std::uint16_t>(&buf_[5], len_ - header_size);\n"
+	"\n"
+	"\t\treturn buf_.first(len_);\n"
+	"\t}\n"
+	"\n"
+	"protected:\n"
+	"\tstd::uint8_t *put_tlv(std::uint8_t id, std::size_t len)\n"
+	"\t{\n"
+	"\t\tstd::uint8_t *ptr;\n"
+	"\n"
+	"\t\tif (!ok_ || len > UINT16_MAX || tlv_header_size + len > buf_.size() - len_) {\n"
+	"\t\t\tok_ = false;\n"
+	"\t\t\treturn nullptr;\n"
+	"\t\t}\n"
+	"\n"
+	"\t\tptr = &buf_[len_];\n"
+	"\t\tptr[0] = id;\n"
+	"\t\tstore<std::uint16_t>(ptr + 1, len);\n"
+	"\t\tlen_ += tlv_header_size + len;\n"
+	"\n"
+	"\t\treturn ptr + tlv_header_size;\n"
+	"\t}\n"
+	"\n"
+	"\t/* Encoders of member F, specialized on its descriptor */\n"
+	"\ttemplate <typename T, field F>\n"
+	"\tbool put_value(const T &val)\n"
+	"\t{\n"
+	"\t\tstd::uint8_t *ptr = put_tlv(F.id, wire_size<T>());\n"
+	"\n"
+	"\t\tif (!ptr)\n"
+	"\t\t\treturn false;\n"
+	"\t\tstore<T>(ptr, val);\n"
+	"\t\treturn true;\n"
+	"\t}\n"
+	"\n"
+	"\ttemplate <typename T, field F>\n"
+	"\tbool put_array(std::span<const T> val)\n"
+	"\t{\n"
+	"\t\tconstexpr std::size_t n = len_size(F);\n"
+	"\t\tstd::uint8_t *ptr;\n"
+	"\n"
+	"\t\tif (F.array_fixed ? val.size() != F.array_size : val.size() > F.array_size)\n"
+	"\t\t\treturn false;\n"
+	"\n"
+	"\t\tptr = put_tlv(F.id, n + val.size() * wire_size<T>());\n"
+	"\t\tif (!ptr)\n"
+	"\t\t\treturn false;\n"
+	"\n"
+	"\t\tif constexpr (n == 2)\n"
+	"\t\t\tstore<std::uint16_t>(ptr, val.size());\n"
+	"\t\telse if constexpr (n == 1)\n"
+	"\t\t\tptr[0] = val.size();\n"
+	"\t\tptr += n;\n"
+	"\n"
+	"\t\tfor (const T &elem : val) {\n"
+	"\t\t\tstore<T>(ptr, elem);\n"
+	"\t\t\tptr += wire_size<T>();\n"
+	"\t\t}\n"
+	"\t\treturn true;\n"
+	"\t}\n"
+	"\n"
+	"\ttemplate <field F>\n"
+	"\tbool put_string(std::string_view val)\n"
+	"\t{\n"
+	"\t\tstd::uint8_t *ptr = put_tlv(F.id, val.size());\n"
+	"\n"
+	"\t\tif (!ptr)\n"
+	"\t\t\treturn false;\n"
+	"\t\tstd::memcpy(ptr, val.data(), val.size());\n"
+	"\t\treturn true;\n"
+	"\t}\n"
+	"\n"
+	"private:\n"
+	"\tstd::span<std::uint8_t> buf_;\n"
+	"\tunsigned txn_;\n"
+	"\tunsigned msg_id_;\n"
+	"\tunsigned type_;\n"
+	"\tstd::size_t len_;\n"
+	"\tbool ok_;\n"
+	"};\n"
+	"\n"
+	"}\n"
+	"\n"
+	"#endif\n"
+	"\n";
+
+/*
+ * IDL names are used as is, so those of members must steer clear of the
+ * descriptor tables emitted alongside them
+ */
+static void cxx_check_name(const char *name)
+{
+	if (!strcmp(name, "fields")) {
+		fprintf(stderr, "member name \"fields\" is reserved by the C++ backend\n");
+		exit(1);
+	}
+}
+
+static void emit_cxx_struct(FILE *fp, struct qmi_struct *qs)
+{
+	struct qmi_struct_member *qsm;
+
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING) {
+			fprintf(stderr, "string members of structs are not supported by the C++ backend\n");
+			exit(1);
+		}
+		cxx_check_name(qsm->name);
+	}
+
+	fprintf(fp, "struct %s {\n", qs->name);
+
+	list_for_each_entry(qsm, &qs->members, node)
+		fprintf(fp, "\t%s %s;\n", sz_cxx_types[qsm->type], qsm->name);
+
+	fprintf(fp, "};\n"
+		    "\n");
+}
+
+/*
+ * The codec of a struct lives in namespace qmi, leaving the struct itself to
+ * the members named in the IDL
+ */
+static void emit_cxx_codec(FILE *fp, const char *package, struct qmi_struct *qs)
+{
+	struct qmi_struct_member *qsm;
+	unsigned offset = 0;
+
+	fprintf(fp, "template <>\n"
+		    "struct codec<%1$s::%2$s> {\n"
+		    "\tstruct fields {\n",
+		    package, qs->name);
+
+	list_for_each_entry(qsm, &qs->members, node) {
+		fprintf(fp, "\t\tstatic constexpr member %s = { kind::%s, %d };\n",
+			qsm->name, sz_cxx_kinds[qsm->type], offset);
+		offset += cxx_type_sizes[qsm->type];
+	}
+
+	fprintf(fp, "\t};\n"
+		    "\n"
+		    "\tstatic constexpr std::size_t wire_size = %3$d;\n"
+		    "\n"
+		    "\tstatic %1$s::%2$s load(const std::uint8_t *ptr)\n"
+		    "\t{\n"
+		    "\t\t%1$s::%2$s val;\n"
+		    "\n",
+		    package, qs->name, offset);
+
+	list_for_each_entry(qsm, &qs->members, node) {
+		fprintf(fp, "\t\tval.%1$s = qmi::load<%2$s>(ptr + fields::%1$s.offset);\n",
+			qsm->name, sz_cxx_types[qsm->type]);
+	}
+
+	fprintf(fp, "\t\treturn val;\n"
+		    "\t}\n"
+		    "\n"
+		    "\tstatic void store(std::uint8_t *ptr, const %1$s::%2$s &val)\n"
+		    "\t{\n",
+		    package, qs->name);
+
+	list_for_each_entry(qsm, &qs->members, node) {
+		fprintf(fp, "\t\tqmi::store<%2$s>(ptr + fields::%1$s.offset, val.%1$s);\n",
+			qsm->name, sz_cxx_types[qsm->type]);
+	}
+
+	fprintf(fp, "\t}\n"
+		    "};\n"
+		    "\n");
+}
+
+static const char *cxx_member_type(char *buf, size_t size, struct qmi_message_member *qmm)
+{
+	if (qmm->type == TYPE_STRUCT)
+		snprintf(buf, size, "%s", qmm->qmi_struct->name);
+	else
+		snprintf(buf, size, "%s", sz_cxx_types[qmm->type]);
+
+	return buf;
+}
+
+static void emit_cxx_getter(FILE *fp, struct qmi_message_member *qmm)
+{
+	char type[256];
+
+	cxx_member_type(type, sizeof(type), qmm);
+
+	if (qmm->type == TYPE_STRING) {
+		fprintf(fp, "\n"
+			    "\t\tstd::optional<std::string_view> get_%1$s() const\n"
+			    "\t\t{\n"
+			    "\t\t\treturn get<char, fields::%1$s>();\n"
+			    "\t\t}\n",
+			    qmm->name);
+	} else if (qmm->array_size) {
+		fprintf(fp, "\n"
+			    "\t\tstd::optional<qmi::array_view<%2$s>> get_%1$s() const\n"
+			    "\t\t{\n"
+			    "\t\t\treturn get<%2$s, fields::%1$s>();\n"
+			    "\t\t}\n",
+			    qmm->name, type);
+	} else {
+		fprintf(fp, "\n"
+			    "\t\tstd::optional<%2$s> get_%1$s() const\n"
+			    "\t\t{\n"
+			    "\t\t\treturn get<%2$s, fields::%1$s>();\n"
+			    "\t\t}\n",
+			    qmm->name, type);
+	}
+}
+
+static void emit_cxx_setter(FILE *fp, struct qmi_message_member *qmm)
+{
+	char type[256];
+
+	cxx_member_type(type, sizeof(type), qmm);
+
+	if (qmm->type == TYPE_STRING) {
+		fprintf(fp, "\n"
+			    "\t\tbool set_%1$s(std::string_view val)\n"
+			    "\t\t{\n"
+			    "\t\t\treturn put_string<fields::%1$s>(val);\n"
+			    "\t\t}\n",
+			    qmm->name);
+	} else if (qmm->array_fixed) {
+		fprintf(fp, "\n"
+			    "\t\tbool set_%1$s(std::span<const %2$s, fields::%1$s.array_size> val)\n"
+			    "\t\t{\n"
+			    "\t\t\treturn put_array<%2$s, fields::%1$s>(val);\n"
+			    "\t\t}\n",
+			    qmm->name, type);
+	} else if (qmm->array_size) {
+		fprintf(fp, "\n"
+			    "\t\ttemplate <std::size_t N>\n"
+			    "\t\tbool set_%1$s(std::span<const %2$s, N> val)\n"
+			    "\t\t{\n"
+			    "\t\t\tstatic_assert(N == std::dynamic_extent || N <= fields::%1$s.array_size, \"%1$s holds at most %3$d elements\");\n"
+			    "\n"
+			    "\t\t\treturn set_%1$s(std::span<const %2$s>(val));\n"
+			    "\t\t}\n"
+			    "\n"
+			    "\t\tbool set_%1$s(std::span<const %2$s> val)\n"
+			    "\t\t{\n"
+			    "\t\t\treturn put_array<%2$s, fields::%1$s>(val);\n"
+			    "\t\t}\n",
+			    qmm->name, type, qmm->array_size);
+	} else {
+		fprintf(fp, "\n"
+			    "\t\tbool set_%1$s(const %2$s &val)\n"
+			    "\t\t{\n"
+			    "\t\t\treturn put_value<%2$s, fields::%1$s>(val);\n"
+			    "\t\t}\n",
+			    qmm->name, type);
+	}
+}
+
+static void emit_cxx_message(FILE *fp, struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	unsigned count = 0;
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		if (qmm->type == TYPE_STRING && qmm->array_size) {
+			fprintf(stderr, "string arrays are not supported by the C++ backend\n");
+			exit(1);
+		}
+		cxx_check_name(qmm->name);
+	}
+
+	fprintf(fp, "struct %s {\n"
+		    "\tstatic constexpr unsigned msg_id = %d;\n"
+		    "\tstatic constexpr unsigned type = %d;\n"
+		    "\n"
+		    "\tstruct fields {\n",
+		    qm->name, qm->msg_id, qm->type);
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		fprintf(fp, "\t\tstatic constexpr qmi::field %s = { %d, qmi::kind::%s, %s, %d, %s, %d };\n",
+			qmm->name, qmm->id, sz_cxx_kinds[qmm->type],
+			qmm->required ? "true" : "false", qmm->array_size,
+			qmm->array_fixed ? "true" : "false", count++);
+	}
+
+	fprintf(fp, "\t};\n"
+		    "\n"
+		    "\t/* Slot of the member of each TLV id, in the reader */\n"
+		    "\tstatic constexpr int index(std::uint8_t id)\n"
+		    "\t{\n"
+		    "\t\tswitch (id) {\n");
+
+	count = 0;
+	list_for_each_entry(qmm, &qm->members, node) {
+		fprintf(fp, "\t\tcase %d:\n"
+			    "\t\t\treturn %d;\n",
+			    qmm->id, count++);
+	}
+
+	fprintf(fp, "\t\tdefault:\n"
+		    "\t\t\treturn -1;\n"
+		    "\t\t}\n"
+		    "\t}\n"
+		    "\n"
+		    "\tclass reader : public qmi::reader<%d, index> {\n"
+		    "\tpublic:\n"
+		    "\t\texplicit reader(std::span<const std::uint8_t> buf) : qmi::reader<%d, index>(buf, msg_id, type) {}\n",
+		    count, count);
+
+	list_for_each_entry(qmm, &qm->members, node)
+		emit_cxx_getter(fp, qmm);
+
+	fprintf(fp, "\t};\n"
+		    "\n"
+		    "\tclass writer : public qmi::writer {\n"
+		    "\tpublic:\n"
+		    "\t\twriter(std::span<std::uint8_t> buf, unsigned txn) : qmi::writer(buf, txn, msg_id, type) {}\n");
+
+	list_for_each_entry(qmm, &qm->members, node)
+		emit_cxx_setter(fp, qmm);
+
+	fprintf(fp, "\t};\n"
+		    "};\n"
+		    "\n");
+}
+
+void cxx_emit_h(FILE *fp, const char *package)
+{
+	struct qmi_message *qm;
+	struct qmi_struct *qs;
+	struct qmi_const *qc;
+	char *upper;
+	char *p;
+
+	upper = p = strdup(package);
+	while (*p) {
+		*p = toupper(*p);
+		p++;
+	}
+
+	fprintf(fp, "#ifndef __QMI_%s_HPP__\n", upper);
+	fprintf(fp, "#define __QMI_%s_HPP__\n", upper);
+	fprintf(fp, "\n");
+
+	free(upper);
+
+	fprintf(fp, "#include <array>\n"
+		    "#include <bit>\n"
+		    "#include <cstddef>\n"
+		    "#include <cstdint>\n"
+		    "#include <cstring>\n"
+		    "#include <optional>\n"
+		    "#include <span>\n"
+		    "#include <string_view>\n"
+		    "#include <type_traits>\n"
+		    "\n");
+
+	fputs(cxx_runtime, fp);
+
+	fprintf(fp, "namespace %s {\n\n", package);
+
+	if (!list_empty(&qmi_consts)) {
+		list_for_each_entry(qc, &qmi_consts, node)
+			fprintf(fp, "constexpr unsigned long long %s = %lluULL;\n",
+				qc->name, qc->value);
+		fprintf(fp, "\n");
+	}
+
+	list_for_each_entry(qs, &qmi_structs, node)
+		emit_cxx_struct(fp, qs);
+
+	if (!list_empty(&qmi_structs)) {
+		fprintf(fp, "}\n"
+			    "\n"
+			    "namespace qmi {\n"
+			    "\n");
+
+		list_for_each_entry(qs, &qmi_structs, node)
+			emit_cxx_codec(fp, package, qs);
+
+		fprintf(fp, "}\n"
+			    "\n"
+			    "namespace %s {\n"
+			    "\n",
+			    package);
+	}
+
+	list_for_each_entry(qm, &qmi_messages, node)
+		emit_cxx_message(fp, qm);
+
+	fprintf(fp, "}\n"
+		    "\n"
+		    "#endif\n");
+}
@@ -0,0 +1,196 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qmic.h"
+
+/*
+ * Per package message lookup table, keyed by msg_id and type. Messages are
+ * placed in an open addressed hash table that is at most half full, with slot
+ * positions resolved at generation time so lookups only need to probe.
+ */
+
+#define DISPATCH_HASH_MUL	2654435761u
+
+unsigned qmi_struct_max_size(struct qmi_struct *qs)
+{
+	static const unsigned simple_sizes[] = {
+		[TYPE_U8] = 1,
+		[TYPE_U16] = 2,
+		[TYPE_U32] = 4,
+		[TYPE_U64] = 8,
+	};
+	struct qmi_struct_member *qsm;
+	unsigned size = 0;
+
+	/* Strings within structs carry a 2 byte length, as their elem_len is 256 */
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING)
+			size += 2 + QMI_STRING_MAX;
+		else
+			size += simple_sizes[qsm->type];
+	}
+
+	return size;
+}
+
+/* Upper bound of the encoded TLVs of a message, excluding the QMI header */
+unsigned qmi_message_max_size(struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	unsigned size = 0;
+	unsigned elem;
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		switch (qmm->type) {
+		case TYPE_U8:
+			elem = 1;
+			break;
+		case TYPE_U16:
+			elem = 2;
+			break;
+		case TYPE_U32:
+			elem = 4;
+			break;
+		case TYPE_U64:
+			elem = 8;
+			break;
+		case TYPE_STRING:
+			elem = QMI_STRING_MAX;
+			break;
+		case TYPE_STRUCT:
+			elem = qmi_struct_max_size(qmm->qmi_struct);
+			break;
+		default:
+			elem = 0;
+			break;
+		}
+
+		/* Struct arrays are all VAR_LEN_ARRAY, so fixed ones carry a count too */
+		size += 3;
+		if (qmm->array_size && qmm->array_fixed && qmm->type != TYPE_STRUCT)
+			size += qmm->array_size * elem;
+		else if (qmm->array_size)
+			size += (qmm->array_size >= 256 ? 2 : 1) + qmm->array_size * elem;
+		else
+			size += elem;
+	}
+
+	return size;
+}
+
+static unsigned dispatch_hash(unsigned msg_id, unsigned type, unsigned bits)
+{
+	uint32_t key = msg_id << 2 | type >> 1;
+
+	return (uint32_t)(key * DISPATCH_HASH_MUL) >> (32 - bits);
+}
+
+void dispatch_emit_h(FILE *fp, const char *package, const char *handler)
+{
+	fprintf(fp, "struct %1$s_msg_info {\n"
+		    "\tunsigned msg_id;\n"
+		    "\tunsigned type;\n"
+		    "\tconst char *name;\n"
+		    "\tunsigned max_len;\n"
+		    "%2$s"
+		    "};\n"
+		    "\n"
+		    "const struct %1$s_msg_info *%1$s_lookup(unsigned msg_id, unsigned type);\n"
+		    "\n",
+		    package, handler);
+}
+
+void dispatch_emit_c(FILE *fp, const char *package,
+		     void (*emit_handler)(FILE *fp, const char *package,
+					  struct qmi_message *qm))
+{
+	struct qmi_message *qm;
+	unsigned *slots;
+	unsigned count = 0;
+	unsigned bits = 1;
+	unsigned slot;
+	unsigned i;
+
+	list_for_each_entry(qm, &qmi_messages, node)
+		count++;
+
+	/* Without messages there is no table, as C has no empty arrays */
+	if (!count) {
+		fprintf(fp, "const struct %1$s_msg_info *%1$s_lookup(unsigned msg_id, unsigned type)\n"
+			    "{\n"
+			    "\t(void)msg_id;\n"
+			    "\t(void)type;\n"
+			    "\n"
+			    "\treturn NULL;\n"
+			    "}\n"
+			    "\n",
+			    package);
+		return;
+	}
+
+	while ((1u << bits) < count * 2)
+		bits++;
+
+	slots = calloc(1u << bits, sizeof(*slots));
+	if (!slots) {
+		fprintf(stderr, "failed to allocate dispatch table\n");
+		exit(1);
+	}
+
+	fprintf(fp, "static const struct %s_msg_info %s_msgs[] = {\n",
+		package, package);
+
+	i = 0;
+	list_for_each_entry(qm, &qmi_messages, node) {
+		fprintf(fp, "\t{\n"
+			    "\t\t.msg_id = %d,\n"
+			    "\t\t.type = %d,\n"
+			    "\t\t.name = \"%s\",\n"
+			    "\t\t.max_len = %d,\n",
+			    qm->msg_id, qm->type, qm->name,
+			    qmi_message_max_size(qm));
+		emit_handler(fp, package, qm);
+		fprintf(fp, "\t},\n");
+
+		slot = dispatch_hash(qm->msg_id, qm->type, bits);
+		while (slots[slot])
+			slot = (slot + 1) & ((1u << bits) - 1);
+		slots[slot] = ++i;
+	}
+
+	fprintf(fp, "};\n"
+		    "\n");
+
+	fprintf(fp, "static const uint16_t %s_msg_slots[%d] = {\n",
+		package, 1u << bits);
+	for (slot = 0; slot < (1u << bits); slot++) {
+		if (slots[slot])
+			fprintf(fp, "\t[%d] = %d,\n", slot, slots[slot]);
+	}
+	fprintf(fp, "};\n"
+		    "\n");
+
+	fprintf(fp, "const struct %1$s_msg_info *%1$s_lookup(unsigned msg_id, unsigned type)\n"
+		    "{\n"
+		    "\tconst struct %1$s_msg_info *info;\n"
+		    "\tuint32_t key = msg_id << 2 | type >> 1;\n"
+		    "\tunsigned slot;\n"
+		    "\n"
+		    "\tslot = (uint32_t)(key * %2$uu) >> %3$d;\n"
+		    "\twhile (%1$s_msg_slots[slot]) {\n"
+		    "\t\tinfo = &%1$s_msgs[%1$s_msg_slots[slot] - 1];\n"
+		    "\t\tif (info->msg_id == msg_id && info->type == type)\n"
+		    "\t\t\treturn info;\n"
+		    "\n"
+		    "\t\tslot = (slot + 1) & %4$d;\n"
+		    "\t}\n"
+		    "\n"
+		    "\treturn NULL;\n"
+		    "}\n"
+		    "\n",
+		    package, DISPATCH_HASH_MUL, 32 - bits, (1u << bits) - 1);
+
+	free(slots);
+}
@@ -88,8 +88,7 @@ static void emit_struct_ei(FILE *fp, const char *package, struct qmi_struct *qs)
 	fprintf(fp, "\n");
 }
 
-static void emit_native_type(FILE *fp, const char *package, struct qmi_message *qm,
-			    struct qmi_message_member *qmm)
+static void emit_native_type(FILE *fp, struct qmi_message_member *qmm)
 {
 	static const char *sz_types[] = {
 		[TYPE_U8] = "uint8_t",
@@ -111,7 +110,7 @@ static void emit_native_type(FILE *fp, const char *package, struct qmi_message *
 	}
 }
 
-static void emit_struct_type(FILE *fp, const char *package, struct qmi_message *qm,
+static void emit_struct_type(FILE *fp, const char *package,
 			     struct qmi_message_member *qmm)
 {
 	struct qmi_struct *qs = qmm->qmi_struct;
@@ -139,14 +138,14 @@ static void emit_msg_struct(FILE *fp, const char *package, struct qmi_message *q
 		case TYPE_U16:
 		case TYPE_U32:
 		case TYPE_U64:
-			emit_native_type(fp, package, qm, qmm);
+			emit_native_type(fp, qmm);
 			break;
 		case TYPE_STRING:
 			fprintf(fp, "\tuint32_t %s_len;\n", qmm->name);
 			fprintf(fp, "\tchar %s[256];\n", qmm->name);
 			break;
 		case TYPE_STRUCT:
-			emit_struct_type(fp, package, qm, qmm);
+			emit_struct_type(fp, package, qmm);
 			break;
 		}
 	}
@@ -306,6 +305,383 @@ static void emit_elem_info_array(FILE *fp, const char *package, struct qmi_messa
 	fprintf(fp, "\n");
 }
 
+/*
+ * Per struct and message copy, equal and clear helpers. Only valid members,
+ * the used part of variable length arrays and the NUL terminated part of
+ * strings are touched, so the cost follows the content rather than the
+ * capacity of the struct.
+ */
+static bool kernel_has_strings(void)
+{
+	struct qmi_message_member *qmm;
+	struct qmi_struct_member *qsm;
+	struct qmi_message *qm;
+	struct qmi_struct *qs;
+
+	list_for_each_entry(qs, &qmi_structs, node) {
+		list_for_each_entry(qsm, &qs->members, node) {
+			if (qsm->type == TYPE_STRING)
+				return true;
+		}
+	}
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		list_for_each_entry(qmm, &qm->members, node) {
+			if (qmm->type == TYPE_STRING)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static bool kernel_has_struct_array(struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		if (qmm->type == TYPE_STRUCT && qmm->array_size)
+			return true;
+	}
+
+	return false;
+}
+
+static void emit_string_copy(FILE *fp)
+{
+	fprintf(fp, "static void qmi_string_copy(char *dst, const char *src, size_t size)\n"
+		    "{\n"
+		    "\tsize_t len = strnlen(src, size - 1);\n"
+		    "\n"
+		    "\tmemcpy(dst, src, len);\n"
+		    "\tdst[len] = '\\0';\n"
+		    "}\n"
+		    "\n");
+}
+
+/*
+ * Walk the TLVs of an encoded message once, checking that they cover it and
+ * noting their ids, then compare those against the required ones.
+ */
+static void emit_validate_message(FILE *fp)
+{
+	fprintf(fp, "static int qmi_validate_message(const void *buf, size_t len, unsigned msg_id, unsigned type,\n"
+		    "\t\t\t\tconst uint64_t required[4])\n"
+		    "{\n"
+		    "\tconst uint8_t *pkt = buf;\n"
+		    "\tuint64_t present[4] = {};\n"
+		    "\tsize_t offset = 7;\n"
+		    "\tsize_t end;\n"
+		    "\tunsigned i;\n"
+		    "\n"
+		    "\tif (len < 7 || pkt[0] != type || (unsigned)(pkt[3] | pkt[4] << 8) != msg_id)\n"
+		    "\t\treturn -EINVAL;\n"
+		    "\n"
+		    "\tend = 7 + (pkt[5] | pkt[6] << 8);\n"
+		    "\tif (end > len)\n"
+		    "\t\treturn -EINVAL;\n"
+		    "\n"
+		    "\twhile (offset < end) {\n"
+		    "\t\tif (end - offset < 3)\n"
+		    "\t\t\treturn -EINVAL;\n"
+		    "\n"
+		    "\t\tpresent[pkt[offset] / 64] |= 1ULL << (pkt[offset] %% 64);\n"
+		    "\t\toffset += 3 + (pkt[offset + 1] | pkt[offset + 2] << 8);\n"
+		    "\t}\n"
+		    "\n"
+		    "\tif (offset != end)\n"
+		    "\t\treturn -EINVAL;\n"
+		    "\n"
+		    "\tfor (i = 0; i < 4; i++) {\n"
+		    "\t\tif ((present[i] & required[i]) != required[i])\n"
+		    "\t\t\treturn -EPROTO;\n"
+		    "\t}\n"
+		    "\n"
+		    "\treturn 0;\n"
+		    "}\n"
+		    "\n");
+}
+
+static void emit_msg_validate(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	unsigned long long required[4];
+
+	qmi_message_required(qm, required);
+
+	fprintf(fp, "int %1$s_%2$s_validate(const void *buf, size_t len)\n"
+		    "{\n"
+		    "\tstatic const uint64_t required[4] = { 0x%5$llxULL, 0x%6$llxULL, 0x%7$llxULL, 0x%8$llxULL };\n"
+		    "\n"
+		    "\treturn qmi_validate_message(buf, len, %3$d, %4$d, required);\n"
+		    "}\n"
+		    "\n",
+		package, qm->name, qm->msg_id, qm->type,
+		required[0], required[1], required[2], required[3]);
+}
+
+static void emit_struct_helpers_decl(FILE *fp, const char *package, struct qmi_struct *qs)
+{
+	fprintf(fp, "void %1$s_%2$s_copy(struct %1$s_%2$s *dst, const struct %1$s_%2$s *src);\n"
+		    "bool %1$s_%2$s_equal(const struct %1$s_%2$s *a, const struct %1$s_%2$s *b);\n"
+		    "void %1$s_%2$s_clear(struct %1$s_%2$s *val);\n",
+		package, qs->name);
+}
+
+static void emit_struct_helpers(FILE *fp, const char *package, struct qmi_struct *qs)
+{
+	struct qmi_struct_member *qsm;
+
+	fprintf(fp, "void %1$s_%2$s_copy(struct %1$s_%2$s *dst, const struct %1$s_%2$s *src)\n"
+		    "{\n",
+		package, qs->name);
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING)
+			fprintf(fp, "\tqmi_string_copy(dst->%1$s, src->%1$s, sizeof(dst->%1$s));\n"
+				    "\tdst->%1$s_len = src->%1$s_len;\n",
+				qsm->name);
+		else
+			fprintf(fp, "\tdst->%1$s = src->%1$s;\n", qsm->name);
+	}
+	fprintf(fp, "}\n"
+		    "\n");
+
+	fprintf(fp, "bool %1$s_%2$s_equal(const struct %1$s_%2$s *a, const struct %1$s_%2$s *b)\n"
+		    "{\n",
+		package, qs->name);
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING)
+			fprintf(fp, "\tif (strncmp(a->%1$s, b->%1$s, sizeof(a->%1$s)))\n"
+				    "\t\treturn false;\n",
+				qsm->name);
+		else
+			fprintf(fp, "\tif (a->%1$s != b->%1$s)\n"
+				    "\t\treturn false;\n",
+				qsm->name);
+	}
+	fprintf(fp, "\n"
+		    "\treturn true;\n"
+		    "}\n"
+		    "\n");
+
+	fprintf(fp, "void %1$s_%2$s_clear(struct %1$s_%2$s *val)\n"
+		    "{\n",
+		package, qs->name);
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING)
+			fprintf(fp, "\tval->%1$s[0] = '\\0';\n"
+				    "\tval->%1$s_len = 0;\n",
+				qsm->name);
+		else
+			fprintf(fp, "\tval->%s = 0;\n", qsm->name);
+	}
+	fprintf(fp, "}\n"
+		    "\n");
+}
+
+static void emit_member_copy(FILE *fp, const char *package, struct qmi_message_member *qmm,
+			     const char *t)
+{
+	const char *name = qmm->name;
+	unsigned n = qmm->array_size;
+
+	if (qmm->type == TYPE_STRING) {
+		fprintf(fp, "%1$sqmi_string_copy(dst->%2$s, src->%2$s, sizeof(dst->%2$s));\n"
+			    "%1$sdst->%2$s_len = src->%2$s_len;\n",
+			t, name);
+	} else if (qmm->type == TYPE_STRUCT && n) {
+		/* Struct arrays are all VAR_LEN_ARRAY, so fixed ones carry _len too */
+		fprintf(fp, "%1$sdst->%2$s_len = src->%2$s_len;\n"
+			    "%1$sfor (i = 0; i < src->%2$s_len && i < %3$u; i++)\n"
+			    "%1$s\t%4$s_%5$s_copy(&dst->%2$s[i], &src->%2$s[i]);\n",
+			t, name, n, package, qmm->qmi_struct->name);
+	} else if (qmm->type == TYPE_STRUCT) {
+		fprintf(fp, "%1$s%2$s_%3$s_copy(&dst->%4$s, &src->%4$s);\n",
+			t, package, qmm->qmi_struct->name, name);
+	} else if (n && !qmm->array_fixed) {
+		fprintf(fp, "%1$sdst->%2$s_len = src->%2$s_len;\n"
+			    "%1$smemcpy(dst->%2$s, src->%2$s, (src->%2$s_len < %3$u ? src->%2$s_len : %3$u) * sizeof(dst->%2$s[0]));\n",
+			t, name, n);
+	} else if (n) {
+		fprintf(fp, "%1$smemcpy(dst->%2$s, src->%2$s, sizeof(dst->%2$s));\n", t, name);
+	} else {
+		fprintf(fp, "%1$sdst->%2$s = src->%2$s;\n", t, name);
+	}
+}
+
+/* Compare a member of a and b, running fail when they differ */
+static void emit_member_equal(FILE *fp, const char *package, struct qmi_message_member *qmm,
+			      const char *t, const char *fail)
+{
+	const char *name = qmm->name;
+	unsigned n = qmm->array_size;
+
+	if (qmm->type == TYPE_STRING) {
+		fprintf(fp, "%1$sif (strncmp(a->%2$s, b->%2$s, sizeof(a->%2$s)))\n"
+			    "%1$s\t%3$s\n",
+			t, name, fail);
+	} else if (qmm->type == TYPE_STRUCT && n) {
+		fprintf(fp, "%1$sif (a->%2$s_len != b->%2$s_len)\n"
+			    "%1$s\t%4$s\n"
+			    "%1$sfor (i = 0; i < a->%2$s_len && i < %3$u; i++) {\n",
+			t, name, n, fail);
+		fprintf(fp, "%1$s\tif (!%2$s_%3$s_equal(&a->%4$s[i], &b->%4$s[i]))\n"
+			    "%1$s\t\t%5$s\n"
+			    "%1$s}\n",
+			t, package, qmm->qmi_struct->name, name, fail);
+	} else if (qmm->type == TYPE_STRUCT) {
+		fprintf(fp, "%1$sif (!%2$s_%3$s_equal(&a->%4$s, &b->%4$s))\n"
+			    "%1$s\t%5$s\n",
+			t, package, qmm->qmi_struct->name, name, fail);
+	} else if (n && !qmm->array_fixed) {
+		fprintf(fp, "%1$sif (a->%2$s_len != b->%2$s_len ||\n"
+			    "%1$s    memcmp(a->%2$s, b->%2$s, (a->%2$s_len < %3$u ? a->%2$s_len : %3$u) * sizeof(a->%2$s[0])))\n"
+			    "%1$s\t%4$s\n",
+			t, name, n, fail);
+	} else if (n) {
+		fprintf(fp, "%1$sif (memcmp(a->%2$s, b->%2$s, sizeof(a->%2$s)))\n"
+			    "%1$s\t%3$s\n",
+			t, name, fail);
+	} else {
+		fprintf(fp, "%1$sif (a->%2$s != b->%2$s)\n"
+			    "%1$s\t%3$s\n",
+			t, name, fail);
+	}
+}
+
+static void emit_member_clear(FILE *fp, const char *package, struct qmi_message_member *qmm)
+{
+	const char *name = qmm->name;
+
+	if (qmm->type == TYPE_STRING)
+		fprintf(fp, "\tmsg->%1$s[0] = '\\0';\n"
+			    "\tmsg->%1$s_len = 0;\n",
+			name);
+	else if (!qmm->required)
+		fprintf(fp, "\tmsg->%s_valid = false;\n", name);
+	else if (qmm->array_size && (!qmm->array_fixed || qmm->type == TYPE_STRUCT))
+		fprintf(fp, "\tmsg->%s_len = 0;\n", name);
+	else if (qmm->array_size)
+		fprintf(fp, "\tmemset(msg->%1$s, 0, sizeof(msg->%1$s));\n", name);
+	else if (qmm->type == TYPE_STRUCT)
+		fprintf(fp, "\t%s_%s_clear(&msg->%s);\n",
+			package, qmm->qmi_struct->name, name);
+	else
+		fprintf(fp, "\tmsg->%s = 0;\n", name);
+}
+
+/* Compare a message member, minding _valid, running fail when they differ */
+static void emit_member_compare(FILE *fp, const char *package, struct qmi_message_member *qmm,
+				const char *fail)
+{
+	if (qmm->required || qmm->type == TYPE_STRING) {
+		emit_member_equal(fp, package, qmm, "\t", fail);
+		return;
+	}
+
+	fprintf(fp, "\tif (a->%1$s_valid != b->%1$s_valid)\n"
+		    "\t\t%2$s\n"
+		    "\tif (a->%1$s_valid) {\n",
+		qmm->name, fail);
+	emit_member_equal(fp, package, qmm, "\t\t", fail);
+	fprintf(fp, "\t}\n");
+}
+
+static void emit_msg_helpers_decl(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	fprintf(fp, "void %1$s_%2$s_copy(struct %1$s_%2$s *dst, const struct %1$s_%2$s *src);\n"
+		    "bool %1$s_%2$s_equal(const struct %1$s_%2$s *a, const struct %1$s_%2$s *b);\n"
+		    "int %1$s_%2$s_diff(const struct %1$s_%2$s *a, const struct %1$s_%2$s *b, uint64_t changed[4]);\n"
+		    "void %1$s_%2$s_clear(struct %1$s_%2$s *msg);\n"
+		    "int %1$s_%2$s_validate(const void *buf, size_t len);\n",
+		package, qm->name);
+}
+
+static void emit_msg_helpers(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+	const char *locals;
+	char fail[64];
+	bool simple;
+
+	/* Strings have no _valid in the kernel structs, so are always copied */
+	locals = kernel_has_struct_array(qm) ? "\tunsigned i;\n\n" : "";
+
+	fprintf(fp, "void %1$s_%2$s_copy(struct %1$s_%2$s *dst, const struct %1$s_%2$s *src)\n"
+		    "{\n"
+		    "%3$s",
+		package, qm->name, locals);
+	if (list_empty(&qm->members))
+		fprintf(fp, "\t(void)dst;\n"
+			    "\t(void)src;\n");
+	list_for_each_entry(qmm, &qm->members, node) {
+		if (qmm->required || qmm->type == TYPE_STRING) {
+			emit_member_copy(fp, package, qmm, "\t");
+			continue;
+		}
+
+		/* Scalars, structs and fixed native arrays copy in one statement */
+		simple = !qmm->array_size || (qmm->array_fixed && qmm->type != TYPE_STRUCT);
+
+		fprintf(fp, "\tdst->%1$s_valid = src->%1$s_valid;\n"
+			    "\tif (src->%1$s_valid)%2$s\n",
+			qmm->name, simple ? "" : " {");
+		emit_member_copy(fp, package, qmm, "\t\t");
+		if (!simple)
+			fprintf(fp, "\t}\n");
+	}
+	fprintf(fp, "}\n"
+		    "\n");
+
+	fprintf(fp, "bool %1$s_%2$s_equal(const struct %1$s_%2$s *a, const struct %1$s_%2$s *b)\n"
+		    "{\n"
+		    "%3$s",
+		package, qm->name, locals);
+	if (list_empty(&qm->members))
+		fprintf(fp, "\t(void)a;\n"
+			    "\t(void)b;\n");
+	list_for_each_entry(qmm, &qm->members, node)
+		emit_member_compare(fp, package, qmm, "return false;");
+	fprintf(fp, "\n"
+		    "\treturn true;\n"
+		    "}\n"
+		    "\n");
+
+	/* As _equal, but flagging each differing member by its TLV id */
+	fprintf(fp, "int %1$s_%2$s_diff(const struct %1$s_%2$s *a, const struct %1$s_%2$s *b, uint64_t changed[4])\n"
+		    "{\n"
+		    "%3$s"
+		    "\tmemset(changed, 0, 4 * sizeof(uint64_t));\n"
+		    "\n",
+		package, qm->name, locals);
+	if (list_empty(&qm->members))
+		fprintf(fp, "\t(void)a;\n"
+			    "\t(void)b;\n");
+	list_for_each_entry(qmm, &qm->members, node) {
+		snprintf(fail, sizeof(fail), "changed[%d] |= 1ULL << %d;", qmm->id / 64, qmm->id % 64);
+		emit_member_compare(fp, package, qmm, fail);
+	}
+	fprintf(fp, "\n"
+		    "\treturn __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +\n"
+		    "\t       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);\n"
+		    "}\n"
+		    "\n");
+
+	fprintf(fp, "void %1$s_%2$s_clear(struct %1$s_%2$s *msg)\n"
+		    "{\n",
+		package, qm->name);
+	if (list_empty(&qm->members))
+		fprintf(fp, "\t(void)msg;\n");
+	list_for_each_entry(qmm, &qm->members, node)
+		emit_member_clear(fp, package, qmm);
+	fprintf(fp, "}\n"
+		    "\n");
+}
+
+static void emit_dispatch_ei(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	fprintf(fp, "\t\t.ei = %1$s_%2$s_ei,\n", package, qm->name);
+}
+
 static void emit_h_file_header(FILE *fp)
 {
 	fprintf(fp, "#include <stdint.h>\n"
@@ -327,6 +703,22 @@ void kernel_emit_c(FILE *fp, const char *package)
 	
 	list_for_each_entry(qm, &qmi_messages, node)
 		emit_elem_info_array(fp, package, qm);
+
+	if (kernel_has_strings())
+		emit_string_copy(fp);
+
+	list_for_each_entry(qs, &qmi_structs, node)
+		emit_struct_helpers(fp, package, qs);
+
+	if (!list_empty(&qmi_messages))
+		emit_validate_message(fp);
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		emit_msg_helpers(fp, package, qm);
+		emit_msg_validate(fp, package, qm);
+	}
+
+	dispatch_emit_c(fp, package, emit_dispatch_ei);
 }
 	
 void kernel_emit_h(FILE *fp, const char *package)
@@ -348,5 +740,17 @@ void kernel_emit_h(FILE *fp, const char *package)
 		emit_elem_info_array_decl(fp, package, qm);
 	fprintf(fp, "\n");
 
+	list_for_each_entry(qs, &qmi_structs, node)
+		emit_struct_helpers_decl(fp, package, qs);
+
+	list_for_each_entry(qm, &qmi_messages, node)
+		emit_msg_helpers_decl(fp, package, qm);
+	fprintf(fp, "\n");
+
+	list_for_each_entry(qm, &qmi_messages, node)
+		qmi_message_emit_changed(fp, package, qm);
+
+	dispatch_emit_h(fp, package, "\tstruct qmi_elem_info *ei;\n");
+
 	guard_footer(fp);
 }
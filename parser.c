@@ -242,7 +242,7 @@ static struct symbol *qmi_identifier_parse(char *buf, size_t size, char ch)
 	/* First character is known to be alphabetic */
 	*p++ = ch;
 	while ((ch = input()) && (isalnum(ch) || ch == '_')) {
-		if (p - buf == size) {
+		if ((size_t)(p - buf) == size) {
 			buf[TOKEN_BUF_MIN] = '\0';
 			yyerror("token too long: \"%s...\"", buf);
 		}
@@ -286,7 +286,7 @@ static unsigned qmi_number_parse(char *buf, size_t size, char ch)
 	}
 
 	while ((ch = input()) && isvalid(ch)) {
-		if (p - buf == size) {
+		if ((size_t)(p - buf) == size) {
 			buf[TOKEN_BUF_MIN] = '\0';
 			yyerror("number too long: \"%s...\"", buf);
 		}
@@ -411,6 +411,19 @@ static void qmi_package_parse(void)
 	qmi_package = tok.str;
 }
 
+/*
+ * Consts and structs become tokens once defined, but a message name is free
+ * to be reused; all share the namespace of the generated code
+ */
+static void qmi_name_check(const char *name)
+{
+	struct qmi_message *qm;
+
+	list_for_each_entry(qm, &qmi_messages, node)
+		if (!strcmp(qm->name, name))
+			yyerror("duplicate name \"%s\"", name);
+}
+
 static void qmi_const_parse()
 {
 	struct qmi_const *qcm;
@@ -426,6 +439,7 @@ static void qmi_const_parse()
 	list_for_each_entry(qcm, &qmi_consts, node)
 		if (!strcmp(qcm->name, id_tok.str))
 			yyerror("duplicate constant \"%s\"", qcm->name);
+	qmi_name_check(id_tok.str);
 
 	qc = memalloc(sizeof(struct qmi_const));
 	qc->name = id_tok.str;
@@ -451,6 +465,8 @@ static void qmi_message_parse(enum message_type message_type)
 	token_expect(TOK_ID, &msg_id_tok);
 	token_expect('{', NULL);
 
+	qmi_name_check(msg_id_tok.str);
+
 	qm = memalloc(sizeof(struct qmi_message));
 	qm->name = msg_id_tok.str;
 	qm->type = message_type;
@@ -490,7 +506,7 @@ static void qmi_message_parse(enum message_type message_type)
 			if (!strcmp(qmm->name, id_tok.str))
 				yyerror("duplicate message member \"%s\"",
 					qmm->name);
-			if (qmm->id == num_tok.num)
+			if ((unsigned long long)qmm->id == num_tok.num)
 				yyerror("duplicate message member number %u",
 					qmm->id);
 		}
@@ -531,6 +547,8 @@ static void qmi_struct_parse(void)
 	token_expect(TOK_ID, &struct_id_tok);
 	token_expect('{', NULL);
 
+	qmi_name_check(struct_id_tok.str);
+
 	qs = memalloc(sizeof(struct qmi_struct));
 	qs->name = struct_id_tok.str;
 	list_init(&qs->members);
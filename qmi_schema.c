@@ -0,0 +1,318 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "qmi_schema.h"
+
+struct qmi_schema {
+	/* Mapping owned by the schema, when opened from a file */
+	void *map;
+	size_t map_size;
+
+	const uint8_t *base;
+	const struct qmi_schema_file_const *consts;
+	const struct qmi_schema_file_struct *structs;
+	const struct qmi_schema_file_message *messages;
+	const struct qmi_schema_file_member *members;
+	const uint16_t *slots;
+	const char *strings;
+	const char *package;
+
+	unsigned n_consts;
+	unsigned n_structs;
+	unsigned n_messages;
+	unsigned n_members;
+	unsigned slot_bits;
+	size_t strings_size;
+};
+
+static const void *qmi_schema_table(const uint8_t *base, size_t size,
+				    const struct qmi_schema_table *table,
+				    size_t elem, size_t align, unsigned *count)
+{
+	uint32_t offset = le32toh(table->offset);
+
+	*count = le32toh(table->count);
+
+	if (offset % align || offset > size || *count > (size - offset) / elem)
+		return NULL;
+
+	return base + offset;
+}
+
+static int qmi_schema_check_string(const struct qmi_schema *schema, uint32_t name)
+{
+	return le32toh(name) < schema->strings_size ? 0 : -EINVAL;
+}
+
+static int qmi_schema_check_members(const struct qmi_schema *schema,
+				    uint32_t first, uint32_t count)
+{
+	first = le32toh(first);
+	count = le32toh(count);
+
+	return first <= schema->n_members && count <= schema->n_members - first ?
+	       0 : -EINVAL;
+}
+
+/* Check every offset and index once, so the accessors need no bounds checks */
+static int qmi_schema_validate(struct qmi_schema *schema, size_t len)
+{
+	const struct qmi_schema_file *hdr = (const void *)schema->base;
+	const struct qmi_schema_file_member *member;
+	const uint8_t *base = schema->base;
+	unsigned n_slots;
+	unsigned n_strings;
+	unsigned used = 0;
+	unsigned i;
+
+	if ((uintptr_t)base % 8 || len < sizeof(*hdr) ||
+	    memcmp(hdr->magic, QMI_SCHEMA_MAGIC, sizeof(hdr->magic)))
+		return -EINVAL;
+
+	if (le32toh(hdr->version) != QMI_SCHEMA_VERSION || le32toh(hdr->size) > len)
+		return -EINVAL;
+	len = le32toh(hdr->size);
+
+	schema->consts = qmi_schema_table(base, len, &hdr->consts, sizeof(*schema->consts),
+					  8, &schema->n_consts);
+	schema->structs = qmi_schema_table(base, len, &hdr->structs, sizeof(*schema->structs),
+					   4, &schema->n_structs);
+	schema->messages = qmi_schema_table(base, len, &hdr->messages, sizeof(*schema->messages),
+					    4, &schema->n_messages);
+	schema->members = qmi_schema_table(base, len, &hdr->members, sizeof(*schema->members),
+					   4, &schema->n_members);
+	schema->slots = qmi_schema_table(base, len, &hdr->slots, sizeof(*schema->slots),
+					 2, &n_slots);
+	schema->strings = qmi_schema_table(base, len, &hdr->strings, 1, 1, &n_strings);
+	if (!schema->consts || !schema->structs || !schema->messages ||
+	    !schema->members || !schema->slots || !schema->strings)
+		return -EINVAL;
+
+	if (n_slots < 2 || (n_slots & (n_slots - 1)))
+		return -EINVAL;
+	schema->slot_bits = __builtin_ctz(n_slots);
+
+	/* A terminating NUL makes every in bounds name offset a valid string */
+	schema->strings_size = n_strings;
+	if (!n_strings || schema->strings[n_strings - 1])
+		return -EINVAL;
+
+	if (qmi_schema_check_string(schema, hdr->package))
+		return -EINVAL;
+	schema->package = schema->strings + le32toh(hdr->package);
+
+	for (i = 0; i < schema->n_consts; i++) {
+		if (qmi_schema_check_string(schema, schema->consts[i].name))
+			return -EINVAL;
+	}
+
+	for (i = 0; i < schema->n_structs; i++) {
+		if (qmi_schema_check_string(schema, schema->structs[i].name) ||
+		    qmi_schema_check_members(schema, schema->structs[i].first_member,
+					     schema->structs[i].n_members))
+			return -EINVAL;
+	}
+
+	for (i = 0; i < schema->n_messages; i++) {
+		if (qmi_schema_check_string(schema, schema->messages[i].name) ||
+		    qmi_schema_check_members(schema, schema->messages[i].first_member,
+					     schema->messages[i].n_members))
+			return -EINVAL;
+	}
+
+	for (i = 0; i < schema->n_members; i++) {
+		member = &schema->members[i];
+		if (qmi_schema_check_string(schema, member->name) ||
+		    member->type > QMI_SCHEMA_STRUCT)
+			return -EINVAL;
+
+		if (le16toh(member->qmi_struct) != QMI_SCHEMA_NO_STRUCT &&
+		    le16toh(member->qmi_struct) >= schema->n_structs)
+			return -EINVAL;
+	}
+
+	/* An empty slot must remain for lookups of unknown messages to end */
+	for (i = 0; i < n_slots; i++) {
+		if (le16toh(schema->slots[i]) > schema->n_messages)
+			return -EINVAL;
+		if (schema->slots[i])
+			used++;
+	}
+	if (used >= n_slots)
+		return -EINVAL;
+
+	return 0;
+}
+
+struct qmi_schema *qmi_schema_load(const void *buf, size_t len)
+{
+	struct qmi_schema *schema;
+	int ret;
+
+	schema = calloc(1, sizeof(*schema));
+	if (!schema)
+		return NULL;
+
+	schema->base = buf;
+
+	ret = qmi_schema_validate(schema, len);
+	if (ret < 0) {
+		free(schema);
+		errno = -ret;
+		return NULL;
+	}
+
+	return schema;
+}
+
+struct qmi_schema *qmi_schema_open(const char *path)
+{
+	struct qmi_schema *schema;
+	struct stat sb;
+	void *map;
+	int saved;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &sb) < 0) {
+		saved = errno;
+		close(fd);
+		errno = saved;
+		return NULL;
+	}
+
+	map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	saved = errno;
+	close(fd);
+	if (map == MAP_FAILED) {
+		errno = saved;
+		return NULL;
+	}
+
+	schema = qmi_schema_load(map, sb.st_size);
+	if (!schema) {
+		saved = errno;
+		munmap(map, sb.st_size);
+		errno = saved;
+		return NULL;
+	}
+
+	schema->map = map;
+	schema->map_size = sb.st_size;
+
+	return schema;
+}
+
+void qmi_schema_close(struct qmi_schema *schema)
+{
+	if (!schema)
+		return;
+
+	if (schema->map)
+		munmap(schema->map, schema->map_size);
+	free(schema);
+}
+
+const char *qmi_schema_package(const struct qmi_schema *schema)
+{
+	return schema->package;
+}
+
+int qmi_schema_get_const(const struct qmi_schema *schema, unsigned idx,
+			 struct qmi_schema_const *qc)
+{
+	if (idx >= schema->n_consts)
+		return -ENOENT;
+
+	qc->name = schema->strings + le32toh(schema->consts[idx].name);
+	qc->value = le64toh(schema->consts[idx].value);
+
+	return 0;
+}
+
+int qmi_schema_get_struct(const struct qmi_schema *schema, unsigned idx,
+			  struct qmi_schema_struct *qs)
+{
+	if (idx >= schema->n_structs)
+		return -ENOENT;
+
+	qs->name = schema->strings + le32toh(schema->structs[idx].name);
+	qs->first_member = le32toh(schema->structs[idx].first_member);
+	qs->n_members = le32toh(schema->structs[idx].n_members);
+
+	return 0;
+}
+
+int qmi_schema_get_message(const struct qmi_schema *schema, unsigned idx,
+			   struct qmi_schema_message *msg)
+{
+	const struct qmi_schema_file_message *qm;
+
+	if (idx >= schema->n_messages)
+		return -ENOENT;
+
+	qm = &schema->messages[idx];
+	msg->name = schema->strings + le32toh(qm->name);
+	msg->msg_id = le16toh(qm->msg_id);
+	msg->type = qm->type;
+	msg->first_member = le32toh(qm->first_member);
+	msg->n_members = le32toh(qm->n_members);
+
+	return 0;
+}
+
+int qmi_schema_get_member(const struct qmi_schema *schema, unsigned idx,
+			  struct qmi_schema_member *member)
+{
+	const struct qmi_schema_file_member *qmm;
+	unsigned qmi_struct;
+
+	if (idx >= schema->n_members)
+		return -ENOENT;
+
+	qmm = &schema->members[idx];
+	qmi_struct = le16toh(qmm->qmi_struct);
+
+	member->name = schema->strings + le32toh(qmm->name);
+	member->id = qmm->id;
+	member->type = qmm->type;
+	member->qmi_struct = qmi_struct == QMI_SCHEMA_NO_STRUCT ? -1 : (int)qmi_struct;
+	member->array_size = le16toh(qmm->array_size);
+	member->required = !!(qmm->flags & QMI_SCHEMA_REQUIRED);
+	member->array_fixed = !!(qmm->flags & QMI_SCHEMA_FIXED);
+
+	return 0;
+}
+
+int qmi_schema_lookup(const struct qmi_schema *schema, unsigned msg_id,
+		      unsigned type, struct qmi_schema_message *msg)
+{
+	const struct qmi_schema_file_message *qm;
+	unsigned mask = (1u << schema->slot_bits) - 1;
+	unsigned slot;
+	unsigned idx;
+
+	slot = qmi_schema_hash(msg_id, type, schema->slot_bits);
+	while ((idx = le16toh(schema->slots[slot])) != 0) {
+		qm = &schema->messages[idx - 1];
+		if (le16toh(qm->msg_id) == msg_id && qm->type == type) {
+			if (msg)
+				qmi_schema_get_message(schema, idx - 1, msg);
+			return idx - 1;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	return -ENOENT;
+}
@@ -0,0 +1,143 @@
+#ifndef __QMI_SCHEMA_H__
+#define __QMI_SCHEMA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Binary schema descriptor, as written by qmic -s. All fields are little
+ * endian and every table is naturally aligned, so the file can be used
+ * directly from an mmap()ed buffer.
+ */
+
+#define QMI_SCHEMA_MAGIC	"QSD\0"
+#define QMI_SCHEMA_VERSION	1
+
+#define QMI_SCHEMA_NO_STRUCT	0xffff
+
+#define QMI_SCHEMA_REQUIRED	(1 << 0)
+#define QMI_SCHEMA_FIXED	(1 << 1)
+
+enum qmi_schema_type {
+	QMI_SCHEMA_U8,
+	QMI_SCHEMA_U16,
+	QMI_SCHEMA_U32,
+	QMI_SCHEMA_U64,
+	QMI_SCHEMA_STRING,
+	QMI_SCHEMA_STRUCT,
+};
+
+struct qmi_schema_table {
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct qmi_schema_file {
+	char magic[4];
+	uint32_t version;
+	uint32_t size;
+	uint32_t package;
+
+	struct qmi_schema_table consts;
+	struct qmi_schema_table structs;
+	struct qmi_schema_table messages;
+	struct qmi_schema_table members;
+	/* Open addressed msg_id lookup, holding message index + 1 */
+	struct qmi_schema_table slots;
+	/* NUL terminated names, referenced by offset */
+	struct qmi_schema_table strings;
+};
+
+struct qmi_schema_file_const {
+	uint64_t value;
+	uint32_t name;
+	uint32_t reserved;
+};
+
+struct qmi_schema_file_struct {
+	uint32_t name;
+	uint32_t first_member;
+	uint32_t n_members;
+};
+
+struct qmi_schema_file_message {
+	uint32_t name;
+	uint16_t msg_id;
+	uint8_t type;
+	uint8_t reserved;
+	uint32_t first_member;
+	uint32_t n_members;
+};
+
+struct qmi_schema_file_member {
+	uint32_t name;
+	uint16_t array_size;
+	uint16_t qmi_struct;
+	uint8_t id;
+	uint8_t type;
+	uint8_t flags;
+	uint8_t reserved;
+};
+
+/* Same hash as the generated <package>_lookup(), over 1 << bits slots */
+static inline unsigned qmi_schema_hash(unsigned msg_id, unsigned type, unsigned bits)
+{
+	uint32_t key = msg_id << 2 | type >> 1;
+
+	return (uint32_t)(key * 2654435761u) >> (32 - bits);
+}
+
+/*
+ * Loader, validating the descriptor once so lookups can trust it. Buffers
+ * passed to qmi_schema_load() must be 8 byte aligned and outlive the schema.
+ */
+
+struct qmi_schema;
+
+struct qmi_schema_const {
+	const char *name;
+	unsigned long long value;
+};
+
+struct qmi_schema_struct {
+	const char *name;
+	unsigned first_member;
+	unsigned n_members;
+};
+
+struct qmi_schema_message {
+	const char *name;
+	unsigned msg_id;
+	unsigned type;
+	unsigned first_member;
+	unsigned n_members;
+};
+
+struct qmi_schema_member {
+	const char *name;
+	unsigned id;
+	enum qmi_schema_type type;
+	int qmi_struct;
+	unsigned array_size;
+	int required;
+	int array_fixed;
+};
+
+struct qmi_schema *qmi_schema_open(const char *path);
+struct qmi_schema *qmi_schema_load(const void *buf, size_t len);
+void qmi_schema_close(struct qmi_schema *schema);
+
+const char *qmi_schema_package(const struct qmi_schema *schema);
+int qmi_schema_lookup(const struct qmi_schema *schema, unsigned msg_id,
+		      unsigned type, struct qmi_schema_message *msg);
+
+int qmi_schema_get_const(const struct qmi_schema *schema, unsigned idx,
+			 struct qmi_schema_const *qc);
+int qmi_schema_get_struct(const struct qmi_schema *schema, unsigned idx,
+			  struct qmi_schema_struct *qs);
+int qmi_schema_get_message(const struct qmi_schema *schema, unsigned idx,
+			   struct qmi_schema_message *msg);
+int qmi_schema_get_member(const struct qmi_schema *schema, unsigned idx,
+			  struct qmi_schema_member *member);
+
+#endif
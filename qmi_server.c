@@ -0,0 +1,297 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/*
+ * Service side dispatcher for the generated server skeletons. Submitted
+ * requests are spread round robin over a pool of workers. Each worker
+ * handles its queued requests in one go, encoding the responses back to back
+ * into its own arena, and hands them to the transport in a single batch.
+ */
+
+#define QMI_SERVER_MAX_MSG	(7 + 65535)
+#define QMI_SERVER_ARENA	(4 * QMI_SERVER_MAX_MSG)
+
+typedef ssize_t (*qmi_server_handle)(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+typedef int (*qmi_server_send)(void **bufs, size_t *lens, size_t count, void *ctx);
+
+/* Requests stored back to back, with their lengths alongside */
+struct qmi_server_queue {
+	uint8_t *data;
+	size_t len;
+	size_t size;
+
+	size_t *lens;
+	size_t count;
+	size_t max_count;
+};
+
+struct qmi_server_worker {
+	struct qmi_server *server;
+	pthread_t thread;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct qmi_server_queue queue;
+	bool stop;
+
+	/* Owned by the worker thread */
+	struct qmi_server_queue work;
+	uint8_t *arena;
+	size_t arena_len;
+	void **bufs;
+	size_t *lens;
+	size_t count;
+	size_t max_count;
+};
+
+struct qmi_server {
+	qmi_server_handle handle;
+	const void *ops;
+	void *ctx;
+
+	qmi_server_send send;
+	void *send_ctx;
+
+	atomic_uint next;
+	unsigned n_workers;
+	struct qmi_server_worker workers[];
+};
+
+static int qmi_server_queue_push(struct qmi_server_queue *queue, const void *buf, size_t len)
+{
+	size_t *lens;
+	size_t size;
+	void *data;
+
+	if (queue->len + len > queue->size) {
+		size = queue->size ? queue->size : QMI_SERVER_MAX_MSG;
+		while (size < queue->len + len)
+			size *= 2;
+
+		data = realloc(queue->data, size);
+		if (!data)
+			return -ENOMEM;
+
+		queue->data = data;
+		queue->size = size;
+	}
+
+	if (queue->count == queue->max_count) {
+		size = queue->max_count ? queue->max_count * 2 : 64;
+		lens = realloc(queue->lens, size * sizeof(*lens));
+		if (!lens)
+			return -ENOMEM;
+
+		queue->lens = lens;
+		queue->max_count = size;
+	}
+
+	memcpy(queue->data + queue->len, buf, len);
+	queue->len += len;
+	queue->lens[queue->count++] = len;
+
+	return 0;
+}
+
+static void qmi_server_flush(struct qmi_server_worker *worker)
+{
+	struct qmi_server *server = worker->server;
+
+	if (worker->count)
+		server->send(worker->bufs, worker->lens, worker->count, server->send_ctx);
+
+	worker->arena_len = 0;
+	worker->count = 0;
+}
+
+static int qmi_server_respond(struct qmi_server_worker *worker, void *buf, size_t len)
+{
+	struct qmi_server *server = worker->server;
+	size_t max_count;
+	size_t *lens;
+	void **bufs;
+	ssize_t ret;
+
+	if (QMI_SERVER_ARENA - worker->arena_len < QMI_SERVER_MAX_MSG)
+		qmi_server_flush(worker);
+
+	if (worker->count == worker->max_count) {
+		max_count = worker->max_count ? worker->max_count * 2 : 64;
+		bufs = realloc(worker->bufs, max_count * sizeof(*bufs));
+		if (!bufs)
+			return -ENOMEM;
+		worker->bufs = bufs;
+
+		lens = realloc(worker->lens, max_count * sizeof(*lens));
+		if (!lens)
+			return -ENOMEM;
+		worker->lens = lens;
+
+		worker->max_count = max_count;
+	}
+
+	ret = server->handle(server->ops, buf, len, worker->arena + worker->arena_len,
+			     QMI_SERVER_ARENA - worker->arena_len, server->ctx);
+	if (ret <= 0)
+		return ret;
+
+	worker->bufs[worker->count] = worker->arena + worker->arena_len;
+	worker->lens[worker->count] = ret;
+	worker->arena_len += ret;
+	worker->count++;
+
+	return 0;
+}
+
+static void *qmi_server_run(void *data)
+{
+	struct qmi_server_worker *worker = data;
+	struct qmi_server_queue tmp;
+	size_t offset;
+	size_t i;
+	bool stop;
+
+	for (;;) {
+		pthread_mutex_lock(&worker->lock);
+		while (!worker->queue.count && !worker->stop)
+			pthread_cond_wait(&worker->cond, &worker->lock);
+
+		tmp = worker->queue;
+		worker->queue = worker->work;
+		worker->queue.len = 0;
+		worker->queue.count = 0;
+		worker->work = tmp;
+		stop = worker->stop;
+		pthread_mutex_unlock(&worker->lock);
+
+		offset = 0;
+		for (i = 0; i < worker->work.count; i++) {
+			qmi_server_respond(worker, worker->work.data + offset, worker->work.lens[i]);
+			offset += worker->work.lens[i];
+		}
+
+		qmi_server_flush(worker);
+
+		if (stop && !worker->work.count)
+			break;
+	}
+
+	return NULL;
+}
+
+static void qmi_server_queue_free(struct qmi_server_queue *queue)
+{
+	free(queue->data);
+	free(queue->lens);
+}
+
+/* Stop the first count workers, handling the requests still queued */
+static void qmi_server_stop(struct qmi_server *server, unsigned count)
+{
+	struct qmi_server_worker *worker;
+	unsigned i;
+
+	for (i = 0; i < count; i++) {
+		worker = &server->workers[i];
+
+		pthread_mutex_lock(&worker->lock);
+		worker->stop = true;
+		pthread_cond_signal(&worker->cond);
+		pthread_mutex_unlock(&worker->lock);
+	}
+
+	for (i = 0; i < count; i++) {
+		worker = &server->workers[i];
+
+		pthread_join(worker->thread, NULL);
+		pthread_mutex_destroy(&worker->lock);
+		pthread_cond_destroy(&worker->cond);
+		qmi_server_queue_free(&worker->queue);
+		qmi_server_queue_free(&worker->work);
+		free(worker->arena);
+		free(worker->bufs);
+		free(worker->lens);
+	}
+}
+
+/*
+ * handle() decodes a request and encodes its response into out, returning
+ * the response length or 0 for none. send() transmits a batch of responses
+ * and is called concurrently from the workers.
+ */
+struct qmi_server *qmi_server_init(unsigned n_workers, qmi_server_handle handle,
+				   const void *ops, void *ctx,
+				   qmi_server_send send, void *send_ctx)
+{
+	struct qmi_server_worker *worker;
+	struct qmi_server *server;
+	unsigned i;
+
+	if (!n_workers)
+		return NULL;
+
+	server = calloc(1, sizeof(struct qmi_server) + n_workers * sizeof(struct qmi_server_worker));
+	if (!server)
+		return NULL;
+
+	server->handle = handle;
+	server->ops = ops;
+	server->ctx = ctx;
+	server->send = send;
+	server->send_ctx = send_ctx;
+	server->n_workers = n_workers;
+	atomic_init(&server->next, 0);
+
+	for (i = 0; i < n_workers; i++) {
+		worker = &server->workers[i];
+		worker->server = server;
+		pthread_mutex_init(&worker->lock, NULL);
+		pthread_cond_init(&worker->cond, NULL);
+
+		worker->arena = malloc(QMI_SERVER_ARENA);
+		if (!worker->arena ||
+		    pthread_create(&worker->thread, NULL, qmi_server_run, worker)) {
+			free(worker->arena);
+			pthread_mutex_destroy(&worker->lock);
+			pthread_cond_destroy(&worker->cond);
+			qmi_server_stop(server, i);
+			free(server);
+			return NULL;
+		}
+	}
+
+	return server;
+}
+
+/* Queue a copy of the request buf for one of the workers */
+int qmi_server_submit(struct qmi_server *server, const void *buf, size_t len)
+{
+	struct qmi_server_worker *worker;
+	int ret;
+
+	if (len > QMI_SERVER_MAX_MSG)
+		return -EINVAL;
+
+	worker = &server->workers[atomic_fetch_add(&server->next, 1) % server->n_workers];
+
+	pthread_mutex_lock(&worker->lock);
+	ret = qmi_server_queue_push(&worker->queue, buf, len);
+	if (!ret && worker->queue.count == 1)
+		pthread_cond_signal(&worker->cond);
+	pthread_mutex_unlock(&worker->lock);
+
+	return ret;
+}
+
+/* Handles the requests still queued, then stops the workers */
+void qmi_server_free(struct qmi_server *server)
+{
+	qmi_server_stop(server, server->n_workers);
+	free(server);
+}
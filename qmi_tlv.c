@@ -1,109 +1,363 @@
+#include <endian.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
 
-struct qmi_tlv *qmi_tlv_init(void)
+#include "qmi_tlv.h"
+
+struct qmi_tlv *qmi_tlv_init(unsigned txn, unsigned msg_id, unsigned type)
 {
 	struct qmi_tlv *tlv;
 
 	tlv = malloc(sizeof(struct qmi_tlv));
+	if (!tlv)
+		return NULL;
 	memset(tlv, 0, sizeof(struct qmi_tlv));
 
+	tlv->txn = txn;
+	tlv->msg_id = msg_id;
+	tlv->type = type;
+
 	return tlv;
 }
 
-struct qmi_tlv *qmi_tlv_decode(void *buf, size_t len)
+/*
+ * Check that the TLVs exactly cover the message, so lookups can trust them,
+ * noting the ids found in present along the way.
+ */
+static int qmi_tlv_validate(void *buf, size_t len, uint64_t present[4])
+{
+	struct qmi_tlv_header *hdr;
+	size_t offset = 0;
+
+	while (offset < len) {
+		if (len - offset < sizeof(struct qmi_tlv_header))
+			return -EINVAL;
+
+		hdr = buf + offset;
+		QMI_TLV_SET_BIT(present, hdr->key);
+		offset += sizeof(struct qmi_tlv_header) + le16toh(hdr->len);
+	}
+
+	return offset == len ? 0 : -EINVAL;
+}
+
+static int qmi_tlv_parse(struct qmi_tlv *tlv, void *buf, size_t len, unsigned msg_id, unsigned type)
+{
+	struct qmi_header *pkt = buf;
+	size_t msg_len;
+
+	if (len < sizeof(struct qmi_header))
+		return -EINVAL;
+
+	if (pkt->type != type || le16toh(pkt->msg_id) != msg_id)
+		return -EINVAL;
+
+	msg_len = le16toh(pkt->msg_len);
+	if (msg_len > len - sizeof(struct qmi_header))
+		return -EINVAL;
+
+	memset(tlv, 0, sizeof(struct qmi_tlv));
+	if (qmi_tlv_validate(pkt + 1, msg_len, tlv->present))
+		return -EINVAL;
+
+	tlv->packet = pkt;
+	tlv->buf = pkt + 1;
+	tlv->size = msg_len;
+	tlv->txn = le16toh(pkt->txn_id);
+	tlv->msg_id = msg_id;
+	tlv->type = type;
+
+	return 0;
+}
+
+struct qmi_tlv *qmi_tlv_decode(void *buf, size_t len, unsigned *txn, unsigned msg_id, unsigned type)
 {
 	struct qmi_tlv *tlv;
 
 	tlv = malloc(sizeof(struct qmi_tlv));
-	memset(tlv, 0, sizeof(struct qmi_tlv));
+	if (!tlv)
+		return NULL;
 
-	tlv->buf = buf;
-	tlv->size = len;
+	if (qmi_tlv_parse(tlv, buf, len, msg_id, type)) {
+		free(tlv);
+		return NULL;
+	}
+
+	if (txn)
+		*txn = tlv->txn;
 
 	return tlv;
 }
 
+/*
+ * Decode a burst of messages into one allocation, holding the returned array
+ * of handles followed by the handles themselves, stored in *tlvs. Messages
+ * failing validation are left NULL in the array. Returns the number of
+ * messages decoded, or -errno with *tlvs left NULL. Release with
+ * qmi_tlv_free_batch(); freeing a single handle with qmi_tlv_free() only
+ * drops the buffer it may have grown, the handle itself lives until the
+ * whole batch is freed.
+ */
+ssize_t qmi_tlv_decode_batch(void **bufs, size_t *lens, size_t count, unsigned *txns,
+			     unsigned msg_id, unsigned type, struct qmi_tlv ***tlvs)
+{
+	struct qmi_tlv *arena;
+	ssize_t decoded = 0;
+	size_t i;
+
+	*tlvs = NULL;
+	if (!count)
+		return 0;
+
+	if (count > SIZE_MAX / (sizeof(struct qmi_tlv *) + sizeof(struct qmi_tlv)))
+		return -EOVERFLOW;
+
+	*tlvs = malloc(count * (sizeof(struct qmi_tlv *) + sizeof(struct qmi_tlv)));
+	if (!*tlvs)
+		return -ENOMEM;
+
+	arena = (struct qmi_tlv *)(*tlvs + count);
+	for (i = 0; i < count; i++) {
+		if (qmi_tlv_parse(&arena[i], bufs[i], lens[i], msg_id, type)) {
+			(*tlvs)[i] = NULL;
+			continue;
+		}
+
+		arena[i].batch = true;
+		(*tlvs)[i] = &arena[i];
+		if (txns)
+			txns[i] = arena[i].txn;
+		decoded++;
+	}
+
+	return decoded;
+}
+
+void qmi_tlv_free_batch(struct qmi_tlv **tlvs, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (tlvs[i])
+			free(tlvs[i]->allocated);
+	}
+	free(tlvs);
+}
+
+static int qmi_tlv_resize(struct qmi_tlv *tlv, size_t size)
+{
+	bool migrate;
+	void *newp;
+
+	/* If using user provided buffer, migrate data */
+	migrate = !tlv->allocated;
+
+	newp = realloc(tlv->allocated, sizeof(struct qmi_header) + size);
+	if (!newp)
+		return -ENOMEM;
+
+	if (migrate && tlv->size)
+		memcpy(newp + sizeof(struct qmi_header), tlv->buf, tlv->size);
+
+	tlv->allocated = newp;
+	tlv->buf = newp + sizeof(struct qmi_header);
+
+	return 0;
+}
+
+static void qmi_tlv_fill_header(struct qmi_tlv *tlv, struct qmi_header *pkt)
+{
+	pkt->type = tlv->type;
+	pkt->txn_id = htole16(tlv->txn);
+	pkt->msg_id = htole16(tlv->msg_id);
+	pkt->msg_len = htole16(tlv->size);
+}
+
+/*
+ * Messages that were decoded and not grown since are encoded in place, in the
+ * buffer they were decoded from: the QMI header is rewritten there, so the
+ * caller's receive buffer is modified and the returned pointer points into it.
+ */
 void *qmi_tlv_encode(struct qmi_tlv *tlv, size_t *len)
 {
-	*len = tlv->size;
-	return tlv->buf;
+	struct qmi_header *pkt;
+
+	if (tlv->allocated)
+		pkt = tlv->allocated;
+	else if (tlv->packet)
+		pkt = tlv->packet;
+	else if (!qmi_tlv_resize(tlv, tlv->size))
+		pkt = tlv->allocated;
+	else
+		return NULL;
+
+	qmi_tlv_fill_header(tlv, pkt);
+
+	*len = sizeof(struct qmi_header) + tlv->size;
+	return pkt;
+}
+
+/*
+ * Encode a burst of messages back to back into buf, e.g. for sendmmsg(). The
+ * length of each message is stored in lens, the total length is returned.
+ */
+ssize_t qmi_tlv_encode_batch(struct qmi_tlv **tlvs, size_t count, void *buf, size_t size, size_t *lens)
+{
+	struct qmi_tlv *tlv;
+	size_t offset = 0;
+	size_t len;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		tlv = tlvs[i];
+		len = sizeof(struct qmi_header) + tlv->size;
+		if (len > size - offset)
+			return -ENOSPC;
+
+		qmi_tlv_fill_header(tlv, buf + offset);
+		memcpy(buf + offset + sizeof(struct qmi_header), tlv->buf, tlv->size);
+
+		lens[i] = len;
+		offset += len;
+	}
+
+	return offset;
 }
 
 void qmi_tlv_free(struct qmi_tlv *tlv)
 {
 	free(tlv->allocated);
+	if (tlv->batch) {
+		tlv->allocated = NULL;
+		return;
+	}
+
 	free(tlv);
 }
 
-static struct qmi_tlv_header *qmi_tlv_get_item(struct qmi_tlv *tlv, unsigned id)
+/*
+ * Call cb for each TLV of the message in wire order, stopping early if it
+ * returns non-zero; that value is then returned.
+ */
+int qmi_tlv_foreach(struct qmi_tlv *tlv, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
 {
 	struct qmi_tlv_header *hdr;
-	unsigned offset = 0;
+	size_t offset = 0;
+	size_t len;
+	int ret;
 
 	while (offset < tlv->size) {
 		hdr = tlv->buf + offset;
-		if (hdr->key == id)
-			return tlv->buf + offset;
+		len = le16toh(hdr->len);
+
+		ret = cb(hdr->key, hdr->data, len, ctx);
+		if (ret)
+			return ret;
 
-		offset += sizeof(struct qmi_tlv_header) + hdr->len;
+		offset += sizeof(struct qmi_tlv_header) + len;
 	}
-	return NULL;
+
+	return 0;
 }
 
-void *qmi_tlv_get(struct qmi_tlv *tlv, unsigned id, size_t *len)
+/*
+ * Flag in changed, a 256 bit map indexed by TLV id, the TLVs present in only
+ * one of a and b or holding different data; only the first TLV of each id is
+ * considered, as with qmi_tlv_get(). The TLVs of a are indexed in one pass and
+ * those of b compared in a second one. Returns the number of changed TLVs.
+ */
+int qmi_tlv_diff(struct qmi_tlv *a, struct qmi_tlv *b, uint64_t changed[4])
 {
+	struct qmi_tlv_header *hdr_a;
 	struct qmi_tlv_header *hdr;
+	uint64_t seen_a[4] = {};
+	uint64_t seen_b[4] = {};
+	uint32_t offsets[256];
+	size_t offset = 0;
+	int count = 0;
+	unsigned i;
 
-	hdr = qmi_tlv_get_item(tlv, id);
-	if (!hdr)
-		return NULL;
+	while (offset < a->size) {
+		hdr = a->buf + offset;
+		if (!QMI_TLV_BIT(seen_a, hdr->key)) {
+			QMI_TLV_SET_BIT(seen_a, hdr->key);
+			offsets[hdr->key] = offset;
+		}
 
-	*len = hdr->len;
-	return hdr->data;
-}
+		offset += sizeof(struct qmi_tlv_header) + le16toh(hdr->len);
+	}
 
-void *qmi_tlv_get_array(struct qmi_tlv *tlv, unsigned id, size_t *len, size_t *size)
-{
-	struct qmi_tlv_header *hdr;
-	uint8_t count;
-	void *ptr;
+	memset(changed, 0, 4 * sizeof(uint64_t));
 
-	hdr = qmi_tlv_get_item(tlv, id);
-	if (!hdr)
-		return NULL;
+	offset = 0;
+	while (offset < b->size) {
+		hdr = b->buf + offset;
+		offset += sizeof(struct qmi_tlv_header) + le16toh(hdr->len);
 
-	ptr = hdr->data;
-	count = *(uint8_t*)ptr++;
+		if (QMI_TLV_BIT(seen_b, hdr->key))
+			continue;
+		QMI_TLV_SET_BIT(seen_b, hdr->key);
 
-	*len = count;
-	*size = (hdr->len - 1) / count;
+		if (QMI_TLV_BIT(seen_a, hdr->key)) {
+			hdr_a = a->buf + offsets[hdr->key];
+			if (hdr_a->len == hdr->len &&
+			    !memcmp(hdr_a->data, hdr->data, le16toh(hdr->len)))
+				continue;
+		}
 
-	return ptr;
+		QMI_TLV_SET_BIT(changed, hdr->key);
+	}
+
+	for (i = 0; i < 4; i++) {
+		changed[i] |= seen_a[i] & ~seen_b[i];
+		count += __builtin_popcountll(changed[i]);
+	}
+
+	return count;
+}
+
+/* Bitmap of the TLV ids present in the message, indexed by id */
+const uint64_t *qmi_tlv_present(struct qmi_tlv *tlv)
+{
+	return tlv->present;
+}
+
+void *qmi_tlv_get(struct qmi_tlv *tlv, unsigned id, size_t *len)
+{
+	return qmi_tlv_find_data(tlv, id, len);
+}
+
+void *qmi_tlv_get_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, size_t *len, size_t *size)
+{
+	return qmi_tlv_find_array(tlv, id, len_size, len, size);
 }
 
 static struct qmi_tlv_header *qmi_tlv_alloc_item(struct qmi_tlv *tlv, unsigned id, size_t len)
 {
 	struct qmi_tlv_header *hdr;
 	size_t new_size;
-	bool migrate;
-	void *newp;
 
-	/* If using user provided buffer, migrate data */
-	migrate = !tlv->allocated;
+	if (len > UINT16_MAX)
+		return NULL;
 
 	new_size = tlv->size + sizeof(struct qmi_tlv_header) + len;
-	newp = realloc(tlv->allocated, new_size);
-	if (!newp)
+	if (new_size > UINT16_MAX)
 		return NULL;
 
-	if (migrate)
-		memcpy(newp, tlv->buf, tlv->size);
+	if (qmi_tlv_resize(tlv, new_size))
+		return NULL;
 
-	hdr = newp + tlv->size;
+	hdr = tlv->buf + tlv->size;
 	hdr->key = id;
-	hdr->len = len;
+	hdr->len = htole16(len);
 
-	tlv->buf = tlv->allocated = newp;
 	tlv->size = new_size;
+	QMI_TLV_SET_BIT(tlv->present, hdr->key);
 
 	return hdr;
 }
@@ -121,22 +375,1419 @@ int qmi_tlv_set(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len)
 	return 0;
 }
 
-int qmi_tlv_set_array(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len, size_t size)
+int qmi_tlv_set_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size)
 {
 	struct qmi_tlv_header *hdr;
 	size_t array_size;
-	void *ptr;
+	uint16_t count16;
+
+	if (len_size && len > (len_size == 2 ? UINT16_MAX : UINT8_MAX))
+		return -EINVAL;
 
 	array_size = len * size;
-	hdr = qmi_tlv_alloc_item(tlv, id, sizeof(uint8_t) + array_size);
+	hdr = qmi_tlv_alloc_item(tlv, id, len_size + array_size);
 	if (!hdr)
 		return -ENOMEM;
 
-	ptr = hdr->data;
-	*(uint8_t*)ptr++ = len;
-	memcpy(ptr, buf, array_size);
+	if (len_size == 2) {
+		count16 = htole16(len);
+		memcpy(hdr->data, &count16, sizeof(count16));
+	} else if (len_size == 1) {
+		hdr->data[0] = len;
+	}
+	if (array_size)
+		memcpy(hdr->data + len_size, buf, array_size);
+
+	return 0;
+}
+
+void qmi_tlv_set_txn(struct qmi_tlv *tlv, unsigned txn)
+{
+	tlv->txn = txn;
+}
+
+/*
+ * Make room for a value of len bytes in TLV id, in place of its current value
+ * or appended when not present, and return where the value goes. Messages
+ * decoded in place are spliced into a new buffer with a single copy of the
+ * surrounding TLVs, allocated ones are resized and the following TLVs moved.
+ */
+static int qmi_tlv_splice(struct qmi_tlv *tlv, unsigned id, size_t len, uint8_t **data)
+{
+	struct qmi_tlv_header *hdr;
+	size_t new_size;
+	size_t old_len;
+	size_t prefix;
+	size_t suffix;
+	void *newp;
+
+	hdr = qmi_tlv_find(tlv, id);
+	if (!hdr) {
+		hdr = qmi_tlv_alloc_item(tlv, id, len);
+		if (!hdr)
+			return -ENOMEM;
+
+		*data = hdr->data;
+		return 0;
+	}
+
+	old_len = le16toh(hdr->len);
+	if (old_len == len) {
+		*data = hdr->data;
+		return 0;
+	}
+
+	prefix = (void *)hdr - tlv->buf;
+	suffix = tlv->size - prefix - sizeof(struct qmi_tlv_header) - old_len;
+
+	new_size = prefix + sizeof(struct qmi_tlv_header) + len + suffix;
+	if (len > UINT16_MAX || new_size > UINT16_MAX)
+		return -EINVAL;
+
+	if (tlv->allocated) {
+		if (len > old_len && qmi_tlv_resize(tlv, new_size))
+			return -ENOMEM;
+
+		hdr = tlv->buf + prefix;
+		memmove(hdr->data + len, hdr->data + old_len, suffix);
+	} else {
+		newp = malloc(sizeof(struct qmi_header) + new_size);
+		if (!newp)
+			return -ENOMEM;
+
+		memcpy(newp + sizeof(struct qmi_header), tlv->buf, prefix);
+		memcpy(newp + sizeof(struct qmi_header) + prefix + sizeof(struct qmi_tlv_header) + len,
+		       hdr->data + old_len, suffix);
+
+		tlv->allocated = newp;
+		tlv->buf = newp + sizeof(struct qmi_header);
+
+		hdr = tlv->buf + prefix;
+		hdr->key = id;
+	}
+
+	hdr->len = htole16(len);
+	tlv->size = new_size;
+
+	*data = hdr->data;
+	return 0;
+}
+
+/*
+ * Replace the value of an existing TLV, or add it if not present. A value of
+ * the same size is overwritten in place, leaving the rest of the message
+ * untouched.
+ */
+int qmi_tlv_replace(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len)
+{
+	uint8_t *data;
+	int ret;
+
+	ret = qmi_tlv_splice(tlv, id, len, &data);
+	if (ret)
+		return ret;
+
+	memcpy(data, buf, len);
+
+	return 0;
+}
+
+int qmi_tlv_replace_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size)
+{
+	uint16_t count16;
+	uint8_t *data;
+	int ret;
+
+	if (len_size && len > (len_size == 2 ? UINT16_MAX : UINT8_MAX))
+		return -EINVAL;
+
+	ret = qmi_tlv_splice(tlv, id, len_size + len * size, &data);
+	if (ret)
+		return ret;
+
+	if (len_size == 2) {
+		count16 = htole16(len);
+		memcpy(data, &count16, sizeof(count16));
+	} else if (len_size == 1) {
+		data[0] = len;
+	}
+	if (len)
+		memcpy(data + len_size, buf, len * size);
 
 	return 0;
 }
 
+enum qmi_tlv_stream_state {
+	QMI_STREAM_HEADER,
+	QMI_STREAM_TLV_HEADER,
+	QMI_STREAM_TLV_DATA,
+	QMI_STREAM_DONE,
+};
+
+/*
+ * Incremental decoder, for messages arriving in chunks. Each TLV is handed
+ * to the callback as soon as it is complete; TLVs contained in a single chunk
+ * are passed in place, others are reassembled in a buffer sized for the
+ * largest TLV seen.
+ */
+struct qmi_tlv_stream {
+	enum qmi_tlv_stream_state state;
+
+	unsigned msg_id;
+	unsigned type;
+	unsigned *txn;
+
+	int (*cb)(unsigned id, void *data, size_t len, void *ctx);
+	void *ctx;
+
+	/* Partially received QMI or TLV header */
+	uint8_t head[sizeof(struct qmi_header)];
+	size_t head_len;
+
+	/* Payload bytes of the message not yet consumed */
+	size_t remaining;
+
+	unsigned item_id;
+	size_t item_len;
+
+	void *data;
+	size_t data_len;
+	size_t data_size;
+};
+
+struct qmi_tlv_stream *qmi_tlv_stream_init(unsigned msg_id, unsigned type, unsigned *txn,
+					   int (*cb)(unsigned id, void *data, size_t len, void *ctx),
+					   void *ctx)
+{
+	struct qmi_tlv_stream *stream;
+
+	stream = malloc(sizeof(struct qmi_tlv_stream));
+	if (!stream)
+		return NULL;
+	memset(stream, 0, sizeof(struct qmi_tlv_stream));
+
+	stream->msg_id = msg_id;
+	stream->type = type;
+	stream->txn = txn;
+	stream->cb = cb;
+	stream->ctx = ctx;
+
+	return stream;
+}
+
+void qmi_tlv_stream_free(struct qmi_tlv_stream *stream)
+{
+	free(stream->data);
+	free(stream);
+}
+
+/* Accumulate up to want bytes of header, returning the number consumed */
+static size_t qmi_tlv_stream_head(struct qmi_tlv_stream *stream, const void *buf, size_t len, size_t want)
+{
+	size_t n;
+
+	n = want - stream->head_len;
+	if (n > len)
+		n = len;
+
+	memcpy(stream->head + stream->head_len, buf, n);
+	stream->head_len += n;
+
+	return n;
+}
+
+static int qmi_tlv_stream_item_done(struct qmi_tlv_stream *stream, void *data)
+{
+	int ret;
+
+	ret = stream->cb(stream->item_id, data, stream->item_len, stream->ctx);
+	if (ret)
+		return ret;
+
+	stream->remaining -= stream->item_len;
+	stream->state = stream->remaining ? QMI_STREAM_TLV_HEADER : QMI_STREAM_DONE;
+
+	return 0;
+}
+
+/*
+ * Feed the next chunk of the message; returns 1 once the message is complete,
+ * 0 if more data is needed or a negative errno. A non-zero return from the
+ * callback aborts decoding and is passed on.
+ */
+int qmi_tlv_stream_feed(struct qmi_tlv_stream *stream, const void *buf, size_t len)
+{
+	struct qmi_tlv_header *hdr;
+	struct qmi_header *pkt;
+	void *newp;
+	size_t n;
+	int ret;
+
+	while (len && stream->state != QMI_STREAM_DONE) {
+		switch (stream->state) {
+		case QMI_STREAM_HEADER:
+			n = qmi_tlv_stream_head(stream, buf, len, sizeof(struct qmi_header));
+			if (stream->head_len < sizeof(struct qmi_header))
+				break;
+
+			pkt = (struct qmi_header *)stream->head;
+			if (pkt->type != stream->type || le16toh(pkt->msg_id) != stream->msg_id)
+				return -EINVAL;
+
+			if (stream->txn)
+				*stream->txn = le16toh(pkt->txn_id);
+
+			stream->remaining = le16toh(pkt->msg_len);
+			stream->state = stream->remaining ? QMI_STREAM_TLV_HEADER : QMI_STREAM_DONE;
+			stream->head_len = 0;
+			break;
+		case QMI_STREAM_TLV_HEADER:
+			n = qmi_tlv_stream_head(stream, buf, len, sizeof(struct qmi_tlv_header));
+			if (stream->head_len < sizeof(struct qmi_tlv_header))
+				break;
+
+			hdr = (struct qmi_tlv_header *)stream->head;
+			stream->item_id = hdr->key;
+			stream->item_len = le16toh(hdr->len);
+			stream->head_len = 0;
+
+			if (stream->remaining < sizeof(struct qmi_tlv_header) + stream->item_len)
+				return -EINVAL;
+			stream->remaining -= sizeof(struct qmi_tlv_header);
+
+			stream->data_len = 0;
+			stream->state = QMI_STREAM_TLV_DATA;
+			if (!stream->item_len) {
+				ret = qmi_tlv_stream_item_done(stream, NULL);
+				if (ret)
+					return ret;
+			}
+			break;
+		case QMI_STREAM_TLV_DATA:
+			/* Deliver in place if the whole item is in this chunk */
+			if (!stream->data_len && len >= stream->item_len) {
+				n = stream->item_len;
+				ret = qmi_tlv_stream_item_done(stream, (void *)buf);
+				if (ret)
+					return ret;
+				break;
+			}
+
+			if (stream->data_size < stream->item_len) {
+				newp = realloc(stream->data, stream->item_len);
+				if (!newp)
+					return -ENOMEM;
+
+				stream->data = newp;
+				stream->data_size = stream->item_len;
+			}
+
+			n = stream->item_len - stream->data_len;
+			if (n > len)
+				n = len;
+
+			memcpy(stream->data + stream->data_len, buf, n);
+			stream->data_len += n;
+
+			if (stream->data_len == stream->item_len) {
+				ret = qmi_tlv_stream_item_done(stream, stream->data);
+				if (ret)
+					return ret;
+			}
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		buf += n;
+		len -= n;
+	}
+
+	return stream->state == QMI_STREAM_DONE;
+}
+
+/*
+ * JSON rendering of a message into a caller provided buffer. Output past the
+ * end of the buffer is counted but dropped, like snprintf(), so the length
+ * needed is known when it doesn't fit.
+ */
+struct qmi_json {
+	char *out;
+	size_t cap;
+	size_t len;
+	bool comma;
+};
+
+static void qmi_json_put(struct qmi_json *json, const char *buf, size_t len)
+{
+	size_t n = 0;
+
+	if (json->len < json->cap)
+		n = json->cap - json->len < len ? json->cap - json->len : len;
+
+	if (n)
+		memcpy(json->out + json->len, buf, n);
+	json->len += len;
+}
+
+static void qmi_json_sep(struct qmi_json *json)
+{
+	if (json->comma)
+		qmi_json_put(json, ",", 1);
+	json->comma = true;
+}
+
+void qmi_json_open(struct qmi_json *json, char c)
+{
+	qmi_json_sep(json);
+	qmi_json_put(json, &c, 1);
+	json->comma = false;
+}
+
+void qmi_json_close(struct qmi_json *json, char c)
+{
+	qmi_json_put(json, &c, 1);
+	json->comma = true;
+}
+
+void qmi_json_key(struct qmi_json *json, const char *key)
+{
+	qmi_json_sep(json);
+	qmi_json_put(json, "\"", 1);
+	qmi_json_put(json, key, strlen(key));
+	qmi_json_put(json, "\":", 2);
+	json->comma = false;
+}
+
+void qmi_json_uint(struct qmi_json *json, uint64_t val)
+{
+	char buf[20];
+	size_t i = sizeof(buf);
+
+	do {
+		buf[--i] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+
+	qmi_json_sep(json);
+	qmi_json_put(json, buf + i, sizeof(buf) - i);
+}
+
+/* Length of the well formed UTF-8 sequence at str, 0 if there is none */
+static size_t qmi_json_utf8_len(const uint8_t *str, size_t len)
+{
+	unsigned cp;
+	size_t n;
+	size_t i;
+
+	if (str[0] < 0xc2 || str[0] > 0xf4)
+		return 0;
+
+	n = str[0] < 0xe0 ? 2 : str[0] < 0xf0 ? 3 : 4;
+	if (len < n)
+		return 0;
+
+	cp = str[0] & (0x7f >> n);
+	for (i = 1; i < n; i++) {
+		if ((str[i] & 0xc0) != 0x80)
+			return 0;
+		cp = cp << 6 | (str[i] & 0x3f);
+	}
+
+	/* Overlong, surrogate or beyond U+10FFFF */
+	if ((n == 3 && cp < 0x800) || (n == 4 && cp < 0x10000) ||
+	    (cp >= 0xd800 && cp < 0xe000) || cp > 0x10ffff)
+		return 0;
+
+	return n;
+}
+
+/*
+ * Strings are copied as is where they are UTF-8, as qmi_json_decode() takes
+ * them back. Any other byte from 0x80 up is escaped as the code point of the
+ * same value, keeping the output valid JSON.
+ */
+void qmi_json_string(struct qmi_json *json, const void *buf, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	const uint8_t *str = buf;
+	size_t start = 0;
+	char esc[6];
+	size_t n;
+	size_t i;
+
+	qmi_json_sep(json);
+	qmi_json_put(json, "\"", 1);
+
+	for (i = 0; i < len; i++) {
+		if (str[i] >= 0x20 && str[i] < 0x80 && str[i] != '"' && str[i] != '\\')
+			continue;
+
+		if (str[i] >= 0x80) {
+			n = qmi_json_utf8_len(str + i, len - i);
+			if (n) {
+				i += n - 1;
+				continue;
+			}
+		}
+
+		qmi_json_put(json, (const char *)str + start, i - start);
+		start = i + 1;
+
+		if (str[i] == '"' || str[i] == '\\') {
+			esc[0] = '\\';
+			esc[1] = str[i];
+			qmi_json_put(json, esc, 2);
+		} else {
+			memcpy(esc, "\\u00", 4);
+			esc[4] = hex[str[i] >> 4];
+			esc[5] = hex[str[i] & 0xf];
+			qmi_json_put(json, esc, 6);
+		}
+	}
+
+	qmi_json_put(json, (const char *)str + start, len - start);
+	qmi_json_put(json, "\"", 1);
+}
+
+/* TLVs not known to the schema, as "0x<id>": "<hex data>" */
+void qmi_json_unknown(struct qmi_json *json, unsigned id, const void *buf, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	const uint8_t *data = buf;
+	char key[5] = "0x";
+	char byte[2];
+	size_t i;
+
+	key[2] = hex[(id >> 4) & 0xf];
+	key[3] = hex[id & 0xf];
+	key[4] = '\0';
+	qmi_json_key(json, key);
 
+	qmi_json_sep(json);
+	qmi_json_put(json, "\"", 1);
+	for (i = 0; i < len; i++) {
+		byte[0] = hex[data[i] >> 4];
+		byte[1] = hex[data[i] & 0xf];
+		qmi_json_put(json, byte, 2);
+	}
+	qmi_json_put(json, "\"", 1);
+}
+
+/*
+ * Render a message in a single pass over its TLVs, validating them on the
+ * way. Returns the length written, excluding the terminating NUL, -EINVAL for
+ * malformed messages or -ENOSPC when the output didn't fit in @cap bytes.
+ */
+int qmi_json_encode(void *buf, size_t len, unsigned msg_id, unsigned type, const char *name,
+		    int (*cb)(unsigned id, void *data, size_t len, void *ctx),
+		    char *out, size_t cap)
+{
+	struct qmi_json json = { out, cap, 0, false };
+	struct qmi_header *pkt = buf;
+	struct qmi_tlv_header *hdr;
+	size_t offset = 0;
+	size_t msg_len;
+	size_t tlv_len;
+	int ret = -EINVAL;
+
+	if (len < sizeof(struct qmi_header) ||
+	    pkt->type != type || le16toh(pkt->msg_id) != msg_id)
+		goto out;
+
+	msg_len = le16toh(pkt->msg_len);
+	if (msg_len > len - sizeof(struct qmi_header))
+		goto out;
+
+	qmi_json_open(&json, '{');
+	qmi_json_key(&json, "msg");
+	qmi_json_string(&json, name, strlen(name));
+	qmi_json_key(&json, "txn");
+	qmi_json_uint(&json, le16toh(pkt->txn_id));
+
+	while (offset < msg_len) {
+		ret = -EINVAL;
+		if (msg_len - offset < sizeof(struct qmi_tlv_header))
+			goto out;
+
+		hdr = (void *)(pkt + 1) + offset;
+		tlv_len = le16toh(hdr->len);
+		if (tlv_len > msg_len - offset - sizeof(struct qmi_tlv_header))
+			goto out;
+
+		ret = cb(hdr->key, hdr->data, tlv_len, &json);
+		if (ret)
+			goto out;
+
+		offset += sizeof(struct qmi_tlv_header) + tlv_len;
+	}
+
+	qmi_json_close(&json, '}');
+
+	ret = json.len < cap ? (int)json.len : -ENOSPC;
+
+out:
+	if (cap)
+		out[json.len < cap ? json.len : cap - 1] = '\0';
+
+	return ret;
+}
+
+/*
+ * Encoding of JSON text straight into a wire buffer, driven by a per message
+ * table of fields. Keys are member names, matching qmi_json_encode() output:
+ * "msg" and "txn" are accepted and ignored and "0x<id>" keys carry raw TLVs
+ * as hex strings.
+ */
+enum qmi_json_type {
+	QMI_JSON_U8,
+	QMI_JSON_U16,
+	QMI_JSON_U32,
+	QMI_JSON_U64,
+	QMI_JSON_STRING,
+	QMI_JSON_STRUCT,
+};
+
+struct qmi_json_field {
+	const char *name;
+	unsigned id;
+	unsigned type;
+	unsigned array_size;
+	unsigned len_size;
+	bool array_fixed;
+	bool required;
+	const struct qmi_json_field *members;
+	unsigned n_members;
+};
+
+/* Longest string, as held NUL terminated in char[256] by the kernel */
+#define QMI_JSON_STRING_MAX	255
+
+struct qmi_json_parser {
+	const char *ptr;
+	const char *end;
+
+	uint8_t *out;
+	size_t cap;
+	size_t len;
+};
+
+static void qmi_json_skip_ws(struct qmi_json_parser *p)
+{
+	while (p->ptr < p->end && (*p->ptr == ' ' || *p->ptr == '\t' ||
+				   *p->ptr == '\n' || *p->ptr == '\r'))
+		p->ptr++;
+}
+
+static int qmi_json_peek(struct qmi_json_parser *p)
+{
+	qmi_json_skip_ws(p);
+
+	return p->ptr < p->end ? *p->ptr : -1;
+}
+
+static int qmi_json_expect(struct qmi_json_parser *p, char c)
+{
+	if (qmi_json_peek(p) != c)
+		return -EINVAL;
+
+	p->ptr++;
+	return 0;
+}
+
+static uint8_t *qmi_json_reserve(struct qmi_json_parser *p, size_t len)
+{
+	uint8_t *ptr;
+
+	if (len > p->cap - p->len)
+		return NULL;
+
+	ptr = p->out + p->len;
+	p->len += len;
+
+	return ptr;
+}
+
+static int qmi_json_parse_uint(struct qmi_json_parser *p, uint64_t max, uint64_t *val)
+{
+	uint64_t v = 0;
+	unsigned digit;
+
+	qmi_json_skip_ws(p);
+	if (p->ptr == p->end || *p->ptr < '0' || *p->ptr > '9')
+		return -EINVAL;
+
+	while (p->ptr < p->end && *p->ptr >= '0' && *p->ptr <= '9') {
+		digit = *p->ptr++ - '0';
+		if (v > (max - digit) / 10)
+			return -ERANGE;
+		v = v * 10 + digit;
+	}
+
+	*val = v;
+	return 0;
+}
+
+static int qmi_json_hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static int qmi_json_parse_u16_escape(struct qmi_json_parser *p, unsigned *val)
+{
+	int digit;
+	int i;
+
+	if (p->end - p->ptr < 4)
+		return -EINVAL;
+
+	*val = 0;
+	for (i = 0; i < 4; i++) {
+		digit = qmi_json_hex_digit(*p->ptr++);
+		if (digit < 0)
+			return -EINVAL;
+		*val = *val << 4 | digit;
+	}
+
+	return 0;
+}
+
+/* Decode a string, appending it to the output as UTF-8 */
+static int qmi_json_parse_string(struct qmi_json_parser *p, size_t *len)
+{
+	size_t start = p->len;
+	unsigned low;
+	unsigned cp;
+	uint8_t *dst;
+	size_t n;
+	char c;
+
+	if (qmi_json_expect(p, '"'))
+		return -EINVAL;
+
+	while (p->ptr < p->end && *p->ptr != '"') {
+		c = *p->ptr++;
+		if ((uint8_t)c < 0x20)
+			return -EINVAL;
+
+		if (c != '\\') {
+			dst = qmi_json_reserve(p, 1);
+			if (!dst)
+				return -ENOSPC;
+			*dst = c;
+			continue;
+		}
+
+		if (p->ptr == p->end)
+			return -EINVAL;
+
+		switch (*p->ptr++) {
+		case '"':
+		case '\\':
+		case '/':
+			cp = p->ptr[-1];
+			break;
+		case 'b':
+			cp = '\b';
+			break;
+		case 'f':
+			cp = '\f';
+			break;
+		case 'n':
+			cp = '\n';
+			break;
+		case 'r':
+			cp = '\r';
+			break;
+		case 't':
+			cp = '\t';
+			break;
+		case 'u':
+			if (qmi_json_parse_u16_escape(p, &cp))
+				return -EINVAL;
+
+			if (cp >= 0xd800 && cp < 0xdc00) {
+				if (p->end - p->ptr < 2 || p->ptr[0] != '\\' || p->ptr[1] != 'u')
+					return -EINVAL;
+				p->ptr += 2;
+				if (qmi_json_parse_u16_escape(p, &low) || low < 0xdc00 || low >= 0xe000)
+					return -EINVAL;
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+			} else if (cp >= 0xdc00 && cp < 0xe000) {
+				return -EINVAL;
+			}
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		n = cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+		dst = qmi_json_reserve(p, n);
+		if (!dst)
+			return -ENOSPC;
+
+		switch (n) {
+		case 1:
+			dst[0] = cp;
+			break;
+		case 2:
+			dst[0] = 0xc0 | cp >> 6;
+			dst[1] = 0x80 | (cp & 0x3f);
+			break;
+		case 3:
+			dst[0] = 0xe0 | cp >> 12;
+			dst[1] = 0x80 | ((cp >> 6) & 0x3f);
+			dst[2] = 0x80 | (cp & 0x3f);
+			break;
+		case 4:
+			dst[0] = 0xf0 | cp >> 18;
+			dst[1] = 0x80 | ((cp >> 12) & 0x3f);
+			dst[2] = 0x80 | ((cp >> 6) & 0x3f);
+			dst[3] = 0x80 | (cp & 0x3f);
+			break;
+		}
+	}
+
+	if (p->ptr == p->end)
+		return -EINVAL;
+	p->ptr++;
+
+	*len = p->len - start;
+	return 0;
+}
+
+/* Keys name members, so they are matched in place and may not be escaped */
+static int qmi_json_parse_key(struct qmi_json_parser *p, const char **key, size_t *len)
+{
+	const char *start;
+
+	if (qmi_json_expect(p, '"'))
+		return -EINVAL;
+
+	start = p->ptr;
+	while (p->ptr < p->end && *p->ptr != '"') {
+		if (*p->ptr == '\\')
+			return -EINVAL;
+		p->ptr++;
+	}
+
+	if (p->ptr == p->end)
+		return -EINVAL;
+
+	*key = start;
+	*len = p->ptr++ - start;
+
+	return qmi_json_expect(p, ':');
+}
+
+static bool qmi_json_key_is(const char *key, size_t len, const char *name)
+{
+	return strlen(name) == len && !memcmp(key, name, len);
+}
+
+static int qmi_json_skip_value(struct qmi_json_parser *p)
+{
+	size_t start = p->len;
+	uint64_t val;
+	size_t len;
+	int ret;
+
+	if (qmi_json_peek(p) == '"') {
+		ret = qmi_json_parse_string(p, &len);
+		p->len = start;
+		return ret;
+	}
+
+	return qmi_json_parse_uint(p, UINT64_MAX, &val);
+}
+
+static const size_t qmi_json_sizes[] = {
+	[QMI_JSON_U8] = 1,
+	[QMI_JSON_U16] = 2,
+	[QMI_JSON_U32] = 4,
+	[QMI_JSON_U64] = 8,
+};
+
+static int qmi_json_parse_scalar(struct qmi_json_parser *p, unsigned type)
+{
+	static const uint64_t max[] = {
+		[QMI_JSON_U8] = UINT8_MAX,
+		[QMI_JSON_U16] = UINT16_MAX,
+		[QMI_JSON_U32] = UINT32_MAX,
+		[QMI_JSON_U64] = UINT64_MAX,
+	};
+	uint64_t val;
+	uint16_t v16;
+	uint32_t v32;
+	uint8_t *dst;
+	int ret;
+
+	dst = qmi_json_reserve(p, qmi_json_sizes[type]);
+	if (!dst)
+		return -ENOSPC;
+
+	ret = qmi_json_parse_uint(p, max[type], &val);
+	if (ret)
+		return ret;
+
+	switch (type) {
+	case QMI_JSON_U8:
+		*dst = val;
+		break;
+	case QMI_JSON_U16:
+		v16 = htole16(val);
+		memcpy(dst, &v16, sizeof(v16));
+		break;
+	case QMI_JSON_U32:
+		v32 = htole32(val);
+		memcpy(dst, &v32, sizeof(v32));
+		break;
+	case QMI_JSON_U64:
+		val = htole64(val);
+		memcpy(dst, &val, sizeof(val));
+		break;
+	}
+
+	return 0;
+}
+
+static const struct qmi_json_field *qmi_json_struct_member(const struct qmi_json_field *field,
+							   const char *key, size_t len)
+{
+	unsigned i;
+
+	for (i = 0; i < field->n_members; i++) {
+		if (qmi_json_key_is(key, len, field->members[i].name))
+			return &field->members[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Struct strings are prefixed by their length in 2 bytes, the kernel holding
+ * them in char[256] and so giving them an elem_len above 255
+ */
+static int qmi_json_parse_struct_string(struct qmi_json_parser *p)
+{
+	uint8_t *prefix;
+	uint16_t len16;
+	size_t len;
+	int ret;
+
+	prefix = qmi_json_reserve(p, sizeof(len16));
+	if (!prefix)
+		return -ENOSPC;
+
+	ret = qmi_json_parse_string(p, &len);
+	if (ret)
+		return ret;
+
+	if (len > QMI_JSON_STRING_MAX)
+		return -EINVAL;
+
+	len16 = htole16(len);
+	memcpy(prefix, &len16, sizeof(len16));
+	return 0;
+}
+
+/* Encode the value of @member in the object at @start, zero if left out */
+static int qmi_json_parse_struct_member(struct qmi_json_parser *p,
+					const struct qmi_json_field *member,
+					const char *start)
+{
+	const char *key;
+	uint8_t *dst;
+	size_t size;
+	size_t len;
+	int ret;
+
+	p->ptr = start;
+	while (qmi_json_peek(p) == '"') {
+		ret = qmi_json_parse_key(p, &key, &len);
+		if (ret)
+			return ret;
+
+		if (qmi_json_key_is(key, len, member->name)) {
+			if (member->type == QMI_JSON_STRING)
+				return qmi_json_parse_struct_string(p);
+			return qmi_json_parse_scalar(p, member->type);
+		}
+
+		ret = qmi_json_skip_value(p);
+		if (ret)
+			return ret;
+		qmi_json_expect(p, ',');
+	}
+
+	size = member->type == QMI_JSON_STRING ? 2 : qmi_json_sizes[member->type];
+	dst = qmi_json_reserve(p, size);
+	if (!dst)
+		return -ENOSPC;
+	memset(dst, 0, size);
+
+	return 0;
+}
+
+/*
+ * Structs are packed little endian on the wire, members in declaration order.
+ * Keys may come in any order, so the object is checked and skipped over once,
+ * then each member is looked up and encoded in turn.
+ */
+static int qmi_json_parse_struct(struct qmi_json_parser *p, const struct qmi_json_field *field)
+{
+	const struct qmi_json_field *member;
+	const char *start;
+	const char *end;
+	const char *key;
+	size_t len;
+	unsigned i;
+	int ret;
+
+	if (qmi_json_expect(p, '{'))
+		return -EINVAL;
+	start = p->ptr;
+
+	if (qmi_json_peek(p) != '}') {
+		do {
+			ret = qmi_json_parse_key(p, &key, &len);
+			if (ret)
+				return ret;
+
+			member = qmi_json_struct_member(field, key, len);
+			if (!member || member->type == QMI_JSON_STRUCT)
+				return -EINVAL;
+
+			ret = qmi_json_skip_value(p);
+			if (ret)
+				return ret;
+		} while (!qmi_json_expect(p, ','));
+	}
+
+	if (qmi_json_expect(p, '}'))
+		return -EINVAL;
+	end = p->ptr;
+
+	for (i = 0; i < field->n_members; i++) {
+		ret = qmi_json_parse_struct_member(p, &field->members[i], start);
+		if (ret)
+			return ret;
+	}
+
+	p->ptr = end;
+	return 0;
+}
+
+static int qmi_json_parse_element(struct qmi_json_parser *p, const struct qmi_json_field *field)
+{
+	size_t len;
+	int ret;
+
+	switch (field->type) {
+	case QMI_JSON_STRING:
+		ret = qmi_json_parse_string(p, &len);
+		if (ret)
+			return ret;
+
+		if (len > (field->array_size ? field->array_size : QMI_JSON_STRING_MAX))
+			return -EINVAL;
+		return 0;
+	case QMI_JSON_STRUCT:
+		return qmi_json_parse_struct(p, field);
+	default:
+		return qmi_json_parse_scalar(p, field->type);
+	}
+}
+
+static int qmi_json_parse_array(struct qmi_json_parser *p, const struct qmi_json_field *field)
+{
+	unsigned count = 0;
+	uint16_t count16;
+	uint8_t *prefix;
+	int ret;
+
+	prefix = qmi_json_reserve(p, field->len_size);
+	if (!prefix)
+		return -ENOSPC;
+
+	if (qmi_json_expect(p, '['))
+		return -EINVAL;
+
+	if (qmi_json_peek(p) != ']') {
+		do {
+			if (count == field->array_size)
+				return -EINVAL;
+
+			ret = qmi_json_parse_element(p, field);
+			if (ret)
+				return ret;
+			count++;
+		} while (!qmi_json_expect(p, ','));
+	}
+
+	if (qmi_json_expect(p, ']'))
+		return -EINVAL;
+
+	if (field->array_fixed && count != field->array_size)
+		return -EINVAL;
+
+	if (field->len_size == 2) {
+		count16 = htole16(count);
+		memcpy(prefix, &count16, sizeof(count16));
+	} else if (field->len_size == 1) {
+		*prefix = count;
+	}
+
+	return 0;
+}
+
+static int qmi_json_parse_hex(struct qmi_json_parser *p)
+{
+	size_t start = p->len;
+	uint8_t *data;
+	size_t len;
+	size_t i;
+	int hi;
+	int lo;
+	int ret;
+
+	ret = qmi_json_parse_string(p, &len);
+	if (ret)
+		return ret;
+
+	if (len % 2)
+		return -EINVAL;
+
+	/* Convert in place, the hex digits being twice the size of the data */
+	data = p->out + start;
+	for (i = 0; i < len / 2; i++) {
+		hi = qmi_json_hex_digit(data[2 * i]);
+		lo = qmi_json_hex_digit(data[2 * i + 1]);
+		if (hi < 0 || lo < 0)
+			return -EINVAL;
+		data[i] = hi << 4 | lo;
+	}
+	p->len = start + len / 2;
+
+	return 0;
+}
+
+/*
+ * Encode a JSON object into a QMI message in @out, checking values against
+ * the schema and that all required members are present. Returns the encoded
+ * length, -EINVAL for invalid input, -ERANGE for out of range numbers or
+ * -ENOSPC when the message doesn't fit in @cap bytes.
+ */
+int qmi_json_decode(const char *json, size_t len, unsigned txn, unsigned msg_id, unsigned type,
+		    const struct qmi_json_field *fields, unsigned count, void *out, size_t cap)
+{
+	struct qmi_json_parser p = { json, json + len, out, cap, 0 };
+	const struct qmi_json_field *field;
+	struct qmi_tlv_header *hdr;
+	struct qmi_header *pkt;
+	uint8_t seen[256 / 8] = {};
+	const char *key;
+	size_t key_len;
+	size_t start;
+	unsigned id;
+	int hi;
+	int lo;
+	unsigned i;
+	int ret;
+
+	pkt = (void *)qmi_json_reserve(&p, sizeof(struct qmi_header));
+	if (!pkt)
+		return -ENOSPC;
+
+	if (qmi_json_expect(&p, '{'))
+		return -EINVAL;
+
+	if (qmi_json_peek(&p) != '}') {
+		do {
+			ret = qmi_json_parse_key(&p, &key, &key_len);
+			if (ret)
+				return ret;
+
+			if (qmi_json_key_is(key, key_len, "msg") ||
+			    qmi_json_key_is(key, key_len, "txn")) {
+				ret = qmi_json_skip_value(&p);
+				if (ret)
+					return ret;
+				continue;
+			}
+
+			field = NULL;
+			for (i = 0; i < count; i++) {
+				if (qmi_json_key_is(key, key_len, fields[i].name)) {
+					field = &fields[i];
+					break;
+				}
+			}
+
+			if (field) {
+				id = field->id;
+			} else if (key_len == 4 && key[0] == '0' && key[1] == 'x') {
+				hi = qmi_json_hex_digit(key[2]);
+				lo = qmi_json_hex_digit(key[3]);
+				if (hi < 0 || lo < 0)
+					return -EINVAL;
+				id = hi << 4 | lo;
+			} else {
+				return -EINVAL;
+			}
+
+			if (seen[id / 8] & (1 << (id % 8)))
+				return -EINVAL;
+			seen[id / 8] |= 1 << (id % 8);
+
+			hdr = (void *)qmi_json_reserve(&p, sizeof(struct qmi_tlv_header));
+			if (!hdr)
+				return -ENOSPC;
+			start = p.len;
+
+			if (!field)
+				ret = qmi_json_parse_hex(&p);
+			else if (field->array_size && field->type != QMI_JSON_STRING)
+				ret = qmi_json_parse_array(&p, field);
+			else
+				ret = qmi_json_parse_element(&p, field);
+			if (ret)
+				return ret;
+
+			if (p.len - start > UINT16_MAX)
+				return -EINVAL;
+
+			hdr->key = id;
+			hdr->len = htole16(p.len - start);
+		} while (!qmi_json_expect(&p, ','));
+	}
+
+	if (qmi_json_expect(&p, '}'))
+		return -EINVAL;
+
+	qmi_json_skip_ws(&p);
+	if (p.ptr != p.end)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		id = fields[i].id;
+		if (fields[i].required && !(seen[id / 8] & (1 << (id % 8))))
+			return -EINVAL;
+	}
+
+	if (p.len - sizeof(struct qmi_header) > UINT16_MAX)
+		return -EINVAL;
+
+	pkt->type = type;
+	pkt->txn_id = htole16(txn);
+	pkt->msg_id = htole16(msg_id);
+	pkt->msg_len = htole16(p.len - sizeof(struct qmi_header));
+
+	return p.len;
+}
+
+/*
+ * Asynchronous client, pipelining requests on one transport. Each request in
+ * flight owns the slot of the txn ring selected by the low bits of its txn.
+ * Slots are claimed and released with compare and swap, so requests may be
+ * issued from any thread while another one feeds the received messages.
+ */
+#define QMI_CLIENT_FREE		0
+#define QMI_CLIENT_BUSY		1
+#define QMI_CLIENT_PENDING	0x10000
+
+typedef void (*qmi_client_complete)(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx);
+
+struct qmi_client_slot {
+	atomic_uint state;
+
+	unsigned msg_id;
+	qmi_client_complete complete;
+	void (*cb)(void);
+	void *ctx;
+};
+
+struct qmi_client {
+	int (*send)(const void *buf, size_t len, void *ctx);
+	void *ctx;
+
+	atomic_uint next_txn;
+	unsigned mask;
+
+	struct qmi_client_slot slots[];
+};
+
+/*
+ * depth is rounded up to a power of two, of at most 32768: a ring of all 65536
+ * txns would leave slot 0 to txn 0 alone, which is never used.
+ */
+struct qmi_client *qmi_client_init(int (*send)(const void *buf, size_t len, void *ctx),
+				   void *ctx, unsigned depth)
+{
+	struct qmi_client *client;
+	unsigned size = 1;
+	unsigned i;
+
+	if (!depth || depth > 32768)
+		return NULL;
+
+	while (size < depth)
+		size <<= 1;
+
+	client = malloc(sizeof(struct qmi_client) + size * sizeof(struct qmi_client_slot));
+	if (!client)
+		return NULL;
+
+	client->send = send;
+	client->ctx = ctx;
+	client->mask = size - 1;
+	atomic_init(&client->next_txn, 1);
+	for (i = 0; i < size; i++)
+		atomic_init(&client->slots[i].state, QMI_CLIENT_FREE);
+
+	return client;
+}
+
+void qmi_client_free(struct qmi_client *client)
+{
+	free(client);
+}
+
+/*
+ * Send the request tlv under a fresh txn, complete() is called with the
+ * decoded response, or an error, once it arrives. Returns the txn, -EBUSY
+ * when the ring is full or the error of the transport.
+ */
+int qmi_client_call(struct qmi_client *client, struct qmi_tlv *tlv,
+		    qmi_client_complete complete, void (*cb)(void), void *ctx)
+{
+	struct qmi_client_slot *slot;
+	unsigned expected;
+	unsigned tries;
+	unsigned txn;
+	size_t len;
+	void *buf;
+	int ret;
+
+	/*
+	 * Probe every slot; as txn 0 is skipped, it takes up to twice the ring
+	 * size of txns around the wrap to reach them all
+	 */
+	for (tries = 0;; tries++) {
+		if (tries > 2 * client->mask + 1)
+			return -EBUSY;
+
+		do {
+			txn = atomic_fetch_add(&client->next_txn, 1) & 0xffff;
+		} while (!txn);
+
+		slot = &client->slots[txn & client->mask];
+		expected = QMI_CLIENT_FREE;
+		if (atomic_compare_exchange_strong(&slot->state, &expected, QMI_CLIENT_BUSY))
+			break;
+	}
+
+	qmi_tlv_set_txn(tlv, txn);
+	buf = qmi_tlv_encode(tlv, &len);
+	if (!buf) {
+		atomic_store_explicit(&slot->state, QMI_CLIENT_FREE, memory_order_release);
+		return -ENOMEM;
+	}
+
+	slot->msg_id = tlv->msg_id;
+	slot->complete = complete;
+	slot->cb = cb;
+	slot->ctx = ctx;
+	atomic_store_explicit(&slot->state, QMI_CLIENT_PENDING | txn, memory_order_release);
+
+	ret = client->send(buf, len, client->ctx);
+	if (ret < 0) {
+		/* Unless a response raced the failure, the request never left */
+		expected = QMI_CLIENT_PENDING | txn;
+		atomic_compare_exchange_strong(&slot->state, &expected, QMI_CLIENT_FREE);
+		return ret;
+	}
+
+	return txn;
+}
+
+/*
+ * Feed a received message; responses complete their request and return 0.
+ * Indications return 1, with msg_id set, for the caller to route. Responses
+ * to unknown txns return -ENOENT.
+ */
+int qmi_client_receive(struct qmi_client *client, void *buf, size_t len, unsigned *msg_id)
+{
+	struct qmi_header *pkt = buf;
+	struct qmi_client_slot *slot;
+	qmi_client_complete complete;
+	void (*cb)(void);
+	struct qmi_tlv *tlv;
+	unsigned expected;
+	unsigned txn;
+	void *ctx;
+
+	if (len < sizeof(struct qmi_header))
+		return -EINVAL;
+
+	if (pkt->type == 4) {
+		*msg_id = le16toh(pkt->msg_id);
+		return 1;
+	}
+
+	if (pkt->type != 2)
+		return -EINVAL;
+
+	txn = le16toh(pkt->txn_id);
+	slot = &client->slots[txn & client->mask];
+	expected = QMI_CLIENT_PENDING | txn;
+	if (!atomic_compare_exchange_strong_explicit(&slot->state, &expected, QMI_CLIENT_BUSY,
+						     memory_order_acquire, memory_order_relaxed))
+		return -ENOENT;
+
+	*msg_id = slot->msg_id;
+	complete = slot->complete;
+	cb = slot->cb;
+	ctx = slot->ctx;
+	atomic_store_explicit(&slot->state, QMI_CLIENT_FREE, memory_order_release);
+
+	tlv = qmi_tlv_decode(buf, len, NULL, *msg_id, 2);
+	complete(tlv, tlv ? 0 : -EPROTO, cb, ctx);
+	if (tlv)
+		qmi_tlv_free(tlv);
+
+	return 0;
+}
+
+/* Complete all requests in flight with error, e.g. when the service goes away */
+void qmi_client_cancel(struct qmi_client *client, int error)
+{
+	struct qmi_client_slot *slot;
+	qmi_client_complete complete;
+	void (*cb)(void);
+	unsigned state;
+	unsigned i;
+	void *ctx;
+
+	for (i = 0; i <= client->mask; i++) {
+		slot = &client->slots[i];
+		state = atomic_load_explicit(&slot->state, memory_order_acquire);
+		if (!(state & QMI_CLIENT_PENDING))
+			continue;
+
+		if (!atomic_compare_exchange_strong(&slot->state, &state, QMI_CLIENT_BUSY))
+			continue;
+
+		complete = slot->complete;
+		cb = slot->cb;
+		ctx = slot->ctx;
+		atomic_store_explicit(&slot->state, QMI_CLIENT_FREE, memory_order_release);
+		complete(NULL, error, cb, ctx);
+	}
+}
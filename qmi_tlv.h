@@ -0,0 +1,119 @@
+#ifndef __QMI_TLV_H__
+#define __QMI_TLV_H__
+
+#include <endian.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Message representation of the accessor runtime, shared with the inline
+ * accessors (qmic -i) so lookups can be inlined into the caller.
+ */
+
+struct qmi_header {
+	uint8_t type;
+	uint16_t txn_id;
+	uint16_t msg_id;
+	uint16_t msg_len;
+} __attribute__((__packed__));
+
+struct qmi_tlv_header {
+	uint8_t key;
+	uint16_t len;
+	uint8_t data[];
+} __attribute__((__packed__));
+
+struct qmi_tlv {
+	/* Room for the QMI header, followed by the TLVs */
+	void *allocated;
+	void *buf;
+	size_t size;
+
+	/* QMI header of a decoded, user provided, buffer */
+	void *packet;
+
+	unsigned txn;
+	unsigned msg_id;
+	unsigned type;
+
+	/* Ids of the TLVs in buf, 256 bits as TLV ids are 8 bit */
+	uint64_t present[4];
+
+	/* Handle allocated by qmi_tlv_decode_batch(), freed with the batch */
+	bool batch;
+};
+
+#define QMI_TLV_BIT(map, id)	((map)[(id) / 64] >> ((id) % 64) & 1)
+#define QMI_TLV_SET_BIT(map, id)	((map)[(id) / 64] |= 1ULL << ((id) % 64))
+
+static inline struct qmi_tlv_header *qmi_tlv_find(struct qmi_tlv *tlv, unsigned id)
+{
+	struct qmi_tlv_header *hdr;
+	size_t offset = 0;
+
+	if (id > UINT8_MAX || !QMI_TLV_BIT(tlv->present, id))
+		return NULL;
+
+	while (offset < tlv->size) {
+		hdr = (struct qmi_tlv_header *)((uint8_t *)tlv->buf + offset);
+		if (hdr->key == id)
+			return hdr;
+
+		offset += sizeof(struct qmi_tlv_header) + le16toh(hdr->len);
+	}
+	return NULL;
+}
+
+static inline void *qmi_tlv_find_data(struct qmi_tlv *tlv, unsigned id, size_t *len)
+{
+	struct qmi_tlv_header *hdr;
+
+	hdr = qmi_tlv_find(tlv, id);
+	if (!hdr)
+		return NULL;
+
+	*len = le16toh(hdr->len);
+	return hdr->data;
+}
+
+static inline void *qmi_tlv_find_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, size_t *len, size_t *size)
+{
+	struct qmi_tlv_header *hdr;
+	uint16_t count16;
+	size_t data_len;
+	size_t count;
+
+	hdr = qmi_tlv_find(tlv, id);
+	if (!hdr)
+		return NULL;
+
+	data_len = le16toh(hdr->len);
+	if (data_len < len_size)
+		return NULL;
+
+	if (len_size == 2) {
+		memcpy(&count16, hdr->data, sizeof(count16));
+		count = le16toh(count16);
+	} else if (len_size == 1) {
+		count = hdr->data[0];
+	} else {
+		/* Fixed size arrays carry no count, the element size is passed in */
+		if (!*size || data_len % *size)
+			return NULL;
+		count = data_len / *size;
+	}
+
+	/* An empty array is present, with no elements of any size */
+	data_len -= len_size;
+	if (count ? data_len % count : data_len)
+		return NULL;
+
+	*len = count;
+	*size = count ? data_len / count : 0;
+
+	return hdr->data + len_size;
+}
+
+#endif
@@ -62,11 +62,67 @@ void guard_footer(FILE *fp)
 	fprintf(fp, "#endif\n");
 }
 
+/*
+ * Tests of the 256 bit map, indexed by TLV id, filled in by the _diff helpers
+ * of both backends.
+ */
+void qmi_message_emit_changed(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	struct qmi_message_member *qmm;
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		fprintf(fp, "static inline bool %1$s_%2$s_changed_%3$s(const uint64_t changed[4])\n"
+			    "{\n"
+			    "\treturn changed[%4$d] >> %5$d & 1;\n"
+			    "}\n"
+			    "\n",
+			package, qm->name, qmm->name, qmm->id / 64, qmm->id % 64);
+	}
+}
+
+/*
+ * Fill mask, indexed by TLV id, with the required members of qm. Returns
+ * whether there are any.
+ */
+bool qmi_message_required(struct qmi_message *qm, unsigned long long mask[4])
+{
+	struct qmi_message_member *qmm;
+	bool any = false;
+
+	memset(mask, 0, 4 * sizeof(mask[0]));
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		if (!qmm->required)
+			continue;
+
+		mask[qmm->id / 64] |= 1ULL << (qmm->id % 64);
+		any = true;
+	}
+
+	return any;
+}
+
+/*
+ * Find the first message of the given type sharing msg_id with qm, e.g. the
+ * response to a request. Returns NULL if there is none.
+ */
+struct qmi_message *qmi_message_peer(struct qmi_message *qm, enum message_type type)
+{
+	struct qmi_message *peer;
+
+	list_for_each_entry(peer, &qmi_messages, node) {
+		if (peer->type == type && peer->msg_id == qm->msg_id)
+			return peer;
+	}
+
+	return NULL;
+}
+
 static void usage(void)
 {
 	extern const char *__progname;
 
-	fprintf(stderr, "Usage: %s [-ak]\n", __progname);
+	fprintf(stderr, "Usage: %s [-acikrs]\n", __progname);
 	exit(1);
 }
 
@@ -78,14 +134,27 @@ int main(int argc, char **argv)
 	int method = 0;
 	int opt;
 
-	while ((opt = getopt(argc, argv, "ak")) != -1) {
+	while ((opt = getopt(argc, argv, "acikrs")) != -1) {
 		switch (opt) {
 		case 'a':
 			method = 0;
 			break;
+		case 'i':
+			method = 0;
+			accessor_inline = true;
+			break;
 		case 'k':
 			method = 1;
 			break;
+		case 'c':
+			method = 2;
+			break;
+		case 's':
+			method = 3;
+			break;
+		case 'r':
+			method = 4;
+			break;
 		default:
 			usage();
 		}
@@ -93,6 +162,35 @@ int main(int argc, char **argv)
 
 	qmi_parse();
 
+	if (method == 2) {
+		snprintf(fname, sizeof(fname), "qmi_%s.hpp", qmi_package);
+		hfp = fopen(fname, "w");
+		if (!hfp)
+			err(1, "failed to open %s", fname);
+
+		cxx_emit_h(hfp, qmi_package);
+
+		fclose(hfp);
+		return 0;
+	}
+
+	if (method == 3) {
+		snprintf(fname, sizeof(fname), "qmi_%s.qsd", qmi_package);
+		sfp = fopen(fname, "wb");
+		if (!sfp)
+			err(1, "failed to open %s", fname);
+
+		schema_emit(sfp, qmi_package);
+
+		fclose(sfp);
+		return 0;
+	}
+
+	if (method == 4) {
+		report_emit(stdout, qmi_package);
+		return 0;
+	}
+
 	snprintf(fname, sizeof(fname), "qmi_%s.c", qmi_package);
 	sfp = fopen(fname, "w");
 	if (!sfp)
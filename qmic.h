@@ -7,6 +7,13 @@
 
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof((x)[0]))
 
+/*
+ * Longest string, as held NUL terminated in char[256] by the kernel structs.
+ * On the wire a string TLV is just the characters, while a string member of
+ * a struct is prefixed by a 2 byte length, its elem_len of 256 exceeding 255.
+ */
+#define QMI_STRING_MAX	255
+
 enum symbol_type {
 	TYPE_U8,
 	TYPE_U16,
@@ -76,15 +83,40 @@ extern struct list_head qmi_structs;
 
 void qmi_parse(void);
 
+struct qmi_message *qmi_message_peer(struct qmi_message *qm, enum message_type type);
+bool qmi_message_required(struct qmi_message *qm, unsigned long long mask[4]);
+void qmi_message_emit_changed(FILE *fp, const char *package, struct qmi_message *qm);
+
 void emit_source_includes(FILE *fp, const char *package);
 void guard_header(FILE *fp, const char *package);
 void guard_footer(FILE *fp);
 void qmi_const_header(FILE *fp);
 
+unsigned qmi_struct_max_size(struct qmi_struct *qs);
+unsigned qmi_message_max_size(struct qmi_message *qm);
+void dispatch_emit_h(FILE *fp, const char *package, const char *handler);
+void dispatch_emit_c(FILE *fp, const char *package,
+		     void (*emit_handler)(FILE *fp, const char *package,
+					  struct qmi_message *qm));
+
+void client_emit_h(FILE *fp, const char *package);
+void client_emit_c(FILE *fp, const char *package);
+
+void server_emit_h(FILE *fp, const char *package);
+void server_emit_c(FILE *fp, const char *package);
+
+extern bool accessor_inline;
+
 void accessor_emit_c(FILE *fp, const char *package);
 void accessor_emit_h(FILE *fp, const char *package);
 
 void kernel_emit_c(FILE *fp, const char *package);
 void kernel_emit_h(FILE *fp, const char *package);
 
+void cxx_emit_h(FILE *fp, const char *package);
+
+void schema_emit(FILE *fp, const char *package);
+
+void report_emit(FILE *fp, const char *package);
+
 #endif
@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "qmic.h"
+
+/*
+ * Layout report (-r), listing for each struct and message the size of its
+ * native struct as kernel.c lays it out, its range of wire sizes and the
+ * capacity of its arrays and strings. Layouts wasting memory, messages that
+ * cannot be encoded and arrays needing a 2-byte count prefix are flagged with
+ * "warning:" lines, for CI to pick up.
+ */
+
+/* Padding worth reordering members for, and a native struct worth a look */
+#define REPORT_PADDING_WARN	8
+#define REPORT_NATIVE_WARN	4096
+
+#define QMI_HEADER_SIZE		7
+#define QMI_TLV_HEADER_SIZE	3
+#define QMI_MAX_TLV_LEN		65535
+
+static const char *report_types[] = {
+	[TYPE_U8] = "u8",
+	[TYPE_U16] = "u16",
+	[TYPE_U32] = "u32",
+	[TYPE_U64] = "u64",
+	[TYPE_STRING] = "string",
+};
+
+static const unsigned report_sizes[] = {
+	[TYPE_U8] = 1,
+	[TYPE_U16] = 2,
+	[TYPE_U32] = 4,
+	[TYPE_U64] = 8,
+};
+
+struct report_layout {
+	unsigned size;
+	unsigned align;
+	unsigned used;
+};
+
+static void layout_add(struct report_layout *layout, unsigned size, unsigned align)
+{
+	layout->size = (layout->size + align - 1) / align * align + size;
+	layout->used += size;
+	if (align > layout->align)
+		layout->align = align;
+}
+
+static void layout_end(struct report_layout *layout)
+{
+	layout->size = (layout->size + layout->align - 1) / layout->align * layout->align;
+}
+
+/* A string is a uint32_t length followed by char[256] in the kernel structs */
+static void layout_add_string(struct report_layout *layout)
+{
+	layout_add(layout, 4, 4);
+	layout_add(layout, QMI_STRING_MAX + 1, 1);
+}
+
+static void qmi_struct_layout(struct qmi_struct *qs, struct report_layout *layout)
+{
+	struct qmi_struct_member *qsm;
+
+	*layout = (struct report_layout){ .align = 1 };
+
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING)
+			layout_add_string(layout);
+		else
+			layout_add(layout, report_sizes[qsm->type], report_sizes[qsm->type]);
+	}
+
+	layout_end(layout);
+}
+
+/* Strings within structs are prefixed by a 2 byte length on the wire */
+static unsigned qmi_struct_min_size(struct qmi_struct *qs)
+{
+	struct qmi_struct_member *qsm;
+	unsigned size = 0;
+
+	list_for_each_entry(qsm, &qs->members, node)
+		size += qsm->type == TYPE_STRING ? 2 : report_sizes[qsm->type];
+
+	return size;
+}
+
+static void qmi_member_elem(struct qmi_message_member *qmm, unsigned *size,
+			    unsigned *align, unsigned *min, unsigned *max)
+{
+	struct report_layout layout;
+
+	if (qmm->type == TYPE_STRUCT) {
+		qmi_struct_layout(qmm->qmi_struct, &layout);
+		*size = layout.size;
+		*align = layout.align;
+		*min = qmi_struct_min_size(qmm->qmi_struct);
+		*max = qmi_struct_max_size(qmm->qmi_struct);
+	} else {
+		*size = *align = *min = *max = report_sizes[qmm->type];
+	}
+}
+
+static void report_struct(FILE *fp, const char *package, struct qmi_struct *qs)
+{
+	struct qmi_struct_member *qsm;
+	struct report_layout layout;
+
+	qmi_struct_layout(qs, &layout);
+
+	fprintf(fp, "struct %s_%s\n"
+		    "\tnative: %u bytes, align %u, %u bytes padding\n"
+		    "\twire: %u..%u bytes\n",
+		package, qs->name, layout.size, layout.align,
+		layout.size - layout.used,
+		qmi_struct_min_size(qs), qmi_struct_max_size(qs));
+
+	list_for_each_entry(qsm, &qs->members, node) {
+		if (qsm->type == TYPE_STRING)
+			fprintf(fp, "\t%-24s string, up to %u bytes\n", qsm->name, QMI_STRING_MAX);
+		else
+			fprintf(fp, "\t%-24s %s\n", qsm->name, report_types[qsm->type]);
+	}
+
+	fprintf(fp, "\n");
+}
+
+static const char *report_message_type(struct qmi_message *qm)
+{
+	switch (qm->type) {
+	case MESSAGE_REQUEST:
+		return "request";
+	case MESSAGE_RESPONSE:
+		return "response";
+	case MESSAGE_INDICATION:
+		return "indication";
+	}
+
+	return "message";
+}
+
+static void report_message(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	struct report_layout layout = { .align = 1 };
+	struct qmi_message_member *qmm;
+	unsigned biggest_size = 0;
+	const char *biggest = NULL;
+	unsigned required = 0;
+	unsigned count = 0;
+	unsigned min = QMI_HEADER_SIZE;
+	unsigned max;
+	unsigned before;
+	unsigned len_size;
+	bool counted;
+	unsigned elem_size;
+	unsigned elem_align;
+	unsigned elem_min;
+	unsigned elem_max;
+	unsigned tlv_max;
+	char type[64];
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		count++;
+		if (qmm->required)
+			required++;
+	}
+
+	fprintf(fp, "message %s_%s (%s 0x%x)\n",
+		package, qm->name, report_message_type(qm), qm->msg_id);
+
+	list_for_each_entry(qmm, &qm->members, node) {
+		before = layout.used;
+		/* Struct arrays are all VAR_LEN_ARRAY, so fixed ones are counted too */
+		counted = !qmm->array_fixed || qmm->type == TYPE_STRUCT;
+		len_size = !counted ? 0 : qmm->array_size >= 256 ? 2 : 1;
+
+		if (!qmm->required && qmm->type != TYPE_STRING)
+			layout_add(&layout, 1, 1);
+
+		if (qmm->type == TYPE_STRING) {
+			layout_add_string(&layout);
+			snprintf(type, sizeof(type), "string");
+			tlv_max = QMI_STRING_MAX;
+			if (qmm->required)
+				min += QMI_TLV_HEADER_SIZE;
+		} else {
+			qmi_member_elem(qmm, &elem_size, &elem_align, &elem_min, &elem_max);
+
+			if (qmm->type == TYPE_STRUCT)
+				snprintf(type, sizeof(type), "%s", qmm->qmi_struct->name);
+			else
+				snprintf(type, sizeof(type), "%s", report_types[qmm->type]);
+
+			if (qmm->array_size) {
+				layout_add(&layout, 4, 4);
+				layout_add(&layout, qmm->array_size * elem_size, elem_align);
+				snprintf(type + strlen(type), sizeof(type) - strlen(type),
+					 qmm->array_fixed ? "[%u]" : "(%u)", qmm->array_size);
+				tlv_max = len_size + qmm->array_size * elem_max;
+				if (qmm->required)
+					min += QMI_TLV_HEADER_SIZE + len_size +
+					       (counted ? 0 : qmm->array_size * elem_min);
+			} else {
+				layout_add(&layout, elem_size, elem_align);
+				tlv_max = elem_max;
+				if (qmm->required)
+					min += QMI_TLV_HEADER_SIZE + elem_min;
+			}
+		}
+
+		fprintf(fp, "\t0x%02x %-24s %-20s %-8s native %u, wire up to %u\n",
+			qmm->id, qmm->name, type,
+			qmm->required ? "required" : "optional",
+			layout.used - before, QMI_TLV_HEADER_SIZE + tlv_max);
+
+		if (layout.used - before > biggest_size) {
+			biggest_size = layout.used - before;
+			biggest = qmm->name;
+		}
+
+		if (len_size == 2)
+			fprintf(fp, "\twarning: %s has %u elements, needing a 2-byte count prefix\n",
+				qmm->name, qmm->array_size);
+
+		if (tlv_max > QMI_MAX_TLV_LEN)
+			fprintf(fp, "\twarning: %s can take %u bytes, more than a TLV holds\n",
+				qmm->name, tlv_max);
+	}
+
+	layout_end(&layout);
+	max = QMI_HEADER_SIZE + qmi_message_max_size(qm);
+
+	fprintf(fp, "\tnative: %u bytes, align %u, %u bytes padding\n"
+		    "\twire: %u..%u bytes, %u TLV%s (%u required)\n",
+		layout.size, layout.align, layout.size - layout.used,
+		min, max, count, count == 1 ? "" : "s", required);
+
+	if (layout.size - layout.used >= REPORT_PADDING_WARN)
+		fprintf(fp, "\twarning: %u of %u native bytes are padding, consider grouping members by alignment\n",
+			layout.size - layout.used, layout.size);
+
+	if (layout.size > REPORT_NATIVE_WARN)
+		fprintf(fp, "\twarning: native struct is %u bytes, %u of them for %s\n",
+			layout.size, biggest_size, biggest);
+
+	if (max > QMI_HEADER_SIZE + QMI_MAX_TLV_LEN)
+		fprintf(fp, "\twarning: can take %u bytes, more than a QMI message holds\n",
+			max);
+
+	fprintf(fp, "\n");
+}
+
+void report_emit(FILE *fp, const char *package)
+{
+	struct qmi_message *qm;
+	struct qmi_struct *qs;
+
+	fprintf(fp, "package %s\n"
+		    "\n",
+		package);
+
+	list_for_each_entry(qs, &qmi_structs, node)
+		report_struct(fp, package, qs);
+
+	list_for_each_entry(qm, &qmi_messages, node)
+		report_message(fp, package, qm);
+}
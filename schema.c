@@ -0,0 +1,220 @@
+#include <endian.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qmic.h"
+#include "qmi_schema.h"
+
+/*
+ * Binary schema descriptor backend, serializing the parsed IR for tools that
+ * load schemas at runtime through qmi_schema.c rather than generated code.
+ */
+
+static const uint8_t schema_types[] = {
+	[TYPE_U8] = QMI_SCHEMA_U8,
+	[TYPE_U16] = QMI_SCHEMA_U16,
+	[TYPE_U32] = QMI_SCHEMA_U32,
+	[TYPE_U64] = QMI_SCHEMA_U64,
+	[TYPE_STRING] = QMI_SCHEMA_STRING,
+	[TYPE_STRUCT] = QMI_SCHEMA_STRUCT,
+};
+
+struct schema_strings {
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+static void *schema_alloc(size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	ptr = calloc(nmemb ? nmemb : 1, size);
+	if (!ptr) {
+		fprintf(stderr, "failed to allocate schema descriptor\n");
+		exit(1);
+	}
+
+	return ptr;
+}
+
+static uint32_t schema_string(struct schema_strings *strings, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	uint32_t offset = strings->len;
+
+	if (strings->len + len > strings->size) {
+		strings->size = (strings->len + len) * 2;
+		strings->buf = realloc(strings->buf, strings->size);
+		if (!strings->buf) {
+			fprintf(stderr, "failed to allocate schema descriptor\n");
+			exit(1);
+		}
+	}
+
+	memcpy(strings->buf + strings->len, str, len);
+	strings->len += len;
+
+	return htole32(offset);
+}
+
+static unsigned schema_struct_index(struct qmi_struct *qs)
+{
+	struct qmi_struct *it;
+	unsigned idx = 0;
+
+	list_for_each_entry(it, &qmi_structs, node) {
+		if (it == qs)
+			return idx;
+		idx++;
+	}
+
+	return QMI_SCHEMA_NO_STRUCT;
+}
+
+static uint32_t schema_table(struct qmi_schema_table *table, uint32_t offset,
+			     unsigned count, size_t size)
+{
+	table->offset = htole32(offset);
+	table->count = htole32(count);
+
+	return offset + count * size;
+}
+
+void schema_emit(FILE *fp, const char *package)
+{
+	struct qmi_schema_file_message *messages;
+	struct qmi_schema_file_member *members;
+	struct qmi_schema_file_struct *structs;
+	struct qmi_schema_file_const *consts;
+	struct schema_strings strings = {};
+	struct qmi_message_member *qmm;
+	struct qmi_struct_member *qsm;
+	struct qmi_schema_file hdr;
+	struct qmi_message *qm;
+	struct qmi_struct *qs;
+	struct qmi_const *qc;
+	unsigned n_messages = 0;
+	unsigned n_members = 0;
+	unsigned n_structs = 0;
+	unsigned n_consts = 0;
+	unsigned bits = 1;
+	unsigned member;
+	unsigned slot;
+	uint16_t *slots;
+	uint32_t offset;
+	unsigned i;
+
+	list_for_each_entry(qc, &qmi_consts, node)
+		n_consts++;
+
+	list_for_each_entry(qs, &qmi_structs, node) {
+		n_structs++;
+		list_for_each_entry(qsm, &qs->members, node)
+			n_members++;
+	}
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		n_messages++;
+		list_for_each_entry(qmm, &qm->members, node) {
+			if (qmm->array_size > UINT16_MAX) {
+				fprintf(stderr, "array %s too large for schema descriptor\n",
+					qmm->name);
+				exit(1);
+			}
+			n_members++;
+		}
+	}
+
+	while ((1u << bits) < n_messages * 2)
+		bits++;
+
+	consts = schema_alloc(n_consts, sizeof(*consts));
+	structs = schema_alloc(n_structs, sizeof(*structs));
+	messages = schema_alloc(n_messages, sizeof(*messages));
+	members = schema_alloc(n_members, sizeof(*members));
+	slots = schema_alloc(1u << bits, sizeof(*slots));
+
+	i = 0;
+	list_for_each_entry(qc, &qmi_consts, node) {
+		consts[i].name = schema_string(&strings, qc->name);
+		consts[i].value = htole64(qc->value);
+		i++;
+	}
+
+	i = 0;
+	member = 0;
+	list_for_each_entry(qs, &qmi_structs, node) {
+		structs[i].name = schema_string(&strings, qs->name);
+		structs[i].first_member = htole32(member);
+
+		list_for_each_entry(qsm, &qs->members, node) {
+			members[member].name = schema_string(&strings, qsm->name);
+			members[member].qmi_struct = htole16(QMI_SCHEMA_NO_STRUCT);
+			members[member].type = schema_types[qsm->type];
+			member++;
+		}
+
+		structs[i].n_members = htole32(member - le32toh(structs[i].first_member));
+		i++;
+	}
+
+	i = 0;
+	list_for_each_entry(qm, &qmi_messages, node) {
+		messages[i].name = schema_string(&strings, qm->name);
+		messages[i].msg_id = htole16(qm->msg_id);
+		messages[i].type = qm->type;
+		messages[i].first_member = htole32(member);
+
+		list_for_each_entry(qmm, &qm->members, node) {
+			members[member].name = schema_string(&strings, qmm->name);
+			members[member].array_size = htole16(qmm->array_size);
+			members[member].qmi_struct = htole16(qmm->qmi_struct ?
+							     schema_struct_index(qmm->qmi_struct) :
+							     QMI_SCHEMA_NO_STRUCT);
+			members[member].id = qmm->id;
+			members[member].type = schema_types[qmm->type];
+			members[member].flags = (qmm->required ? QMI_SCHEMA_REQUIRED : 0) |
+						(qmm->array_fixed ? QMI_SCHEMA_FIXED : 0);
+			member++;
+		}
+
+		messages[i].n_members = htole32(member - le32toh(messages[i].first_member));
+
+		slot = qmi_schema_hash(qm->msg_id, qm->type, bits);
+		while (slots[slot])
+			slot = (slot + 1) & ((1u << bits) - 1);
+		slots[slot] = htole16(++i);
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, QMI_SCHEMA_MAGIC, sizeof(hdr.magic));
+	hdr.version = htole32(QMI_SCHEMA_VERSION);
+	hdr.package = schema_string(&strings, package);
+
+	offset = sizeof(hdr);
+	offset = schema_table(&hdr.consts, offset, n_consts, sizeof(*consts));
+	offset = schema_table(&hdr.structs, offset, n_structs, sizeof(*structs));
+	offset = schema_table(&hdr.messages, offset, n_messages, sizeof(*messages));
+	offset = schema_table(&hdr.members, offset, n_members, sizeof(*members));
+	offset = schema_table(&hdr.slots, offset, 1u << bits, sizeof(*slots));
+	offset = schema_table(&hdr.strings, offset, strings.len, 1);
+	hdr.size = htole32(offset);
+
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+	fwrite(consts, sizeof(*consts), n_consts, fp);
+	fwrite(structs, sizeof(*structs), n_structs, fp);
+	fwrite(messages, sizeof(*messages), n_messages, fp);
+	fwrite(members, sizeof(*members), n_members, fp);
+	fwrite(slots, sizeof(*slots), 1u << bits, fp);
+	fwrite(strings.buf, 1, strings.len, fp);
+
+	free(strings.buf);
+	free(slots);
+	free(members);
+	free(messages);
+	free(structs);
+	free(consts);
+}
@@ -0,0 +1,234 @@
+#include <stdio.h>
+
+#include "qmic.h"
+
+/*
+ * Server skeletons, on top of the qmi_server runtime. Each request gets a
+ * typed handler in <package>_server_ops, taking the decoded request and, if
+ * a response shares its msg_id, the response to fill in; it is sent when
+ * the handler returns 0 and dropped otherwise. Requests lacking required
+ * members don't reach the handler: they are answered with a result TLV of
+ * QMI_RESULT_FAILURE and QMI_ERR_MISSING_ARG, so the client isn't left waiting,
+ * or dropped with -EPROTO when there's no response to send. Requests are
+ * routed by msg_id, <package>_server_dispatch() plugs the ops into
+ * qmi_server_init().
+ */
+
+#define QMI_RESULT_FAILURE	1
+#define QMI_ERR_MISSING_ARG	0x11
+
+static bool server_first_request(struct qmi_message *qm)
+{
+	return qm->type == MESSAGE_REQUEST &&
+	       qmi_message_peer(qm, MESSAGE_REQUEST) == qm;
+}
+
+void server_emit_h(FILE *fp, const char *package)
+{
+	struct qmi_message *resp;
+	struct qmi_message *qm;
+	bool empty = true;
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		if (!server_first_request(qm))
+			continue;
+
+		if (empty)
+			fprintf(fp, "struct %s_server_ops {\n", package);
+		empty = false;
+
+		resp = qmi_message_peer(qm, MESSAGE_RESPONSE);
+		if (resp)
+			fprintf(fp, "\tint (*%2$s)(struct %1$s_%2$s *%2$s, struct %1$s_%3$s *%3$s, void *ctx);\n",
+				    package, qm->name, resp->name);
+		else
+			fprintf(fp, "\tint (*%2$s)(struct %1$s_%2$s *%2$s, void *ctx);\n",
+				    package, qm->name);
+	}
+
+	if (empty)
+		fprintf(fp, "struct %s_server_ops;\n", package);
+	else
+		fprintf(fp, "};\n");
+
+	fprintf(fp, "\n"
+		    "ssize_t %1$s_server_handle(const struct %1$s_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);\n"
+		    "ssize_t %1$s_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);\n"
+		    "\n",
+		    package);
+}
+
+static bool server_has_required(struct qmi_message *qm)
+{
+	unsigned long long required[4];
+
+	return qmi_message_required(qm, required);
+}
+
+/* Shared by the requests with a response, to fail the ones missing members */
+static void server_emit_missing_arg(FILE *fp, const char *package)
+{
+	struct qmi_message *qm;
+	bool used = false;
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		if (server_first_request(qm) && server_has_required(qm) &&
+		    qmi_message_peer(qm, MESSAGE_RESPONSE))
+			used = true;
+	}
+
+	if (!used)
+		return;
+
+	fprintf(fp, "static int %1$s_server_missing_arg(struct qmi_tlv *resp)\n"
+		    "{\n"
+		    "\tuint8_t result[] = { %2$d, 0, 0x%3$02x, 0 };\n"
+		    "\n"
+		    "\treturn qmi_tlv_set(resp, 2, result, sizeof(result));\n"
+		    "}\n"
+		    "\n",
+		    package, QMI_RESULT_FAILURE, QMI_ERR_MISSING_ARG);
+}
+
+static void server_emit_serve(FILE *fp, const char *package, struct qmi_message *qm)
+{
+	struct qmi_message *resp;
+
+	resp = qmi_message_peer(qm, MESSAGE_RESPONSE);
+	if (!resp) {
+		fprintf(fp, "static ssize_t %1$s_%2$s_serve(const struct %1$s_server_ops *ops, void *buf, size_t len, void *ctx)\n"
+			    "{\n"
+			    "\tstruct qmi_tlv *req;\n"
+			    "\tint ret;\n"
+			    "\n"
+			    "\treq = qmi_tlv_decode(buf, len, NULL, %3$d, %4$d);\n"
+			    "\tif (!req)\n"
+			    "\t\treturn -EINVAL;\n"
+			    "\n",
+			    package, qm->name, qm->msg_id, qm->type);
+		if (server_has_required(qm))
+			fprintf(fp, "\tif (%1$s_%2$s_missing_required((struct %1$s_%2$s *)req)) {\n"
+				    "\t\tqmi_tlv_free(req);\n"
+				    "\t\treturn -EPROTO;\n"
+				    "\t}\n"
+				    "\n",
+				    package, qm->name);
+		fprintf(fp, "\tret = ops->%2$s((struct %1$s_%2$s *)req, ctx);\n"
+			    "\tqmi_tlv_free(req);\n"
+			    "\n"
+			    "\treturn ret < 0 ? ret : 0;\n"
+			    "}\n"
+			    "\n",
+			    package, qm->name);
+		return;
+	}
+
+	fprintf(fp, "static ssize_t %1$s_%2$s_serve(const struct %1$s_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)\n"
+		    "{\n"
+		    "\tstruct qmi_tlv *resp;\n"
+		    "\tstruct qmi_tlv *req;\n"
+		    "\tunsigned txn;\n"
+		    "\tsize_t resp_len;\n"
+		    "\tssize_t ret;\n"
+		    "\n"
+		    "\treq = qmi_tlv_decode(buf, len, &txn, %3$d, %4$d);\n"
+		    "\tif (!req)\n"
+		    "\t\treturn -EINVAL;\n"
+		    "\n",
+		    package, qm->name, qm->msg_id, qm->type);
+	fprintf(fp, "\tresp = qmi_tlv_init(txn, %1$d, %2$d);\n"
+		    "\tif (!resp) {\n"
+		    "\t\tqmi_tlv_free(req);\n"
+		    "\t\treturn -ENOMEM;\n"
+		    "\t}\n"
+		    "\n",
+		    qm->msg_id, resp->type);
+	if (server_has_required(qm))
+		fprintf(fp, "\tif (%1$s_%2$s_missing_required((struct %1$s_%2$s *)req))\n"
+			    "\t\tret = %1$s_server_missing_arg(resp);\n"
+			    "\telse\n"
+			    "\t\tret = ops->%2$s((struct %1$s_%2$s *)req, (struct %1$s_%3$s *)resp, ctx);\n",
+			    package, qm->name, resp->name);
+	else
+		fprintf(fp, "\tret = ops->%2$s((struct %1$s_%2$s *)req, (struct %1$s_%3$s *)resp, ctx);\n",
+			    package, qm->name, resp->name);
+	fprintf(fp, "\tif (!ret)\n"
+		    "\t\tret = qmi_tlv_encode_batch(&resp, 1, out, cap, &resp_len);\n"
+		    "\telse if (ret > 0)\n"
+		    "\t\tret = 0;\n"
+		    "\n"
+		    "\tqmi_tlv_free(resp);\n"
+		    "\tqmi_tlv_free(req);\n"
+		    "\n"
+		    "\treturn ret;\n"
+		    "}\n"
+		    "\n");
+}
+
+void server_emit_c(FILE *fp, const char *package)
+{
+	struct qmi_message *qm;
+	bool replies = false;
+	bool empty = true;
+
+	server_emit_missing_arg(fp, package);
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		if (server_first_request(qm)) {
+			server_emit_serve(fp, package, qm);
+			if (qmi_message_peer(qm, MESSAGE_RESPONSE))
+				replies = true;
+			empty = false;
+		}
+	}
+
+	fprintf(fp, "ssize_t %1$s_server_handle(const struct %1$s_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)\n"
+		    "{\n"
+		    "\tconst uint8_t *pkt = buf;\n"
+		    "\n",
+		    package);
+	if (empty)
+		fprintf(fp, "\t(void)ops;\n"
+			    "\t(void)ctx;\n");
+	if (!replies)
+		fprintf(fp, "\t(void)out;\n"
+			    "\t(void)cap;\n");
+	if (!replies || empty)
+		fprintf(fp, "\n");
+	fprintf(fp, "\tif (len < 7 || pkt[0] != 0)\n"
+		    "\t\treturn -EINVAL;\n"
+		    "\n"
+		    "\tswitch (pkt[3] | pkt[4] << 8) {\n");
+
+	list_for_each_entry(qm, &qmi_messages, node) {
+		if (!server_first_request(qm))
+			continue;
+
+		fprintf(fp, "\tcase %d:\n"
+			    "\t\tif (!ops->%s)\n"
+			    "\t\t\treturn -EOPNOTSUPP;\n"
+			    "\n",
+			    qm->msg_id, qm->name);
+
+		if (qmi_message_peer(qm, MESSAGE_RESPONSE))
+			fprintf(fp, "\t\treturn %s_%s_serve(ops, buf, len, out, cap, ctx);\n",
+				    package, qm->name);
+		else
+			fprintf(fp, "\t\treturn %s_%s_serve(ops, buf, len, ctx);\n",
+				    package, qm->name);
+	}
+
+	fprintf(fp, "\t}\n"
+		    "\n"
+		    "\treturn -ENOENT;\n"
+		    "}\n"
+		    "\n");
+
+	/* For qmi_server_init(), which is only linked in when used */
+	fprintf(fp, "ssize_t %1$s_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)\n"
+		    "{\n"
+		    "\treturn %1$s_server_handle(ops, buf, len, out, cap, ctx);\n"
+		    "}\n"
+		    "\n",
+		    package);
+}
@@ -0,0 +1,210 @@
+#!/bin/sh
+#
+# Run qmic over each fixture in tests/, with the accessor (-a), inline
+# accessor (-i), kernel (-k) and C++ (-c) backends. Generated sources are
+# compared against the expected output in tests/expected/ and built with
+# -Werror; fixtures with an expected .err file must instead fail with that
+# error message. Binary schema descriptors (-s) are compared through the
+# output of schema_dump, layout reports (-r) as printed.
+#
+# The runtime tests then build the programs of tests/runtime/ against code
+# generated from tests/runtime/runtime.qmi and run them, byteswap.c in a
+# build passing for a big endian host, and cxx.cpp against the C++ code of
+# tests/runtime/cxx.qmi. qmidecode reports on the capture in
+# tests/runtime/ are compared against tests/expected/ for several thread
+# counts, and must not depend on the thread count on a generated capture.
+# The layout report of runtime.qmi is compared as well.
+#
+# Usage: check.sh <qmic> [-u]
+#
+# With -u the expected output is updated rather than compared.
+#
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 <qmic> [-u]" >&2
+	exit 1
+fi
+
+QMIC=$(realpath "$1")
+UPDATE=${2:-}
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+
+TESTS=$(cd "$(dirname "$0")" && pwd)
+EXPECTED=$TESTS/expected
+TMP=$(mktemp -d)
+WORK=$TMP/work
+trap 'rm -rf "$TMP"' EXIT
+
+mkdir "$WORK"
+if ! $CC -Wall -Werror -o "$TMP/schema_dump" "$TESTS/schema_dump.c" "$TESTS/../qmi_schema.c"; then
+	echo "FAIL: schema_dump does not build"
+	exit 1
+fi
+
+failed=0
+passed=0
+
+fail() {
+	echo "FAIL: $*"
+	failed=$((failed + 1))
+}
+
+for qmi in "$TESTS"/*.qmi; do
+	name=$(basename "$qmi" .qmi)
+
+	for method in a i k c r s; do
+		rm -rf "$WORK"/*
+
+		(cd "$WORK" && "$QMIC" -$method < "$qmi" > "$WORK/stdout" 2> "$WORK/stderr")
+		ret=$?
+
+		if [ -f "$EXPECTED/$name.err" ]; then
+			if [ $ret -eq 0 ]; then
+				fail "$name -$method: unexpected success"
+			elif ! diff -u "$EXPECTED/$name.err" "$WORK/stderr"; then
+				fail "$name -$method: wrong error message"
+			else
+				passed=$((passed + 1))
+			fi
+			continue
+		fi
+
+		if [ $ret -ne 0 ]; then
+			cat "$WORK/stderr"
+			fail "$name -$method: qmic failed"
+			continue
+		fi
+
+		case $method in
+		c)
+			exts=hpp
+			build="echo '#include \"$(basename "$WORK"/qmi_*.hpp)\"' | $CXX -std=c++20 -Wall -Wextra -Werror -x c++ -fsyntax-only -"
+			;;
+		r)
+			exts=txt
+			build=true
+			mv "$WORK/stdout" "$WORK/qmi_report.txt"
+			;;
+		s)
+			exts=txt
+			build="\"$TMP/schema_dump\" qmi_*.qsd > /dev/null"
+			"$TMP/schema_dump" "$WORK"/qmi_*.qsd > "$WORK/qmi_schema.txt" 2>&1
+			;;
+		*)
+			exts="c h"
+			build="$CC -Wall -Wextra -Werror -I\"$TESTS\" -I\"$TESTS/..\" -c qmi_*.c"
+			;;
+		esac
+
+		ok=1
+		for ext in $exts; do
+			out=$(ls "$WORK"/qmi_*.$ext)
+			golden=$EXPECTED/$name.$method.$ext
+
+			if [ "$UPDATE" = "-u" ]; then
+				mkdir -p "$EXPECTED"
+				cp "$out" "$golden"
+			elif ! diff -u "$golden" "$out"; then
+				fail "$name -$method: qmi_*.$ext differs"
+				ok=0
+			fi
+		done
+
+		if ! (cd "$WORK" && eval "$build"); then
+			fail "$name -$method: generated code does not build"
+			ok=0
+		fi
+
+		[ $ok -eq 1 ] && passed=$((passed + 1))
+	done
+done
+
+# Runtime tests, against the accessor and kernel code of tests/runtime/runtime.qmi
+RUNTIME=$TESTS/runtime
+RT=$TMP/runtime
+BYTESWAP="-include $RUNTIME/byteswap.h -U__BYTE_ORDER__ -D__BYTE_ORDER__=__ORDER_BIG_ENDIAN__ -Wno-builtin-macro-redefined"
+mkdir "$RT" "$RT/kernel" "$RT/cxx"
+
+# Layout report of runtime.qmi, sizing struct strings and struct arrays the fixtures lack
+"$QMIC" -r < "$RUNTIME/runtime.qmi" > "$RT/runtime.r.txt"
+[ "$UPDATE" = "-u" ] && cp "$RT/runtime.r.txt" "$EXPECTED/runtime.r.txt"
+if diff -u "$EXPECTED/runtime.r.txt" "$RT/runtime.r.txt"; then
+	passed=$((passed + 1))
+else
+	fail "runtime: report"
+fi
+
+if ! (cd "$RT" && "$QMIC" -a < "$RUNTIME/runtime.qmi" && "$QMIC" -s < "$RUNTIME/runtime.qmi") ||
+   ! (cd "$RT/kernel" && "$QMIC" -k < "$RUNTIME/runtime.qmi") ||
+   ! (cd "$RT/cxx" && "$QMIC" -c < "$RUNTIME/cxx.qmi"); then
+	fail "runtime: qmic failed"
+elif ! $CC -Wall -Wextra -Werror -o "$RT/qmic-gen" "$TESTS/../tools/qmic-gen.c" "$TESTS/../qmi_schema.c" ||
+     ! $CC -Wall -Wextra -Werror -o "$RT/qmidecode" "$TESTS/../tools/qmidecode.c" "$TESTS/../qmi_schema.c" -pthread ||
+     ! $CC -Wall -Wextra -Werror -I"$RT" -I"$TESTS" -I"$TESTS/.." -o "$RT/json_roundtrip" \
+	"$RUNTIME/json_roundtrip.c" "$RT/qmi_rt.c" "$TESTS/../qmi_tlv.c" ||
+     ! $CC -Wall -Wextra -Werror -I"$RT" -I"$TESTS" -I"$TESTS/.." -o "$RT/runtime" \
+	"$RUNTIME/runtime.c" "$RT/qmi_rt.c" "$TESTS/../qmi_tlv.c" "$TESTS/../qmi_server.c" -pthread ||
+     ! $CC -Wall -Wextra -Werror $BYTESWAP -I"$RT" -I"$TESTS" -I"$TESTS/.." -o "$RT/byteswap" \
+	"$RUNTIME/byteswap.c" "$RT/qmi_rt.c" "$TESTS/../qmi_tlv.c" ||
+     ! $CC -Wall -Wextra -Werror -I"$RT/kernel" -I"$TESTS" -o "$RT/kernel/kernel" \
+	"$RUNTIME/kernel.c" "$RT/kernel/qmi_rt.c" "$TESTS/../bench/elem_info.c" ||
+     ! $CXX -std=c++20 -Wall -Wextra -Werror -I"$RT/cxx" -o "$RT/cxx/cxx" "$RUNTIME/cxx.cpp"; then
+	fail "runtime: tests do not build"
+else
+	"$RT/qmic-gen" -s "$RT/qmi_rt.qsd" -n 10000 -o "$RT/capture.pcap" 2> /dev/null
+	if "$RT/json_roundtrip" < "$RT/capture.pcap"; then
+		passed=$((passed + 1))
+	else
+		fail "runtime: json_roundtrip"
+	fi
+
+	for test in runtime byteswap kernel/kernel cxx/cxx; do
+		if "$RT/$test"; then
+			passed=$((passed + 1))
+		else
+			fail "runtime: $(basename $test)"
+		fi
+	done
+
+	# Messages encoded by the kernel codec, decoded and rendered by the accessor one
+	if "$RT/kernel/kernel" "$RT/kernel.pcap" &&
+	   "$RT/json_roundtrip" -p < "$RT/kernel.pcap" > "$RT/kernel.json"; then
+		[ "$UPDATE" = "-u" ] && cp "$RT/kernel.json" "$EXPECTED/kernel.json"
+		if diff -u "$EXPECTED/kernel.json" "$RT/kernel.json"; then
+			passed=$((passed + 1))
+		else
+			fail "runtime: kernel to accessor"
+		fi
+	else
+		fail "runtime: kernel to accessor"
+	fi
+
+	"$RT/qmidecode" -v -s "$RT/qmi_rt.qsd" "$RUNTIME/capture.pcap" > "$RT/qmidecode.v.txt"
+	if [ "$UPDATE" = "-u" ]; then
+		cp "$RT/qmidecode.v.txt" "$EXPECTED/qmidecode.v.txt"
+		"$RT/qmidecode" -j 1 -s "$RT/qmi_rt.qsd" "$RUNTIME/capture.pcap" > "$EXPECTED/qmidecode.txt"
+	fi
+
+	ok=1
+	diff -u "$EXPECTED/qmidecode.v.txt" "$RT/qmidecode.v.txt" || ok=0
+	for threads in 1 2 3 8 64; do
+		"$RT/qmidecode" -j $threads -s "$RT/qmi_rt.qsd" "$RUNTIME/capture.pcap" > "$RT/qmidecode.txt"
+		diff -u "$EXPECTED/qmidecode.txt" "$RT/qmidecode.txt" || ok=0
+	done
+
+	"$RT/qmidecode" -j 1 "$RT/capture.pcap" > "$RT/serial.txt"
+	for threads in 4 7 32; do
+		"$RT/qmidecode" -j $threads "$RT/capture.pcap" | diff -u "$RT/serial.txt" - || ok=0
+	done
+
+	if [ $ok -eq 1 ]; then
+		passed=$((passed + 1))
+	else
+		fail "runtime: qmidecode"
+	fi
+fi
+
+echo "$passed passed, $failed failed"
+
+[ $failed -eq 0 ]
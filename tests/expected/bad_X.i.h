@@ -0,0 +1,480 @@
+#ifndef __QMI_TEST_H__
+#define __QMI_TEST_H__
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <errno.h>
+
+#include "qmi_tlv.h"
+
+struct qmi_tlv;
+
+struct qmi_tlv *qmi_tlv_init(unsigned txn, unsigned msg_id, unsigned type);
+struct qmi_tlv *qmi_tlv_decode(void *buf, size_t len, unsigned *txn, unsigned msg_id, unsigned type);
+void *qmi_tlv_encode(struct qmi_tlv *tlv, size_t *len);
+void qmi_tlv_free(struct qmi_tlv *tlv);
+int qmi_tlv_foreach(struct qmi_tlv *tlv, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int qmi_tlv_diff(struct qmi_tlv *a, struct qmi_tlv *b, uint64_t changed[4]);
+const uint64_t *qmi_tlv_present(struct qmi_tlv *tlv);
+
+ssize_t qmi_tlv_decode_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, unsigned msg_id, unsigned type, struct qmi_tlv ***tlvs);
+ssize_t qmi_tlv_encode_batch(struct qmi_tlv **tlvs, size_t count, void *buf, size_t size, size_t *lens);
+void qmi_tlv_free_batch(struct qmi_tlv **tlvs, size_t count);
+
+struct qmi_tlv_stream;
+
+struct qmi_tlv_stream *qmi_tlv_stream_init(unsigned msg_id, unsigned type, unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int qmi_tlv_stream_feed(struct qmi_tlv_stream *stream, const void *buf, size_t len);
+void qmi_tlv_stream_free(struct qmi_tlv_stream *stream);
+
+void *qmi_tlv_get(struct qmi_tlv *tlv, unsigned id, size_t *len);
+void *qmi_tlv_get_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, size_t *len, size_t *size);
+int qmi_tlv_set(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);
+int qmi_tlv_set_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);
+
+void qmi_tlv_set_txn(struct qmi_tlv *tlv, unsigned txn);
+int qmi_tlv_replace(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);
+int qmi_tlv_replace_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);
+
+struct qmi_json;
+
+int qmi_json_encode(void *buf, size_t len, unsigned msg_id, unsigned type, const char *name, int (*cb)(unsigned id, void *data, size_t len, void *ctx), char *out, size_t cap);
+void qmi_json_open(struct qmi_json *json, char c);
+void qmi_json_close(struct qmi_json *json, char c);
+void qmi_json_key(struct qmi_json *json, const char *key);
+void qmi_json_uint(struct qmi_json *json, uint64_t val);
+void qmi_json_string(struct qmi_json *json, const void *buf, size_t len);
+void qmi_json_unknown(struct qmi_json *json, unsigned id, const void *buf, size_t len);
+
+#ifndef __QMI_JSON_FIELD__
+#define __QMI_JSON_FIELD__
+enum qmi_json_type {
+	QMI_JSON_U8,
+	QMI_JSON_U16,
+	QMI_JSON_U32,
+	QMI_JSON_U64,
+	QMI_JSON_STRING,
+	QMI_JSON_STRUCT,
+};
+
+struct qmi_json_field {
+	const char *name;
+	unsigned id;
+	unsigned type;
+	unsigned array_size;
+	unsigned len_size;
+	bool array_fixed;
+	bool required;
+	const struct qmi_json_field *members;
+	unsigned n_members;
+};
+#endif
+
+int qmi_json_decode(const char *json, size_t len, unsigned txn, unsigned msg_id, unsigned type, const struct qmi_json_field *fields, unsigned count, void *out, size_t cap);
+
+struct qmi_client;
+
+#ifndef __QMI_CLIENT_COMPLETE__
+#define __QMI_CLIENT_COMPLETE__
+typedef void (*qmi_client_complete)(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx);
+#endif
+
+struct qmi_client *qmi_client_init(int (*send)(const void *buf, size_t len, void *ctx), void *ctx, unsigned depth);
+void qmi_client_free(struct qmi_client *client);
+int qmi_client_call(struct qmi_client *client, struct qmi_tlv *tlv, qmi_client_complete complete, void (*cb)(void), void *ctx);
+int qmi_client_receive(struct qmi_client *client, void *buf, size_t len, unsigned *msg_id);
+void qmi_client_cancel(struct qmi_client *client, int error);
+
+struct qmi_server;
+
+#ifndef __QMI_SERVER_HANDLE__
+#define __QMI_SERVER_HANDLE__
+typedef ssize_t (*qmi_server_handle)(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+typedef int (*qmi_server_send)(void **bufs, size_t *lens, size_t count, void *ctx);
+#endif
+
+struct qmi_server *qmi_server_init(unsigned n_workers, qmi_server_handle handle, const void *ops, void *ctx, qmi_server_send send, void *send_ctx);
+int qmi_server_submit(struct qmi_server *server, const void *buf, size_t len);
+void qmi_server_free(struct qmi_server *server);
+
+struct test_qmi_result {
+	uint16_t result;
+	uint16_t error;
+};
+
+#ifndef __QMI_LE_HELPERS__
+#define __QMI_LE_HELPERS__
+static inline uint8_t qmi_le8_to_cpu(const void *ptr)
+{
+	uint8_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+	return val;
+}
+
+static inline uint8_t qmi_cpu_to_le8(uint8_t val)
+{
+	return val;
+}
+
+static inline void qmi_put_le8(void *ptr, uint8_t val)
+{
+	val = qmi_cpu_to_le8(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+static inline uint16_t qmi_le16_to_cpu(const void *ptr)
+{
+	uint16_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap16(val);
+#endif
+	return val;
+}
+
+static inline uint16_t qmi_cpu_to_le16(uint16_t val)
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap16(val);
+#endif
+	return val;
+}
+
+static inline void qmi_put_le16(void *ptr, uint16_t val)
+{
+	val = qmi_cpu_to_le16(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+static inline uint32_t qmi_le32_to_cpu(const void *ptr)
+{
+	uint32_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap32(val);
+#endif
+	return val;
+}
+
+static inline uint32_t qmi_cpu_to_le32(uint32_t val)
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap32(val);
+#endif
+	return val;
+}
+
+static inline void qmi_put_le32(void *ptr, uint32_t val)
+{
+	val = qmi_cpu_to_le32(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+static inline uint64_t qmi_le64_to_cpu(const void *ptr)
+{
+	uint64_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap64(val);
+#endif
+	return val;
+}
+
+static inline uint64_t qmi_cpu_to_le64(uint64_t val)
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap64(val);
+#endif
+	return val;
+}
+
+static inline void qmi_put_le64(void *ptr, uint64_t val)
+{
+	val = qmi_cpu_to_le64(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+#endif
+
+static inline int test_qmi_result_pack(const struct test_qmi_result *val, uint8_t *buf)
+{
+	size_t offset = 0;
+
+	if (buf)
+		qmi_put_le16(buf + offset, val->result);
+	offset += 2;
+	if (buf)
+		qmi_put_le16(buf + offset, val->error);
+	offset += 2;
+
+	return offset;
+}
+
+static inline int test_qmi_result_unpack(struct test_qmi_result *val, const uint8_t *data, size_t len)
+{
+	size_t offset = 0;
+
+	if (len - offset < 2)
+		return -EINVAL;
+	val->result = qmi_le16_to_cpu(data + offset);
+	offset += 2;
+	if (len - offset < 2)
+		return -EINVAL;
+	val->error = qmi_le16_to_cpu(data + offset);
+	offset += 2;
+
+	return offset;
+}
+
+struct test_test_request;
+struct test_test_response;
+struct test_test_indication;
+
+/*
+ * test_test_request message
+ */
+struct test_test_request *test_test_request_alloc(unsigned txn);
+struct test_test_request *test_test_request_parse(void *buf, size_t len, unsigned *txn);
+void *test_test_request_encode(struct test_test_request *test_request, size_t *len);
+void test_test_request_free(struct test_test_request *test_request);
+ssize_t test_test_request_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_request ***test_request);
+ssize_t test_test_request_encode_batch(struct test_test_request **test_request, size_t count, void *buf, size_t size, size_t *lens);
+void test_test_request_free_batch(struct test_test_request **test_request, size_t count);
+struct qmi_tlv_stream *test_test_request_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int test_test_request_diff(struct test_test_request *a, struct test_test_request *b, uint64_t changed[4]);
+
+static inline int test_test_request_set_test_number(struct test_test_request *test_request, uint8_t val)
+{
+	val = qmi_cpu_to_le8(val);
+	return qmi_tlv_set((struct qmi_tlv*)test_request, 18, &val, sizeof(uint8_t));
+}
+
+static inline int test_test_request_get_test_number(struct test_test_request *test_request, uint8_t *val)
+{
+	uint8_t *ptr;
+	size_t len;
+
+	ptr = qmi_tlv_find_data((struct qmi_tlv*)test_request, 18, &len);
+	if (!ptr)
+		return -ENOENT;
+
+	if (len != sizeof(uint8_t))
+		return -EINVAL;
+
+	*val = qmi_le8_to_cpu(ptr);
+	return 0;
+}
+
+static inline int test_test_request_replace_test_number(struct test_test_request *test_request, uint8_t val)
+{
+	val = qmi_cpu_to_le8(val);
+	return qmi_tlv_replace((struct qmi_tlv*)test_request, 18, &val, sizeof(uint8_t));
+}
+
+struct test_test_request_visitor {
+	int (*test_number)(uint8_t val, void *ctx);
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int test_test_request_visit(struct test_test_request *test_request, const struct test_test_request_visitor *visitor, void *ctx);
+
+int test_test_request_to_json(void *buf, size_t len, char *out, size_t cap);
+int test_test_request_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool test_test_request_changed_test_number(const uint64_t changed[4])
+{
+	return changed[0] >> 18 & 1;
+}
+
+static inline bool test_test_request_has_test_number(struct test_test_request *test_request)
+{
+	return ((struct qmi_tlv*)test_request)->present[0] >> 18 & 1;
+}
+
+static inline bool test_test_request_missing_required(struct test_test_request *test_request)
+{
+	const uint64_t *present = ((struct qmi_tlv*)test_request)->present;
+
+	return (present[0] & 0x40000ULL) != 0x40000ULL;
+}
+
+/*
+ * test_test_response message
+ */
+struct test_test_response *test_test_response_alloc(unsigned txn);
+struct test_test_response *test_test_response_parse(void *buf, size_t len, unsigned *txn);
+void *test_test_response_encode(struct test_test_response *test_response, size_t *len);
+void test_test_response_free(struct test_test_response *test_response);
+ssize_t test_test_response_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_response ***test_response);
+ssize_t test_test_response_encode_batch(struct test_test_response **test_response, size_t count, void *buf, size_t size, size_t *lens);
+void test_test_response_free_batch(struct test_test_response **test_response, size_t count);
+struct qmi_tlv_stream *test_test_response_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int test_test_response_diff(struct test_test_response *a, struct test_test_response *b, uint64_t changed[4]);
+
+static inline int test_test_response_set_r(struct test_test_response *test_response, const struct test_qmi_result *val)
+{
+	uint8_t buf[4];
+	int len;
+
+	len = test_qmi_result_pack(val, buf);
+	if (len < 0)
+		return len;
+
+	return qmi_tlv_set((struct qmi_tlv*)test_response, 2, buf, len);
+}
+
+static inline int test_test_response_get_r(struct test_test_response *test_response, struct test_qmi_result *val)
+{
+	size_t len;
+	void *ptr;
+
+	ptr = qmi_tlv_find_data((struct qmi_tlv*)test_response, 2, &len);
+	if (!ptr)
+		return -ENOENT;
+
+	if (test_qmi_result_unpack(val, ptr, len) != (int)len)
+		return -EINVAL;
+
+	return 0;
+}
+
+static inline int test_test_response_replace_r(struct test_test_response *test_response, const struct test_qmi_result *val)
+{
+	uint8_t buf[4];
+	int len;
+
+	len = test_qmi_result_pack(val, buf);
+	if (len < 0)
+		return len;
+
+	return qmi_tlv_replace((struct qmi_tlv*)test_response, 2, buf, len);
+}
+
+struct test_test_response_visitor {
+	int (*r)(const void *data, size_t len, size_t count, void *ctx);
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int test_test_response_visit(struct test_test_response *test_response, const struct test_test_response_visitor *visitor, void *ctx);
+
+int test_test_response_to_json(void *buf, size_t len, char *out, size_t cap);
+int test_test_response_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool test_test_response_changed_r(const uint64_t changed[4])
+{
+	return changed[0] >> 2 & 1;
+}
+
+static inline bool test_test_response_has_r(struct test_test_response *test_response)
+{
+	return ((struct qmi_tlv*)test_response)->present[0] >> 2 & 1;
+}
+
+static inline bool test_test_response_missing_required(struct test_test_response *test_response)
+{
+	const uint64_t *present = ((struct qmi_tlv*)test_response)->present;
+
+	return (present[0] & 0x4ULL) != 0x4ULL;
+}
+
+/*
+ * test_test_indication message
+ */
+struct test_test_indication *test_test_indication_alloc(unsigned txn);
+struct test_test_indication *test_test_indication_parse(void *buf, size_t len, unsigned *txn);
+void *test_test_indication_encode(struct test_test_indication *test_indication, size_t *len);
+void test_test_indication_free(struct test_test_indication *test_indication);
+ssize_t test_test_indication_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_indication ***test_indication);
+ssize_t test_test_indication_encode_batch(struct test_test_indication **test_indication, size_t count, void *buf, size_t size, size_t *lens);
+void test_test_indication_free_batch(struct test_test_indication **test_indication, size_t count);
+struct qmi_tlv_stream *test_test_indication_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int test_test_indication_diff(struct test_test_indication *a, struct test_test_indication *b, uint64_t changed[4]);
+
+static inline int test_test_indication_set_value(struct test_test_indication *test_indication, uint64_t val)
+{
+	val = qmi_cpu_to_le64(val);
+	return qmi_tlv_set((struct qmi_tlv*)test_indication, 153, &val, sizeof(uint64_t));
+}
+
+static inline int test_test_indication_get_value(struct test_test_indication *test_indication, uint64_t *val)
+{
+	uint64_t *ptr;
+	size_t len;
+
+	ptr = qmi_tlv_find_data((struct qmi_tlv*)test_indication, 153, &len);
+	if (!ptr)
+		return -ENOENT;
+
+	if (len != sizeof(uint64_t))
+		return -EINVAL;
+
+	*val = qmi_le64_to_cpu(ptr);
+	return 0;
+}
+
+static inline int test_test_indication_replace_value(struct test_test_indication *test_indication, uint64_t val)
+{
+	val = qmi_cpu_to_le64(val);
+	return qmi_tlv_replace((struct qmi_tlv*)test_indication, 153, &val, sizeof(uint64_t));
+}
+
+struct test_test_indication_visitor {
+	int (*value)(uint64_t val, void *ctx);
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int test_test_indication_visit(struct test_test_indication *test_indication, const struct test_test_indication_visitor *visitor, void *ctx);
+
+int test_test_indication_to_json(void *buf, size_t len, char *out, size_t cap);
+int test_test_indication_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool test_test_indication_changed_value(const uint64_t changed[4])
+{
+	return changed[2] >> 25 & 1;
+}
+
+static inline bool test_test_indication_has_value(struct test_test_indication *test_indication)
+{
+	return ((struct qmi_tlv*)test_indication)->present[2] >> 25 & 1;
+}
+
+static inline bool test_test_indication_missing_required(struct test_test_indication *test_indication)
+{
+	(void)test_indication;
+
+	return false;
+}
+
+struct test_client_indications {
+	void (*test_indication)(struct test_test_indication *test_indication, void *ctx);
+};
+
+int test_test_request_call(struct qmi_client *client, struct test_test_request *test_request, void (*cb)(struct test_test_response *test_response, int error, void *ctx), void *ctx);
+int test_client_receive(struct qmi_client *client, void *buf, size_t len, const struct test_client_indications *ind, void *ctx);
+
+struct test_server_ops {
+	int (*test_request)(struct test_test_request *test_request, struct test_test_response *test_response, void *ctx);
+};
+
+ssize_t test_server_handle(const struct test_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+ssize_t test_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+
+struct test_msg_info {
+	unsigned msg_id;
+	unsigned type;
+	const char *name;
+	unsigned max_len;
+	void *(*parse)(void *buf, size_t len, unsigned *txn);
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __QMI_TEST_H__
+#define __QMI_TEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libqrtr.h"
+
+struct test_qmi_result {
+	uint16_t result;
+	uint16_t error;
+};
+
+struct test_test_request {
+	uint8_t test_number;
+};
+
+struct test_test_response {
+	struct test_qmi_result r;
+};
+
+struct test_test_indication {
+	bool value_valid;
+	uint64_t value;
+};
+
+extern struct qmi_elem_info test_test_request_ei[];
+extern struct qmi_elem_info test_test_response_ei[];
+extern struct qmi_elem_info test_test_indication_ei[];
+
+void test_qmi_result_copy(struct test_qmi_result *dst, const struct test_qmi_result *src);
+bool test_qmi_result_equal(const struct test_qmi_result *a, const struct test_qmi_result *b);
+void test_qmi_result_clear(struct test_qmi_result *val);
+void test_test_request_copy(struct test_test_request *dst, const struct test_test_request *src);
+bool test_test_request_equal(const struct test_test_request *a, const struct test_test_request *b);
+int test_test_request_diff(const struct test_test_request *a, const struct test_test_request *b, uint64_t changed[4]);
+void test_test_request_clear(struct test_test_request *msg);
+int test_test_request_validate(const void *buf, size_t len);
+void test_test_response_copy(struct test_test_response *dst, const struct test_test_response *src);
+bool test_test_response_equal(const struct test_test_response *a, const struct test_test_response *b);
+int test_test_response_diff(const struct test_test_response *a, const struct test_test_response *b, uint64_t changed[4]);
+void test_test_response_clear(struct test_test_response *msg);
+int test_test_response_validate(const void *buf, size_t len);
+void test_test_indication_copy(struct test_test_indication *dst, const struct test_test_indication *src);
+bool test_test_indication_equal(const struct test_test_indication *a, const struct test_test_indication *b);
+int test_test_indication_diff(const struct test_test_indication *a, const struct test_test_indication *b, uint64_t changed[4]);
+void test_test_indication_clear(struct test_test_indication *msg);
+int test_test_indication_validate(const void *buf, size_t len);
+
+static inline bool test_test_request_changed_test_number(const uint64_t changed[4])
+{
+	return changed[0] >> 18 & 1;
+}
+
+static inline bool test_test_response_changed_r(const uint64_t changed[4])
+{
+	return changed[0] >> 2 & 1;
+}
+
+static inline bool test_test_indication_changed_value(const uint64_t changed[4])
+{
+	return changed[2] >> 25 & 1;
+}
+
+struct test_msg_info {
+	unsigned msg_id;
+	unsigned type;
+	const char *name;
+	unsigned max_len;
+	struct qmi_elem_info *ei;
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type);
+
+#endif
@@ -0,0 +1,755 @@
+#include <errno.h>
+#include <string.h>
+#include "qmi_test.h"
+
+static inline uint8_t qmi_le8_to_cpu(const void *ptr)
+{
+	uint8_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+	return val;
+}
+
+static inline uint8_t qmi_cpu_to_le8(uint8_t val)
+{
+	return val;
+}
+
+static inline void qmi_put_le8(void *ptr, uint8_t val)
+{
+	val = qmi_cpu_to_le8(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+static inline uint16_t qmi_le16_to_cpu(const void *ptr)
+{
+	uint16_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap16(val);
+#endif
+	return val;
+}
+
+static inline uint16_t qmi_cpu_to_le16(uint16_t val)
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap16(val);
+#endif
+	return val;
+}
+
+static inline void qmi_put_le16(void *ptr, uint16_t val)
+{
+	val = qmi_cpu_to_le16(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+static inline uint32_t qmi_le32_to_cpu(const void *ptr)
+{
+	uint32_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap32(val);
+#endif
+	return val;
+}
+
+static inline uint32_t qmi_cpu_to_le32(uint32_t val)
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap32(val);
+#endif
+	return val;
+}
+
+static inline void qmi_put_le32(void *ptr, uint32_t val)
+{
+	val = qmi_cpu_to_le32(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+static inline uint64_t qmi_le64_to_cpu(const void *ptr)
+{
+	uint64_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap64(val);
+#endif
+	return val;
+}
+
+static inline uint64_t qmi_cpu_to_le64(uint64_t val)
+{
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	val = __builtin_bswap64(val);
+#endif
+	return val;
+}
+
+static inline void qmi_put_le64(void *ptr, uint64_t val)
+{
+	val = qmi_cpu_to_le64(val);
+	memcpy(ptr, &val, sizeof(val));
+}
+
+static int test_qmi_result_pack(const struct test_qmi_result *val, uint8_t *buf)
+{
+	size_t offset = 0;
+
+	if (buf)
+		qmi_put_le16(buf + offset, val->result);
+	offset += 2;
+	if (buf)
+		qmi_put_le16(buf + offset, val->error);
+	offset += 2;
+
+	return offset;
+}
+
+static int test_qmi_result_unpack(struct test_qmi_result *val, const uint8_t *data, size_t len)
+{
+	size_t offset = 0;
+
+	if (len - offset < 2)
+		return -EINVAL;
+	val->result = qmi_le16_to_cpu(data + offset);
+	offset += 2;
+	if (len - offset < 2)
+		return -EINVAL;
+	val->error = qmi_le16_to_cpu(data + offset);
+	offset += 2;
+
+	return offset;
+}
+
+static int test_qmi_result_json(struct qmi_json *json, const uint8_t *data, size_t len)
+{
+	size_t offset = 0;
+
+	qmi_json_open(json, '{');
+	if (len - offset < 2)
+		return -EINVAL;
+	qmi_json_key(json, "result");
+	qmi_json_uint(json, qmi_le16_to_cpu(data + offset));
+	offset += 2;
+	if (len - offset < 2)
+		return -EINVAL;
+	qmi_json_key(json, "error");
+	qmi_json_uint(json, qmi_le16_to_cpu(data + offset));
+	offset += 2;
+	qmi_json_close(json, '}');
+
+	return offset;
+}
+
+static const struct qmi_json_field test_qmi_result_json_fields[] = {
+	{ .name = "result", .type = QMI_JSON_U16 },
+	{ .name = "error", .type = QMI_JSON_U16 },
+};
+
+struct test_test_request *test_test_request_alloc(unsigned txn)
+{
+	return (struct test_test_request*)qmi_tlv_init(txn, 35, 0);
+}
+
+struct test_test_request *test_test_request_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct test_test_request*)qmi_tlv_decode(buf, len, txn, 35, 0);
+}
+
+void *test_test_request_encode(struct test_test_request *test_request, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)test_request, len);
+}
+
+void test_test_request_free(struct test_test_request *test_request)
+{
+	qmi_tlv_free((struct qmi_tlv*)test_request);
+}
+
+ssize_t test_test_request_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_request ***test_request)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 35, 0, (struct qmi_tlv***)test_request);
+}
+
+ssize_t test_test_request_encode_batch(struct test_test_request **test_request, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)test_request, count, buf, size, lens);
+}
+
+void test_test_request_free_batch(struct test_test_request **test_request, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)test_request, count);
+}
+
+struct qmi_tlv_stream *test_test_request_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(35, 0, txn, cb, ctx);
+}
+
+int test_test_request_diff(struct test_test_request *a, struct test_test_request *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *test_test_request_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return test_test_request_parse(buf, len, txn);
+}
+
+int test_test_request_set_test_number(struct test_test_request *test_request, uint8_t val)
+{
+	val = qmi_cpu_to_le8(val);
+	return qmi_tlv_set((struct qmi_tlv*)test_request, 18, &val, sizeof(uint8_t));
+}
+
+int test_test_request_get_test_number(struct test_test_request *test_request, uint8_t *val)
+{
+	uint8_t *ptr;
+	size_t len;
+
+	ptr = qmi_tlv_get((struct qmi_tlv*)test_request, 18, &len);
+	if (!ptr)
+		return -ENOENT;
+
+	if (len != sizeof(uint8_t))
+		return -EINVAL;
+
+	*val = qmi_le8_to_cpu(ptr);
+	return 0;
+}
+
+int test_test_request_replace_test_number(struct test_test_request *test_request, uint8_t val)
+{
+	val = qmi_cpu_to_le8(val);
+	return qmi_tlv_replace((struct qmi_tlv*)test_request, 18, &val, sizeof(uint8_t));
+}
+
+struct test_test_request_visit_ctx {
+	const struct test_test_request_visitor *visitor;
+	void *ctx;
+};
+
+static int test_test_request_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct test_test_request_visit_ctx *v = ctx;
+	const struct test_test_request_visitor *visitor = v->visitor;
+
+	switch (id) {
+	case 18:
+		if (!visitor->test_number)
+			return 0;
+		if (len != sizeof(uint8_t))
+			return -EINVAL;
+		return visitor->test_number(qmi_le8_to_cpu(data), v->ctx);
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int test_test_request_visit(struct test_test_request *test_request, const struct test_test_request_visitor *visitor, void *ctx)
+{
+	struct test_test_request_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)test_request, test_test_request_visit_tlv, &v);
+}
+
+static int test_test_request_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+
+	switch (id) {
+	case 18:
+		if (len != sizeof(uint8_t))
+			return -EINVAL;
+		qmi_json_key(json, "test_number");
+		qmi_json_uint(json, qmi_le8_to_cpu(data));
+		return 0;
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int test_test_request_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 35, 0, "test_request", test_test_request_json_tlv, out, cap);
+}
+
+static const struct qmi_json_field test_test_request_json_fields[] = {
+	{
+		.name = "test_number",
+		.id = 18,
+		.type = QMI_JSON_U8,
+		.required = true,
+	},
+};
+
+int test_test_request_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 35, 0, test_test_request_json_fields,
+			       sizeof(test_test_request_json_fields) / sizeof(test_test_request_json_fields[0]), out, cap);
+}
+
+struct test_test_response *test_test_response_alloc(unsigned txn)
+{
+	return (struct test_test_response*)qmi_tlv_init(txn, 35, 2);
+}
+
+struct test_test_response *test_test_response_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct test_test_response*)qmi_tlv_decode(buf, len, txn, 35, 2);
+}
+
+void *test_test_response_encode(struct test_test_response *test_response, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)test_response, len);
+}
+
+void test_test_response_free(struct test_test_response *test_response)
+{
+	qmi_tlv_free((struct qmi_tlv*)test_response);
+}
+
+ssize_t test_test_response_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_response ***test_response)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 35, 2, (struct qmi_tlv***)test_response);
+}
+
+ssize_t test_test_response_encode_batch(struct test_test_response **test_response, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)test_response, count, buf, size, lens);
+}
+
+void test_test_response_free_batch(struct test_test_response **test_response, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)test_response, count);
+}
+
+struct qmi_tlv_stream *test_test_response_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(35, 2, txn, cb, ctx);
+}
+
+int test_test_response_diff(struct test_test_response *a, struct test_test_response *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *test_test_response_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return test_test_response_parse(buf, len, txn);
+}
+
+int test_test_response_set_r(struct test_test_response *test_response, const struct test_qmi_result *val)
+{
+	uint8_t buf[4];
+	int len;
+
+	len = test_qmi_result_pack(val, buf);
+	if (len < 0)
+		return len;
+
+	return qmi_tlv_set((struct qmi_tlv*)test_response, 2, buf, len);
+}
+
+int test_test_response_get_r(struct test_test_response *test_response, struct test_qmi_result *val)
+{
+	size_t len;
+	void *ptr;
+
+	ptr = qmi_tlv_get((struct qmi_tlv*)test_response, 2, &len);
+	if (!ptr)
+		return -ENOENT;
+
+	if (test_qmi_result_unpack(val, ptr, len) != (int)len)
+		return -EINVAL;
+
+	return 0;
+}
+
+int test_test_response_replace_r(struct test_test_response *test_response, const struct test_qmi_result *val)
+{
+	uint8_t buf[4];
+	int len;
+
+	len = test_qmi_result_pack(val, buf);
+	if (len < 0)
+		return len;
+
+	return qmi_tlv_replace((struct qmi_tlv*)test_response, 2, buf, len);
+}
+
+struct test_test_response_visit_ctx {
+	const struct test_test_response_visitor *visitor;
+	void *ctx;
+};
+
+static int test_test_response_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct test_test_response_visit_ctx *v = ctx;
+	const struct test_test_response_visitor *visitor = v->visitor;
+
+	switch (id) {
+	case 2:
+		if (!visitor->r)
+			return 0;
+		return visitor->r(data, len, 1, v->ctx);
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int test_test_response_visit(struct test_test_response *test_response, const struct test_test_response_visitor *visitor, void *ctx)
+{
+	struct test_test_response_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)test_response, test_test_response_visit_tlv, &v);
+}
+
+static int test_test_response_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+	int ret;
+
+	switch (id) {
+	case 2:
+		qmi_json_key(json, "r");
+		ret = test_qmi_result_json(json, data, len);
+		if (ret < 0 || (size_t)ret != len)
+			return -EINVAL;
+		return 0;
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int test_test_response_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 35, 2, "test_response", test_test_response_json_tlv, out, cap);
+}
+
+static const struct qmi_json_field test_test_response_json_fields[] = {
+	{
+		.name = "r",
+		.id = 2,
+		.type = QMI_JSON_STRUCT,
+		.required = true,
+		.members = test_qmi_result_json_fields,
+		.n_members = 2,
+	},
+};
+
+int test_test_response_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 35, 2, test_test_response_json_fields,
+			       sizeof(test_test_response_json_fields) / sizeof(test_test_response_json_fields[0]), out, cap);
+}
+
+struct test_test_indication *test_test_indication_alloc(unsigned txn)
+{
+	return (struct test_test_indication*)qmi_tlv_init(txn, 7, 4);
+}
+
+struct test_test_indication *test_test_indication_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct test_test_indication*)qmi_tlv_decode(buf, len, txn, 7, 4);
+}
+
+void *test_test_indication_encode(struct test_test_indication *test_indication, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)test_indication, len);
+}
+
+void test_test_indication_free(struct test_test_indication *test_indication)
+{
+	qmi_tlv_free((struct qmi_tlv*)test_indication);
+}
+
+ssize_t test_test_indication_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_indication ***test_indication)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 7, 4, (struct qmi_tlv***)test_indication);
+}
+
+ssize_t test_test_indication_encode_batch(struct test_test_indication **test_indication, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)test_indication, count, buf, size, lens);
+}
+
+void test_test_indication_free_batch(struct test_test_indication **test_indication, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)test_indication, count);
+}
+
+struct qmi_tlv_stream *test_test_indication_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(7, 4, txn, cb, ctx);
+}
+
+int test_test_indication_diff(struct test_test_indication *a, struct test_test_indication *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *test_test_indication_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return test_test_indication_parse(buf, len, txn);
+}
+
+int test_test_indication_set_value(struct test_test_indication *test_indication, uint64_t val)
+{
+	val = qmi_cpu_to_le64(val);
+	return qmi_tlv_set((struct qmi_tlv*)test_indication, 153, &val, sizeof(uint64_t));
+}
+
+int test_test_indication_get_value(struct test_test_indication *test_indication, uint64_t *val)
+{
+	uint64_t *ptr;
+	size_t len;
+
+	ptr = qmi_tlv_get((struct qmi_tlv*)test_indication, 153, &len);
+	if (!ptr)
+		return -ENOENT;
+
+	if (len != sizeof(uint64_t))
+		return -EINVAL;
+
+	*val = qmi_le64_to_cpu(ptr);
+	return 0;
+}
+
+int test_test_indication_replace_value(struct test_test_indication *test_indication, uint64_t val)
+{
+	val = qmi_cpu_to_le64(val);
+	return qmi_tlv_replace((struct qmi_tlv*)test_indication, 153, &val, sizeof(uint64_t));
+}
+
+struct test_test_indication_visit_ctx {
+	const struct test_test_indication_visitor *visitor;
+	void *ctx;
+};
+
+static int test_test_indication_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct test_test_indication_visit_ctx *v = ctx;
+	const struct test_test_indication_visitor *visitor = v->visitor;
+
+	switch (id) {
+	case 153:
+		if (!visitor->value)
+			return 0;
+		if (len != sizeof(uint64_t))
+			return -EINVAL;
+		return visitor->value(qmi_le64_to_cpu(data), v->ctx);
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int test_test_indication_visit(struct test_test_indication *test_indication, const struct test_test_indication_visitor *visitor, void *ctx)
+{
+	struct test_test_indication_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)test_indication, test_test_indication_visit_tlv, &v);
+}
+
+static int test_test_indication_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+
+	switch (id) {
+	case 153:
+		if (len != sizeof(uint64_t))
+			return -EINVAL;
+		qmi_json_key(json, "value");
+		qmi_json_uint(json, qmi_le64_to_cpu(data));
+		return 0;
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int test_test_indication_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 7, 4, "test_indication", test_test_indication_json_tlv, out, cap);
+}
+
+static const struct qmi_json_field test_test_indication_json_fields[] = {
+	{
+		.name = "value",
+		.id = 153,
+		.type = QMI_JSON_U64,
+	},
+};
+
+int test_test_indication_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 7, 4, test_test_indication_json_fields,
+			       sizeof(test_test_indication_json_fields) / sizeof(test_test_indication_json_fields[0]), out, cap);
+}
+
+static void test_test_request_complete(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx)
+{
+	if (tlv && test_test_response_missing_required((struct test_test_response *)tlv)) {
+		tlv = NULL;
+		error = -EPROTO;
+	}
+
+	((void (*)(struct test_test_response *, int, void *))cb)((struct test_test_response *)tlv, error, ctx);
+}
+
+int test_test_request_call(struct qmi_client *client, struct test_test_request *test_request, void (*cb)(struct test_test_response *test_response, int error, void *ctx), void *ctx)
+{
+	return qmi_client_call(client, (struct qmi_tlv *)test_request, test_test_request_complete, (void (*)(void))cb, ctx);
+}
+
+int test_client_receive(struct qmi_client *client, void *buf, size_t len, const struct test_client_indications *ind, void *ctx)
+{
+	struct qmi_tlv *tlv;
+	unsigned msg_id;
+	int ret;
+
+	ret = qmi_client_receive(client, buf, len, &msg_id);
+	if (ret <= 0)
+		return ret;
+
+	switch (msg_id) {
+	case 7:
+		if (!ind || !ind->test_indication)
+			return 0;
+
+		tlv = qmi_tlv_decode(buf, len, NULL, 7, 4);
+		if (!tlv)
+			return -EINVAL;
+
+		ind->test_indication((struct test_test_indication *)tlv, ctx);
+		qmi_tlv_free(tlv);
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+static int test_server_missing_arg(struct qmi_tlv *resp)
+{
+	uint8_t result[] = { 1, 0, 0x11, 0 };
+
+	return qmi_tlv_set(resp, 2, result, sizeof(result));
+}
+
+static ssize_t test_test_request_serve(const struct test_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	struct qmi_tlv *resp;
+	struct qmi_tlv *req;
+	unsigned txn;
+	size_t resp_len;
+	ssize_t ret;
+
+	req = qmi_tlv_decode(buf, len, &txn, 35, 0);
+	if (!req)
+		return -EINVAL;
+
+	resp = qmi_tlv_init(txn, 35, 2);
+	if (!resp) {
+		qmi_tlv_free(req);
+		return -ENOMEM;
+	}
+
+	if (test_test_request_missing_required((struct test_test_request *)req))
+		ret = test_server_missing_arg(resp);
+	else
+		ret = ops->test_request((struct test_test_request *)req, (struct test_test_response *)resp, ctx);
+	if (!ret)
+		ret = qmi_tlv_encode_batch(&resp, 1, out, cap, &resp_len);
+	else if (ret > 0)
+		ret = 0;
+
+	qmi_tlv_free(resp);
+	qmi_tlv_free(req);
+
+	return ret;
+}
+
+ssize_t test_server_handle(const struct test_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	const uint8_t *pkt = buf;
+
+	if (len < 7 || pkt[0] != 0)
+		return -EINVAL;
+
+	switch (pkt[3] | pkt[4] << 8) {
+	case 35:
+		if (!ops->test_request)
+			return -EOPNOTSUPP;
+
+		return test_test_request_serve(ops, buf, len, out, cap, ctx);
+	}
+
+	return -ENOENT;
+}
+
+ssize_t test_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	return test_server_handle(ops, buf, len, out, cap, ctx);
+}
+
+static const struct test_msg_info test_msgs[] = {
+	{
+		.msg_id = 35,
+		.type = 0,
+		.name = "test_request",
+		.max_len = 4,
+		.parse = test_test_request_parse_msg,
+	},
+	{
+		.msg_id = 35,
+		.type = 2,
+		.name = "test_response",
+		.max_len = 7,
+		.parse = test_test_response_parse_msg,
+	},
+	{
+		.msg_id = 7,
+		.type = 4,
+		.name = "test_indication",
+		.max_len = 11,
+		.parse = test_test_indication_parse_msg,
+	},
+};
+
+static const uint16_t test_msg_slots[8] = {
+	[1] = 2,
+	[4] = 1,
+	[5] = 3,
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type)
+{
+	const struct test_msg_info *info;
+	uint32_t key = msg_id << 2 | type >> 1;
+	unsigned slot;
+
+	slot = (uint32_t)(key * 2654435761u) >> 29;
+	while (test_msg_slots[slot]) {
+		info = &test_msgs[test_msg_slots[slot] - 1];
+		if (info->msg_id == msg_id && info->type == type)
+			return info;
+
+		slot = (slot + 1) & 7;
+	}
+
+	return NULL;
+}
+
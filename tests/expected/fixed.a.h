@@ -0,0 +1,261 @@
+#ifndef __QMI_TEST_H__
+#define __QMI_TEST_H__
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct qmi_tlv;
+
+struct qmi_tlv *qmi_tlv_init(unsigned txn, unsigned msg_id, unsigned type);
+struct qmi_tlv *qmi_tlv_decode(void *buf, size_t len, unsigned *txn, unsigned msg_id, unsigned type);
+void *qmi_tlv_encode(struct qmi_tlv *tlv, size_t *len);
+void qmi_tlv_free(struct qmi_tlv *tlv);
+int qmi_tlv_foreach(struct qmi_tlv *tlv, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int qmi_tlv_diff(struct qmi_tlv *a, struct qmi_tlv *b, uint64_t changed[4]);
+const uint64_t *qmi_tlv_present(struct qmi_tlv *tlv);
+
+ssize_t qmi_tlv_decode_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, unsigned msg_id, unsigned type, struct qmi_tlv ***tlvs);
+ssize_t qmi_tlv_encode_batch(struct qmi_tlv **tlvs, size_t count, void *buf, size_t size, size_t *lens);
+void qmi_tlv_free_batch(struct qmi_tlv **tlvs, size_t count);
+
+struct qmi_tlv_stream;
+
+struct qmi_tlv_stream *qmi_tlv_stream_init(unsigned msg_id, unsigned type, unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int qmi_tlv_stream_feed(struct qmi_tlv_stream *stream, const void *buf, size_t len);
+void qmi_tlv_stream_free(struct qmi_tlv_stream *stream);
+
+void *qmi_tlv_get(struct qmi_tlv *tlv, unsigned id, size_t *len);
+void *qmi_tlv_get_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, size_t *len, size_t *size);
+int qmi_tlv_set(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);
+int qmi_tlv_set_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);
+
+void qmi_tlv_set_txn(struct qmi_tlv *tlv, unsigned txn);
+int qmi_tlv_replace(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);
+int qmi_tlv_replace_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);
+
+struct qmi_json;
+
+int qmi_json_encode(void *buf, size_t len, unsigned msg_id, unsigned type, const char *name, int (*cb)(unsigned id, void *data, size_t len, void *ctx), char *out, size_t cap);
+void qmi_json_open(struct qmi_json *json, char c);
+void qmi_json_close(struct qmi_json *json, char c);
+void qmi_json_key(struct qmi_json *json, const char *key);
+void qmi_json_uint(struct qmi_json *json, uint64_t val);
+void qmi_json_string(struct qmi_json *json, const void *buf, size_t len);
+void qmi_json_unknown(struct qmi_json *json, unsigned id, const void *buf, size_t len);
+
+#ifndef __QMI_JSON_FIELD__
+#define __QMI_JSON_FIELD__
+enum qmi_json_type {
+	QMI_JSON_U8,
+	QMI_JSON_U16,
+	QMI_JSON_U32,
+	QMI_JSON_U64,
+	QMI_JSON_STRING,
+	QMI_JSON_STRUCT,
+};
+
+struct qmi_json_field {
+	const char *name;
+	unsigned id;
+	unsigned type;
+	unsigned array_size;
+	unsigned len_size;
+	bool array_fixed;
+	bool required;
+	const struct qmi_json_field *members;
+	unsigned n_members;
+};
+#endif
+
+int qmi_json_decode(const char *json, size_t len, unsigned txn, unsigned msg_id, unsigned type, const struct qmi_json_field *fields, unsigned count, void *out, size_t cap);
+
+struct qmi_client;
+
+#ifndef __QMI_CLIENT_COMPLETE__
+#define __QMI_CLIENT_COMPLETE__
+typedef void (*qmi_client_complete)(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx);
+#endif
+
+struct qmi_client *qmi_client_init(int (*send)(const void *buf, size_t len, void *ctx), void *ctx, unsigned depth);
+void qmi_client_free(struct qmi_client *client);
+int qmi_client_call(struct qmi_client *client, struct qmi_tlv *tlv, qmi_client_complete complete, void (*cb)(void), void *ctx);
+int qmi_client_receive(struct qmi_client *client, void *buf, size_t len, unsigned *msg_id);
+void qmi_client_cancel(struct qmi_client *client, int error);
+
+struct qmi_server;
+
+#ifndef __QMI_SERVER_HANDLE__
+#define __QMI_SERVER_HANDLE__
+typedef ssize_t (*qmi_server_handle)(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+typedef int (*qmi_server_send)(void **bufs, size_t *lens, size_t count, void *ctx);
+#endif
+
+struct qmi_server *qmi_server_init(unsigned n_workers, qmi_server_handle handle, const void *ops, void *ctx, qmi_server_send send, void *send_ctx);
+int qmi_server_submit(struct qmi_server *server, const void *buf, size_t len);
+void qmi_server_free(struct qmi_server *server);
+
+struct test_qmi_result {
+	uint16_t result;
+	uint16_t error;
+};
+
+struct test_test_request;
+struct test_test_response;
+
+/*
+ * The _get_ accessors of numeric arrays return pointers into the message,
+ * in wire order: little endian and not necessarily aligned. As such they
+ * are only usable on little endian hosts, the _copy accessors convert to
+ * host order on any host.
+ */
+
+/*
+ * test_test_request message
+ */
+struct test_test_request *test_test_request_alloc(unsigned txn);
+struct test_test_request *test_test_request_parse(void *buf, size_t len, unsigned *txn);
+void *test_test_request_encode(struct test_test_request *test_request, size_t *len);
+void test_test_request_free(struct test_test_request *test_request);
+ssize_t test_test_request_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_request ***test_request);
+ssize_t test_test_request_encode_batch(struct test_test_request **test_request, size_t count, void *buf, size_t size, size_t *lens);
+void test_test_request_free_batch(struct test_test_request **test_request, size_t count);
+struct qmi_tlv_stream *test_test_request_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int test_test_request_diff(struct test_test_request *a, struct test_test_request *b, uint64_t changed[4]);
+
+int test_test_request_set_variable(struct test_test_request *test_request, uint8_t *val, size_t count);
+uint8_t *test_test_request_get_variable(struct test_test_request *test_request, size_t *count);
+int test_test_request_set_variable_copy(struct test_test_request *test_request, const uint8_t *val, size_t count);
+int test_test_request_get_variable_copy(struct test_test_request *test_request, uint8_t *val, size_t count);
+int test_test_request_replace_variable(struct test_test_request *test_request, uint8_t *val, size_t count);
+
+int test_test_request_set_fixed(struct test_test_request *test_request, uint16_t *val, size_t count);
+uint16_t *test_test_request_get_fixed(struct test_test_request *test_request, size_t *count);
+int test_test_request_set_fixed_copy(struct test_test_request *test_request, const uint16_t *val, size_t count);
+int test_test_request_get_fixed_copy(struct test_test_request *test_request, uint16_t *val, size_t count);
+int test_test_request_replace_fixed(struct test_test_request *test_request, uint16_t *val, size_t count);
+
+int test_test_request_set_not_fixed(struct test_test_request *test_request, uint32_t *val, size_t count);
+uint32_t *test_test_request_get_not_fixed(struct test_test_request *test_request, size_t *count);
+int test_test_request_set_not_fixed_copy(struct test_test_request *test_request, const uint32_t *val, size_t count);
+int test_test_request_get_not_fixed_copy(struct test_test_request *test_request, uint32_t *val, size_t count);
+int test_test_request_replace_not_fixed(struct test_test_request *test_request, uint32_t *val, size_t count);
+
+struct test_test_request_visitor {
+	int (*variable)(const uint8_t *val, size_t count, void *ctx);
+	int (*fixed)(const uint16_t *val, size_t count, void *ctx);
+	int (*not_fixed)(const uint32_t *val, size_t count, void *ctx);
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int test_test_request_visit(struct test_test_request *test_request, const struct test_test_request_visitor *visitor, void *ctx);
+
+int test_test_request_to_json(void *buf, size_t len, char *out, size_t cap);
+int test_test_request_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool test_test_request_changed_variable(const uint64_t changed[4])
+{
+	return changed[0] >> 1 & 1;
+}
+
+static inline bool test_test_request_changed_fixed(const uint64_t changed[4])
+{
+	return changed[0] >> 2 & 1;
+}
+
+static inline bool test_test_request_changed_not_fixed(const uint64_t changed[4])
+{
+	return changed[0] >> 3 & 1;
+}
+
+static inline bool test_test_request_has_variable(struct test_test_request *test_request)
+{
+	return qmi_tlv_present((struct qmi_tlv*)test_request)[0] >> 1 & 1;
+}
+
+static inline bool test_test_request_has_fixed(struct test_test_request *test_request)
+{
+	return qmi_tlv_present((struct qmi_tlv*)test_request)[0] >> 2 & 1;
+}
+
+static inline bool test_test_request_has_not_fixed(struct test_test_request *test_request)
+{
+	return qmi_tlv_present((struct qmi_tlv*)test_request)[0] >> 3 & 1;
+}
+
+static inline bool test_test_request_missing_required(struct test_test_request *test_request)
+{
+	(void)test_request;
+
+	return false;
+}
+
+/*
+ * test_test_response message
+ */
+struct test_test_response *test_test_response_alloc(unsigned txn);
+struct test_test_response *test_test_response_parse(void *buf, size_t len, unsigned *txn);
+void *test_test_response_encode(struct test_test_response *test_response, size_t *len);
+void test_test_response_free(struct test_test_response *test_response);
+ssize_t test_test_response_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_response ***test_response);
+ssize_t test_test_response_encode_batch(struct test_test_response **test_response, size_t count, void *buf, size_t size, size_t *lens);
+void test_test_response_free_batch(struct test_test_response **test_response, size_t count);
+struct qmi_tlv_stream *test_test_response_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int test_test_response_diff(struct test_test_response *a, struct test_test_response *b, uint64_t changed[4]);
+
+int test_test_response_set_r(struct test_test_response *test_response, const struct test_qmi_result *val);
+int test_test_response_get_r(struct test_test_response *test_response, struct test_qmi_result *val);
+int test_test_response_replace_r(struct test_test_response *test_response, const struct test_qmi_result *val);
+
+struct test_test_response_visitor {
+	int (*r)(const void *data, size_t len, size_t count, void *ctx);
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int test_test_response_visit(struct test_test_response *test_response, const struct test_test_response_visitor *visitor, void *ctx);
+
+int test_test_response_to_json(void *buf, size_t len, char *out, size_t cap);
+int test_test_response_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool test_test_response_changed_r(const uint64_t changed[4])
+{
+	return changed[0] >> 2 & 1;
+}
+
+static inline bool test_test_response_has_r(struct test_test_response *test_response)
+{
+	return qmi_tlv_present((struct qmi_tlv*)test_response)[0] >> 2 & 1;
+}
+
+static inline bool test_test_response_missing_required(struct test_test_response *test_response)
+{
+	const uint64_t *present = qmi_tlv_present((struct qmi_tlv*)test_response);
+
+	return (present[0] & 0x4ULL) != 0x4ULL;
+}
+
+struct test_client_indications;
+
+int test_test_request_call(struct qmi_client *client, struct test_test_request *test_request, void (*cb)(struct test_test_response *test_response, int error, void *ctx), void *ctx);
+int test_client_receive(struct qmi_client *client, void *buf, size_t len, const struct test_client_indications *ind, void *ctx);
+
+struct test_server_ops {
+	int (*test_request)(struct test_test_request *test_request, struct test_test_response *test_response, void *ctx);
+};
+
+ssize_t test_server_handle(const struct test_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+ssize_t test_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+
+struct test_msg_info {
+	unsigned msg_id;
+	unsigned type;
+	const char *name;
+	unsigned max_len;
+	void *(*parse)(void *buf, size_t len, unsigned *txn);
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type);
+
+#endif
@@ -0,0 +1,476 @@
+#include <errno.h>
+#include <string.h>
+#include "qmi_test.h"
+
+static int test_qmi_result_json(struct qmi_json *json, const uint8_t *data, size_t len)
+{
+	size_t offset = 0;
+
+	qmi_json_open(json, '{');
+	if (len - offset < 2)
+		return -EINVAL;
+	qmi_json_key(json, "result");
+	qmi_json_uint(json, qmi_le16_to_cpu(data + offset));
+	offset += 2;
+	if (len - offset < 2)
+		return -EINVAL;
+	qmi_json_key(json, "error");
+	qmi_json_uint(json, qmi_le16_to_cpu(data + offset));
+	offset += 2;
+	qmi_json_close(json, '}');
+
+	return offset;
+}
+
+static const struct qmi_json_field test_qmi_result_json_fields[] = {
+	{ .name = "result", .type = QMI_JSON_U16 },
+	{ .name = "error", .type = QMI_JSON_U16 },
+};
+
+struct test_test_request *test_test_request_alloc(unsigned txn)
+{
+	return (struct test_test_request*)qmi_tlv_init(txn, 35, 0);
+}
+
+struct test_test_request *test_test_request_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct test_test_request*)qmi_tlv_decode(buf, len, txn, 35, 0);
+}
+
+void *test_test_request_encode(struct test_test_request *test_request, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)test_request, len);
+}
+
+void test_test_request_free(struct test_test_request *test_request)
+{
+	qmi_tlv_free((struct qmi_tlv*)test_request);
+}
+
+ssize_t test_test_request_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_request ***test_request)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 35, 0, (struct qmi_tlv***)test_request);
+}
+
+ssize_t test_test_request_encode_batch(struct test_test_request **test_request, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)test_request, count, buf, size, lens);
+}
+
+void test_test_request_free_batch(struct test_test_request **test_request, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)test_request, count);
+}
+
+struct qmi_tlv_stream *test_test_request_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(35, 0, txn, cb, ctx);
+}
+
+int test_test_request_diff(struct test_test_request *a, struct test_test_request *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *test_test_request_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return test_test_request_parse(buf, len, txn);
+}
+
+struct test_test_request_visit_ctx {
+	const struct test_test_request_visitor *visitor;
+	void *ctx;
+};
+
+static int test_test_request_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct test_test_request_visit_ctx *v = ctx;
+	const struct test_test_request_visitor *visitor = v->visitor;
+	size_t count;
+
+	switch (id) {
+	case 1:
+		if (!visitor->variable)
+			return 0;
+		if (len < 1)
+			return -EINVAL;
+		count = qmi_le8_to_cpu(data);
+		if (count > 5)
+			return -EINVAL;
+		if (len - 1 != count * sizeof(uint8_t))
+			return -EINVAL;
+		return visitor->variable((uint8_t*)data + 1, count, v->ctx);
+	case 2: {
+		uint16_t val[5];
+
+		if (!visitor->fixed)
+			return 0;
+		count = 5;
+		if (len != count * sizeof(uint16_t))
+			return -EINVAL;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		memcpy(val, data, count * sizeof(uint16_t));
+#else
+		qmi_swap_array(val, data, count, sizeof(uint16_t));
+#endif
+		return visitor->fixed(val, count, v->ctx);
+	}
+	case 3: {
+		uint32_t val[5];
+
+		if (!visitor->not_fixed)
+			return 0;
+		if (len < 1)
+			return -EINVAL;
+		count = qmi_le8_to_cpu(data);
+		if (count > 5)
+			return -EINVAL;
+		if (len - 1 != count * sizeof(uint32_t))
+			return -EINVAL;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		memcpy(val, (uint8_t*)data + 1, count * sizeof(uint32_t));
+#else
+		qmi_swap_array(val, (uint8_t*)data + 1, count, sizeof(uint32_t));
+#endif
+		return visitor->not_fixed(val, count, v->ctx);
+	}
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int test_test_request_visit(struct test_test_request *test_request, const struct test_test_request_visitor *visitor, void *ctx)
+{
+	struct test_test_request_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)test_request, test_test_request_visit_tlv, &v);
+}
+
+static int test_test_request_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+	size_t count;
+	size_t i;
+
+	switch (id) {
+	case 1:
+		if (len < 1)
+			return -EINVAL;
+		count = qmi_le8_to_cpu(data);
+		if (count > 5)
+			return -EINVAL;
+		if (len - 1 != count * sizeof(uint8_t))
+			return -EINVAL;
+		qmi_json_key(json, "variable");
+		qmi_json_open(json, '[');
+		for (i = 0; i < count; i++)
+			qmi_json_uint(json, qmi_le8_to_cpu((uint8_t*)data + 1 + i * sizeof(uint8_t)));
+		qmi_json_close(json, ']');
+		return 0;
+	case 2:
+		count = 5;
+		if (len != count * sizeof(uint16_t))
+			return -EINVAL;
+		qmi_json_key(json, "fixed");
+		qmi_json_open(json, '[');
+		for (i = 0; i < count; i++)
+			qmi_json_uint(json, qmi_le16_to_cpu((uint8_t*)data + i * sizeof(uint16_t)));
+		qmi_json_close(json, ']');
+		return 0;
+	case 3:
+		if (len < 1)
+			return -EINVAL;
+		count = qmi_le8_to_cpu(data);
+		if (count > 5)
+			return -EINVAL;
+		if (len - 1 != count * sizeof(uint32_t))
+			return -EINVAL;
+		qmi_json_key(json, "not_fixed");
+		qmi_json_open(json, '[');
+		for (i = 0; i < count; i++)
+			qmi_json_uint(json, qmi_le32_to_cpu((uint8_t*)data + 1 + i * sizeof(uint32_t)));
+		qmi_json_close(json, ']');
+		return 0;
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int test_test_request_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 35, 0, "test_request", test_test_request_json_tlv, out, cap);
+}
+
+static const struct qmi_json_field test_test_request_json_fields[] = {
+	{
+		.name = "variable",
+		.id = 1,
+		.type = QMI_JSON_U8,
+		.array_size = 5,
+		.len_size = 1,
+	},
+	{
+		.name = "fixed",
+		.id = 2,
+		.type = QMI_JSON_U16,
+		.array_size = 5,
+		.array_fixed = true,
+	},
+	{
+		.name = "not_fixed",
+		.id = 3,
+		.type = QMI_JSON_U32,
+		.array_size = 5,
+		.len_size = 1,
+	},
+};
+
+int test_test_request_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 35, 0, test_test_request_json_fields,
+			       sizeof(test_test_request_json_fields) / sizeof(test_test_request_json_fields[0]), out, cap);
+}
+
+struct test_test_response *test_test_response_alloc(unsigned txn)
+{
+	return (struct test_test_response*)qmi_tlv_init(txn, 35, 2);
+}
+
+struct test_test_response *test_test_response_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct test_test_response*)qmi_tlv_decode(buf, len, txn, 35, 2);
+}
+
+void *test_test_response_encode(struct test_test_response *test_response, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)test_response, len);
+}
+
+void test_test_response_free(struct test_test_response *test_response)
+{
+	qmi_tlv_free((struct qmi_tlv*)test_response);
+}
+
+ssize_t test_test_response_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct test_test_response ***test_response)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 35, 2, (struct qmi_tlv***)test_response);
+}
+
+ssize_t test_test_response_encode_batch(struct test_test_response **test_response, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)test_response, count, buf, size, lens);
+}
+
+void test_test_response_free_batch(struct test_test_response **test_response, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)test_response, count);
+}
+
+struct qmi_tlv_stream *test_test_response_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(35, 2, txn, cb, ctx);
+}
+
+int test_test_response_diff(struct test_test_response *a, struct test_test_response *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *test_test_response_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return test_test_response_parse(buf, len, txn);
+}
+
+struct test_test_response_visit_ctx {
+	const struct test_test_response_visitor *visitor;
+	void *ctx;
+};
+
+static int test_test_response_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct test_test_response_visit_ctx *v = ctx;
+	const struct test_test_response_visitor *visitor = v->visitor;
+
+	switch (id) {
+	case 2:
+		if (!visitor->r)
+			return 0;
+		return visitor->r(data, len, 1, v->ctx);
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int test_test_response_visit(struct test_test_response *test_response, const struct test_test_response_visitor *visitor, void *ctx)
+{
+	struct test_test_response_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)test_response, test_test_response_visit_tlv, &v);
+}
+
+static int test_test_response_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+	int ret;
+
+	switch (id) {
+	case 2:
+		qmi_json_key(json, "r");
+		ret = test_qmi_result_json(json, data, len);
+		if (ret < 0 || (size_t)ret != len)
+			return -EINVAL;
+		return 0;
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int test_test_response_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 35, 2, "test_response", test_test_response_json_tlv, out, cap);
+}
+
+static const struct qmi_json_field test_test_response_json_fields[] = {
+	{
+		.name = "r",
+		.id = 2,
+		.type = QMI_JSON_STRUCT,
+		.required = true,
+		.members = test_qmi_result_json_fields,
+		.n_members = 2,
+	},
+};
+
+int test_test_response_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 35, 2, test_test_response_json_fields,
+			       sizeof(test_test_response_json_fields) / sizeof(test_test_response_json_fields[0]), out, cap);
+}
+
+static void test_test_request_complete(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx)
+{
+	if (tlv && test_test_response_missing_required((struct test_test_response *)tlv)) {
+		tlv = NULL;
+		error = -EPROTO;
+	}
+
+	((void (*)(struct test_test_response *, int, void *))cb)((struct test_test_response *)tlv, error, ctx);
+}
+
+int test_test_request_call(struct qmi_client *client, struct test_test_request *test_request, void (*cb)(struct test_test_response *test_response, int error, void *ctx), void *ctx)
+{
+	return qmi_client_call(client, (struct qmi_tlv *)test_request, test_test_request_complete, (void (*)(void))cb, ctx);
+}
+
+int test_client_receive(struct qmi_client *client, void *buf, size_t len, const struct test_client_indications *ind, void *ctx)
+{
+	unsigned msg_id;
+	int ret;
+
+	(void)ind;
+	(void)ctx;
+
+	ret = qmi_client_receive(client, buf, len, &msg_id);
+
+	return ret <= 0 ? ret : -ENOENT;
+}
+
+static ssize_t test_test_request_serve(const struct test_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	struct qmi_tlv *resp;
+	struct qmi_tlv *req;
+	unsigned txn;
+	size_t resp_len;
+	ssize_t ret;
+
+	req = qmi_tlv_decode(buf, len, &txn, 35, 0);
+	if (!req)
+		return -EINVAL;
+
+	resp = qmi_tlv_init(txn, 35, 2);
+	if (!resp) {
+		qmi_tlv_free(req);
+		return -ENOMEM;
+	}
+
+	ret = ops->test_request((struct test_test_request *)req, (struct test_test_response *)resp, ctx);
+	if (!ret)
+		ret = qmi_tlv_encode_batch(&resp, 1, out, cap, &resp_len);
+	else if (ret > 0)
+		ret = 0;
+
+	qmi_tlv_free(resp);
+	qmi_tlv_free(req);
+
+	return ret;
+}
+
+ssize_t test_server_handle(const struct test_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	const uint8_t *pkt = buf;
+
+	if (len < 7 || pkt[0] != 0)
+		return -EINVAL;
+
+	switch (pkt[3] | pkt[4] << 8) {
+	case 35:
+		if (!ops->test_request)
+			return -EOPNOTSUPP;
+
+		return test_test_request_serve(ops, buf, len, out, cap, ctx);
+	}
+
+	return -ENOENT;
+}
+
+ssize_t test_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	return test_server_handle(ops, buf, len, out, cap, ctx);
+}
+
+static const struct test_msg_info test_msgs[] = {
+	{
+		.msg_id = 35,
+		.type = 0,
+		.name = "test_request",
+		.max_len = 46,
+		.parse = test_test_request_parse_msg,
+	},
+	{
+		.msg_id = 35,
+		.type = 2,
+		.name = "test_response",
+		.max_len = 7,
+		.parse = test_test_response_parse_msg,
+	},
+};
+
+static const uint16_t test_msg_slots[4] = {
+	[0] = 2,
+	[2] = 1,
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type)
+{
+	const struct test_msg_info *info;
+	uint32_t key = msg_id << 2 | type >> 1;
+	unsigned slot;
+
+	slot = (uint32_t)(key * 2654435761u) >> 30;
+	while (test_msg_slots[slot]) {
+		info = &test_msgs[test_msg_slots[slot] - 1];
+		if (info->msg_id == msg_id && info->type == type)
+			return info;
+
+		slot = (slot + 1) & 3;
+	}
+
+	return NULL;
+}
+
@@ -0,0 +1,489 @@
+#ifndef __QMI_TEST_HPP__
+#define __QMI_TEST_HPP__
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+#ifndef __QMI_CXX_RUNTIME__
+#define __QMI_CXX_RUNTIME__
+
+namespace qmi {
+
+enum class kind : std::uint8_t {
+	u8,
+	u16,
+	u32,
+	u64,
+	string,
+	structure,
+};
+
+/* Message member, index being the slot of its TLV in the reader */
+struct field {
+	std::uint8_t id;
+	kind type;
+	bool required;
+	std::uint16_t array_size;
+	bool array_fixed;
+	std::uint8_t index;
+};
+
+/* Struct member, at offset in the packed wire encoding of the struct */
+struct member {
+	kind type;
+	std::uint16_t offset;
+};
+
+constexpr std::size_t header_size = 7;
+constexpr std::size_t tlv_header_size = 3;
+
+/*
+ * Size of the element count ahead of an array. Fixed arrays of integers have
+ * none, but struct arrays are all VAR_LEN_ARRAY in the kernel encoding, so
+ * fixed ones are counted too.
+ */
+constexpr std::size_t len_size(const field &f)
+{
+	if (!f.array_size || (f.array_fixed && f.type != kind::structure))
+		return 0;
+	return f.array_size >= 256 ? 2 : 1;
+}
+
+/* Wire size, load() and store() of each struct, specialized per struct */
+template <typename T>
+struct codec;
+
+template <typename T>
+constexpr T bswap(T val)
+{
+	if constexpr (sizeof(T) == 2)
+		return __builtin_bswap16(val);
+	else if constexpr (sizeof(T) == 4)
+		return __builtin_bswap32(val);
+	else if constexpr (sizeof(T) == 8)
+		return __builtin_bswap64(val);
+	else
+		return val;
+}
+
+/* Integers are little endian on the wire, structs packed member by member */
+template <typename T>
+constexpr std::size_t wire_size()
+{
+	if constexpr (std::is_integral_v<T>)
+		return sizeof(T);
+	else
+		return codec<T>::wire_size;
+}
+
+template <typename T>
+inline T load(const std::uint8_t *ptr)
+{
+	if constexpr (std::is_integral_v<T>) {
+		T val;
+
+		std::memcpy(&val, ptr, sizeof(val));
+		if constexpr (std::endian::native != std::endian::little)
+			val = bswap(val);
+		return val;
+	} else {
+		return codec<T>::load(ptr);
+	}
+}
+
+template <typename T>
+inline void store(std::uint8_t *ptr, const T &val)
+{
+	if constexpr (std::is_integral_v<T>) {
+		T le = val;
+
+		if constexpr (std::endian::native != std::endian::little)
+			le = bswap(le);
+		std::memcpy(ptr, &le, sizeof(le));
+	} else {
+		codec<T>::store(ptr, val);
+	}
+}
+
+/* View of an array in a received message, converting elements on access */
+template <typename T>
+class array_view {
+public:
+	class iterator {
+	public:
+		constexpr iterator(const std::uint8_t *ptr) : ptr_(ptr) {}
+
+		T operator*() const { return load<T>(ptr_); }
+		iterator &operator++() { ptr_ += wire_size<T>(); return *this; }
+		bool operator!=(const iterator &other) const { return ptr_ != other.ptr_; }
+
+	private:
+		const std::uint8_t *ptr_;
+	};
+
+	constexpr array_view(const std::uint8_t *data, std::size_t count) : data_(data), count_(count) {}
+
+	constexpr std::size_t size() const { return count_; }
+	constexpr bool empty() const { return !count_; }
+	T operator[](std::size_t i) const { return load<T>(data_ + i * wire_size<T>()); }
+
+	iterator begin() const { return iterator(data_); }
+	iterator end() const { return iterator(data_ + count_ * wire_size<T>()); }
+
+	std::span<const std::uint8_t> bytes() const { return { data_, count_ * wire_size<T>() }; }
+
+private:
+	const std::uint8_t *data_;
+	std::size_t count_;
+};
+
+/* What the accessor of member F, of C++ type T, returns */
+template <typename T, field F>
+using value_type = std::conditional_t<F.type == kind::string, std::string_view,
+				      std::conditional_t<(F.array_size > 0), array_view<T>, T>>;
+
+/*
+ * A received message, validated once on construction. The same pass records
+ * the offset of the first TLV of each of the N members, Index() mapping TLV
+ * ids to member slots, so member accessors don't search the message.
+ */
+template <std::size_t N, int (*Index)(std::uint8_t)>
+class reader {
+public:
+	reader(std::span<const std::uint8_t> buf, unsigned msg_id, unsigned type)
+	{
+		std::size_t offset = 0;
+		std::size_t len;
+		int slot;
+
+		if (buf.size() < header_size || buf[0] != type ||
+		    load<std::uint16_t>(&buf[3]) != msg_id)
+			return;
+
+		len = load<std::uint16_t>(&buf[5]);
+		if (len > buf.size() - header_size)
+			return;
+
+		tlvs_ = buf.subspan(header_size, len);
+		while (offset < len) {
+			if (len - offset < tlv_header_size)
+				return;
+
+			slot = Index(tlvs_[offset]);
+			if (slot >= 0 && !offsets_[slot])
+				offsets_[slot] = offset + 1;
+
+			offset += tlv_header_size + load<std::uint16_t>(&tlvs_[offset + 1]);
+		}
+
+		txn_ = load<std::uint16_t>(&buf[1]);
+		valid_ = offset == len;
+	}
+
+	bool valid() const { return valid_; }
+	unsigned txn() const { return txn_; }
+
+	/* Any TLV by id, e.g. one unknown to the schema; searches the message */
+	std::optional<std::span<const std::uint8_t>> find(std::uint8_t id) const
+	{
+		std::size_t offset = 0;
+		std::size_t len;
+
+		if (!valid_)
+			return std::nullopt;
+
+		while (offset < tlvs_.size()) {
+			len = load<std::uint16_t>(&tlvs_[offset + 1]);
+			if (tlvs_[offset] == id)
+				return tlvs_.subspan(offset + tlv_header_size, len);
+
+			offset += tlv_header_size + len;
+		}
+		return std::nullopt;
+	}
+
+protected:
+	/* Accessor of member F, specialized on its descriptor */
+	template <typename T, field F>
+	std::optional<value_type<T, F>> get() const
+	{
+		std::span<const std::uint8_t> tlv;
+		std::size_t offset;
+
+		if (!valid_ || !offsets_[F.index])
+			return std::nullopt;
+
+		offset = offsets_[F.index] - 1;
+		tlv = tlvs_.subspan(offset + tlv_header_size, load<std::uint16_t>(&tlvs_[offset + 1]));
+
+		if constexpr (F.type == kind::string) {
+			return std::string_view(reinterpret_cast<const char *>(tlv.data()), tlv.size());
+		} else if constexpr (F.array_size > 0 && !len_size(F)) {
+			if (tlv.size() != F.array_size * wire_size<T>())
+				return std::nullopt;
+			return array_view<T>(tlv.data(), F.array_size);
+		} else if constexpr (F.array_size > 0) {
+			constexpr std::size_t n = len_size(F);
+			std::size_t count;
+
+			if (tlv.size() < n)
+				return std::nullopt;
+
+			if constexpr (n == 2)
+				count = load<std::uint16_t>(tlv.data());
+			else
+				count = tlv[0];
+
+			if ((F.array_fixed ? count != F.array_size : count > F.array_size) ||
+			    tlv.size() - n != count * wire_size<T>())
+				return std::nullopt;
+			return array_view<T>(tlv.data() + n, count);
+		} else {
+			if (tlv.size() != wire_size<T>())
+				return std::nullopt;
+			return load<T>(tlv.data());
+		}
+	}
+
+private:
+	std::span<const std::uint8_t> tlvs_;
+	std::array<std::uint16_t, N> offsets_ = {};
+	unsigned txn_ = 0;
+	bool valid_ = false;
+};
+
+/* Encodes a message into a caller provided buffer */
+class writer {
+public:
+	writer(std::span<std::uint8_t> buf, unsigned txn, unsigned msg_id, unsigned type)
+		: buf_(buf), txn_(txn), msg_id_(msg_id), type_(type),
+		  len_(header_size), ok_(buf.size() >= header_size)
+	{
+	}
+
+	bool ok() const { return ok_; }
+
+	/* Fill in the QMI header, returning the encoded message */
+	std::span<const std::uint8_t> finish()
+	{
+		if (!ok_ || len_ - header_size > UINT16_MAX)
+			return {};
+
+		buf_[0] = type_;
+		store<std::uint16_t>(&buf_[1], txn_);
+		store<std::uint16_t>(&buf_[3], msg_id_);
+		store<std::uint16_t>(&buf_[5], len_ - header_size);
+
+		return buf_.first(len_);
+	}
+
+protected:
+	std::uint8_t *put_tlv(std::uint8_t id, std::size_t len)
+	{
+		std::uint8_t *ptr;
+
+		if (!ok_ || len > UINT16_MAX || tlv_header_size + len > buf_.size() - len_) {
+			ok_ = false;
+			return nullptr;
+		}
+
+		ptr = &buf_[len_];
+		ptr[0] = id;
+		store<std::uint16_t>(ptr + 1, len);
+		len_ += tlv_header_size + len;
+
+		return ptr + tlv_header_size;
+	}
+
+	/* Encoders of member F, specialized on its descriptor */
+	template <typename T, field F>
+	bool put_value(const T &val)
+	{
+		std::uint8_t *ptr = put_tlv(F.id, wire_size<T>());
+
+		if (!ptr)
+			return false;
+		store<T>(ptr, val);
+		return true;
+	}
+
+	template <typename T, field F>
+	bool put_array(std::span<const T> val)
+	{
+		constexpr std::size_t n = len_size(F);
+		std::uint8_t *ptr;
+
+		if (F.array_fixed ? val.size() != F.array_size : val.size() > F.array_size)
+			return false;
+
+		ptr = put_tlv(F.id, n + val.size() * wire_size<T>());
+		if (!ptr)
+			return false;
+
+		if constexpr (n == 2)
+			store<std::uint16_t>(ptr, val.size());
+		else if constexpr (n == 1)
+			ptr[0] = val.size();
+		ptr += n;
+
+		for (const T &elem : val) {
+			store<T>(ptr, elem);
+			ptr += wire_size<T>();
+		}
+		return true;
+	}
+
+	template <field F>
+	bool put_string(std::string_view val)
+	{
+		std::uint8_t *ptr = put_tlv(F.id, val.size());
+
+		if (!ptr)
+			return false;
+		std::memcpy(ptr, val.data(), val.size());
+		return true;
+	}
+
+private:
+	std::span<std::uint8_t> buf_;
+	unsigned txn_;
+	unsigned msg_id_;
+	unsigned type_;
+	std::size_t len_;
+	bool ok_;
+};
+
+}
+
+#endif
+
+namespace test {
+
+struct qmi_result {
+	std::uint16_t result;
+	std::uint16_t error;
+};
+
+}
+
+namespace qmi {
+
+template <>
+struct codec<test::qmi_result> {
+	struct fields {
+		static constexpr member result = { kind::u16, 0 };
+		static constexpr member error = { kind::u16, 2 };
+	};
+
+	static constexpr std::size_t wire_size = 4;
+
+	static test::qmi_result load(const std::uint8_t *ptr)
+	{
+		test::qmi_result val;
+
+		val.result = qmi::load<std::uint16_t>(ptr + fields::result.offset);
+		val.error = qmi::load<std::uint16_t>(ptr + fields::error.offset);
+		return val;
+	}
+
+	static void store(std::uint8_t *ptr, const test::qmi_result &val)
+	{
+		qmi::store<std::uint16_t>(ptr + fields::result.offset, val.result);
+		qmi::store<std::uint16_t>(ptr + fields::error.offset, val.error);
+	}
+};
+
+}
+
+namespace test {
+
+struct test_request {
+	static constexpr unsigned msg_id = 35;
+	static constexpr unsigned type = 0;
+
+	struct fields {
+		static constexpr qmi::field weird = { 26, qmi::kind::u16, false, 0, false, 0 };
+	};
+
+	/* Slot of the member of each TLV id, in the reader */
+	static constexpr int index(std::uint8_t id)
+	{
+		switch (id) {
+		case 26:
+			return 0;
+		default:
+			return -1;
+		}
+	}
+
+	class reader : public qmi::reader<1, index> {
+	public:
+		explicit reader(std::span<const std::uint8_t> buf) : qmi::reader<1, index>(buf, msg_id, type) {}
+
+		std::optional<std::uint16_t> get_weird() const
+		{
+			return get<std::uint16_t, fields::weird>();
+		}
+	};
+
+	class writer : public qmi::writer {
+	public:
+		writer(std::span<std::uint8_t> buf, unsigned txn) : qmi::writer(buf, txn, msg_id, type) {}
+
+		bool set_weird(const std::uint16_t &val)
+		{
+			return put_value<std::uint16_t, fields::weird>(val);
+		}
+	};
+};
+
+struct test_response {
+	static constexpr unsigned msg_id = 35;
+	static constexpr unsigned type = 2;
+
+	struct fields {
+		static constexpr qmi::field r = { 2, qmi::kind::structure, true, 0, false, 0 };
+	};
+
+	/* Slot of the member of each TLV id, in the reader */
+	static constexpr int index(std::uint8_t id)
+	{
+		switch (id) {
+		case 2:
+			return 0;
+		default:
+			return -1;
+		}
+	}
+
+	class reader : public qmi::reader<1, index> {
+	public:
+		explicit reader(std::span<const std::uint8_t> buf) : qmi::reader<1, index>(buf, msg_id, type) {}
+
+		std::optional<qmi_result> get_r() const
+		{
+			return get<qmi_result, fields::r>();
+		}
+	};
+
+	class writer : public qmi::writer {
+	public:
+		writer(std::span<std::uint8_t> buf, unsigned txn) : qmi::writer(buf, txn, msg_id, type) {}
+
+		bool set_r(const qmi_result &val)
+		{
+			return put_value<qmi_result, fields::r>(val);
+		}
+	};
+};
+
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include <errno.h>
+#include <string.h>
+#include "qmi_test.h"
+
+struct qmi_elem_info test_qmi_result_ei[] = {
+	{
+		.data_type = QMI_UNSIGNED_2_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint16_t),
+		.offset = offsetof(struct test_qmi_result, result),
+	},
+	{
+		.data_type = QMI_UNSIGNED_2_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint16_t),
+		.offset = offsetof(struct test_qmi_result, error),
+	},
+	{}
+};
+
+struct qmi_elem_info test_test_request_ei[] = {
+	{
+		.data_type = QMI_OPT_FLAG,
+		.elem_len = 1,
+		.elem_size = sizeof(bool),
+		.tlv_type = 26,
+		.offset = offsetof(struct test_test_request, weird_valid),
+	},
+	{
+		.data_type = QMI_UNSIGNED_2_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint16_t),
+		.tlv_type = 26,
+		.offset = offsetof(struct test_test_request, weird),
+	},
+	{}
+};
+
+struct qmi_elem_info test_test_response_ei[] = {
+	{
+		.data_type = QMI_STRUCT,
+		.elem_len = 1,
+		.elem_size = sizeof(struct test_qmi_result),
+		.tlv_type = 2,
+		.offset = offsetof(struct test_test_response, r),
+		.ei_array = test_qmi_result_ei,
+	},
+	{}
+};
+
+void test_qmi_result_copy(struct test_qmi_result *dst, const struct test_qmi_result *src)
+{
+	dst->result = src->result;
+	dst->error = src->error;
+}
+
+bool test_qmi_result_equal(const struct test_qmi_result *a, const struct test_qmi_result *b)
+{
+	if (a->result != b->result)
+		return false;
+	if (a->error != b->error)
+		return false;
+
+	return true;
+}
+
+void test_qmi_result_clear(struct test_qmi_result *val)
+{
+	val->result = 0;
+	val->error = 0;
+}
+
+static int qmi_validate_message(const void *buf, size_t len, unsigned msg_id, unsigned type,
+				const uint64_t required[4])
+{
+	const uint8_t *pkt = buf;
+	uint64_t present[4] = {};
+	size_t offset = 7;
+	size_t end;
+	unsigned i;
+
+	if (len < 7 || pkt[0] != type || (unsigned)(pkt[3] | pkt[4] << 8) != msg_id)
+		return -EINVAL;
+
+	end = 7 + (pkt[5] | pkt[6] << 8);
+	if (end > len)
+		return -EINVAL;
+
+	while (offset < end) {
+		if (end - offset < 3)
+			return -EINVAL;
+
+		present[pkt[offset] / 64] |= 1ULL << (pkt[offset] % 64);
+		offset += 3 + (pkt[offset + 1] | pkt[offset + 2] << 8);
+	}
+
+	if (offset != end)
+		return -EINVAL;
+
+	for (i = 0; i < 4; i++) {
+		if ((present[i] & required[i]) != required[i])
+			return -EPROTO;
+	}
+
+	return 0;
+}
+
+void test_test_request_copy(struct test_test_request *dst, const struct test_test_request *src)
+{
+	dst->weird_valid = src->weird_valid;
+	if (src->weird_valid)
+		dst->weird = src->weird;
+}
+
+bool test_test_request_equal(const struct test_test_request *a, const struct test_test_request *b)
+{
+	if (a->weird_valid != b->weird_valid)
+		return false;
+	if (a->weird_valid) {
+		if (a->weird != b->weird)
+			return false;
+	}
+
+	return true;
+}
+
+int test_test_request_diff(const struct test_test_request *a, const struct test_test_request *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	if (a->weird_valid != b->weird_valid)
+		changed[0] |= 1ULL << 26;
+	if (a->weird_valid) {
+		if (a->weird != b->weird)
+			changed[0] |= 1ULL << 26;
+	}
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void test_test_request_clear(struct test_test_request *msg)
+{
+	msg->weird_valid = false;
+}
+
+int test_test_request_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, 35, 0, required);
+}
+
+void test_test_response_copy(struct test_test_response *dst, const struct test_test_response *src)
+{
+	test_qmi_result_copy(&dst->r, &src->r);
+}
+
+bool test_test_response_equal(const struct test_test_response *a, const struct test_test_response *b)
+{
+	if (!test_qmi_result_equal(&a->r, &b->r))
+		return false;
+
+	return true;
+}
+
+int test_test_response_diff(const struct test_test_response *a, const struct test_test_response *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	if (!test_qmi_result_equal(&a->r, &b->r))
+		changed[0] |= 1ULL << 2;
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void test_test_response_clear(struct test_test_response *msg)
+{
+	test_qmi_result_clear(&msg->r);
+}
+
+int test_test_response_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x4ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, 35, 2, required);
+}
+
+static const struct test_msg_info test_msgs[] = {
+	{
+		.msg_id = 35,
+		.type = 0,
+		.name = "test_request",
+		.max_len = 5,
+		.ei = test_test_request_ei,
+	},
+	{
+		.msg_id = 35,
+		.type = 2,
+		.name = "test_response",
+		.max_len = 7,
+		.ei = test_test_response_ei,
+	},
+};
+
+static const uint16_t test_msg_slots[4] = {
+	[0] = 2,
+	[2] = 1,
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type)
+{
+	const struct test_msg_info *info;
+	uint32_t key = msg_id << 2 | type >> 1;
+	unsigned slot;
+
+	slot = (uint32_t)(key * 2654435761u) >> 30;
+	while (test_msg_slots[slot]) {
+		info = &test_msgs[test_msg_slots[slot] - 1];
+		if (info->msg_id == msg_id && info->type == type)
+			return info;
+
+		slot = (slot + 1) & 3;
+	}
+
+	return NULL;
+}
+
@@ -0,0 +1,215 @@
+#ifndef __QMI_EMPTY_H__
+#define __QMI_EMPTY_H__
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+struct qmi_tlv;
+
+struct qmi_tlv *qmi_tlv_init(unsigned txn, unsigned msg_id, unsigned type);
+struct qmi_tlv *qmi_tlv_decode(void *buf, size_t len, unsigned *txn, unsigned msg_id, unsigned type);
+void *qmi_tlv_encode(struct qmi_tlv *tlv, size_t *len);
+void qmi_tlv_free(struct qmi_tlv *tlv);
+int qmi_tlv_foreach(struct qmi_tlv *tlv, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int qmi_tlv_diff(struct qmi_tlv *a, struct qmi_tlv *b, uint64_t changed[4]);
+const uint64_t *qmi_tlv_present(struct qmi_tlv *tlv);
+
+ssize_t qmi_tlv_decode_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, unsigned msg_id, unsigned type, struct qmi_tlv ***tlvs);
+ssize_t qmi_tlv_encode_batch(struct qmi_tlv **tlvs, size_t count, void *buf, size_t size, size_t *lens);
+void qmi_tlv_free_batch(struct qmi_tlv **tlvs, size_t count);
+
+struct qmi_tlv_stream;
+
+struct qmi_tlv_stream *qmi_tlv_stream_init(unsigned msg_id, unsigned type, unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int qmi_tlv_stream_feed(struct qmi_tlv_stream *stream, const void *buf, size_t len);
+void qmi_tlv_stream_free(struct qmi_tlv_stream *stream);
+
+void *qmi_tlv_get(struct qmi_tlv *tlv, unsigned id, size_t *len);
+void *qmi_tlv_get_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, size_t *len, size_t *size);
+int qmi_tlv_set(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);
+int qmi_tlv_set_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);
+
+void qmi_tlv_set_txn(struct qmi_tlv *tlv, unsigned txn);
+int qmi_tlv_replace(struct qmi_tlv *tlv, unsigned id, void *buf, size_t len);
+int qmi_tlv_replace_array(struct qmi_tlv *tlv, unsigned id, unsigned len_size, void *buf, size_t len, size_t size);
+
+struct qmi_json;
+
+int qmi_json_encode(void *buf, size_t len, unsigned msg_id, unsigned type, const char *name, int (*cb)(unsigned id, void *data, size_t len, void *ctx), char *out, size_t cap);
+void qmi_json_open(struct qmi_json *json, char c);
+void qmi_json_close(struct qmi_json *json, char c);
+void qmi_json_key(struct qmi_json *json, const char *key);
+void qmi_json_uint(struct qmi_json *json, uint64_t val);
+void qmi_json_string(struct qmi_json *json, const void *buf, size_t len);
+void qmi_json_unknown(struct qmi_json *json, unsigned id, const void *buf, size_t len);
+
+#ifndef __QMI_JSON_FIELD__
+#define __QMI_JSON_FIELD__
+enum qmi_json_type {
+	QMI_JSON_U8,
+	QMI_JSON_U16,
+	QMI_JSON_U32,
+	QMI_JSON_U64,
+	QMI_JSON_STRING,
+	QMI_JSON_STRUCT,
+};
+
+struct qmi_json_field {
+	const char *name;
+	unsigned id;
+	unsigned type;
+	unsigned array_size;
+	unsigned len_size;
+	bool array_fixed;
+	bool required;
+	const struct qmi_json_field *members;
+	unsigned n_members;
+};
+#endif
+
+int qmi_json_decode(const char *json, size_t len, unsigned txn, unsigned msg_id, unsigned type, const struct qmi_json_field *fields, unsigned count, void *out, size_t cap);
+
+struct qmi_client;
+
+#ifndef __QMI_CLIENT_COMPLETE__
+#define __QMI_CLIENT_COMPLETE__
+typedef void (*qmi_client_complete)(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx);
+#endif
+
+struct qmi_client *qmi_client_init(int (*send)(const void *buf, size_t len, void *ctx), void *ctx, unsigned depth);
+void qmi_client_free(struct qmi_client *client);
+int qmi_client_call(struct qmi_client *client, struct qmi_tlv *tlv, qmi_client_complete complete, void (*cb)(void), void *ctx);
+int qmi_client_receive(struct qmi_client *client, void *buf, size_t len, unsigned *msg_id);
+void qmi_client_cancel(struct qmi_client *client, int error);
+
+struct qmi_server;
+
+#ifndef __QMI_SERVER_HANDLE__
+#define __QMI_SERVER_HANDLE__
+typedef ssize_t (*qmi_server_handle)(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+typedef int (*qmi_server_send)(void **bufs, size_t *lens, size_t count, void *ctx);
+#endif
+
+struct qmi_server *qmi_server_init(unsigned n_workers, qmi_server_handle handle, const void *ops, void *ctx, qmi_server_send send, void *send_ctx);
+int qmi_server_submit(struct qmi_server *server, const void *buf, size_t len);
+void qmi_server_free(struct qmi_server *server);
+
+struct empty_ping;
+struct empty_pong;
+struct empty_tick;
+
+/*
+ * empty_ping message
+ */
+struct empty_ping *empty_ping_alloc(unsigned txn);
+struct empty_ping *empty_ping_parse(void *buf, size_t len, unsigned *txn);
+void *empty_ping_encode(struct empty_ping *ping, size_t *len);
+void empty_ping_free(struct empty_ping *ping);
+ssize_t empty_ping_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct empty_ping ***ping);
+ssize_t empty_ping_encode_batch(struct empty_ping **ping, size_t count, void *buf, size_t size, size_t *lens);
+void empty_ping_free_batch(struct empty_ping **ping, size_t count);
+struct qmi_tlv_stream *empty_ping_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int empty_ping_diff(struct empty_ping *a, struct empty_ping *b, uint64_t changed[4]);
+
+struct empty_ping_visitor {
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int empty_ping_visit(struct empty_ping *ping, const struct empty_ping_visitor *visitor, void *ctx);
+
+int empty_ping_to_json(void *buf, size_t len, char *out, size_t cap);
+int empty_ping_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool empty_ping_missing_required(struct empty_ping *ping)
+{
+	(void)ping;
+
+	return false;
+}
+
+/*
+ * empty_pong message
+ */
+struct empty_pong *empty_pong_alloc(unsigned txn);
+struct empty_pong *empty_pong_parse(void *buf, size_t len, unsigned *txn);
+void *empty_pong_encode(struct empty_pong *pong, size_t *len);
+void empty_pong_free(struct empty_pong *pong);
+ssize_t empty_pong_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct empty_pong ***pong);
+ssize_t empty_pong_encode_batch(struct empty_pong **pong, size_t count, void *buf, size_t size, size_t *lens);
+void empty_pong_free_batch(struct empty_pong **pong, size_t count);
+struct qmi_tlv_stream *empty_pong_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int empty_pong_diff(struct empty_pong *a, struct empty_pong *b, uint64_t changed[4]);
+
+struct empty_pong_visitor {
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int empty_pong_visit(struct empty_pong *pong, const struct empty_pong_visitor *visitor, void *ctx);
+
+int empty_pong_to_json(void *buf, size_t len, char *out, size_t cap);
+int empty_pong_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool empty_pong_missing_required(struct empty_pong *pong)
+{
+	(void)pong;
+
+	return false;
+}
+
+/*
+ * empty_tick message
+ */
+struct empty_tick *empty_tick_alloc(unsigned txn);
+struct empty_tick *empty_tick_parse(void *buf, size_t len, unsigned *txn);
+void *empty_tick_encode(struct empty_tick *tick, size_t *len);
+void empty_tick_free(struct empty_tick *tick);
+ssize_t empty_tick_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct empty_tick ***tick);
+ssize_t empty_tick_encode_batch(struct empty_tick **tick, size_t count, void *buf, size_t size, size_t *lens);
+void empty_tick_free_batch(struct empty_tick **tick, size_t count);
+struct qmi_tlv_stream *empty_tick_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx);
+int empty_tick_diff(struct empty_tick *a, struct empty_tick *b, uint64_t changed[4]);
+
+struct empty_tick_visitor {
+	int (*unknown)(unsigned id, void *data, size_t len, void *ctx);
+};
+
+int empty_tick_visit(struct empty_tick *tick, const struct empty_tick_visitor *visitor, void *ctx);
+
+int empty_tick_to_json(void *buf, size_t len, char *out, size_t cap);
+int empty_tick_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+
+static inline bool empty_tick_missing_required(struct empty_tick *tick)
+{
+	(void)tick;
+
+	return false;
+}
+
+struct empty_client_indications {
+	void (*tick)(struct empty_tick *tick, void *ctx);
+};
+
+int empty_ping_call(struct qmi_client *client, struct empty_ping *ping, void (*cb)(struct empty_pong *pong, int error, void *ctx), void *ctx);
+int empty_client_receive(struct qmi_client *client, void *buf, size_t len, const struct empty_client_indications *ind, void *ctx);
+
+struct empty_server_ops {
+	int (*ping)(struct empty_ping *ping, struct empty_pong *pong, void *ctx);
+};
+
+ssize_t empty_server_handle(const struct empty_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+ssize_t empty_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx);
+
+struct empty_msg_info {
+	unsigned msg_id;
+	unsigned type;
+	const char *name;
+	unsigned max_len;
+	void *(*parse)(void *buf, size_t len, unsigned *txn);
+};
+
+const struct empty_msg_info *empty_lookup(unsigned msg_id, unsigned type);
+
+#endif
@@ -0,0 +1,430 @@
+#include <errno.h>
+#include <string.h>
+#include "qmi_empty.h"
+
+struct empty_ping *empty_ping_alloc(unsigned txn)
+{
+	return (struct empty_ping*)qmi_tlv_init(txn, 1, 0);
+}
+
+struct empty_ping *empty_ping_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct empty_ping*)qmi_tlv_decode(buf, len, txn, 1, 0);
+}
+
+void *empty_ping_encode(struct empty_ping *ping, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)ping, len);
+}
+
+void empty_ping_free(struct empty_ping *ping)
+{
+	qmi_tlv_free((struct qmi_tlv*)ping);
+}
+
+ssize_t empty_ping_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct empty_ping ***ping)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 1, 0, (struct qmi_tlv***)ping);
+}
+
+ssize_t empty_ping_encode_batch(struct empty_ping **ping, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)ping, count, buf, size, lens);
+}
+
+void empty_ping_free_batch(struct empty_ping **ping, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)ping, count);
+}
+
+struct qmi_tlv_stream *empty_ping_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(1, 0, txn, cb, ctx);
+}
+
+int empty_ping_diff(struct empty_ping *a, struct empty_ping *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *empty_ping_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return empty_ping_parse(buf, len, txn);
+}
+
+struct empty_ping_visit_ctx {
+	const struct empty_ping_visitor *visitor;
+	void *ctx;
+};
+
+static int empty_ping_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct empty_ping_visit_ctx *v = ctx;
+	const struct empty_ping_visitor *visitor = v->visitor;
+
+	switch (id) {
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int empty_ping_visit(struct empty_ping *ping, const struct empty_ping_visitor *visitor, void *ctx)
+{
+	struct empty_ping_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)ping, empty_ping_visit_tlv, &v);
+}
+
+static int empty_ping_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+
+	switch (id) {
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int empty_ping_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 1, 0, "ping", empty_ping_json_tlv, out, cap);
+}
+
+int empty_ping_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 1, 0, NULL, 0, out, cap);
+}
+
+struct empty_pong *empty_pong_alloc(unsigned txn)
+{
+	return (struct empty_pong*)qmi_tlv_init(txn, 1, 2);
+}
+
+struct empty_pong *empty_pong_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct empty_pong*)qmi_tlv_decode(buf, len, txn, 1, 2);
+}
+
+void *empty_pong_encode(struct empty_pong *pong, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)pong, len);
+}
+
+void empty_pong_free(struct empty_pong *pong)
+{
+	qmi_tlv_free((struct qmi_tlv*)pong);
+}
+
+ssize_t empty_pong_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct empty_pong ***pong)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 1, 2, (struct qmi_tlv***)pong);
+}
+
+ssize_t empty_pong_encode_batch(struct empty_pong **pong, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)pong, count, buf, size, lens);
+}
+
+void empty_pong_free_batch(struct empty_pong **pong, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)pong, count);
+}
+
+struct qmi_tlv_stream *empty_pong_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(1, 2, txn, cb, ctx);
+}
+
+int empty_pong_diff(struct empty_pong *a, struct empty_pong *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *empty_pong_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return empty_pong_parse(buf, len, txn);
+}
+
+struct empty_pong_visit_ctx {
+	const struct empty_pong_visitor *visitor;
+	void *ctx;
+};
+
+static int empty_pong_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct empty_pong_visit_ctx *v = ctx;
+	const struct empty_pong_visitor *visitor = v->visitor;
+
+	switch (id) {
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int empty_pong_visit(struct empty_pong *pong, const struct empty_pong_visitor *visitor, void *ctx)
+{
+	struct empty_pong_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)pong, empty_pong_visit_tlv, &v);
+}
+
+static int empty_pong_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+
+	switch (id) {
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int empty_pong_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 1, 2, "pong", empty_pong_json_tlv, out, cap);
+}
+
+int empty_pong_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 1, 2, NULL, 0, out, cap);
+}
+
+struct empty_tick *empty_tick_alloc(unsigned txn)
+{
+	return (struct empty_tick*)qmi_tlv_init(txn, 2, 4);
+}
+
+struct empty_tick *empty_tick_parse(void *buf, size_t len, unsigned *txn)
+{
+	return (struct empty_tick*)qmi_tlv_decode(buf, len, txn, 2, 4);
+}
+
+void *empty_tick_encode(struct empty_tick *tick, size_t *len)
+{
+	return qmi_tlv_encode((struct qmi_tlv*)tick, len);
+}
+
+void empty_tick_free(struct empty_tick *tick)
+{
+	qmi_tlv_free((struct qmi_tlv*)tick);
+}
+
+ssize_t empty_tick_parse_batch(void **bufs, size_t *lens, size_t count, unsigned *txns, struct empty_tick ***tick)
+{
+	return qmi_tlv_decode_batch(bufs, lens, count, txns, 2, 4, (struct qmi_tlv***)tick);
+}
+
+ssize_t empty_tick_encode_batch(struct empty_tick **tick, size_t count, void *buf, size_t size, size_t *lens)
+{
+	return qmi_tlv_encode_batch((struct qmi_tlv**)tick, count, buf, size, lens);
+}
+
+void empty_tick_free_batch(struct empty_tick **tick, size_t count)
+{
+	qmi_tlv_free_batch((struct qmi_tlv**)tick, count);
+}
+
+struct qmi_tlv_stream *empty_tick_stream(unsigned *txn, int (*cb)(unsigned id, void *data, size_t len, void *ctx), void *ctx)
+{
+	return qmi_tlv_stream_init(2, 4, txn, cb, ctx);
+}
+
+int empty_tick_diff(struct empty_tick *a, struct empty_tick *b, uint64_t changed[4])
+{
+	return qmi_tlv_diff((struct qmi_tlv*)a, (struct qmi_tlv*)b, changed);
+}
+
+static void *empty_tick_parse_msg(void *buf, size_t len, unsigned *txn)
+{
+	return empty_tick_parse(buf, len, txn);
+}
+
+struct empty_tick_visit_ctx {
+	const struct empty_tick_visitor *visitor;
+	void *ctx;
+};
+
+static int empty_tick_visit_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct empty_tick_visit_ctx *v = ctx;
+	const struct empty_tick_visitor *visitor = v->visitor;
+
+	switch (id) {
+	default:
+		if (!visitor->unknown)
+			return 0;
+		return visitor->unknown(id, data, len, v->ctx);
+	}
+}
+
+int empty_tick_visit(struct empty_tick *tick, const struct empty_tick_visitor *visitor, void *ctx)
+{
+	struct empty_tick_visit_ctx v = { visitor, ctx };
+
+	return qmi_tlv_foreach((struct qmi_tlv*)tick, empty_tick_visit_tlv, &v);
+}
+
+static int empty_tick_json_tlv(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct qmi_json *json = ctx;
+
+	switch (id) {
+	default:
+		qmi_json_unknown(json, id, data, len);
+		return 0;
+	}
+}
+
+int empty_tick_to_json(void *buf, size_t len, char *out, size_t cap)
+{
+	return qmi_json_encode(buf, len, 2, 4, "tick", empty_tick_json_tlv, out, cap);
+}
+
+int empty_tick_from_json(const char *json, size_t len, unsigned txn, void *out, size_t cap)
+{
+	return qmi_json_decode(json, len, txn, 2, 4, NULL, 0, out, cap);
+}
+
+static void empty_ping_complete(struct qmi_tlv *tlv, int error, void (*cb)(void), void *ctx)
+{
+	((void (*)(struct empty_pong *, int, void *))cb)((struct empty_pong *)tlv, error, ctx);
+}
+
+int empty_ping_call(struct qmi_client *client, struct empty_ping *ping, void (*cb)(struct empty_pong *pong, int error, void *ctx), void *ctx)
+{
+	return qmi_client_call(client, (struct qmi_tlv *)ping, empty_ping_complete, (void (*)(void))cb, ctx);
+}
+
+int empty_client_receive(struct qmi_client *client, void *buf, size_t len, const struct empty_client_indications *ind, void *ctx)
+{
+	struct qmi_tlv *tlv;
+	unsigned msg_id;
+	int ret;
+
+	ret = qmi_client_receive(client, buf, len, &msg_id);
+	if (ret <= 0)
+		return ret;
+
+	switch (msg_id) {
+	case 2:
+		if (!ind || !ind->tick)
+			return 0;
+
+		tlv = qmi_tlv_decode(buf, len, NULL, 2, 4);
+		if (!tlv)
+			return -EINVAL;
+
+		ind->tick((struct empty_tick *)tlv, ctx);
+		qmi_tlv_free(tlv);
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+static ssize_t empty_ping_serve(const struct empty_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	struct qmi_tlv *resp;
+	struct qmi_tlv *req;
+	unsigned txn;
+	size_t resp_len;
+	ssize_t ret;
+
+	req = qmi_tlv_decode(buf, len, &txn, 1, 0);
+	if (!req)
+		return -EINVAL;
+
+	resp = qmi_tlv_init(txn, 1, 2);
+	if (!resp) {
+		qmi_tlv_free(req);
+		return -ENOMEM;
+	}
+
+	ret = ops->ping((struct empty_ping *)req, (struct empty_pong *)resp, ctx);
+	if (!ret)
+		ret = qmi_tlv_encode_batch(&resp, 1, out, cap, &resp_len);
+	else if (ret > 0)
+		ret = 0;
+
+	qmi_tlv_free(resp);
+	qmi_tlv_free(req);
+
+	return ret;
+}
+
+ssize_t empty_server_handle(const struct empty_server_ops *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	const uint8_t *pkt = buf;
+
+	if (len < 7 || pkt[0] != 0)
+		return -EINVAL;
+
+	switch (pkt[3] | pkt[4] << 8) {
+	case 1:
+		if (!ops->ping)
+			return -EOPNOTSUPP;
+
+		return empty_ping_serve(ops, buf, len, out, cap, ctx);
+	}
+
+	return -ENOENT;
+}
+
+ssize_t empty_server_dispatch(const void *ops, void *buf, size_t len, void *out, size_t cap, void *ctx)
+{
+	return empty_server_handle(ops, buf, len, out, cap, ctx);
+}
+
+static const struct empty_msg_info empty_msgs[] = {
+	{
+		.msg_id = 1,
+		.type = 0,
+		.name = "ping",
+		.max_len = 0,
+		.parse = empty_ping_parse_msg,
+	},
+	{
+		.msg_id = 1,
+		.type = 2,
+		.name = "pong",
+		.max_len = 0,
+		.parse = empty_pong_parse_msg,
+	},
+	{
+		.msg_id = 2,
+		.type = 4,
+		.name = "tick",
+		.max_len = 0,
+		.parse = empty_tick_parse_msg,
+	},
+};
+
+static const uint16_t empty_msg_slots[8] = {
+	[0] = 2,
+	[1] = 3,
+	[3] = 1,
+};
+
+const struct empty_msg_info *empty_lookup(unsigned msg_id, unsigned type)
+{
+	const struct empty_msg_info *info;
+	uint32_t key = msg_id << 2 | type >> 1;
+	unsigned slot;
+
+	slot = (uint32_t)(key * 2654435761u) >> 29;
+	while (empty_msg_slots[slot]) {
+		info = &empty_msgs[empty_msg_slots[slot] - 1];
+		if (info->msg_id == msg_id && info->type == type)
+			return info;
+
+		slot = (slot + 1) & 7;
+	}
+
+	return NULL;
+}
+
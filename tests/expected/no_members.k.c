@@ -0,0 +1,210 @@
+#include <errno.h>
+#include <string.h>
+#include "qmi_empty.h"
+
+struct qmi_elem_info empty_ping_ei[] = {
+	{}
+};
+
+struct qmi_elem_info empty_pong_ei[] = {
+	{}
+};
+
+struct qmi_elem_info empty_tick_ei[] = {
+	{}
+};
+
+static int qmi_validate_message(const void *buf, size_t len, unsigned msg_id, unsigned type,
+				const uint64_t required[4])
+{
+	const uint8_t *pkt = buf;
+	uint64_t present[4] = {};
+	size_t offset = 7;
+	size_t end;
+	unsigned i;
+
+	if (len < 7 || pkt[0] != type || (unsigned)(pkt[3] | pkt[4] << 8) != msg_id)
+		return -EINVAL;
+
+	end = 7 + (pkt[5] | pkt[6] << 8);
+	if (end > len)
+		return -EINVAL;
+
+	while (offset < end) {
+		if (end - offset < 3)
+			return -EINVAL;
+
+		present[pkt[offset] / 64] |= 1ULL << (pkt[offset] % 64);
+		offset += 3 + (pkt[offset + 1] | pkt[offset + 2] << 8);
+	}
+
+	if (offset != end)
+		return -EINVAL;
+
+	for (i = 0; i < 4; i++) {
+		if ((present[i] & required[i]) != required[i])
+			return -EPROTO;
+	}
+
+	return 0;
+}
+
+void empty_ping_copy(struct empty_ping *dst, const struct empty_ping *src)
+{
+	(void)dst;
+	(void)src;
+}
+
+bool empty_ping_equal(const struct empty_ping *a, const struct empty_ping *b)
+{
+	(void)a;
+	(void)b;
+
+	return true;
+}
+
+int empty_ping_diff(const struct empty_ping *a, const struct empty_ping *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	(void)a;
+	(void)b;
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void empty_ping_clear(struct empty_ping *msg)
+{
+	(void)msg;
+}
+
+int empty_ping_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, 1, 0, required);
+}
+
+void empty_pong_copy(struct empty_pong *dst, const struct empty_pong *src)
+{
+	(void)dst;
+	(void)src;
+}
+
+bool empty_pong_equal(const struct empty_pong *a, const struct empty_pong *b)
+{
+	(void)a;
+	(void)b;
+
+	return true;
+}
+
+int empty_pong_diff(const struct empty_pong *a, const struct empty_pong *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	(void)a;
+	(void)b;
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void empty_pong_clear(struct empty_pong *msg)
+{
+	(void)msg;
+}
+
+int empty_pong_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, 1, 2, required);
+}
+
+void empty_tick_copy(struct empty_tick *dst, const struct empty_tick *src)
+{
+	(void)dst;
+	(void)src;
+}
+
+bool empty_tick_equal(const struct empty_tick *a, const struct empty_tick *b)
+{
+	(void)a;
+	(void)b;
+
+	return true;
+}
+
+int empty_tick_diff(const struct empty_tick *a, const struct empty_tick *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	(void)a;
+	(void)b;
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void empty_tick_clear(struct empty_tick *msg)
+{
+	(void)msg;
+}
+
+int empty_tick_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, 2, 4, required);
+}
+
+static const struct empty_msg_info empty_msgs[] = {
+	{
+		.msg_id = 1,
+		.type = 0,
+		.name = "ping",
+		.max_len = 0,
+		.ei = empty_ping_ei,
+	},
+	{
+		.msg_id = 1,
+		.type = 2,
+		.name = "pong",
+		.max_len = 0,
+		.ei = empty_pong_ei,
+	},
+	{
+		.msg_id = 2,
+		.type = 4,
+		.name = "tick",
+		.max_len = 0,
+		.ei = empty_tick_ei,
+	},
+};
+
+static const uint16_t empty_msg_slots[8] = {
+	[0] = 2,
+	[1] = 3,
+	[3] = 1,
+};
+
+const struct empty_msg_info *empty_lookup(unsigned msg_id, unsigned type)
+{
+	const struct empty_msg_info *info;
+	uint32_t key = msg_id << 2 | type >> 1;
+	unsigned slot;
+
+	slot = (uint32_t)(key * 2654435761u) >> 29;
+	while (empty_msg_slots[slot]) {
+		info = &empty_msgs[empty_msg_slots[slot] - 1];
+		if (info->msg_id == msg_id && info->type == type)
+			return info;
+
+		slot = (slot + 1) & 7;
+	}
+
+	return NULL;
+}
+
@@ -0,0 +1,48 @@
+#ifndef __QMI_EMPTY_H__
+#define __QMI_EMPTY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libqrtr.h"
+
+struct empty_ping {
+};
+
+struct empty_pong {
+};
+
+struct empty_tick {
+};
+
+extern struct qmi_elem_info empty_ping_ei[];
+extern struct qmi_elem_info empty_pong_ei[];
+extern struct qmi_elem_info empty_tick_ei[];
+
+void empty_ping_copy(struct empty_ping *dst, const struct empty_ping *src);
+bool empty_ping_equal(const struct empty_ping *a, const struct empty_ping *b);
+int empty_ping_diff(const struct empty_ping *a, const struct empty_ping *b, uint64_t changed[4]);
+void empty_ping_clear(struct empty_ping *msg);
+int empty_ping_validate(const void *buf, size_t len);
+void empty_pong_copy(struct empty_pong *dst, const struct empty_pong *src);
+bool empty_pong_equal(const struct empty_pong *a, const struct empty_pong *b);
+int empty_pong_diff(const struct empty_pong *a, const struct empty_pong *b, uint64_t changed[4]);
+void empty_pong_clear(struct empty_pong *msg);
+int empty_pong_validate(const void *buf, size_t len);
+void empty_tick_copy(struct empty_tick *dst, const struct empty_tick *src);
+bool empty_tick_equal(const struct empty_tick *a, const struct empty_tick *b);
+int empty_tick_diff(const struct empty_tick *a, const struct empty_tick *b, uint64_t changed[4]);
+void empty_tick_clear(struct empty_tick *msg);
+int empty_tick_validate(const void *buf, size_t len);
+
+struct empty_msg_info {
+	unsigned msg_id;
+	unsigned type;
+	const char *name;
+	unsigned max_len;
+	struct qmi_elem_info *ei;
+};
+
+const struct empty_msg_info *empty_lookup(unsigned msg_id, unsigned type);
+
+#endif
@@ -0,0 +1,50 @@
+#include <errno.h>
+#include <string.h>
+#include "qmi_test.h"
+
+struct qmi_elem_info test_qmi_result_ei[] = {
+	{
+		.data_type = QMI_UNSIGNED_2_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint16_t),
+		.offset = offsetof(struct test_qmi_result, result),
+	},
+	{
+		.data_type = QMI_UNSIGNED_2_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint16_t),
+		.offset = offsetof(struct test_qmi_result, error),
+	},
+	{}
+};
+
+void test_qmi_result_copy(struct test_qmi_result *dst, const struct test_qmi_result *src)
+{
+	dst->result = src->result;
+	dst->error = src->error;
+}
+
+bool test_qmi_result_equal(const struct test_qmi_result *a, const struct test_qmi_result *b)
+{
+	if (a->result != b->result)
+		return false;
+	if (a->error != b->error)
+		return false;
+
+	return true;
+}
+
+void test_qmi_result_clear(struct test_qmi_result *val)
+{
+	val->result = 0;
+	val->error = 0;
+}
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type)
+{
+	(void)msg_id;
+	(void)type;
+
+	return NULL;
+}
+
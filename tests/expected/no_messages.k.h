@@ -0,0 +1,31 @@
+#ifndef __QMI_TEST_H__
+#define __QMI_TEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libqrtr.h"
+
+#define TEST_VERSION 1
+
+struct test_qmi_result {
+	uint16_t result;
+	uint16_t error;
+};
+
+
+void test_qmi_result_copy(struct test_qmi_result *dst, const struct test_qmi_result *src);
+bool test_qmi_result_equal(const struct test_qmi_result *a, const struct test_qmi_result *b);
+void test_qmi_result_clear(struct test_qmi_result *val);
+
+struct test_msg_info {
+	unsigned msg_id;
+	unsigned type;
+	const char *name;
+	unsigned max_len;
+	struct qmi_elem_info *ei;
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type);
+
+#endif
@@ -0,0 +1,284 @@
+#include <errno.h>
+#include <string.h>
+#include "qmi_test.h"
+
+struct qmi_elem_info test_qmi_result_ei[] = {
+	{
+		.data_type = QMI_UNSIGNED_2_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint16_t),
+		.offset = offsetof(struct test_qmi_result, result),
+	},
+	{
+		.data_type = QMI_UNSIGNED_2_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint16_t),
+		.offset = offsetof(struct test_qmi_result, error),
+	},
+	{}
+};
+
+struct qmi_elem_info test_test_request_ei[] = {
+	{
+		.data_type = QMI_UNSIGNED_1_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint8_t),
+		.tlv_type = 18,
+		.offset = offsetof(struct test_test_request, test_number),
+	},
+	{}
+};
+
+struct qmi_elem_info test_test_response_ei[] = {
+	{
+		.data_type = QMI_STRUCT,
+		.elem_len = 1,
+		.elem_size = sizeof(struct test_qmi_result),
+		.tlv_type = 2,
+		.offset = offsetof(struct test_test_response, r),
+		.ei_array = test_qmi_result_ei,
+	},
+	{}
+};
+
+struct qmi_elem_info test_test_indication_ei[] = {
+	{
+		.data_type = QMI_OPT_FLAG,
+		.elem_len = 1,
+		.elem_size = sizeof(bool),
+		.tlv_type = 153,
+		.offset = offsetof(struct test_test_indication, value_valid),
+	},
+	{
+		.data_type = QMI_UNSIGNED_8_BYTE,
+		.elem_len = 1,
+		.elem_size = sizeof(uint64_t),
+		.tlv_type = 153,
+		.offset = offsetof(struct test_test_indication, value),
+	},
+	{}
+};
+
+void test_qmi_result_copy(struct test_qmi_result *dst, const struct test_qmi_result *src)
+{
+	dst->result = src->result;
+	dst->error = src->error;
+}
+
+bool test_qmi_result_equal(const struct test_qmi_result *a, const struct test_qmi_result *b)
+{
+	if (a->result != b->result)
+		return false;
+	if (a->error != b->error)
+		return false;
+
+	return true;
+}
+
+void test_qmi_result_clear(struct test_qmi_result *val)
+{
+	val->result = 0;
+	val->error = 0;
+}
+
+static int qmi_validate_message(const void *buf, size_t len, unsigned msg_id, unsigned type,
+				const uint64_t required[4])
+{
+	const uint8_t *pkt = buf;
+	uint64_t present[4] = {};
+	size_t offset = 7;
+	size_t end;
+	unsigned i;
+
+	if (len < 7 || pkt[0] != type || (unsigned)(pkt[3] | pkt[4] << 8) != msg_id)
+		return -EINVAL;
+
+	end = 7 + (pkt[5] | pkt[6] << 8);
+	if (end > len)
+		return -EINVAL;
+
+	while (offset < end) {
+		if (end - offset < 3)
+			return -EINVAL;
+
+		present[pkt[offset] / 64] |= 1ULL << (pkt[offset] % 64);
+		offset += 3 + (pkt[offset + 1] | pkt[offset + 2] << 8);
+	}
+
+	if (offset != end)
+		return -EINVAL;
+
+	for (i = 0; i < 4; i++) {
+		if ((present[i] & required[i]) != required[i])
+			return -EPROTO;
+	}
+
+	return 0;
+}
+
+void test_test_request_copy(struct test_test_request *dst, const struct test_test_request *src)
+{
+	dst->test_number = src->test_number;
+}
+
+bool test_test_request_equal(const struct test_test_request *a, const struct test_test_request *b)
+{
+	if (a->test_number != b->test_number)
+		return false;
+
+	return true;
+}
+
+int test_test_request_diff(const struct test_test_request *a, const struct test_test_request *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	if (a->test_number != b->test_number)
+		changed[0] |= 1ULL << 18;
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void test_test_request_clear(struct test_test_request *msg)
+{
+	msg->test_number = 0;
+}
+
+int test_test_request_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x40000ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, -2147483648, 0, required);
+}
+
+void test_test_response_copy(struct test_test_response *dst, const struct test_test_response *src)
+{
+	test_qmi_result_copy(&dst->r, &src->r);
+}
+
+bool test_test_response_equal(const struct test_test_response *a, const struct test_test_response *b)
+{
+	if (!test_qmi_result_equal(&a->r, &b->r))
+		return false;
+
+	return true;
+}
+
+int test_test_response_diff(const struct test_test_response *a, const struct test_test_response *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	if (!test_qmi_result_equal(&a->r, &b->r))
+		changed[0] |= 1ULL << 2;
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void test_test_response_clear(struct test_test_response *msg)
+{
+	test_qmi_result_clear(&msg->r);
+}
+
+int test_test_response_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x4ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, -2147483648, 2, required);
+}
+
+void test_test_indication_copy(struct test_test_indication *dst, const struct test_test_indication *src)
+{
+	dst->value_valid = src->value_valid;
+	if (src->value_valid)
+		dst->value = src->value;
+}
+
+bool test_test_indication_equal(const struct test_test_indication *a, const struct test_test_indication *b)
+{
+	if (a->value_valid != b->value_valid)
+		return false;
+	if (a->value_valid) {
+		if (a->value != b->value)
+			return false;
+	}
+
+	return true;
+}
+
+int test_test_indication_diff(const struct test_test_indication *a, const struct test_test_indication *b, uint64_t changed[4])
+{
+	memset(changed, 0, 4 * sizeof(uint64_t));
+
+	if (a->value_valid != b->value_valid)
+		changed[2] |= 1ULL << 25;
+	if (a->value_valid) {
+		if (a->value != b->value)
+			changed[2] |= 1ULL << 25;
+	}
+
+	return __builtin_popcountll(changed[0]) + __builtin_popcountll(changed[1]) +
+	       __builtin_popcountll(changed[2]) + __builtin_popcountll(changed[3]);
+}
+
+void test_test_indication_clear(struct test_test_indication *msg)
+{
+	msg->value_valid = false;
+}
+
+int test_test_indication_validate(const void *buf, size_t len)
+{
+	static const uint64_t required[4] = { 0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL };
+
+	return qmi_validate_message(buf, len, 7, 4, required);
+}
+
+static const struct test_msg_info test_msgs[] = {
+	{
+		.msg_id = -2147483648,
+		.type = 0,
+		.name = "test_request",
+		.max_len = 4,
+		.ei = test_test_request_ei,
+	},
+	{
+		.msg_id = -2147483648,
+		.type = 2,
+		.name = "test_response",
+		.max_len = 7,
+		.ei = test_test_response_ei,
+	},
+	{
+		.msg_id = 7,
+		.type = 4,
+		.name = "test_indication",
+		.max_len = 11,
+		.ei = test_test_indication_ei,
+	},
+};
+
+static const uint16_t test_msg_slots[8] = {
+	[0] = 1,
+	[4] = 2,
+	[5] = 3,
+};
+
+const struct test_msg_info *test_lookup(unsigned msg_id, unsigned type)
+{
+	const struct test_msg_info *info;
+	uint32_t key = msg_id << 2 | type >> 1;
+	unsigned slot;
+
+	slot = (uint32_t)(key * 2654435761u) >> 29;
+	while (test_msg_slots[slot]) {
+		info = &test_msgs[test_msg_slots[slot] - 1];
+		if (info->msg_id == msg_id && info->type == type)
+			return info;
+
+		slot = (slot + 1) & 7;
+	}
+
+	return NULL;
+}
+
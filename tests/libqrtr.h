@@ -0,0 +1,59 @@
+#ifndef __LIBQRTR_H__
+#define __LIBQRTR_H__
+
+/*
+ * Minimal stand-in for the elem_info definitions of libqrtr, enough to build
+ * the kernel style (-k) output of the test fixtures. The codec entry points
+ * are implemented by bench/elem_info.c, for the benchmarks.
+ */
+
+#include <sys/types.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum qmi_elem_type {
+	QMI_EOTI,
+	QMI_OPT_FLAG,
+	QMI_DATA_LEN,
+	QMI_UNSIGNED_1_BYTE,
+	QMI_UNSIGNED_2_BYTE,
+	QMI_UNSIGNED_4_BYTE,
+	QMI_UNSIGNED_8_BYTE,
+	QMI_SIGNED_2_BYTE_ENUM,
+	QMI_SIGNED_4_BYTE_ENUM,
+	QMI_STRUCT,
+	QMI_STRING,
+};
+
+enum qmi_array_type {
+	NO_ARRAY,
+	STATIC_ARRAY,
+	VAR_LEN_ARRAY,
+};
+
+struct qmi_elem_info {
+	enum qmi_elem_type data_type;
+	uint32_t elem_len;
+	uint32_t elem_size;
+	enum qmi_array_type array_type;
+	uint8_t tlv_type;
+	uint32_t offset;
+	struct qmi_elem_info *ei_array;
+};
+
+struct qrtr_packet {
+	int type;
+	unsigned int node;
+	unsigned int port;
+	void *data;
+	size_t data_len;
+};
+
+ssize_t qmi_encode_message(struct qrtr_packet *pkt, int type, int msg_id,
+			   int txn_id, const void *c_struct,
+			   struct qmi_elem_info *ei);
+int qmi_decode_message(void *c_struct, unsigned int *txn,
+		       const struct qrtr_packet *pkt, int type, int id,
+		       struct qmi_elem_info *ei);
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * Byte swapping paths of the accessor codec, built with byteswap.h to pass
+ * for a big endian host. Numeric members set through the scalar and _copy
+ * accessors must be stored with their bytes reversed, read back in host
+ * order, also after a trip through the wire, and handed to the visitor in
+ * host order. The zero-copy _get_ of an array is left in wire order.
+ * Structs are packed member by member, each swapped and without the padding
+ * of the C struct, and unpacked back to host order.
+ */
+#include <err.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "qmi_rt.h"
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#error "build with byteswap.h and __BYTE_ORDER__ set to big endian"
+#endif
+
+struct visit_ctx {
+	uint16_t samples[300];
+	size_t n_samples;
+	uint32_t fixed[4];
+	uint32_t id;
+	uint64_t big;
+};
+
+static const uint16_t samples[300] = {
+	[0] = 0x0102, [1] = 0x0304, [150] = 0xa0b0, [299] = 0xfffe,
+};
+static const uint32_t fixed[4] = { 0x01020304, 0x05060708, 0, 0xffffffff };
+
+/* The bytes of val in memory, in reverse order, must be at data */
+static void check_reversed(const char *what, const void *data, const void *val, size_t size)
+{
+	const uint8_t *p = data;
+	const uint8_t *v = val;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		if (p[i] != v[size - 1 - i])
+			errx(1, "%s: not stored byte reversed", what);
+	}
+}
+
+static int visit_id(uint32_t val, void *ctx)
+{
+	((struct visit_ctx *)ctx)->id = val;
+	return 0;
+}
+
+static int visit_samples(const uint16_t *val, size_t count, void *ctx)
+{
+	struct visit_ctx *v = ctx;
+
+	memcpy(v->samples, val, count * sizeof(val[0]));
+	v->n_samples = count;
+	return 0;
+}
+
+static int visit_fixed(const uint32_t *val, size_t count, void *ctx)
+{
+	memcpy(((struct visit_ctx *)ctx)->fixed, val, count * sizeof(val[0]));
+	return 0;
+}
+
+static int visit_big(uint64_t val, void *ctx)
+{
+	((struct visit_ctx *)ctx)->big = val;
+	return 0;
+}
+
+static const struct rt_query_visitor visitor = {
+	.id = visit_id,
+	.samples = visit_samples,
+	.fixed = visit_fixed,
+	.big = visit_big,
+};
+
+static void check_query(const char *what, struct rt_query *query)
+{
+	struct visit_ctx v = {};
+	uint16_t s[300];
+	uint32_t f[4];
+	uint64_t big;
+	uint32_t id;
+
+	if (rt_query_get_id(query, &id) || id != 0x11223344 ||
+	    rt_query_get_big(query, &big) || big != 0x0102030405060708ULL)
+		errx(1, "%s: scalars differ", what);
+
+	if (rt_query_get_samples_copy(query, s, 300) != 300 || memcmp(s, samples, sizeof(s)) ||
+	    rt_query_get_fixed_copy(query, f, 4) != 4 || memcmp(f, fixed, sizeof(f)))
+		errx(1, "%s: _copy arrays differ", what);
+
+	if (rt_query_visit(query, &visitor, &v) || v.id != 0x11223344 ||
+	    v.big != 0x0102030405060708ULL || v.n_samples != 300 ||
+	    memcmp(v.samples, samples, sizeof(samples)) || memcmp(v.fixed, fixed, sizeof(fixed)))
+		errx(1, "%s: visited members differ", what);
+}
+
+static void check_structs(void)
+{
+	struct rt_cell serving = { .mcc = 0x0102, .mnc = 0x0304, .name = "abc", .cid = 0x05060708 };
+	struct rt_pair pairs[3] = {
+		{ 1, 0x0102030405060708ULL }, { 2, 0 }, { 3, 0xffffffffffffff00ULL },
+	};
+	struct rt_query *parsed;
+	struct rt_query *query;
+	struct rt_pair got[3];
+	struct rt_cell cell;
+	uint8_t buf[256];
+	uint16_t val16;
+	unsigned txn;
+	size_t len;
+	void *ptr;
+	int i;
+
+	query = rt_query_alloc(1);
+	if (rt_query_set_id(query, 1) ||
+	    rt_query_set_serving(query, &serving) ||
+	    rt_query_set_pairs(query, pairs, 3))
+		errx(1, "structs: setting the members failed");
+
+	/* serving at 17, the string behind its 2 byte length, then pairs at 33 */
+	ptr = rt_query_encode(query, &len);
+	memcpy(buf, ptr, len);
+	val16 = 3;
+	check_reversed("serving.mcc", buf + 17, &serving.mcc, 2);
+	check_reversed("serving.mnc", buf + 19, &serving.mnc, 2);
+	check_reversed("serving.name length", buf + 21, &val16, 2);
+	check_reversed("serving.cid", buf + 26, &serving.cid, 4);
+	if (memcmp(buf + 23, "abc", 3))
+		errx(1, "structs: serving.name not packed");
+
+	val16 = 1 + 3 * 9;
+	check_reversed("pairs length", buf + 31, &val16, 2);
+	if (buf[33] != 3 || buf[34] != 1 || buf[52] != 3)
+		errx(1, "structs: pairs not packed");
+	check_reversed("pairs[0].b", buf + 35, &pairs[0].b, 8);
+	check_reversed("pairs[2].b", buf + 53, &pairs[2].b, 8);
+
+	parsed = rt_query_parse(buf, len, &txn);
+	if (!parsed ||
+	    rt_query_get_serving(parsed, &cell) || cell.mcc != serving.mcc ||
+	    cell.mnc != serving.mnc || strcmp(cell.name, "abc") || cell.cid != serving.cid)
+		errx(1, "structs: serving differs");
+
+	if (rt_query_get_pairs(parsed, got, 3) != 3)
+		errx(1, "structs: pairs missing");
+	for (i = 0; i < 3; i++) {
+		if (got[i].a != pairs[i].a || got[i].b != pairs[i].b)
+			errx(1, "structs: pairs[%d] differs", i);
+	}
+
+	rt_query_free(parsed);
+	rt_query_free(query);
+}
+
+int main(void)
+{
+	struct rt_query *parsed;
+	struct rt_query *query;
+	uint8_t buf[1024];
+	uint32_t val32;
+	uint64_t val64;
+	unsigned txn;
+	uint16_t *p;
+	uint16_t s;
+	size_t count;
+	size_t len;
+	void *ptr;
+
+	query = rt_query_alloc(1);
+	if (rt_query_set_id(query, 0x11223344) ||
+	    rt_query_set_big(query, 0x0102030405060708ULL) ||
+	    rt_query_set_samples_copy(query, samples, 300) ||
+	    rt_query_set_fixed_copy(query, fixed, 4))
+		errx(1, "setting the members failed");
+
+	/* Each TLV follows its 3 byte header, in the order set */
+	ptr = rt_query_encode(query, &len);
+	memcpy(buf, ptr, len);
+	val32 = 0x11223344;
+	val64 = 0x0102030405060708ULL;
+	check_reversed("id", buf + 10, &val32, 4);
+	check_reversed("big", buf + 17, &val64, 8);
+	check_reversed("samples[1]", buf + 30 + 2, &samples[1], 2);
+	check_reversed("samples[299]", buf + 30 + 598, &samples[299], 2);
+	check_reversed("fixed[1]", buf + 633 + 4, &fixed[1], 4);
+
+	check_query("set", query);
+
+	/* The zero-copy accessor returns the wire data as is */
+	p = rt_query_get_samples(query, &count);
+	memcpy(&s, &p[1], sizeof(s));
+	if (!p || count != 300 || s != __builtin_bswap16(samples[1]))
+		errx(1, "zero-copy samples not in wire order");
+
+	parsed = rt_query_parse(buf, len, &txn);
+	if (!parsed)
+		errx(1, "parse failed");
+	check_query("parsed", parsed);
+
+	rt_query_free(parsed);
+	rt_query_free(query);
+
+	check_structs();
+
+	return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef __BYTESWAP_SHIM_H__
+#define __BYTESWAP_SHIM_H__
+
+/*
+ * Byte swap shim, included ahead of each source of the byteswap test along
+ * with __BYTE_ORDER__ overridden to big endian on the command line. All
+ * conversions between host and little endian order then swap, in the
+ * runtime as in the generated code, as they would on a big endian host.
+ * Host values appear byte reversed to the code under test, consistently
+ * across the runtime and the generated accessors.
+ */
+#include <endian.h>
+
+#undef htole16
+#undef htole32
+#undef htole64
+#undef le16toh
+#undef le32toh
+#undef le64toh
+
+#define htole16(x)	__builtin_bswap16(x)
+#define htole32(x)	__builtin_bswap32(x)
+#define htole64(x)	__builtin_bswap64(x)
+#define le16toh(x)	__builtin_bswap16(x)
+#define le32toh(x)	__builtin_bswap32(x)
+#define le64toh(x)	__builtin_bswap64(x)
+
+#endif
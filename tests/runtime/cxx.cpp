@@ -0,0 +1,74 @@
+/*
+ * Encode and decode through the C++ (-c) output of cxx.qmi: what the writer
+ * encodes the reader must give back, integers little endian and structs
+ * packed. Struct arrays are VAR_LEN_ARRAY on the wire, so the fixed one
+ * carries its count like the variable one.
+ */
+#include <cstdio>
+#include <cstdlib>
+
+#include "qmi_cx.hpp"
+
+#define check(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			std::fprintf(stderr, "cxx: %s:%d: %s\n",	\
+				     __FILE__, __LINE__, #cond);	\
+			std::exit(1);					\
+		}							\
+	} while (0)
+
+static const cx::pair pairs[3] = {
+	{ 1, 0x0102030405060708ULL },
+	{ 2, 0 },
+	{ 3, 0xffffffffffffff00ULL },
+};
+
+int main()
+{
+	static const std::uint16_t samples[3] = { 1, 2, 0x0304 };
+	static const std::uint32_t fixed[4] = { 0, 1000, 2000, 0x01020304 };
+	std::array<std::uint8_t, 512> buf;
+	std::span<const std::uint8_t> msg;
+	unsigned i;
+
+	cx::query::writer w(buf, 9);
+	check(w.set_id(7));
+	check(w.set_label("hi"));
+	check(w.set_samples(std::span(samples)));
+	check(w.set_fixed(fixed));
+	check(w.set_one(pairs[0]));
+	check(w.set_list(std::span(pairs, 2)));
+	check(w.set_pairs(pairs));
+	msg = w.finish();
+
+	/* The fixed struct array is counted, its TLV at 83 */
+	check(msg.size() == 114);
+	check(msg[83] == 0x15 && msg[84] == 28 && msg[85] == 0);
+	check(msg[86] == 3);
+	check(msg[87] == 1 && msg[88] == 0x08 && msg[95] == 0x01);
+
+	cx::query::reader r(msg);
+	check(r.valid() && r.txn() == 9);
+	check(r.get_id() == 7u);
+	check(r.get_label() == "hi");
+	check(r.get_samples()->size() == 3 && (*r.get_samples())[2] == 0x0304);
+	check(r.get_fixed()->size() == 4 && (*r.get_fixed())[3] == 0x01020304);
+	check(r.get_one()->a == 1 && r.get_one()->b == 0x0102030405060708ULL);
+	check(r.get_list()->size() == 2 && (*r.get_list())[1].a == 2);
+
+	i = 0;
+	for (cx::pair p : *r.get_pairs()) {
+		check(p.a == pairs[i].a && p.b == pairs[i].b);
+		i++;
+	}
+	check(i == 3);
+
+	/* A fixed struct array must hold all of its elements */
+	std::array<std::uint8_t, 512> short_buf = buf;
+	short_buf[86] = 2;
+	cx::query::reader s(std::span<const std::uint8_t>(short_buf.data(), msg.size()));
+	check(s.valid() && !s.get_pairs());
+
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Round trip of qmic-gen output through the accessor codec: each message of
+ * the pcap capture on stdin is decoded with _parse(), encoded again, rendered
+ * with _to_json() and encoded back with _from_json(), which must reproduce the
+ * original bytes. Both ends speak the packed wire encoding of the schema.
+ * Struct members given out of order, or left out, and string bounds and
+ * escapes are checked separately.
+ * With -p the JSON of each message is printed, one per line, for captures
+ * written by other codecs.
+ */
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qmi_rt.h"
+
+#define PCAP_MAGIC_US		0xa1b2c3d4
+#define QMI_MAX_LEN		(7 + 65535)
+
+struct roundtrip_msg {
+	unsigned msg_id;
+	unsigned type;
+	void *(*parse_encode)(void *buf, size_t len, size_t *out_len);
+	int (*to_json)(void *buf, size_t len, char *out, size_t cap);
+	int (*from_json)(const char *json, size_t len, unsigned txn, void *out, size_t cap);
+};
+
+#define ROUNDTRIP_MSG(name)								\
+static void *name##_parse_encode(void *buf, size_t len, size_t *out_len)		\
+{											\
+	struct rt_##name *msg;								\
+	unsigned txn;									\
+	void *ptr;									\
+											\
+	msg = rt_##name##_parse(buf, len, &txn);					\
+	if (!msg)									\
+		return NULL;								\
+											\
+	ptr = rt_##name##_encode(msg, out_len);						\
+	rt_##name##_free(msg);								\
+	return ptr;									\
+}
+
+ROUNDTRIP_MSG(query)
+ROUNDTRIP_MSG(query_resp)
+ROUNDTRIP_MSG(report)
+
+static const struct roundtrip_msg msgs[] = {
+	{ 0x30, 0, query_parse_encode, rt_query_to_json, rt_query_from_json },
+	{ 0x30, 2, query_resp_parse_encode, rt_query_resp_to_json, rt_query_resp_from_json },
+	{ 0x31, 4, report_parse_encode, rt_report_to_json, rt_report_from_json },
+};
+
+static const struct roundtrip_msg *roundtrip_lookup(const uint8_t *buf)
+{
+	unsigned msg_id = buf[3] | buf[4] << 8;
+	unsigned i;
+
+	for (i = 0; i < sizeof(msgs) / sizeof(msgs[0]); i++) {
+		if (msgs[i].msg_id == msg_id && msgs[i].type == buf[0])
+			return &msgs[i];
+	}
+
+	return NULL;
+}
+
+static void roundtrip_struct_order(void)
+{
+	static const char json[] = "{\"serving\":{\"cid\":7,\"name\":\"ab\",\"mcc\":1},\"id\":5}";
+	static const uint8_t expected[] = {
+		0x00, 0x09, 0x00, 0x30, 0x00, 0x16, 0x00,
+		0x14, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 'a', 'b', 0x07, 0x00, 0x00, 0x00,
+		0x01, 0x04, 0x00, 0x05, 0x00, 0x00, 0x00,
+	};
+	uint8_t out[64];
+	int ret;
+
+	ret = rt_query_from_json(json, sizeof(json) - 1, 9, out, sizeof(out));
+	if (ret != sizeof(expected) || memcmp(out, expected, ret))
+		errx(1, "struct members out of order: %d", ret);
+}
+
+/*
+ * Message strings are held in char[256] by the kernel, so a longer one is
+ * refused. UTF-8 is rendered as is, other bytes from 0x80 up are escaped.
+ */
+static void roundtrip_strings(void)
+{
+	static const uint8_t msg[] = {
+		0x00, 0x09, 0x00, 0x30, 0x00, 0x0f, 0x00,
+		0x01, 0x04, 0x00, 0x05, 0x00, 0x00, 0x00,
+		0x10, 0x05, 0x00, 0xc3, 0xa9, 0xff, 0xe9, '"',
+	};
+	static const char label[] = "\"label\":\"\xc3\xa9\\u00ff\\u00e9\\\"\"";
+	char json[512];
+	uint8_t out[512];
+	size_t len;
+	int ret;
+
+	len = snprintf(json, sizeof(json), "{\"id\":1,\"label\":\"%0255d\"}", 0);
+	ret = rt_query_from_json(json, len, 9, out, sizeof(out));
+	if (ret != 7 + 7 + 3 + 255)
+		errx(1, "string of 255 bytes refused: %d", ret);
+
+	len = snprintf(json, sizeof(json), "{\"id\":1,\"label\":\"%0256d\"}", 0);
+	ret = rt_query_from_json(json, len, 9, out, sizeof(out));
+	if (ret >= 0)
+		errx(1, "string of 256 bytes accepted");
+
+	ret = rt_query_to_json((void *)msg, sizeof(msg), json, sizeof(json) - 1);
+	if (ret < 0)
+		errx(1, "_to_json failed: %d", ret);
+
+	json[ret] = '\0';
+	if (!strstr(json, label))
+		errx(1, "string bytes not escaped: %s", json);
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t buf[QMI_MAX_LEN];
+	static uint8_t orig[QMI_MAX_LEN];
+	static uint8_t out[QMI_MAX_LEN];
+	static char json[1 << 20];
+	const struct roundtrip_msg *msg;
+	bool print = argc > 1 && !strcmp(argv[1], "-p");
+	unsigned long count = 0;
+	uint32_t hdr[6];
+	uint32_t rec[4];
+	size_t len;
+	void *ptr;
+	int ret;
+
+	if (fread(hdr, sizeof(hdr), 1, stdin) != 1 || hdr[0] != PCAP_MAGIC_US)
+		errx(1, "not a pcap capture");
+
+	while (fread(rec, sizeof(rec), 1, stdin) == 1) {
+		if (rec[2] < 7 || rec[2] > sizeof(buf) || fread(buf, rec[2], 1, stdin) != 1)
+			errx(1, "message %lu: truncated", count);
+		memcpy(orig, buf, rec[2]);
+
+		msg = roundtrip_lookup(buf);
+		if (!msg)
+			errx(1, "message %lu: unknown message", count);
+
+		/* Encoding a decoded message rewrites its header in buf */
+		ptr = msg->parse_encode(buf, rec[2], &len);
+		if (!ptr || len != rec[2] || memcmp(ptr, orig, len))
+			errx(1, "message %lu: _parse/_encode differs", count);
+
+		ret = msg->to_json(ptr, len, json, sizeof(json));
+		if (ret < 0)
+			errx(1, "message %lu: _to_json failed: %d", count, ret);
+		if (print)
+			printf("%.*s\n", ret, json);
+
+		ret = msg->from_json(json, ret, orig[1] | orig[2] << 8, out, sizeof(out));
+		if (ret < 0)
+			errx(1, "message %lu: _from_json failed: %d\n%s", count, ret, json);
+
+		if ((size_t)ret != rec[2] || memcmp(out, orig, ret))
+			errx(1, "message %lu: _from_json differs\n%s", count, json);
+
+		count++;
+	}
+
+	if (!count)
+		errx(1, "no messages");
+
+	roundtrip_struct_order();
+	roundtrip_strings();
+
+	return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copy, compare and diff helpers of the kernel style (-k) output of
+ * runtime.qmi, whose structs carry strings: copies must be equal, strings
+ * compare up to their terminator and each member is flagged on its own.
+ * Fixed struct arrays are VAR_LEN_ARRAY on the wire, so their _len counts.
+ * A query with every member at its longest encodes to exactly the max_len
+ * of its dispatch entry.
+ *
+ * Given a path, the messages are also encoded through the elem_info codec
+ * and written there as a pcap capture, for the accessor codec to decode.
+ */
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "qmi_rt.h"
+
+#define PCAP_MAGIC_US		0xa1b2c3d4
+#define PCAP_LINKTYPE_USER0	147
+#define QMI_MAX_LEN		(7 + 65535)
+
+static void set_cell(struct rt_cell *cell, const char *name, uint32_t cid)
+{
+	memset(cell, 0xaa, sizeof(*cell));
+	cell->mcc = 240;
+	cell->mnc = 1;
+	cell->name_len = strlen(name);
+	memcpy(cell->name, name, cell->name_len + 1);
+	cell->cid = cid;
+}
+
+static void fill_cell(struct rt_cell *cell)
+{
+	cell->name_len = sizeof(cell->name) - 1;
+	memset(cell->name, 'n', cell->name_len);
+	cell->name[cell->name_len] = '\0';
+}
+
+static void check_max_len(void)
+{
+	static uint8_t buf[QMI_MAX_LEN];
+	struct qrtr_packet pkt = { .data = buf, .data_len = sizeof(buf) };
+	const struct rt_msg_info *info;
+	static struct rt_query q;
+	ssize_t len;
+	unsigned i;
+
+	q.label_len = sizeof(q.label) - 1;
+	memset(q.label, 'l', q.label_len);
+	q.samples_valid = true;
+	q.samples_len = 300;
+	q.bytes_valid = true;
+	q.bytes_len = 8;
+	q.fixed_valid = true;
+	q.fixed_len = 4;
+	q.serving_valid = true;
+	fill_cell(&q.serving);
+	q.neighbours_valid = true;
+	q.neighbours_len = 6;
+	for (i = 0; i < 6; i++)
+		fill_cell(&q.neighbours[i]);
+	q.pairs_valid = true;
+	q.pairs_len = 3;
+	q.big_valid = true;
+
+	info = rt_lookup(0x30, 0);
+	len = qmi_encode_message(&pkt, 0, 0x30, 1, &q, rt_query_ei);
+	if (!info || len < 0)
+		errx(1, "encoding the longest query failed: %zd", len);
+
+	if ((size_t)len - 7 != info->max_len)
+		errx(1, "longest query encodes to %zd bytes, max_len is %u",
+		     len - 7, info->max_len);
+}
+
+static void write_message(FILE *fp, int type, int msg_id, const void *c_struct,
+			  struct qmi_elem_info *ei)
+{
+	static uint8_t buf[QMI_MAX_LEN];
+	struct qrtr_packet pkt = { .data = buf, .data_len = sizeof(buf) };
+	uint32_t rec[4] = {};
+	ssize_t len;
+
+	len = qmi_encode_message(&pkt, type, msg_id, 1, c_struct, ei);
+	if (len < 0)
+		errx(1, "encoding message 0x%x failed: %zd", msg_id, len);
+
+	rec[2] = rec[3] = len;
+	fwrite(rec, sizeof(rec), 1, fp);
+	fwrite(buf, len, 1, fp);
+}
+
+static void write_capture(const char *path, const struct rt_query *query)
+{
+	uint32_t hdr[6] = { PCAP_MAGIC_US, 2 | 4 << 16, 0, 0, QMI_MAX_LEN, PCAP_LINKTYPE_USER0 };
+	static struct rt_query_resp resp;
+	static struct rt_report report;
+	FILE *fp;
+
+	fp = fopen(path, "wb");
+	if (!fp)
+		err(1, "failed to open %s", path);
+
+	fwrite(hdr, sizeof(hdr), 1, fp);
+
+	write_message(fp, 0, 0x30, query, rt_query_ei);
+
+	resp.result.a = 1;
+	resp.result.b = 0x0102030405060708ULL;
+	resp.flags_valid = true;
+	resp.flags = 0x80;
+	write_message(fp, 2, 0x30, &resp, rt_query_resp_ei);
+
+	report.cells_valid = true;
+	report.cells_len = 2;
+	set_cell(&report.cells[0], "abc", 1);
+	set_cell(&report.cells[1], "", 2);
+	write_message(fp, 4, 0x31, &report, rt_report_ei);
+
+	if (fclose(fp))
+		err(1, "failed to write %s", path);
+}
+
+int main(int argc, char **argv)
+{
+	static struct rt_query a;
+	static struct rt_query b;
+	uint64_t changed[4];
+	unsigned i;
+
+	a.id = 7;
+	a.label_len = 5;
+	strcpy(a.label, "label");
+	a.bytes_valid = true;
+	a.bytes_len = 2;
+	a.bytes[0] = 0xff;
+	a.bytes[1] = 0x01;
+	a.fixed_valid = true;
+	for (i = 0; i < 4; i++)
+		a.fixed[i] = 1000 * i;
+	a.serving_valid = true;
+	set_cell(&a.serving, "abc", 1);
+	a.neighbours_valid = true;
+	a.neighbours_len = 3;
+	for (i = 0; i < 3; i++)
+		set_cell(&a.neighbours[i], "neighbour", 10 + i);
+	a.pairs_valid = true;
+	a.pairs_len = 3;
+	for (i = 0; i < 3; i++) {
+		a.pairs[i].a = i;
+		a.pairs[i].b = 100 + i;
+	}
+	a.big_valid = true;
+	a.big = 1;
+
+	if (argc > 1)
+		write_capture(argv[1], &a);
+
+	check_max_len();
+
+	memset(&b, 0x55, sizeof(b));
+	rt_query_copy(&b, &a);
+	if (!rt_query_equal(&a, &b) || rt_query_diff(&a, &b, changed))
+		errx(1, "copy differs");
+
+	if (strcmp(b.neighbours[2].name, "neighbour") || b.neighbours[2].name_len != 9)
+		errx(1, "string member not copied");
+
+	if (b.pairs_len != 3 || b.pairs[2].b != 102)
+		errx(1, "fixed struct array not copied");
+
+	b.pairs_len = 2;
+	if (rt_query_equal(&a, &b) || rt_query_diff(&a, &b, changed) != 1 ||
+	    !rt_query_changed_pairs(changed))
+		errx(1, "fixed struct array length not compared");
+	b.pairs_len = 3;
+
+	/* Bytes past the terminator are not part of the string */
+	b.serving.name[200] = 'x';
+	if (!rt_query_equal(&a, &b))
+		errx(1, "bytes past the string terminator compared");
+
+	strcpy(b.neighbours[1].name, "other");
+	if (rt_query_equal(&a, &b) || rt_query_diff(&a, &b, changed) != 1 ||
+	    !rt_query_changed_neighbours(changed) || rt_query_changed_serving(changed))
+		errx(1, "changed string in struct array not flagged alone");
+
+	strcpy(b.label, "labels");
+	b.big = 2;
+	if (rt_query_diff(&a, &b, changed) != 3 || !rt_query_changed_label(changed) ||
+	    !rt_query_changed_big(changed) || rt_query_changed_id(changed))
+		errx(1, "changed members not flagged");
+
+	rt_query_clear(&b);
+	if (b.label[0] || b.serving_valid || b.neighbours_valid || b.pairs_valid ||
+	    rt_query_equal(&a, &b))
+		errx(1, "clear left members set");
+
+	return 0;
+}
@@ -0,0 +1,567 @@
+/*
+ * Runtime tests of the accessor codec, on the messages of runtime.qmi: the
+ * stream decoder fed at every split of a message, in place replacement of
+ * TLVs, batch decode and encode, diffs, member presence, the pipelining
+ * client and the server dispatcher.
+ */
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "qmi_rt.h"
+
+#define BATCH_COUNT		8
+#define SERVER_COUNT		1000
+#define WRAP_COUNT		70000
+
+static struct rt_query *build_query(unsigned txn, uint32_t id)
+{
+	struct rt_cell neighbours[3] = {};
+	struct rt_pair pairs[3] = {};
+	struct rt_cell serving = {};
+	uint32_t fixed[4] = { 1, 2, 3, 4 };
+	uint8_t bytes[5] = { 9, 8, 7, 6, 5 };
+	uint16_t samples[300];
+	struct rt_query *query;
+	unsigned i;
+
+	for (i = 0; i < 300; i++)
+		samples[i] = i * 3;
+
+	serving.mcc = 240;
+	serving.mnc = 1;
+	serving.cid = 0x1234;
+	for (i = 0; i < 3; i++) {
+		neighbours[i].mcc = 240;
+		neighbours[i].cid = i;
+		pairs[i].a = i;
+		pairs[i].b = 1ULL << (i * 20);
+	}
+
+	query = rt_query_alloc(txn);
+	if (!query ||
+	    rt_query_set_id(query, id) ||
+	    rt_query_set_label(query, "label", 5) ||
+	    rt_query_set_samples(query, samples, 300) ||
+	    rt_query_set_bytes(query, bytes, 5) ||
+	    rt_query_set_fixed(query, fixed, 4) ||
+	    rt_query_set_serving(query, &serving) ||
+	    rt_query_set_neighbours(query, neighbours, 3) ||
+	    rt_query_set_pairs(query, pairs, 3) ||
+	    rt_query_set_big(query, 0x0102030405060708ULL))
+		errx(1, "build: setting the members failed");
+
+	return query;
+}
+
+struct stream_ctx {
+	uint8_t buf[4096];
+	size_t len;
+};
+
+static int stream_cb(unsigned id, void *data, size_t len, void *ctx)
+{
+	struct stream_ctx *s = ctx;
+
+	if (s->len + 3 + len > sizeof(s->buf))
+		return -ENOSPC;
+
+	s->buf[s->len++] = id;
+	s->buf[s->len++] = len;
+	s->buf[s->len++] = len >> 8;
+	memcpy(s->buf + s->len, data, len);
+	s->len += len;
+
+	return 0;
+}
+
+/* Feed buf in chunks of at most step bytes, after a first chunk of split */
+static void stream_feed(const uint8_t *buf, size_t len, size_t split, size_t step)
+{
+	struct qmi_tlv_stream *stream;
+	struct stream_ctx s = {};
+	size_t offset = 0;
+	unsigned txn = 0;
+	size_t n;
+	int ret = 0;
+
+	stream = rt_query_stream(&txn, stream_cb, &s);
+	if (!stream)
+		errx(1, "stream: init failed");
+
+	for (n = split; offset < len; n = step) {
+		if (n > len - offset)
+			n = len - offset;
+
+		ret = qmi_tlv_stream_feed(stream, buf + offset, n);
+		offset += n;
+		if (ret != (offset == len))
+			errx(1, "stream: split %zu step %zu: feed returned %d at %zu", split, step, ret, offset);
+	}
+
+	if (txn != 7 || s.len != len - 7 || memcmp(s.buf, buf + 7, s.len))
+		errx(1, "stream: split %zu step %zu: wrong TLVs", split, step);
+
+	qmi_tlv_stream_free(stream);
+}
+
+static void test_stream(void)
+{
+	struct rt_query *query;
+	size_t split;
+	size_t len;
+	void *buf;
+
+	query = build_query(7, 1);
+	buf = rt_query_encode(query, &len);
+	if (!buf)
+		errx(1, "stream: encode failed");
+
+	for (split = 0; split <= len; split++)
+		stream_feed(buf, len, split, len);
+	stream_feed(buf, len, 1, 1);
+
+	rt_query_free(query);
+}
+
+static void test_replace(void)
+{
+	uint16_t samples[2] = { 1, 2 };
+	struct rt_query *decoded;
+	struct rt_query *query;
+	uint8_t orig[4096];
+	uint8_t copy[4096];
+	uint16_t val[300];
+	char label[64];
+	size_t orig_len;
+	unsigned txn;
+	uint32_t id;
+	size_t len;
+	void *buf;
+
+	query = build_query(3, 42);
+	buf = rt_query_encode(query, &orig_len);
+	memcpy(orig, buf, orig_len);
+
+	/* Grow and shrink members ahead of others, on the allocated message */
+	if (rt_query_replace_label(query, "a much longer label", 19) ||
+	    rt_query_replace_samples(query, samples, 2))
+		errx(1, "replace: failed");
+
+	if (rt_query_get_label(query, label, sizeof(label)) != 19 || memcmp(label, "a much longer label", 19))
+		errx(1, "replace: label not grown");
+
+	if (rt_query_get_samples_copy(query, val, 300) != 2 || val[0] != 1 || val[1] != 2)
+		errx(1, "replace: samples not shrunk");
+
+	if (rt_query_get_id(query, &id) || id != 42)
+		errx(1, "replace: id lost");
+
+	rt_query_free(query);
+
+	/* Replacing back on a decoded message must give the original bytes */
+	memcpy(copy, orig, orig_len);
+	decoded = rt_query_parse(copy, orig_len, &txn);
+	if (!decoded)
+		errx(1, "replace: parse failed");
+
+	if (rt_query_replace_label(decoded, "a much longer label", 19) ||
+	    rt_query_replace_label(decoded, "label", 5) ||
+	    rt_query_replace_id(decoded, 42))
+		errx(1, "replace: failed on decoded message");
+
+	buf = rt_query_encode(decoded, &len);
+	if (!buf || len != orig_len || memcmp(buf, orig, len))
+		errx(1, "replace: decoded message differs");
+
+	/* Replacing an absent member adds it */
+	if (rt_query_replace_id(decoded, 43) || rt_query_get_id(decoded, &id) || id != 43)
+		errx(1, "replace: id not replaced");
+
+	rt_query_free(decoded);
+}
+
+static void test_batch(void)
+{
+	struct rt_query *queries[BATCH_COUNT];
+	struct rt_query **parsed;
+	void *bufs[BATCH_COUNT];
+	size_t lens[BATCH_COUNT];
+	unsigned txns[BATCH_COUNT];
+	static uint8_t buf[BATCH_COUNT * 4096];
+	uint8_t *p = buf;
+	ssize_t decoded;
+	ssize_t total;
+	uint32_t id;
+	unsigned i;
+
+	for (i = 0; i < BATCH_COUNT; i++)
+		queries[i] = build_query(100 + i, i);
+
+	total = rt_query_encode_batch(queries, BATCH_COUNT, buf, sizeof(buf), lens);
+	if (total < 0)
+		errx(1, "batch: encode failed: %zd", total);
+
+	for (i = 0; i < BATCH_COUNT; i++) {
+		bufs[i] = p;
+		p += lens[i];
+		rt_query_free(queries[i]);
+	}
+
+	if (p - buf != total)
+		errx(1, "batch: lengths do not add up");
+
+	/* Truncate the last message, which must be rejected alone */
+	lens[BATCH_COUNT - 1] -= 1;
+
+	decoded = rt_query_parse_batch(bufs, lens, BATCH_COUNT, txns, &parsed);
+	if (decoded != BATCH_COUNT - 1)
+		errx(1, "batch: %zd of %d messages decoded", decoded, BATCH_COUNT - 1);
+
+	for (i = 0; i < BATCH_COUNT - 1; i++) {
+		if (!parsed[i] || txns[i] != 100 + i || rt_query_get_id(parsed[i], &id) || id != i)
+			errx(1, "batch: message %u differs", i);
+	}
+
+	if (parsed[BATCH_COUNT - 1])
+		errx(1, "batch: truncated message accepted");
+
+	rt_query_free_batch(parsed, BATCH_COUNT);
+
+	/* An empty batch is no error, one the handles can't be sized for is */
+	if (rt_query_parse_batch(bufs, lens, 0, txns, &parsed) || parsed)
+		errx(1, "batch: empty batch failed");
+	rt_query_free_batch(parsed, 0);
+
+	if (rt_query_parse_batch(bufs, lens, SIZE_MAX, txns, &parsed) != -EOVERFLOW || parsed)
+		errx(1, "batch: handle array size overflow not caught");
+}
+
+static void test_diff(void)
+{
+	uint64_t changed[4];
+	struct rt_query *a;
+	struct rt_query *b;
+
+	/* Same members, set in a different order */
+	a = rt_query_alloc(1);
+	b = rt_query_alloc(2);
+	if (rt_query_set_id(a, 5) || rt_query_set_label(a, "x", 1) || rt_query_set_big(a, 9) ||
+	    rt_query_set_big(b, 9) || rt_query_set_label(b, "x", 1) || rt_query_set_id(b, 5))
+		errx(1, "diff: setting the members failed");
+
+	if (rt_query_diff(a, b, changed))
+		errx(1, "diff: reordered TLVs differ");
+
+	if (rt_query_replace_label(b, "y", 1) ||
+	    rt_query_diff(a, b, changed) != 1 ||
+	    !rt_query_changed_label(changed) || rt_query_changed_id(changed))
+		errx(1, "diff: changed label not flagged");
+
+	if (rt_query_set_bytes_copy(b, (const uint8_t *)"z", 1) ||
+	    rt_query_diff(a, b, changed) != 2 || !rt_query_changed_bytes(changed) ||
+	    rt_query_diff(b, a, changed) != 2 || !rt_query_changed_bytes(changed))
+		errx(1, "diff: member of one side only not flagged");
+
+	rt_query_free(a);
+	rt_query_free(b);
+}
+
+static void test_presence(void)
+{
+	struct rt_query *query;
+	struct rt_query *parsed;
+	uint8_t buf[64];
+	unsigned txn;
+	size_t len;
+	void *ptr;
+
+	query = rt_query_alloc(1);
+	if (rt_query_has_id(query) || !rt_query_missing_required(query))
+		errx(1, "presence: empty message");
+
+	if (rt_query_set_label(query, "x", 1) || !rt_query_has_label(query) ||
+	    !rt_query_missing_required(query))
+		errx(1, "presence: optional member only");
+
+	ptr = rt_query_encode(query, &len);
+	memcpy(buf, ptr, len);
+	parsed = rt_query_parse(buf, len, &txn);
+	if (!parsed || !rt_query_has_label(parsed) || rt_query_has_id(parsed) ||
+	    !rt_query_missing_required(parsed))
+		errx(1, "presence: decoded message without id");
+	rt_query_free(parsed);
+
+	if (rt_query_set_id(query, 1) || !rt_query_has_id(query) || rt_query_has_big(query) ||
+	    rt_query_missing_required(query))
+		errx(1, "presence: required member set");
+
+	rt_query_free(query);
+}
+
+struct client_ctx {
+	uint8_t req[4096];
+	size_t req_len;
+
+	unsigned completed;
+	unsigned cancelled;
+	unsigned reports;
+	int last_error;
+	uint64_t last_b;
+};
+
+static int client_send(const void *buf, size_t len, void *ctx)
+{
+	struct client_ctx *c = ctx;
+
+	memcpy(c->req, buf, len);
+	c->req_len = len;
+
+	return 0;
+}
+
+static void client_done(struct rt_query_resp *resp, int error, void *ctx)
+{
+	struct client_ctx *c = ctx;
+	struct rt_pair result;
+
+	c->last_error = error;
+	if (error) {
+		c->cancelled++;
+		return;
+	}
+
+	c->last_b = rt_query_resp_get_result(resp, &result) ? 0 : result.b;
+	c->completed++;
+}
+
+static void client_report(struct rt_report *report, void *ctx)
+{
+	struct client_ctx *c = ctx;
+
+	(void)report;
+	c->reports++;
+}
+
+/* Answer the request last sent with result.b set to its txn */
+static int client_respond(struct qmi_client *client, struct client_ctx *c)
+{
+	struct rt_client_indications ind = { .report = client_report };
+	struct rt_query_resp *resp;
+	struct rt_pair result = {};
+	unsigned txn;
+	size_t len;
+	void *buf;
+	int ret;
+
+	txn = c->req[1] | c->req[2] << 8;
+	result.b = txn;
+
+	resp = rt_query_resp_alloc(txn);
+	rt_query_resp_set_result(resp, &result);
+	buf = rt_query_resp_encode(resp, &len);
+	ret = rt_client_receive(client, buf, len, &ind, c);
+	rt_query_resp_free(resp);
+
+	return ret;
+}
+
+static void test_client(void)
+{
+	struct rt_client_indications ind = { .report = client_report };
+	unsigned txns[4];
+	struct qmi_client *client;
+	struct rt_query *query;
+	struct rt_report *report;
+	struct client_ctx c = {};
+	unsigned expected = 1;
+	unsigned i;
+	size_t len;
+	void *buf;
+	int txn;
+
+	if (qmi_client_init(client_send, &c, 0) || qmi_client_init(client_send, &c, 32769) ||
+	    qmi_client_init(client_send, &c, 65536))
+		errx(1, "client: bad depth accepted");
+
+	client = qmi_client_init(client_send, &c, 4);
+	query = rt_query_alloc(0);
+	rt_query_set_id(query, 1);
+
+	/* Round trips across the wrap of the txn space, which skips txn 0 */
+	for (i = 0; i < WRAP_COUNT; i++) {
+		txn = rt_query_call(client, query, client_done, &c);
+		if (txn != (int)expected)
+			errx(1, "client: call %u got txn %d, expected %u", i, txn, expected);
+
+		if (client_respond(client, &c) || c.last_error || c.last_b != expected)
+			errx(1, "client: call %u not completed", i);
+
+		expected = expected == 0xffff ? 1 : expected + 1;
+	}
+
+	if (c.completed != WRAP_COUNT)
+		errx(1, "client: %u of %u completed", c.completed, WRAP_COUNT);
+
+	/* Fill the ring, then cancel all requests in flight */
+	for (i = 0; i < 4; i++) {
+		txn = rt_query_call(client, query, client_done, &c);
+		if (txn <= 0)
+			errx(1, "client: call %u into the ring failed: %d", i, txn);
+		txns[i] = txn;
+	}
+
+	if (rt_query_call(client, query, client_done, &c) != -EBUSY)
+		errx(1, "client: full ring accepted a call");
+
+	qmi_client_cancel(client, -ECONNRESET);
+	if (c.cancelled != 4 || c.last_error != -ECONNRESET)
+		errx(1, "client: %u of 4 cancelled", c.cancelled);
+
+	/* A late response to a cancelled request is not routed */
+	c.req[1] = txns[0];
+	c.req[2] = txns[0] >> 8;
+	if (client_respond(client, &c) != -ENOENT || c.completed != WRAP_COUNT)
+		errx(1, "client: response to a cancelled txn completed");
+
+	report = rt_report_alloc(0);
+	buf = rt_report_encode(report, &len);
+	if (rt_client_receive(client, buf, len, &ind, &c) || c.reports != 1)
+		errx(1, "client: indication not routed");
+	rt_report_free(report);
+
+	qmi_client_free(client);
+
+	/* The deepest ring holds a request for every slot, txn 0 excepted */
+	client = qmi_client_init(client_send, &c, 32768);
+	if (!client)
+		errx(1, "client: depth 32768 rejected");
+
+	for (i = 0; i < 32768; i++) {
+		if (rt_query_call(client, query, client_done, &c) <= 0)
+			errx(1, "client: call %u into the deepest ring failed", i);
+	}
+
+	if (rt_query_call(client, query, client_done, &c) != -EBUSY)
+		errx(1, "client: full deepest ring accepted a call");
+
+	c.cancelled = 0;
+	qmi_client_cancel(client, -ECONNRESET);
+	if (c.cancelled != 32768)
+		errx(1, "client: %u of 32768 cancelled", c.cancelled);
+
+	qmi_client_free(client);
+	rt_query_free(query);
+}
+
+struct server_ctx {
+	pthread_mutex_t lock;
+	uint8_t seen[SERVER_COUNT];
+	unsigned responses;
+	unsigned missing;
+	unsigned bad;
+};
+
+static int server_query(struct rt_query *query, struct rt_query_resp *resp, void *ctx)
+{
+	struct rt_pair result = {};
+	uint32_t id;
+
+	(void)ctx;
+
+	rt_query_get_id(query, &id);
+	result.b = (uint64_t)id * 2;
+
+	return rt_query_resp_set_result(resp, &result);
+}
+
+static const struct rt_server_ops server_ops = {
+	.query = server_query,
+};
+
+static int server_send(void **bufs, size_t *lens, size_t count, void *ctx)
+{
+	static const uint8_t missing[] = { 0x02, 0x04, 0x00, 1, 0, 0x11, 0 };
+	struct server_ctx *s = ctx;
+	struct rt_query_resp *resp;
+	struct rt_pair result;
+	uint8_t *buf;
+	unsigned txn;
+	size_t i;
+
+	pthread_mutex_lock(&s->lock);
+	for (i = 0; i < count; i++) {
+		buf = bufs[i];
+		txn = buf[1] | buf[2] << 8;
+		if (lens[i] < 7 || txn >= SERVER_COUNT || s->seen[txn]++) {
+			s->bad++;
+			continue;
+		}
+
+		/* Every tenth request lacks its id */
+		if (txn % 10 == 0) {
+			if (lens[i] != 7 + sizeof(missing) || memcmp(buf + 7, missing, sizeof(missing)))
+				s->bad++;
+			s->missing++;
+		} else {
+			resp = rt_query_resp_parse(buf, lens[i], &txn);
+			if (!resp || rt_query_resp_get_result(resp, &result) ||
+			    result.b != (uint64_t)txn * 2)
+				s->bad++;
+			if (resp)
+				rt_query_resp_free(resp);
+		}
+
+		s->responses++;
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	return 0;
+}
+
+static void test_server(void)
+{
+	struct server_ctx s = { .lock = PTHREAD_MUTEX_INITIALIZER };
+	struct qmi_server *server;
+	struct rt_query *query;
+	size_t len;
+	unsigned i;
+	void *buf;
+
+	server = qmi_server_init(4, rt_server_dispatch, &server_ops, NULL, server_send, &s);
+	if (!server)
+		errx(1, "server: init failed");
+
+	for (i = 0; i < SERVER_COUNT; i++) {
+		query = rt_query_alloc(i);
+		if (i % 10)
+			rt_query_set_id(query, i);
+
+		buf = rt_query_encode(query, &len);
+		if (qmi_server_submit(server, buf, len))
+			errx(1, "server: submit %u failed", i);
+		rt_query_free(query);
+	}
+
+	/* Freeing the server flushes the requests still queued */
+	qmi_server_free(server);
+
+	if (s.responses != SERVER_COUNT || s.missing != SERVER_COUNT / 10 || s.bad)
+		errx(1, "server: %u responses, %u missing arguments, %u bad",
+		     s.responses, s.missing, s.bad);
+}
+
+int main(void)
+{
+	test_stream();
+	test_replace();
+	test_batch();
+	test_diff();
+	test_presence();
+	test_client();
+	test_server();
+
+	return 0;
+}
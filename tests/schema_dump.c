@@ -0,0 +1,94 @@
+/*
+ * Print a binary schema descriptor, as loaded by qmi_schema.c, in .qmi like
+ * form. Every message is also resolved through qmi_schema_lookup().
+ */
+#include <err.h>
+#include <stdio.h>
+
+#include "../qmi_schema.h"
+
+static const char *type_names[] = {
+	[QMI_SCHEMA_U8] = "u8",
+	[QMI_SCHEMA_U16] = "u16",
+	[QMI_SCHEMA_U32] = "u32",
+	[QMI_SCHEMA_U64] = "u64",
+	[QMI_SCHEMA_STRING] = "string",
+};
+
+static const char *message_types[] = {
+	[0] = "request",
+	[2] = "response",
+	[4] = "indication",
+};
+
+static void dump_member(struct qmi_schema *schema, unsigned idx, int in_message)
+{
+	struct qmi_schema_member member;
+	struct qmi_schema_struct qs;
+	const char *type;
+
+	if (qmi_schema_get_member(schema, idx, &member) < 0)
+		errx(1, "invalid member %u", idx);
+
+	if (member.qmi_struct >= 0) {
+		qmi_schema_get_struct(schema, member.qmi_struct, &qs);
+		type = qs.name;
+	} else {
+		type = type_names[member.type];
+	}
+
+	printf("\t");
+	if (in_message)
+		printf("%s ", member.required ? "required" : "optional");
+	printf("%s %s", type, member.name);
+	if (member.array_size)
+		printf(member.array_fixed ? "[%u]" : "(%u)", member.array_size);
+	if (in_message)
+		printf(" = 0x%02x", member.id);
+	printf(";\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct qmi_schema_message msg;
+	struct qmi_schema_struct qs;
+	struct qmi_schema_const qc;
+	struct qmi_schema *schema;
+	unsigned i;
+	unsigned j;
+	int idx;
+
+	if (argc != 2)
+		errx(1, "usage: %s <descriptor>", argv[0]);
+
+	schema = qmi_schema_open(argv[1]);
+	if (!schema)
+		err(1, "failed to load %s", argv[1]);
+
+	printf("package %s;\n", qmi_schema_package(schema));
+
+	for (i = 0; qmi_schema_get_const(schema, i, &qc) == 0; i++)
+		printf("%sconst %s = %llu;\n", i ? "" : "\n", qc.name, qc.value);
+
+	for (i = 0; qmi_schema_get_struct(schema, i, &qs) == 0; i++) {
+		printf("\nstruct %s {\n", qs.name);
+		for (j = 0; j < qs.n_members; j++)
+			dump_member(schema, qs.first_member + j, 0);
+		printf("};\n");
+	}
+
+	for (i = 0; qmi_schema_get_message(schema, i, &msg) == 0; i++) {
+		idx = qmi_schema_lookup(schema, msg.msg_id, msg.type, NULL);
+		if (idx != (int)i)
+			errx(1, "lookup of %s returned %d", msg.name, idx);
+
+		printf("\n%s %s {\n", message_types[msg.type], msg.name);
+		for (j = 0; j < msg.n_members; j++)
+			dump_member(schema, msg.first_member + j, 1);
+		printf("} = 0x%x;\n", msg.msg_id);
+	}
+
+	qmi_schema_close(schema);
+
+	return 0;
+}
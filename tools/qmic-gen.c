@@ -0,0 +1,365 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../qmi_schema.h"
+
+/*
+ * Load generator, producing random but schema valid messages from a binary
+ * schema descriptor. Required members are always present and optional ones
+ * half of the time, arrays hold up to array_size elements and fixed arrays
+ * exactly array_size. Fixed numeric arrays go without a count prefix, while
+ * struct arrays are always counted, as the kernel's VAR_LEN_ARRAY. Messages
+ * are written as a pcap capture, readable by qmidecode, or sent as datagrams
+ * to a unix socket.
+ */
+
+#define PCAP_MAGIC_US		0xa1b2c3d4
+#define PCAP_LINKTYPE_USER0	147
+
+#define QMI_HEADER_SIZE		7
+#define QMI_MAX_LEN		(QMI_HEADER_SIZE + 65535)
+
+#define STRING_MAX_LEN		32
+
+struct gen {
+	struct qmi_schema *schema;
+	uint64_t rng;
+
+	uint8_t *buf;
+	size_t len;
+	bool overflow;
+};
+
+static uint64_t gen_random(struct gen *gen)
+{
+	/* xorshift64* */
+	gen->rng ^= gen->rng >> 12;
+	gen->rng ^= gen->rng << 25;
+	gen->rng ^= gen->rng >> 27;
+
+	return gen->rng * 2685821657736338717ULL;
+}
+
+static unsigned gen_below(struct gen *gen, unsigned n)
+{
+	return (gen_random(gen) >> 32) % n;
+}
+
+/* Messages outgrowing the buffer are flagged, rather than written */
+static uint8_t *gen_reserve(struct gen *gen, size_t len)
+{
+	uint8_t *ptr;
+
+	if (gen->overflow || len > QMI_MAX_LEN - gen->len) {
+		gen->overflow = true;
+		return NULL;
+	}
+
+	ptr = gen->buf + gen->len;
+	gen->len += len;
+
+	return ptr;
+}
+
+static void gen_put_le(struct gen *gen, uint64_t val, unsigned size)
+{
+	uint8_t *ptr = gen_reserve(gen, size);
+	unsigned i;
+
+	for (i = 0; ptr && i < size; i++)
+		ptr[i] = val >> (8 * i);
+}
+
+static void gen_string(struct gen *gen, unsigned max, unsigned len_size)
+{
+	unsigned len = gen_below(gen, max + 1);
+	uint8_t *ptr;
+	unsigned i;
+
+	gen_put_le(gen, len, len_size);
+	ptr = gen_reserve(gen, len);
+	for (i = 0; ptr && i < len; i++)
+		ptr[i] = 'a' + gen_below(gen, 26);
+}
+
+/*
+ * Structs are encoded packed, as the kernel's elem_info would, their strings
+ * behind a 2 byte length as the elem_len of char[256] exceeds 255
+ */
+static void gen_struct(struct gen *gen, unsigned idx)
+{
+	static const unsigned sizes[] = { 1, 2, 4, 8 };
+	struct qmi_schema_member member;
+	struct qmi_schema_struct qs;
+	unsigned i;
+
+	qmi_schema_get_struct(gen->schema, idx, &qs);
+	for (i = 0; i < qs.n_members; i++) {
+		qmi_schema_get_member(gen->schema, qs.first_member + i, &member);
+		if (member.type == QMI_SCHEMA_STRING)
+			gen_string(gen, STRING_MAX_LEN, 2);
+		else
+			gen_put_le(gen, gen_random(gen), sizes[member.type]);
+	}
+}
+
+static void gen_element(struct gen *gen, struct qmi_schema_member *member)
+{
+	static const unsigned sizes[] = { 1, 2, 4, 8 };
+
+	switch (member->type) {
+	case QMI_SCHEMA_STRUCT:
+		gen_struct(gen, member->qmi_struct);
+		break;
+	case QMI_SCHEMA_STRING:
+		gen_string(gen, STRING_MAX_LEN, 0);
+		break;
+	default:
+		gen_put_le(gen, gen_random(gen), sizes[member->type]);
+		break;
+	}
+}
+
+static void gen_member(struct gen *gen, struct qmi_schema_member *member)
+{
+	uint8_t *hdr;
+	size_t start;
+	unsigned count;
+	unsigned i;
+
+	hdr = gen_reserve(gen, 3);
+	if (!hdr)
+		return;
+	start = gen->len;
+
+	if (member->type == QMI_SCHEMA_STRING) {
+		gen_string(gen, member->array_size ? member->array_size : STRING_MAX_LEN, 0);
+	} else if (member->array_fixed && member->type != QMI_SCHEMA_STRUCT) {
+		for (i = 0; i < member->array_size; i++)
+			gen_element(gen, member);
+	} else if (member->array_size) {
+		count = member->array_fixed ? member->array_size : gen_below(gen, member->array_size + 1);
+		gen_put_le(gen, count, member->array_size >= 256 ? 2 : 1);
+		for (i = 0; i < count; i++)
+			gen_element(gen, member);
+	} else {
+		gen_element(gen, member);
+	}
+
+	if (gen->len - start > UINT16_MAX)
+		gen->overflow = true;
+
+	hdr[0] = member->id;
+	hdr[1] = gen->len - start;
+	hdr[2] = (gen->len - start) >> 8;
+}
+
+/* Returns the message length, or 0 when it would not fit a QMI message */
+static size_t gen_message(struct gen *gen, struct qmi_schema_message *msg, unsigned txn)
+{
+	struct qmi_schema_member member;
+	unsigned i;
+
+	gen->len = QMI_HEADER_SIZE;
+	gen->overflow = false;
+
+	for (i = 0; i < msg->n_members; i++) {
+		qmi_schema_get_member(gen->schema, msg->first_member + i, &member);
+		if (!member.required && gen_below(gen, 2))
+			continue;
+
+		gen_member(gen, &member);
+		if (gen->overflow)
+			return 0;
+	}
+
+	gen->buf[0] = msg->type;
+	gen->buf[1] = txn;
+	gen->buf[2] = txn >> 8;
+	gen->buf[3] = msg->msg_id;
+	gen->buf[4] = msg->msg_id >> 8;
+	gen->buf[5] = gen->len - QMI_HEADER_SIZE;
+	gen->buf[6] = (gen->len - QMI_HEADER_SIZE) >> 8;
+
+	return gen->len;
+}
+
+static void write_pcap_header(FILE *fp)
+{
+	uint32_t hdr[6] = { PCAP_MAGIC_US, 2 | 4 << 16, 0, 0, 65535 + QMI_HEADER_SIZE,
+			    PCAP_LINKTYPE_USER0 };
+
+	fwrite(hdr, sizeof(hdr), 1, fp);
+}
+
+static void write_pcap_record(FILE *fp, const void *buf, size_t len, unsigned long seq)
+{
+	uint32_t rec[4] = { seq / 1000000, seq % 1000000, len, len };
+
+	fwrite(rec, sizeof(rec), 1, fp);
+	fwrite(buf, len, 1, fp);
+}
+
+static int open_socket(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+		errx(1, "socket path too long");
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd < 0)
+		err(1, "failed to create socket");
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		err(1, "failed to connect to %s", path);
+
+	return fd;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(void)
+{
+	extern const char *__progname;
+
+	fprintf(stderr, "Usage: %s -s schema.qsd [-m message]... [-n count] [-S seed] [-o capture.pcap | -u socket]\n",
+		__progname);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct qmi_schema_message *msgs = NULL;
+	struct qmi_schema_message msg;
+	const char *socket_path = NULL;
+	const char *output = NULL;
+	const char **names = NULL;
+	unsigned long count = 1000000;
+	unsigned long skipped = 0;
+	unsigned long bytes = 0;
+	unsigned long i;
+	struct gen gen = { .rng = 1 };
+	unsigned n_names = 0;
+	unsigned n_msgs = 0;
+	FILE *fp = NULL;
+	double start;
+	size_t len;
+	unsigned j;
+	int fd = -1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:n:o:s:S:u:")) != -1) {
+		switch (opt) {
+		case 'm':
+			names = realloc(names, (n_names + 1) * sizeof(*names));
+			if (!names)
+				err(1, "failed to allocate message names");
+			names[n_names++] = optarg;
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 's':
+			gen.schema = qmi_schema_open(optarg);
+			if (!gen.schema)
+				err(1, "failed to load %s", optarg);
+			break;
+		case 'S':
+			gen.rng = strtoull(optarg, NULL, 0) | 1;
+			break;
+		case 'u':
+			socket_path = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (!gen.schema || optind != argc || (output && socket_path))
+		usage();
+
+	for (j = 0; qmi_schema_get_message(gen.schema, j, &msg) == 0; j++) {
+		for (i = 0; i < n_names; i++) {
+			if (!strcmp(names[i], msg.name))
+				break;
+		}
+		if (n_names && i == n_names)
+			continue;
+
+		msgs = realloc(msgs, (n_msgs + 1) * sizeof(*msgs));
+		if (!msgs)
+			err(1, "failed to allocate messages");
+		msgs[n_msgs++] = msg;
+	}
+
+	if (!n_msgs)
+		errx(1, "no messages to generate");
+
+	gen.buf = malloc(QMI_MAX_LEN);
+	if (!gen.buf)
+		err(1, "failed to allocate message buffer");
+
+	if (socket_path) {
+		fd = open_socket(socket_path);
+	} else {
+		fp = output ? fopen(output, "wb") : stdout;
+		if (!fp)
+			err(1, "failed to open %s", output);
+		setvbuf(fp, NULL, _IOFBF, 1 << 20);
+		write_pcap_header(fp);
+	}
+
+	start = now();
+	for (i = 0; i < count; i++) {
+		len = gen_message(&gen, &msgs[gen_below(&gen, n_msgs)], i);
+		if (!len) {
+			skipped++;
+			continue;
+		}
+
+		if (fp)
+			write_pcap_record(fp, gen.buf, len, i);
+		else if (send(fd, gen.buf, len, 0) < 0)
+			err(1, "failed to send message");
+
+		bytes += len;
+	}
+
+	if (fp && fflush(fp))
+		err(1, "failed to write messages");
+
+	fprintf(stderr, "%lu messages, %lu bytes in %.3f s, %lu too large\n",
+		count - skipped, bytes, now() - start, skipped);
+
+	if (fp && fp != stdout)
+		fclose(fp);
+	if (fd >= 0)
+		close(fd);
+	free(gen.buf);
+	free(msgs);
+	free(names);
+	qmi_schema_close(gen.schema);
+
+	return 0;
+}
@@ -0,0 +1,571 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <err.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../qmi_schema.h"
+
+/*
+ * Offline decoder for pcap captures of QMI messages. The capture is mapped
+ * and split into equal byte ranges, each thread finds the first record
+ * boundary in its range and decodes from there into private statistics that
+ * are merged at the end. Schemas are only consulted for names, when
+ * reporting or printing messages.
+ */
+
+#define PCAP_MAGIC_US		0xa1b2c3d4
+#define PCAP_MAGIC_NS		0xa1b23c4d
+#define PCAP_HEADER_SIZE	24
+#define PCAP_RECORD_SIZE	16
+
+/* Consecutive plausible record headers taken as a record boundary */
+#define RESYNC_RECORDS		8
+
+#define QMI_HEADER_SIZE		7
+#define QMI_TLV_HEADER_SIZE	3
+
+/* msg_id and type (0, 2 or 4) folded into a dense index */
+#define MSG_KEYS		(65536 * 3)
+
+struct msg_stats {
+	unsigned long count;
+	unsigned long bytes;
+	unsigned long malformed;
+	unsigned long tlv_count[256];
+	unsigned long tlv_bytes[256];
+};
+
+struct worker {
+	pthread_t thread;
+
+	/* Range of the capture whose records this worker decodes */
+	const uint8_t *begin;
+	const uint8_t *end;
+
+	/* First record decoded and where the walk stopped, past end */
+	const uint8_t *start;
+	const uint8_t *stop;
+	bool truncated;
+
+	struct msg_stats **msgs;
+	unsigned long packets;
+	unsigned long malformed;
+	unsigned long short_packets;
+};
+
+static struct qmi_schema **schemas;
+static unsigned n_schemas;
+
+static const uint8_t *capture_end;
+static uint32_t snaplen;
+static uint32_t frac_limit;
+
+static bool swapped;
+static size_t link_offset;
+static bool verbose;
+
+static const char *message_types[] = {
+	[0] = "request",
+	[2] = "response",
+	[4] = "indication",
+};
+
+static uint32_t pcap_u32(const uint8_t *ptr)
+{
+	uint32_t val;
+
+	memcpy(&val, ptr, sizeof(val));
+
+	return swapped ? __builtin_bswap32(val) : val;
+}
+
+static unsigned qmi_u16(const uint8_t *ptr)
+{
+	return ptr[0] | ptr[1] << 8;
+}
+
+static int schema_lookup(unsigned msg_id, unsigned type,
+			 struct qmi_schema **schema, struct qmi_schema_message *msg)
+{
+	unsigned i;
+
+	for (i = 0; i < n_schemas; i++) {
+		if (qmi_schema_lookup(schemas[i], msg_id, type, msg) >= 0) {
+			*schema = schemas[i];
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static const char *schema_member(struct qmi_schema *schema,
+				 struct qmi_schema_message *msg, unsigned id)
+{
+	struct qmi_schema_member member;
+	unsigned i;
+
+	for (i = 0; i < msg->n_members; i++) {
+		qmi_schema_get_member(schema, msg->first_member + i, &member);
+		if (member.id == id)
+			return member.name;
+	}
+
+	return NULL;
+}
+
+static void print_message(const uint8_t *buf, size_t len)
+{
+	struct qmi_schema_message msg;
+	struct qmi_schema *schema;
+	const char *name;
+	unsigned msg_id = qmi_u16(buf + 3);
+	unsigned type = buf[0];
+	size_t offset = QMI_HEADER_SIZE;
+	bool known;
+
+	known = !schema_lookup(msg_id, type, &schema, &msg);
+	if (known)
+		printf("%s txn %u", msg.name, qmi_u16(buf + 1));
+	else
+		printf("msg 0x%04x type %u txn %u", msg_id, type, qmi_u16(buf + 1));
+
+	while (offset < len) {
+		name = known ? schema_member(schema, &msg, buf[offset]) : NULL;
+		if (name)
+			printf(" %s(%u)", name, qmi_u16(buf + offset + 1));
+		else
+			printf(" 0x%02x(%u)", buf[offset], qmi_u16(buf + offset + 1));
+
+		offset += QMI_TLV_HEADER_SIZE + qmi_u16(buf + offset + 1);
+	}
+	printf("\n");
+}
+
+static struct msg_stats *worker_stats(struct worker *worker, unsigned key)
+{
+	struct msg_stats *stats = worker->msgs[key];
+
+	if (!stats) {
+		stats = calloc(1, sizeof(*stats));
+		if (!stats)
+			err(1, "failed to allocate statistics");
+		worker->msgs[key] = stats;
+	}
+
+	return stats;
+}
+
+static void decode_message(struct worker *worker, const uint8_t *buf, size_t len)
+{
+	struct msg_stats *stats;
+	size_t msg_len;
+	size_t offset;
+	size_t tlv_len;
+	unsigned type;
+
+	if (len < QMI_HEADER_SIZE) {
+		worker->short_packets++;
+		return;
+	}
+
+	type = buf[0];
+	if (type > 4 || type & 1) {
+		worker->malformed++;
+		return;
+	}
+
+	stats = worker_stats(worker, qmi_u16(buf + 3) * 3 + type / 2);
+	stats->count++;
+	stats->bytes += len;
+
+	msg_len = qmi_u16(buf + 5);
+	if (msg_len > len - QMI_HEADER_SIZE) {
+		stats->malformed++;
+		return;
+	}
+
+	/* First validate the TLV chain, so partial messages are not counted */
+	len = QMI_HEADER_SIZE + msg_len;
+	for (offset = QMI_HEADER_SIZE; offset < len; offset += tlv_len) {
+		if (len - offset < QMI_TLV_HEADER_SIZE) {
+			stats->malformed++;
+			return;
+		}
+
+		tlv_len = QMI_TLV_HEADER_SIZE + qmi_u16(buf + offset + 1);
+		if (tlv_len > len - offset) {
+			stats->malformed++;
+			return;
+		}
+	}
+
+	for (offset = QMI_HEADER_SIZE; offset < len; offset += tlv_len) {
+		tlv_len = QMI_TLV_HEADER_SIZE + qmi_u16(buf + offset + 1);
+		stats->tlv_count[buf[offset]]++;
+		stats->tlv_bytes[buf[offset]] += tlv_len - QMI_TLV_HEADER_SIZE;
+	}
+
+	if (verbose)
+		print_message(buf, len);
+}
+
+/*
+ * Whether a record could start at ptr: captured in full, with a length
+ * within the snapshot length and the original packet length, a valid
+ * fraction of second and a QMI message of a known type filling it.
+ */
+static bool record_plausible(const uint8_t *ptr)
+{
+	const uint8_t *msg = ptr + PCAP_RECORD_SIZE + link_offset;
+	size_t caplen;
+
+	if (capture_end - ptr < PCAP_RECORD_SIZE)
+		return false;
+
+	caplen = pcap_u32(ptr + 8);
+	if (pcap_u32(ptr + 4) >= frac_limit || caplen > snaplen ||
+	    caplen > pcap_u32(ptr + 12) ||
+	    caplen > (size_t)(capture_end - ptr) - PCAP_RECORD_SIZE ||
+	    caplen < link_offset + QMI_HEADER_SIZE)
+		return false;
+
+	return msg[0] <= 4 && !(msg[0] & 1) &&
+	       qmi_u16(msg + 5) == caplen - link_offset - QMI_HEADER_SIZE;
+}
+
+/*
+ * Records carry no sync marker, so a worker takes the first offset in its
+ * range that starts a chain of plausible record headers, up to the end of
+ * the capture, as its first record.
+ */
+static const uint8_t *record_resync(const uint8_t *ptr, const uint8_t *end)
+{
+	const uint8_t *next;
+	unsigned i;
+
+	for (; ptr < end; ptr++) {
+		next = ptr;
+		for (i = 0; i < RESYNC_RECORDS && next != capture_end; i++) {
+			if (!record_plausible(next))
+				break;
+
+			next += PCAP_RECORD_SIZE + pcap_u32(next + 8);
+		}
+
+		if (i == RESYNC_RECORDS || next == capture_end)
+			return ptr;
+	}
+
+	return NULL;
+}
+
+/* Decodes the records from start up to the first one past end */
+static void worker_walk(struct worker *worker)
+{
+	const uint8_t *ptr = worker->start;
+	size_t caplen;
+
+	while (ptr < worker->end) {
+		if (capture_end - ptr < PCAP_RECORD_SIZE) {
+			worker->truncated = true;
+			break;
+		}
+
+		caplen = pcap_u32(ptr + 8);
+		if (caplen > (size_t)(capture_end - ptr) - PCAP_RECORD_SIZE) {
+			worker->truncated = true;
+			break;
+		}
+
+		ptr += PCAP_RECORD_SIZE;
+
+		worker->packets++;
+		if (caplen < link_offset)
+			worker->short_packets++;
+		else
+			decode_message(worker, ptr + link_offset, caplen - link_offset);
+
+		ptr += caplen;
+	}
+
+	worker->stop = ptr;
+}
+
+static void worker_reset(struct worker *worker)
+{
+	unsigned key;
+
+	for (key = 0; key < MSG_KEYS; key++) {
+		free(worker->msgs[key]);
+		worker->msgs[key] = NULL;
+	}
+
+	worker->packets = 0;
+	worker->malformed = 0;
+	worker->short_packets = 0;
+	worker->truncated = false;
+}
+
+static void *worker_run(void *data)
+{
+	struct worker *worker = data;
+	uintptr_t page;
+
+	page = (uintptr_t)worker->begin & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+	madvise((void *)page, (uintptr_t)worker->end - page, MADV_SEQUENTIAL);
+
+	/* The first worker starts right after the file header */
+	if (!worker->start)
+		worker->start = record_resync(worker->begin, worker->end);
+
+	if (worker->start)
+		worker_walk(worker);
+
+	return NULL;
+}
+
+/*
+ * A worker may have synchronized on a false record boundary, so its results
+ * are only kept if it started where the previous walk stopped. Otherwise its
+ * range is walked again from there, leaving the outcome identical to a
+ * serial walk. Ranges after a truncated record are dropped, the rest of the
+ * capture counts as trailing bytes. Returns the number of workers kept.
+ */
+static unsigned join_chunks(struct worker *workers, unsigned n_workers,
+			    unsigned long *trailing)
+{
+	unsigned i;
+
+	for (i = 1; i < n_workers; i++) {
+		if (workers[i - 1].truncated)
+			break;
+
+		if (workers[i].start == workers[i - 1].stop)
+			continue;
+
+		worker_reset(&workers[i]);
+		workers[i].start = workers[i - 1].stop;
+		worker_walk(&workers[i]);
+	}
+
+	*trailing = capture_end - workers[i - 1].stop;
+
+	return i;
+}
+
+static void merge_stats(struct worker *into, struct worker *from)
+{
+	struct msg_stats *dst;
+	struct msg_stats *src;
+	unsigned key;
+	unsigned i;
+
+	into->packets += from->packets;
+	into->malformed += from->malformed;
+	into->short_packets += from->short_packets;
+
+	for (key = 0; key < MSG_KEYS; key++) {
+		src = from->msgs[key];
+		if (!src)
+			continue;
+
+		dst = worker_stats(into, key);
+		dst->count += src->count;
+		dst->bytes += src->bytes;
+		dst->malformed += src->malformed;
+		for (i = 0; i < 256; i++) {
+			dst->tlv_count[i] += src->tlv_count[i];
+			dst->tlv_bytes[i] += src->tlv_bytes[i];
+		}
+		free(src);
+	}
+	free(from->msgs);
+}
+
+static void report(struct worker *worker, unsigned long trailing)
+{
+	struct qmi_schema_message msg;
+	struct qmi_schema *schema;
+	struct msg_stats *stats;
+	const char *name;
+	unsigned msg_id;
+	unsigned type;
+	unsigned key;
+	bool known;
+	unsigned i;
+
+	printf("packets %lu, short %lu, malformed %lu, trailing bytes %lu\n\n",
+	       worker->packets, worker->short_packets, worker->malformed, trailing);
+
+	printf("%-6s %-10s %-32s %12s %14s %10s\n",
+	       "msg_id", "type", "name", "count", "bytes", "malformed");
+
+	for (key = 0; key < MSG_KEYS; key++) {
+		stats = worker->msgs[key];
+		if (!stats)
+			continue;
+
+		msg_id = key / 3;
+		type = key % 3 * 2;
+		known = !schema_lookup(msg_id, type, &schema, &msg);
+
+		printf("0x%04x %-10s %-32s %12lu %14lu %10lu\n",
+		       msg_id, message_types[type], known ? msg.name : "-",
+		       stats->count, stats->bytes, stats->malformed);
+
+		for (i = 0; i < 256; i++) {
+			if (!stats->tlv_count[i])
+				continue;
+
+			name = known ? schema_member(schema, &msg, i) : NULL;
+			printf("  0x%02x   %-43s %12lu %14lu\n", i, name ? name : "-",
+			       stats->tlv_count[i], stats->tlv_bytes[i]);
+		}
+	}
+}
+
+static void usage(void)
+{
+	extern const char *__progname;
+
+	fprintf(stderr, "Usage: %s [-v] [-j threads] [-o offset] [-s schema.qsd]... capture.pcap\n",
+		__progname);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned long trailing;
+	struct worker *workers;
+	struct stat sb;
+	unsigned n_chunks;
+	uint32_t magic;
+	uint8_t *buf;
+	size_t chunk;
+	size_t size;
+	unsigned i;
+	int opt;
+	int fd;
+
+	while ((opt = getopt(argc, argv, "j:o:s:v")) != -1) {
+		switch (opt) {
+		case 'j':
+			n_workers = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			link_offset = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			schemas = realloc(schemas, (n_schemas + 1) * sizeof(*schemas));
+			if (!schemas)
+				err(1, "failed to allocate schemas");
+			schemas[n_schemas] = qmi_schema_open(optarg);
+			if (!schemas[n_schemas])
+				err(1, "failed to load %s", optarg);
+			n_schemas++;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (optind != argc - 1)
+		usage();
+
+	/* Printed messages must come out in capture order */
+	if (verbose || !n_workers)
+		n_workers = 1;
+
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0)
+		err(1, "failed to open %s", argv[optind]);
+
+	if (fstat(fd, &sb) < 0)
+		err(1, "failed to stat %s", argv[optind]);
+
+	if (sb.st_size < PCAP_HEADER_SIZE)
+		errx(1, "%s: not a pcap file", argv[optind]);
+
+	buf = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf == MAP_FAILED)
+		err(1, "failed to map %s", argv[optind]);
+	close(fd);
+
+	memcpy(&magic, buf, sizeof(magic));
+	if (magic == __builtin_bswap32(PCAP_MAGIC_US) ||
+	    magic == __builtin_bswap32(PCAP_MAGIC_NS))
+		swapped = true;
+	else if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS)
+		errx(1, "%s: not a pcap file", argv[optind]);
+
+	frac_limit = magic == PCAP_MAGIC_NS || magic == __builtin_bswap32(PCAP_MAGIC_NS) ?
+		     1000000000 : 1000000;
+	snaplen = pcap_u32(buf + 16);
+	if (!snaplen)
+		snaplen = UINT32_MAX;
+
+	workers = calloc(n_workers, sizeof(*workers));
+	if (!workers)
+		err(1, "failed to allocate workers");
+
+	size = sb.st_size - PCAP_HEADER_SIZE;
+	chunk = size / n_workers + 1;
+	capture_end = buf + sb.st_size;
+
+	for (i = 0; i < n_workers; i++) {
+		workers[i].begin = buf + PCAP_HEADER_SIZE + (i * chunk < size ? i * chunk : size);
+		workers[i].end = i + 1 < n_workers && (i + 1) * chunk < size ?
+				 workers[i].begin + chunk : capture_end;
+	}
+	workers[0].start = workers[0].begin;
+
+	for (i = 0; i < n_workers; i++) {
+		workers[i].msgs = calloc(MSG_KEYS, sizeof(*workers[i].msgs));
+		if (!workers[i].msgs)
+			err(1, "failed to allocate statistics");
+
+		if (pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]))
+			errx(1, "failed to start worker");
+	}
+
+	for (i = 0; i < n_workers; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	n_chunks = join_chunks(workers, n_workers, &trailing);
+
+	for (i = 1; i < n_workers; i++) {
+		if (i < n_chunks) {
+			merge_stats(&workers[0], &workers[i]);
+		} else {
+			worker_reset(&workers[i]);
+			free(workers[i].msgs);
+		}
+	}
+
+	report(&workers[0], trailing);
+
+	for (i = 0; i < MSG_KEYS; i++)
+		free(workers[0].msgs[i]);
+	free(workers[0].msgs);
+	free(workers);
+
+	for (i = 0; i < n_schemas; i++)
+		qmi_schema_close(schemas[i]);
+	free(schemas);
+
+	munmap(buf, sb.st_size);
+
+	return 0;
+}